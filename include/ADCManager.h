@@ -1,88 +1,176 @@
 // ADCManager.h
-// Manages ESP32 onboard ADC for O2 and Volume sensors
+// Manages ESP32 onboard ADC for the analog sensor channels (SensorChannels.h)
 // Handles calibration, filtering, and conversion to physical units
+// Conversions use 4096-entry lookup tables rebuilt when calibration changes
+// Optional high-rate acquisition task with per-channel timestamps and
+// decimation to a volume stream and to values aligned with CO2 packets
 
 #ifndef ADC_MANAGER_H
 #define ADC_MANAGER_H
 
 #include <Arduino.h>
+#include <atomic>
 #include <esp_adc_cal.h>
-#include "MaCO2Parser.h"  // For CO2Data structure
+#include <freertos/semphr.h>
+#include "MaCO2Parser.h"      // For CO2Data structure
+#include "ADCSampleSource.h"
+#include "SensorBank.h"
+#include "CalibrationStore.h"
+#include "LockFreeRing.h"
+
+// One acquisition cycle (every channel, each with its own timestamp)
+struct ADCSample {
+    uint32_t t_us[SENSOR_COUNT];    // micros() when each channel was converted
+    uint16_t raw[SENSOR_COUNT];     // 12-bit count << ADC_FRAC_BITS
+};
+
+// Measured noise per channel (over NOISE_WINDOW acquisition samples)
+struct ADCNoiseStats {
+    float noise_lsb;        // RMS noise in 12-bit LSB
+    float noise_mv;         // RMS noise in mV
+    float enob;             // Effective number of bits (full scale / noise)
+};
+
+// Decimated high-rate volume output
+struct VolumeSample {
+    uint32_t t_us;          // Center timestamp of the decimation block
+    float volume_ml;
+};
 
 class ADCManager {
 public:
-    ADCManager(uint8_t o2_pin, uint8_t vol_pin);
+    ADCManager();
     
     // Initialize ADC with calibration
     bool begin();
     
     // Read and update ADC values in CO2Data structure
+    // With acquisition running, uses the mean of all samples since the
+    // previous call (aligned to the CO2 packet); otherwise reads once.
     void update(CO2Data& data);
     
-    // Set calibration parameters for O2 sensor
-    // voltage_at_0_percent: voltage reading at 0% O2
-    // voltage_at_100_percent: voltage reading at 100% O2 (typically air = 20.9%)
-    void setO2Calibration(float voltage_at_0_percent, float voltage_at_100_percent);
+    // Start/stop the high-rate acquisition task (sample_rate_hz: 200-1000).
+    // stopAcquisition() returns once the task has left its loop.
+    bool startAcquisition(uint16_t sample_rate_hz = 500);
+    void stopAcquisition();
+    bool isAcquiring() const { return _acqTask != nullptr; }
+    uint16_t getSampleRate() const { return _sampleRateHz; }
+    
+    // Drain the acquisition ring (call every loop iteration)
+    void poll();
+    
+    // Decimated volume stream (rate = sample rate / factor)
+    void setVolumeDecimation(uint8_t factor);
+    uint16_t readVolumeStream(VolumeSample* out, uint16_t max_samples);
+    
+    // Replace the sample source (e.g. synthetic generator); nullptr restores
+    // direct pin reads. Call while acquisition is stopped.
+    void setSampleSource(ADCSampleSource* source);
+    
+    // Acquisition statistics
+    uint32_t getSampleCount() const { return _sampleCount; }
+    uint32_t getOverrunCount() const { return _acqRing.overruns(); }
+    uint32_t getCycleUs() const { return _acqCycleUs; }        // Last conversion cycle
+    uint32_t getCycleMaxUs() const { return _acqCycleMaxUs; }
+    
+    // Oversample-and-decimate: factor 4-256 (rounded down to a power of two)
+    // gives log2(factor)/2 extra bits; 1 disables. Dither randomizes the
+    // discarded bits. Call while acquisition is stopped.
+    void setOversampling(uint16_t factor, bool dither = false);
+    uint16_t getOversampling() const { return 1 << _osLog2; }
     
-    // Set calibration parameters for volume sensor
-    // ml_per_volt: conversion factor (mL per volt)
-    // offset_ml: offset in mL (reading at 0V)
-    void setVolumeCalibration(float ml_per_volt, float offset_ml);
+    // Noise floor and ENOB, measured while acquisition runs
+    const ADCNoiseStats& getNoiseStats(uint8_t channel) const { return _noise[channel]; }
     
-    // Get raw ADC readings (for diagnostics)
-    uint16_t getO2Raw() const { return _o2_raw; }
-    uint16_t getVolRaw() const { return _vol_raw; }
+    // Straight-line calibration through (v0, y0) and (v1, y1), e.g.
+    // setLinearCalibration(SENSOR_O2, 0.0, 0.0, 1.0, 100.0) for a 0-1 V O2 cell
+    void setLinearCalibration(uint8_t channel, float v0, float y0, float v1, float y1);
     
-    // Get voltages (for diagnostics)
-    float getO2Voltage() const { return _o2_voltage; }
-    float getVolVoltage() const { return _vol_voltage; }
+    // Multi-point calibration (voltage -> value), up to 16 points per channel
+    bool setCalibrationCurve(uint8_t channel, const CalPoint* points, uint8_t count,
+                             CalibrationMode mode = CAL_PIECEWISE_LINEAR);
     
-    // Enable/disable moving average filtering
+    // Apply a stored profile (channels without points keep their calibration)
+    bool applyProfile(const CalibrationProfile& profile);
+    
+    // Current calibration of every channel as a profile for serial
+    bool getProfile(const char* serial, CalibrationProfile& profile) const;
+    
+    // Raw ADC readings (12-bit, filtered) and voltages, for diagnostics
+    uint16_t getRaw(uint8_t channel) const { return _raw[channel]; }
+    float getVoltage(uint8_t channel) const { return _voltage[channel]; }
+    
+    // Enable/disable filtering
     void setFilterEnabled(bool enabled) { _filterEnabled = enabled; }
+    // Moving average window (1..ADC_FILTER_MAX_WINDOW samples)
     void setFilterSize(uint8_t size);
     
 private:
-    // Pin assignments
-    uint8_t _o2Pin;
-    uint8_t _volPin;
+    // Sample source (nullptr = read the pins directly)
+    uint8_t _pins[SENSOR_COUNT];
+    ADCSampleSource* _source;
+    
+    // Acquisition task -> loop() ring (single producer, single consumer)
+    static const uint16_t ACQ_RING_SIZE = 256;  // 256 ms at 1 kHz
+    SPSCRing<ADCSample, ACQ_RING_SIZE> _acqRing;
+    std::atomic<bool> _acqStop;
+    TaskHandle_t _acqTask;
+    SemaphoreHandle_t _acqDone;     // Given by the task right before it deletes itself
+    static const uint32_t ACQ_STOP_TIMEOUT_MS = 1000;
+    uint16_t _sampleRateHz;
+    uint32_t _sampleCount;
+    
+    // Packet-aligned accumulation (since last update())
+    uint32_t _pktSum[SENSOR_COUNT];
+    uint16_t _pktCount;
+    
+    // Volume stream decimation
+    static const uint16_t VOL_STREAM_SIZE = 128;
+    VolumeSample _volStream[VOL_STREAM_SIZE];
+    uint16_t _volStreamHead;
+    uint16_t _volStreamCount;
+    uint8_t _volDecimation;
+    uint32_t _decVolSum;
+    uint32_t _decStartUs;
+    uint8_t _decCount;
+    
+    ADCSample _lastSample;      // Most recent sample drained from the ring
+    
+    // Oversampling
+    uint8_t _osLog2;            // log2(factor), 0 = off
+    bool _dither;
+    uint32_t _ditherState;      // xorshift32
+    volatile uint32_t _acqCycleUs;
+    volatile uint32_t _acqCycleMaxUs;
+    
+    // Noise measurement (first-difference variance)
+    static const uint16_t NOISE_WINDOW = 256;
+    uint16_t _noiseCount;
+    uint64_t _noiseSumSq[SENSOR_COUNT];
+    uint16_t _noisePrev[SENSOR_COUNT];
+    ADCNoiseStats _noise[SENSOR_COUNT];
     
     // ADC calibration
     esp_adc_cal_characteristics_t _adcChars;
     
     // Current readings
-    uint16_t _o2_raw;
-    uint16_t _vol_raw;
-    float _o2_voltage;
-    float _vol_voltage;
-    
-    // Calibration parameters
-    struct {
-        float v_at_0_percent;
-        float v_at_100_percent;
-    } _o2Cal;
-    
-    struct {
-        float ml_per_volt;
-        float offset_ml;
-    } _volCal;
-    
-    // Moving average filter
+    uint16_t _raw[SENSOR_COUNT];
+    float _voltage[SENSOR_COUNT];
+    
+    // Per-channel filter, calibration curve and lookup tables
+    bool _adcCharacterized;
+    uint16_t _mvLut[ADC_LUT_SIZE];      // Calibrated ADC voltage (mV), shared
+    SensorBankAll _bank;
     bool _filterEnabled;
     uint8_t _filterSize;
-    uint16_t* _o2FilterBuffer;
-    uint16_t* _volFilterBuffer;
-    uint8_t _filterIndex;
     
     // Helper functions
-    uint16_t readADC(uint8_t pin);
-    float rawToVoltage(uint16_t raw);
-    float voltageToO2Percent(float voltage);
-    float voltageToVolume(float voltage);
-    uint16_t applyFilter(uint16_t* buffer, uint16_t newValue);
-    
-    // Scale ADC readings to match PIC format for LabVIEW compatibility
-    uint16_t scaleToPIC_AN0(uint16_t raw);  // 12-bit to 16-bit (left-justified)
-    uint16_t scaleToPIC_AN1(uint16_t raw);  // 12-bit to 10-bit (right-justified)
+    uint16_t readADC(uint8_t channel);
+    void consumeSample(const ADCSample& sample);
+    void updateNoiseStats(const ADCSample& sample);
+    void resetNoiseStats();
+    static void acquisitionTask(void* arg);
+    void buildTables();
 };
 
 #endif // ADC_MANAGER_H
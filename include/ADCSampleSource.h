@@ -0,0 +1,20 @@
+// ADCSampleSource.h
+// Source of raw ADC counts for ADCManager
+// By default ADCManager reads the sensor pins directly; a synthetic
+// generator can be substituted (setSampleSource) to drive the pipeline
+// without sensors
+
+#ifndef ADC_SAMPLE_SOURCE_H
+#define ADC_SAMPLE_SOURCE_H
+
+#include <stdint.h>
+
+class ADCSampleSource {
+public:
+    virtual ~ADCSampleSource() {}
+
+    // Return one raw 12-bit reading (0-4095) of a channel (index in Sensors)
+    virtual uint16_t read(uint8_t channel) = 0;
+};
+
+#endif // ADC_SAMPLE_SOURCE_H
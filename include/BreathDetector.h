@@ -0,0 +1,111 @@
+// BreathDetector.h
+// Incremental breath-by-breath capnography engine
+// Segments the CO2 waveform into inspiration/expiration in O(1) per sample
+// using fixed-point envelope tracking with hysteresis (no Arduino dependencies)
+
+#ifndef BREATH_DETECTOR_H
+#define BREATH_DETECTOR_H
+
+#include <stdint.h>
+
+// Metrics of one completed breath
+struct BreathMetrics {
+    uint16_t etco2_x10;         // End-tidal CO2 (mmHg x 10), plateau peak
+    uint16_t fico2_x10;         // Inspired CO2 (mmHg x 10), inspiratory minimum
+    uint16_t ti_ms;             // Inspiratory time
+    uint16_t te_ms;             // Expiratory time
+    int16_t phase3_slope;       // Alveolar plateau slope (mmHg/s x 100)
+    uint16_t rr_x10;            // Waveform-derived RR (breaths/min x 10)
+    uint32_t breath_count;      // Breaths detected since reset
+    uint32_t end_time;          // Timestamp (ms) at end of expiration
+};
+
+class BreathDetector {
+public:
+    BreathDetector();
+
+    // Feed one waveform sample (mmHg) with its timestamp (ms).
+    // Returns true when a breath was completed by this sample.
+    bool addSample(uint8_t co2_mmhg, uint32_t timestamp_ms);
+
+    // Last completed breath (zeroed until the first breath)
+    const BreathMetrics& getLastBreath() const { return _last; }
+
+    // End-tidal CO2 in whole mmHg (rounded), 0 until first breath / after apnea
+    uint8_t getEtCO2() const { return (uint8_t)((_last.etco2_x10 + 5) / 10); }
+
+    // True while in the expiratory (high CO2) phase
+    bool isExpiring() const { return _phase == PHASE_EXPIRATION; }
+
+    // True if no breath has completed within APNEA_MS
+    bool isApnea() const { return _apnea; }
+
+    void reset();
+
+    // Tuning constants
+    static const int32_t MIN_AMPLITUDE_Q8 = 3 << 8;  // Smallest breath swing (3 mmHg)
+    static const uint32_t MIN_BREATH_MS = 1000;      // 60 breaths/min
+    static const uint32_t MAX_BREATH_MS = 30000;     // 2 breaths/min
+    static const uint32_t APNEA_MS = 30000;          // No breath -> clear outputs
+
+private:
+    enum Phase : uint8_t {
+        PHASE_UNKNOWN,
+        PHASE_INSPIRATION,
+        PHASE_EXPIRATION
+    };
+
+    // Envelope decay shift: ~64 samples (8 s at 8 Hz) time constant
+    static const uint8_t ENVELOPE_SHIFT = 6;
+    // Upstroke samples kept to place the rising crossing (1 s at 8 Hz)
+    static const uint8_t RISE_SAMPLES = 8;
+
+    Phase _phase;
+    bool _apnea;
+
+    // Signal state (Q8 fixed point mmHg)
+    int32_t _smooth;            // Lightly smoothed waveform
+    int32_t _envHi;             // Upper envelope (plateau level)
+    int32_t _envLo;             // Lower envelope (baseline level)
+    bool _primed;
+
+    uint32_t _prevT;            // Previous sample
+    int32_t _prevY;
+
+    // Current breath
+    uint32_t _inspStart;        // Start of inspiration (falling crossing)
+    uint32_t _lastBreathEnd;
+    int32_t _inspMin;           // Minimum during inspiration (Q8)
+    int32_t _expMax;            // Maximum during expiration (Q8)
+    bool _inspValid;            // The expiration follows a seen inspiration
+
+    // Crossings of the breath's own midpoint, interpolated between samples
+    uint32_t _riseT[RISE_SAMPLES];  // Upstroke, from the sample before the trigger
+    int32_t _riseY[RISE_SAMPLES];
+    uint8_t _riseN;
+    uint32_t _aboveT;           // Last expiration sample at or above the midpoint
+    int32_t _aboveY;
+    uint32_t _belowT;           // First sample below it after that
+    int32_t _belowY;
+    bool _below;
+
+    // Phase III regression sums (x = ms since first plateau sample, y = Q8)
+    uint32_t _p3Start;
+    int32_t _p3N;
+    int64_t _p3SumX;
+    int64_t _p3SumY;
+    int64_t _p3SumXX;
+    int64_t _p3SumXY;
+
+    BreathMetrics _last;
+
+    void startExpiration(uint32_t t, int32_t y);
+    uint32_t riseCrossing(int32_t level) const;
+    uint32_t fallCrossing(int32_t level) const;
+    bool finishBreath(uint32_t t, uint32_t expStart, uint32_t expEnd);
+    void resetPhase3();
+    void addPhase3(uint32_t t, int32_t y);
+    int16_t phase3Slope() const;
+};
+
+#endif // BREATH_DETECTOR_H
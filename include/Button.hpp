@@ -5,31 +5,55 @@
 #define BUTTON_HPP
 
 #include <Arduino.h>
+#include "LockFreeRing.h"
+#include "Clock.h"
 
 class Button {
 public:
     Button(uint8_t pin, unsigned long longPressMs = 1000, unsigned long debounceMs = 50);
     
     void begin();
+    
+    // Collect edges recorded by the ISR (call before the was*() queries)
     void update();
     
     bool wasPressed();
     bool wasReleased();
     bool wasLongPress();
     
+    // Time source for debounce / long press (nullptr: hardware millis(),
+    // which is safe in the ISR while the flash cache is off)
+    void setClock(Clock* clock) { _clock = clock; }
+    
+    // Edges lost because update() was not called often enough
+    uint32_t getDroppedEvents() const { return _events.overruns(); }
+    
 private:
+    // Edge recorded by the ISR
+    enum EventType : uint8_t {
+        EVENT_PRESS = 0,
+        EVENT_RELEASE,
+        EVENT_RELEASE_LONG
+    };
+    
     void IRAM_ATTR handleInterrupt();
     
     uint8_t _pin;
     unsigned long _longPressMs;
     unsigned long _debounceMs;
+    Clock* _clock = nullptr;
+    
+    // ISR -> update() hand-off
+    SPSCRing<uint8_t, 8> _events;
+    
+    // ISR-only state
+    unsigned long _lastInterruptTime = 0;
+    unsigned long _pressStartTime = 0;
     
-    volatile bool _pressedFlag = false;
-    volatile bool _releasedFlag = false;
-    volatile bool _longPressFlag = false;
-    volatile unsigned long _lastInterruptTime = 0;
-    volatile unsigned long _pressStartTime = 0;
-    volatile unsigned long _pressDuration = 0;
+    // loop()-only state (set by update(), cleared by the queries)
+    bool _pressedFlag = false;
+    bool _releasedFlag = false;
+    bool _longPressFlag = false;
 };
 
 #endif // BUTTON_HPP
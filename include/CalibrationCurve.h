@@ -0,0 +1,54 @@
+// CalibrationCurve.h
+// Multi-point sensor calibration (voltage -> physical value)
+// Piecewise-linear or natural cubic spline through up to 16 points, with
+// linear extrapolation outside the points. No Arduino dependencies.
+
+#ifndef CALIBRATION_CURVE_H
+#define CALIBRATION_CURVE_H
+
+#include <stdint.h>
+
+enum CalibrationMode : uint8_t {
+    CAL_PIECEWISE_LINEAR = 0,
+    CAL_CUBIC_SPLINE = 1
+};
+
+struct CalPoint {
+    float x;    // Sensor voltage (V)
+    float y;    // Physical value (%, mL, ...)
+};
+
+class CalibrationCurve {
+public:
+    static const uint8_t MAX_POINTS = 16;
+
+    CalibrationCurve();
+
+    // Set the calibration points (any order, x values must be distinct).
+    // Returns false (and leaves the curve empty) if fewer than 2 points or
+    // duplicate x values are given.
+    bool setPoints(const CalPoint* points, uint8_t count,
+                   CalibrationMode mode = CAL_PIECEWISE_LINEAR);
+
+    // Two-point straight line helper
+    bool setLinear(float x0, float y0, float x1, float y1);
+
+    // Evaluate at x (0 if the curve is empty)
+    float evaluate(float x) const;
+
+    bool isValid() const { return _count >= 2; }
+    uint8_t getCount() const { return _count; }
+    CalibrationMode getMode() const { return _mode; }
+    const CalPoint& getPoint(uint8_t i) const { return _pts[i]; }
+
+private:
+    CalPoint _pts[MAX_POINTS];      // Sorted by x
+    float _m2[MAX_POINTS];          // Spline second derivatives
+    uint8_t _count;
+    CalibrationMode _mode;
+
+    void computeSpline();
+    float endSlope(bool upper) const;
+};
+
+#endif // CALIBRATION_CURVE_H
@@ -0,0 +1,72 @@
+// CalibrationStore.h
+// Persistent calibration profiles, one per sensor serial number
+// CalibrationStore is the interface; FileCalibrationStore keeps profiles as
+// files (host builds, tests), NVSCalibrationStore uses ESP32 NVS.
+
+#ifndef CALIBRATION_STORE_H
+#define CALIBRATION_STORE_H
+
+#include <stdint.h>
+#include "CalibrationCurve.h"
+#include "SensorChannels.h"
+
+// Calibration points of one channel
+struct ChannelCalibration {
+    uint8_t mode;                               // CalibrationMode
+    uint8_t count;                              // Points in use (0 = not set)
+    CalPoint points[CalibrationCurve::MAX_POINTS];
+};
+
+// Stored profile (fixed layout, written as one blob)
+struct CalibrationProfile {
+    static const uint16_t VERSION = 2;          // 2: one entry per Sensors channel
+    static const uint8_t SERIAL_LEN = 16;       // Incl. terminator (NVS key limit 15)
+
+    uint16_t version;
+    char serial[SERIAL_LEN];
+    ChannelCalibration channels[SENSOR_COUNT];  // Voltage -> value, in Sensors order
+};
+
+class CalibrationStore {
+public:
+    virtual ~CalibrationStore() {}
+
+    virtual bool save(const CalibrationProfile& profile) = 0;
+    virtual bool load(const char* serial, CalibrationProfile& profile) = 0;
+    virtual bool remove(const char* serial) = 0;
+
+    // Serial of the profile applied at boot
+    virtual bool setActive(const char* serial) = 0;
+    virtual bool getActive(char* serial, uint8_t max_len) = 0;
+
+    // Load the active profile
+    bool loadActive(CalibrationProfile& profile);
+
+    // Empty profile for a serial (returns false if the serial is invalid)
+    static bool initProfile(CalibrationProfile& profile, const char* serial);
+
+    // Serial numbers: 1-15 chars of [A-Za-z0-9_-]
+    static bool isValidSerial(const char* serial);
+
+    // Version / terminator check after reading a blob
+    static bool isValidProfile(const CalibrationProfile& profile);
+};
+
+// Profiles as <dir>/<serial>.cal, active serial in <dir>/active
+class FileCalibrationStore : public CalibrationStore {
+public:
+    explicit FileCalibrationStore(const char* dir);
+
+    bool save(const CalibrationProfile& profile) override;
+    bool load(const char* serial, CalibrationProfile& profile) override;
+    bool remove(const char* serial) override;
+    bool setActive(const char* serial) override;
+    bool getActive(char* serial, uint8_t max_len) override;
+
+private:
+    char _dir[64];
+
+    void profilePath(char* path, uint16_t len, const char* serial) const;
+};
+
+#endif // CALIBRATION_STORE_H
@@ -0,0 +1,52 @@
+// Clock.h
+// Time source for everything that schedules or times out
+// Components take a Clock (setClock) instead of calling millis()/micros()
+// directly. On the device that is the hardware clock; host runs use a
+// VirtualClock advanced by the driver, so a long recording replays in
+// seconds with every timeout behaving as in real time.
+
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <Arduino.h>
+
+class Clock {
+public:
+    virtual ~Clock() {}
+
+    virtual uint32_t millis() = 0;
+    virtual uint32_t micros() = 0;
+
+    // Wait (hardware) or advance time (virtual)
+    virtual void delay(uint32_t ms) = 0;
+
+    // Shared hardware clock (the default for every component)
+    static Clock& hardware();
+};
+
+// millis() / micros() / delay() of the Arduino core
+class HardwareClock : public Clock {
+public:
+    uint32_t millis() override;
+    uint32_t micros() override;
+    void delay(uint32_t ms) override;
+};
+
+// Manually advanced clock; starts at 0 and only moves when told to
+class VirtualClock : public Clock {
+public:
+    VirtualClock() : _us(0) {}
+
+    uint32_t millis() override { return (uint32_t)(_us / 1000); }
+    uint32_t micros() override { return (uint32_t)_us; }
+    void delay(uint32_t ms) override { _us += (uint64_t)ms * 1000; }
+
+    void advance(uint32_t us) { _us += us; }
+    void set(uint64_t us) { _us = us; }
+    uint64_t now() const { return _us; }
+
+private:
+    uint64_t _us;
+};
+
+#endif // CLOCK_H
@@ -8,6 +8,7 @@
 
 #include <Arduino.h>
 #include "MaCO2Parser.h"  // For CO2Data structure
+#include "SampleTimeline.h"
 
 // Output format selection
 enum OutputFormat {
@@ -25,6 +26,14 @@ public:
     // Send data to stream in selected format (8Hz)
     void sendData(Stream& stream, const CO2Data& data);
     
+    // Read from a SampleTimeline (each sample is sent exactly once)
+    void setTimeline(const SampleTimeline* timeline);
+    const TimelineCursor& getTimelineCursor() const { return _cursor; }
+    
+    // Send all valid samples added since the last call; per-breath fields
+    // come from data. Without a timeline, sends data itself if valid.
+    void update(Stream& stream, const CO2Data& data);
+    
     // Legacy PIC-compatible format (for LabVIEW)
     void sendPICFormat(Stream& stream, const CO2Data& data);
     
@@ -39,6 +48,10 @@ public:
     void setOutputEnabled(bool enabled);
     bool isOutputEnabled() const { return _outputEnabled; }
     
+    // Host output period (loop() schedule), 10-1000 ms
+    void setOutputInterval(uint16_t interval_ms);
+    uint16_t getOutputInterval() const { return _outputIntervalMs; }
+    
     // CSV logging (future implementation)
     void enableCSVLogging(bool enabled);
     bool isCSVLoggingEnabled() const { return _csvEnabled; }
@@ -51,12 +64,19 @@ public:
     void resetStatistics();
     
 private:
+    friend class MicroBench;    // Benchmarks private hot paths
+    
     OutputFormat _outputFormat;
     bool _outputEnabled;
+    uint16_t _outputIntervalMs;
     bool _csvEnabled;
     uint32_t _packetsSent;
     uint32_t _bytesSent;
     
+    // Timeline reader
+    const SampleTimeline* _timeline;
+    TimelineCursor _cursor;
+    
     // Format data packet in original PIC format
     // Format: <ESC>ABC<TAB>DEFGH<TAB>IJKLM<TAB>[Status1][Status2][RR][FiCO2][FetCO2]<CR><LF>
     void formatPICPacket(char* buffer, size_t bufferSize, const CO2Data& data);
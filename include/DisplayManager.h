@@ -7,6 +7,9 @@
 
 #include <TFT_eSPI.h>
 #include "MaCO2Parser.h"  // For CO2Data structure
+#include "TrendStore.h"   // For long-term trend page
+#include "SampleTimeline.h" // Waveform history
+#include "Clock.h"
 
 // Custom soft color palette
 #define TFT_LOGOBACKGROUND       0x85BA
@@ -19,6 +22,20 @@
 #define TFT_GREENISH_TINT        0x5DAD
 #define TFT_STRONGER_GREEN       0x07E0  // Stronger green for WiFi indicator
 
+// Drawing time of the rendered frames (primitive and pixel counts come from
+// the host framebuffer build, test/test_display)
+struct FrameStats {
+    uint32_t frame_us;      // Time spent in updateAll()
+    uint32_t max_frame_us;  // Worst frame since resetFrameStats()
+    uint32_t frames;        // Frames rendered since resetFrameStats()
+};
+
+// Display pages
+enum DisplayPage {
+    PAGE_LIVE = 0,      // Waveform + numeric values + status
+    PAGE_TREND = 1      // Long-term EtCO2 / RR / O2 trends
+};
+
 class DisplayManager {
 public:
     DisplayManager();
@@ -55,11 +72,37 @@ public:
     void setWaveformSpeed(uint8_t speed);  // Pixels per update (1-10)
     void setRefreshRate(uint16_t rate_ms); // Minimum time between updates
     
-    // Add data point to waveform buffer
-    void addWaveformPoint(uint16_t co2_value);
+    // Per-frame draw time
+    const FrameStats& getFrameStats() const { return _frameStats; }
+    void resetFrameStats();
+    
+    // The panel (on the host: the framebuffer, with exact draw counts)
+    const TFT_eSPI& getTFT() const { return _tft; }
+    
+    // Time source for the refresh throttle (default: hardware clock;
+    // frame costs are always measured with micros())
+    void setClock(Clock* clock) { _clock = clock; }
+    
+    // Set SampleTimeline reference (waveform history)
+    void setTimeline(const SampleTimeline* timeline) { _timeline = timeline; }
+    
+    // Set TrendStore reference (for trend page)
+    void setTrendStore(const TrendStore* store) { _trendStore = store; }
+    
+    // Page selection (live / trend)
+    void setPage(DisplayPage page);
+    DisplayPage getPage() const { return _page; }
+    
+    // Trend zoom level (1h / 4h / 12h)
+    void setTrendZoom(TrendZoom zoom);
+    void cycleTrendZoom();
+    TrendZoom getTrendZoom() const { return _trendZoom; }
     
 private:
+    friend class MicroBench;    // Benchmarks private hot paths
+    
     TFT_eSPI _tft;
+    FrameStats _frameStats;
     
     // Display dimensions (T-Display S3: 170x320)
     static const uint16_t SCREEN_WIDTH = 170;
@@ -84,10 +127,12 @@ private:
         uint16_t status_h;
     } _layout;
     
-    // Waveform buffer (circular buffer)
-    static const uint16_t WAVEFORM_BUFFER_SIZE = 170;  // Full screen width
-    uint16_t _waveformBuffer[WAVEFORM_BUFFER_SIZE];
-    uint16_t _waveformIndex;
+    Clock* _clock;
+    
+    // Waveform: last WAVEFORM_POINTS samples of the timeline
+    static const uint16_t WAVEFORM_POINTS = 170;  // Full screen width
+    const SampleTimeline* _timeline;
+    uint32_t _waveformSeq;      // Timeline head at the last scale update
     uint16_t _waveformMin;
     uint16_t _waveformMax;
     
@@ -109,18 +154,25 @@ private:
     struct PreviousValues {
         uint8_t co2_waveform;  // FCO2 waveform value (d[4])
         uint8_t fco2;
-        float o2_percent;
-        float volume_ml;
         uint8_t status2;
         char fco2_wave_str[8];  // Formatted FCO2 waveform string
         char fco2_str[8];
-        char o2_str[8];
-        char vol_str[8];
+        float sensor[SENSOR_COUNT];         // NAN: not drawn yet
+        char sensor_str[SENSOR_COUNT][8];
     } _prevValues;
     
     // Previous header title to avoid flicker
     char _prevTitle[32];
     
+    // Trend page state
+    const TrendStore* _trendStore;
+    DisplayPage _page;
+    TrendZoom _trendZoom;
+    uint32_t _trendRevision;    // TrendStore revision last drawn
+    bool _trendDirty;           // Force full trend redraw
+    static const uint16_t TREND_PLOT_WIDTH = SCREEN_WIDTH - 10;
+    TrendColumn _trendColumns[TREND_PLOT_WIDTH];
+    
     // Drawing helper functions
     void drawHeader(const char* title);
     void drawWaveformArea();
@@ -134,6 +186,13 @@ private:
     
     // Waveform rendering
     void plotWaveform();
+    
+    // Trend page rendering
+    void updateTrendPage();
+    void drawTrendPanel(uint16_t y, uint16_t h, TrendChannel channel,
+                        const char* label, const char* unit, float scale,
+                        uint16_t min_span, uint16_t color);
+    void resetLivePage();
     void updateWaveformScale();
     
     // Color scheme
@@ -0,0 +1,231 @@
+// FilterChain.h
+// Compile-time composable integer filter stages for ADC channels
+// Each stage keeps its state in fixed storage (no heap); a FilterChain runs
+// samples through its stages in order. No Arduino dependencies.
+
+#ifndef FILTER_CHAIN_H
+#define FILTER_CHAIN_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Stage interface (duck-typed):
+//   int32_t process(int32_t x)   filter one sample
+//   void prime(int32_t x)        fill the state as if x had been constant
+
+// Moving average with a running sum: O(1) per sample for any window.
+// MAX_WINDOW sets the storage; the window can be changed at runtime up to it.
+template<uint16_t MAX_WINDOW>
+class MovingAverage {
+public:
+    MovingAverage() : _window(MAX_WINDOW) { prime(0); }
+
+    int32_t process(int32_t x) {
+        _sum += x - _buf[_index];
+        _buf[_index] = x;
+        if (++_index >= _window) _index = 0;
+        return mean();
+    }
+
+    void prime(int32_t x) {
+        for (uint16_t i = 0; i < _window; i++) _buf[i] = x;
+        _sum = (int64_t)x * _window;
+        _index = 0;
+    }
+
+    // Change the window (1..MAX_WINDOW), re-primed with the current mean
+    void setWindow(uint16_t window) {
+        if (window < 1) window = 1;
+        if (window > MAX_WINDOW) window = MAX_WINDOW;
+        int32_t m = mean();
+        _window = window;
+        prime(m);
+    }
+
+    uint16_t getWindow() const { return _window; }
+
+private:
+    int32_t _buf[MAX_WINDOW];
+    int64_t _sum;
+    uint16_t _index;
+    uint16_t _window;
+
+    // Rounded to nearest (symmetric for negative sums)
+    int32_t mean() const {
+        int64_t half = _window / 2;
+        return (int32_t)((_sum >= 0 ? _sum + half : _sum - half) / _window);
+    }
+};
+
+// First-order exponential IIR: y += (x - y) / 2^shift, Q8 internal state
+template<uint8_t DEFAULT_SHIFT = 3>
+class ExpIIR {
+public:
+    ExpIIR() : _shift(DEFAULT_SHIFT), _state(0) {}
+
+    int32_t process(int32_t x) {
+        _state += (((int64_t)x << 8) - _state) >> _shift;
+        return (int32_t)((_state + 128) >> 8);
+    }
+
+    void prime(int32_t x) { _state = (int64_t)x << 8; }
+
+    // Time constant ~2^shift samples (0 = pass-through)
+    void setShift(uint8_t shift) { _shift = (shift > 16) ? 16 : shift; }
+
+private:
+    uint8_t _shift;
+    int64_t _state;
+};
+
+// Sliding median over a small odd window (spike rejection).
+// Keeps the window sorted: O(N) per sample for a fixed compile-time N.
+template<uint8_t N>
+class SlidingMedian {
+    static_assert(N % 2 == 1, "SlidingMedian window must be odd");
+public:
+    SlidingMedian() { prime(0); }
+
+    int32_t process(int32_t x) {
+        const int32_t old = _ring[_index];
+        _ring[_index] = x;
+        if (++_index >= N) _index = 0;
+
+        // Remove the oldest value from the sorted array
+        uint8_t pos = 0;
+        while (pos < N - 1 && _sorted[pos] != old) pos++;
+        for (; pos < N - 1; pos++) _sorted[pos] = _sorted[pos + 1];
+
+        // Insert the new value
+        uint8_t ins = N - 1;
+        while (ins > 0 && _sorted[ins - 1] > x) {
+            _sorted[ins] = _sorted[ins - 1];
+            ins--;
+        }
+        _sorted[ins] = x;
+
+        return _sorted[N / 2];
+    }
+
+    void prime(int32_t x) {
+        for (uint8_t i = 0; i < N; i++) {
+            _ring[i] = x;
+            _sorted[i] = x;
+        }
+        _index = 0;
+    }
+
+private:
+    int32_t _ring[N];       // Arrival order
+    int32_t _sorted[N];     // Ascending
+    uint8_t _index;
+};
+
+// FIR filter with Q15 coefficients (default: boxcar over TAPS)
+template<uint8_t TAPS>
+class FIRFilter {
+public:
+    FIRFilter() {
+        for (uint8_t i = 0; i < TAPS; i++) _coef[i] = (int16_t)(32767 / TAPS);
+        prime(0);
+    }
+
+    // coef[0] applies to the newest sample
+    void setCoefficients(const int16_t* coef) {
+        for (uint8_t i = 0; i < TAPS; i++) _coef[i] = coef[i];
+    }
+
+    int32_t process(int32_t x) {
+        _index = (_index == 0) ? TAPS - 1 : _index - 1;
+        _hist[_index] = x;
+
+        int64_t acc = 0;
+        uint8_t j = _index;
+        for (uint8_t i = 0; i < TAPS; i++) {
+            acc += (int64_t)_coef[i] * _hist[j];
+            if (++j >= TAPS) j = 0;
+        }
+        return (int32_t)((acc + (1 << 14)) >> 15);
+    }
+
+    void prime(int32_t x) {
+        for (uint8_t i = 0; i < TAPS; i++) _hist[i] = x;
+        _index = 0;
+    }
+
+private:
+    int16_t _coef[TAPS];
+    int32_t _hist[TAPS];
+    uint8_t _index;         // Position of the newest sample
+};
+
+// Chain of stages applied left to right, e.g.
+//   FilterChain<SlidingMedian<3>, MovingAverage<64>> filter;
+//   filter.stage<1>().setWindow(10);
+template<typename... Stages>
+class FilterChain;
+
+template<>
+class FilterChain<> {
+public:
+    int32_t process(int32_t x) { return x; }
+    void prime(int32_t) {}
+    void setWindow(uint16_t) {}
+};
+
+template<size_t I, typename Chain>
+struct FilterChainStage;
+
+template<typename First, typename... Rest>
+class FilterChain<First, Rest...> {
+public:
+    int32_t process(int32_t x) { return _tail.process(_head.process(x)); }
+
+    void prime(int32_t x) {
+        _head.prime(x);
+        _tail.prime(x);
+    }
+
+    // Set the window of every stage that has one (others are untouched)
+    void setWindow(uint16_t window) {
+        applyWindow(_head, window, 0);
+        _tail.setWindow(window);
+    }
+
+    First& head() { return _head; }
+    FilterChain<Rest...>& tail() { return _tail; }
+
+    // Access stage I (for runtime configuration)
+    template<size_t I>
+    typename FilterChainStage<I, FilterChain>::type& stage() {
+        return FilterChainStage<I, FilterChain>::get(*this);
+    }
+
+private:
+    First _head;
+    FilterChain<Rest...> _tail;
+
+    // Overload resolution picks the first form only if S::setWindow exists
+    template<typename S>
+    static auto applyWindow(S& s, uint16_t window, int) -> decltype(s.setWindow(window), void()) {
+        s.setWindow(window);
+    }
+    template<typename S>
+    static void applyWindow(S&, uint16_t, long) {}
+};
+
+template<typename First, typename... Rest>
+struct FilterChainStage<0, FilterChain<First, Rest...>> {
+    typedef First type;
+    static type& get(FilterChain<First, Rest...>& c) { return c.head(); }
+};
+
+template<size_t I, typename First, typename... Rest>
+struct FilterChainStage<I, FilterChain<First, Rest...>> {
+    typedef typename FilterChainStage<I - 1, FilterChain<Rest...>>::type type;
+    static type& get(FilterChain<First, Rest...>& c) {
+        return FilterChainStage<I - 1, FilterChain<Rest...>>::get(c.tail());
+    }
+};
+
+#endif // FILTER_CHAIN_H
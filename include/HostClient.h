@@ -0,0 +1,131 @@
+// HostClient.h
+// Linux client of the host command protocol (host builds only)
+// Drives HostCommands over a Stream - an FdStream on the device's CDC port
+// (e.g. /dev/ttyACM0) or any other byte stream. Requests are retried with
+// the same sequence number, which the device answers from its response
+// cache without running them twice. Dumps are acknowledged chunk by chunk
+// (go-back-N from the first missing chunk). Frames on the data and log
+// channels that arrive meanwhile go to their own outputs, so the client
+// also splits a framed stream back into records and log text.
+//
+//   FdStream port;
+//   port.open("/dev/ttyACM0");
+//   HostClient client(port);
+//   client.setLogOutput(&logFile);
+//   HostDeviceStatus status;
+//   if (client.getStatus(status) == HOST_OK) ...
+
+#ifndef HOST_CLIENT_H
+#define HOST_CLIENT_H
+
+#ifndef ESP_PLATFORM
+
+#include <Arduino.h>
+#include "HostCommands.h"
+#include "Clock.h"
+
+// PING response
+struct HostDeviceInfo {
+    uint8_t version;            // HOST_PROTOCOL_VERSION
+    uint8_t maxPayload;
+    uint8_t chunkBytes;
+    char build[32];             // Build date and time
+};
+
+// STATUS response
+struct HostDeviceStatus {
+    uint32_t uptimeMs;
+    uint32_t packets;           // MaCO2 packets / errors
+    uint32_t packetErrors;
+    uint32_t records;           // Host records sent
+    uint32_t timelineHead;
+    uint32_t logDropped;
+    uint32_t adcSamples;
+    uint32_t adcOverruns;
+    uint16_t co2Waveform;
+    uint8_t fetco2;
+    uint8_t respiratoryRate;
+    uint8_t status2;
+    uint8_t outputFormat;
+    bool outputEnabled;
+    uint8_t linkMode;
+    bool dumping;
+    uint8_t sensorCount;
+    float sensors[SENSOR_COUNT];
+};
+
+struct HostClientStats {
+    uint32_t requests;
+    uint32_t retries;           // Requests sent again after a timeout
+    uint32_t dataFrames;        // Frames passed to the data / log outputs
+    uint32_t logFrames;
+    uint32_t frameErrors;       // Bad CRC or COBS (HostFrameDecoder)
+    uint32_t dumpResends;       // Go-back-N acknowledgements of a missing chunk
+};
+
+class HostClient {
+public:
+    static const uint8_t NO_RESPONSE = 0xFF;        // Status: every try timed out
+    static const uint16_t RESPONSE_TIMEOUT_MS = 500;
+    static const uint8_t TRIES = 3;
+    static const uint16_t DUMP_TIMEOUT_MS = 1000;   // No chunk: acknowledge again
+
+    explicit HostClient(Stream& port);
+
+    void setClock(Clock* clock) { _clock = clock; }
+
+    // Where data records and log text received in framed mode go
+    // (nullptr discards them)
+    void setDataOutput(Print* out) { _dataOut = out; }
+    void setLogOutput(Print* out) { _logOut = out; }
+
+    // Each call returns a HostStatus, or NO_RESPONSE
+    uint8_t ping(HostDeviceInfo& info);
+    uint8_t getStatus(HostDeviceStatus& status);
+
+    // value: in, room; out, the value as read back or applied
+    uint8_t getConfig(uint8_t key, uint8_t* value, size_t& len);
+    uint8_t setConfig(uint8_t key, const uint8_t* value, size_t len,
+                      uint8_t* applied = nullptr, size_t* appliedLen = nullptr);
+    uint8_t setConfig8(uint8_t key, uint8_t value) { return setConfig(key, &value, 1); }
+    uint8_t setConfig16(uint8_t key, uint16_t value);
+
+    uint8_t sensorCommand(uint8_t command);
+
+    // Bulk dump of a HostDumpSource into out, in order. firstChunk resumes
+    // a broken transfer; *size (if given) gets the source's byte count.
+    // HOST_OK once DUMP_END arrived and was acknowledged.
+    uint8_t dump(uint8_t source, Print& out, uint8_t window = HostCommands::MAX_WINDOW,
+                 uint32_t firstChunk = 0, uint32_t* size = nullptr);
+
+    // Any request: body gets the response body (bodyLen: in, room; out, length)
+    uint8_t request(uint8_t op, const uint8_t* args, size_t len, uint8_t* body, size_t& bodyLen);
+
+    // Read what has arrived (data / log frames to their outputs)
+    void poll();
+
+    const HostClientStats& getStats() const { return _stats; }
+
+private:
+    Stream& _port;
+    Clock* _clock;
+    Print* _dataOut;
+    Print* _logOut;
+    HostFrameDecoder _rx;
+    uint16_t _seq;
+
+    // Latest frame on the command channel, until taken
+    uint8_t _response[HostFrame::MAX_PAYLOAD];
+    size_t _responseLen;
+
+    HostClientStats _stats;
+
+    void send(const uint8_t* payload, size_t len);
+    bool receive();             // Until a command frame is held in _response
+    bool waitResponse(uint16_t seq, uint8_t op, uint32_t timeoutMs);
+    void sendAck(uint32_t next, uint8_t window);
+};
+
+#endif // ESP_PLATFORM
+
+#endif // HOST_CLIENT_H
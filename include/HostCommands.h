@@ -0,0 +1,143 @@
+// HostCommands.h
+// Framed request / response protocol on the USB host link (HOST_CH_CMD)
+// Request:  [seq u16][op][args...]   Response: [seq u16][op | 0x80][status][body...]
+// Little-endian throughout. Status, configuration and sensor commands are
+// answered at once; a dump streams a data source in numbered chunks within a
+// credit window that the host extends with DUMP_ACK. A repeated sequence
+// number gets the cached response again without re-executing. The legacy
+// single-byte commands are unaffected. Full description:
+// documentation/Host_Command_Protocol.md
+
+#ifndef HOST_COMMANDS_H
+#define HOST_COMMANDS_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include "HostLink.h"
+#include "MaCO2Parser.h"
+#include "ADCManager.h"
+#include "DataLogger.h"
+#include "SampleTimeline.h"
+#include "TrendStore.h"
+#include "UartCapture.h"
+#include "CalibrationStore.h"
+#include "Clock.h"
+
+#define HOST_PROTOCOL_VERSION 1
+
+enum HostOp : uint8_t {
+    HOST_OP_PING = 0x01,            // -> version, max payload, chunk size, build date
+    HOST_OP_STATUS = 0x02,          // -> counters and latest readings
+    HOST_OP_GET_CONFIG = 0x03,      // key -> key, value
+    HOST_OP_SET_CONFIG = 0x04,      // key, value -> key, value (as applied)
+    HOST_OP_SENSOR_COMMAND = 0x05,  // MaCO2Command byte (pump start / zero)
+    HOST_OP_DUMP_START = 0x10,      // source, window[, first chunk u32] -> size
+    HOST_OP_DUMP_ACK = 0x11,        // next chunk u32, window (no response)
+    HOST_OP_DUMP_CANCEL = 0x12,
+    HOST_OP_DUMP_DATA = 0x13,       // Device -> host: chunk u32, bytes
+    HOST_OP_RESPONSE = 0x80         // Set in every device -> host op
+};
+
+enum HostStatus : uint8_t {
+    HOST_OK = 0,
+    HOST_ERR_UNKNOWN_OP = 1,
+    HOST_ERR_BAD_ARGS = 2,
+    HOST_ERR_BUSY = 3,              // Dump running / capture recording
+    HOST_ERR_UNAVAILABLE = 4,       // Source missing or not readable
+    HOST_ERR_OVERRUN = 5,           // Source overwrote data before it was sent
+    HOST_ERR_TIMEOUT = 6,           // Host stopped acknowledging
+    HOST_DUMP_END = 7               // Last DUMP_DATA frame (no bytes)
+};
+
+enum HostConfigKey : uint8_t {
+    HOST_CFG_OUTPUT_FORMAT = 1,     // u8 OutputFormat
+    HOST_CFG_OUTPUT_ENABLED = 2,    // u8 0/1
+    HOST_CFG_OUTPUT_INTERVAL = 3,   // u16 ms
+    HOST_CFG_ADC_RATE = 4,          // u16 Hz (restarts acquisition)
+    HOST_CFG_ADC_OVERSAMPLING = 5,  // u16 factor (restarts acquisition)
+    HOST_CFG_LINK_MODE = 6,         // u8 HostLinkMode (applied after the response)
+    HOST_CFG_CALIBRATION = 7,       // set only: u8 channel, f32 v0, y0, v1, y1
+    HOST_CFG_PROFILE_SAVE = 8,      // set only: serial (text), stores the current calibration
+    HOST_CFG_PROFILE = 9            // serial (text) of the active profile; set loads and applies it
+};
+
+enum HostDumpSource : uint8_t {
+    HOST_DUMP_TIMELINE = 1,         // Samples held in the SampleTimeline
+    HOST_DUMP_TREND_1S = 2,         // TrendStore buckets, oldest first
+    HOST_DUMP_TREND_10S = 3,
+    HOST_DUMP_TREND_1MIN = 4,
+    HOST_DUMP_CAPTURE = 5           // Raw MaCO2 UART capture file
+};
+
+class HostCommands {
+public:
+    static const uint8_t CHUNK_BYTES = 240;         // Dump bytes per frame
+    static const uint8_t MAX_WINDOW = 64;           // Chunks in flight
+    static const uint8_t CHUNKS_PER_UPDATE = 16;    // Bounds the time per loop()
+    static const uint16_t ACK_TIMEOUT_MS = 2000;
+
+    explicit HostCommands(HostLink& link);
+
+    void setParser(const MaCO2Parser* parser) { _parser = parser; }
+    void setADCManager(ADCManager* adc) { _adc = adc; }
+    void setDataLogger(DataLogger* logger) { _logger = logger; }
+    void setTimeline(const SampleTimeline* timeline) { _timeline = timeline; }
+    void setTrendStore(const TrendStore* trend) { _trend = trend; }
+    void setCapture(const char* path, const UartRecorder* recorder);
+    void setCalibrationStore(CalibrationStore* store) { _calStore = store; }
+    void setClock(Clock* clock) { _clock = clock; }
+
+    // Answer pending requests and send dump chunks (loop only)
+    void update(const CO2Data& current);
+
+    // Sensor commands received (forwarded by main like web commands)
+    bool hasCommand() const { return _pendingCommand != 0; }
+    uint8_t getCommand();
+
+    bool isDumping() const { return _dump.active; }
+
+private:
+    struct Dump {
+        bool active;
+        bool endSent;
+        uint16_t seq;               // Of the DUMP_START request
+        uint8_t source;
+        uint8_t window;
+        uint32_t size;              // Bytes
+        uint32_t chunks;
+        uint32_t next;              // Next chunk to send
+        uint32_t acked;             // Host has all chunks below this
+        uint32_t lastAckMs;
+        uint16_t recordSize;
+        uint32_t first;             // Timeline sequence / trend revision at start
+        uint16_t count;             // Trend buckets at start
+    };
+
+    HostLink& _link;
+    Clock* _clock;
+    const MaCO2Parser* _parser;
+    ADCManager* _adc;
+    DataLogger* _logger;
+    const SampleTimeline* _timeline;
+    const TrendStore* _trend;
+    const char* _capturePath;
+    const UartRecorder* _recorder;
+    CalibrationStore* _calStore;
+    File _file;
+    uint8_t _pendingCommand;
+
+    // Last response, resent for a repeated sequence number
+    uint8_t _last[HostFrame::MAX_PAYLOAD];
+    size_t _lastLen;
+    Dump _dump;
+
+    void handleRequest(const uint8_t* req, size_t len, const CO2Data& current);
+    size_t handleConfig(uint8_t op, const uint8_t* args, size_t len, uint8_t* body, uint8_t& status);
+    size_t startDump(const uint8_t* args, size_t len, uint8_t* body, uint8_t& status);
+    void pumpDump();
+    void endDump(uint8_t status);
+    bool readDump(uint32_t offset, uint8_t* out, size_t len, uint8_t& status);
+    void sendResponse(uint16_t seq, uint8_t op, uint8_t status, const uint8_t* body, size_t len);
+};
+
+#endif // HOST_COMMANDS_H
@@ -0,0 +1,83 @@
+// HostDemux.h
+// Splits a framed device stream into data records and log text (host builds
+// only; program: [env:host_demux])
+// A HostClient that only listens: data frames go to one output, log frames
+// to another, command frames are dropped. The input is any Stream - an
+// FdStream on the device's CDC port, on stdin or on a saved capture.
+//
+//   FdStream port;
+//   port.open("/dev/ttyACM0");
+//   FilePrint records, log;
+//   records.open("records.bin");
+//   log.open("device.log");
+//   HostDemux demux(port, records, log);
+//   while (...) demux.update();
+
+#ifndef HOST_DEMUX_H
+#define HOST_DEMUX_H
+
+#ifndef ESP_PLATFORM
+
+#include <Arduino.h>
+#include <stdio.h>
+#include "HostClient.h"
+
+// Print into a file, flushed on request
+class FilePrint : public Print {
+public:
+    FilePrint() : _file(nullptr) {}
+    ~FilePrint() { close(); }
+
+    // Create or truncate path; false on failure
+    bool open(const char* path);
+    void close();
+
+    size_t write(uint8_t b) override { return write(&b, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    void flush();
+
+private:
+    FILE* _file;
+};
+
+struct HostDemuxStats {
+    uint32_t records;           // Data frames
+    uint32_t recordBytes;
+    uint32_t logFrames;
+    uint32_t logBytes;
+    uint32_t frameErrors;       // Bad CRC or COBS (HostFrameDecoder)
+};
+
+class HostDemux {
+public:
+    HostDemux(Stream& in, Print& records, Print& log);
+
+    // Split what has arrived; true if any frame was passed on
+    bool update();
+
+    HostDemuxStats getStats() const;
+
+private:
+    // Output of one channel, counting bytes
+    class Channel : public Print {
+    public:
+        explicit Channel(Print& out) : bytes(0), _out(out) {}
+        size_t write(uint8_t b) override { return write(&b, 1); }
+        size_t write(const uint8_t* buffer, size_t size) override;
+        using Print::write;
+
+        uint32_t bytes;
+
+    private:
+        Print& _out;
+    };
+
+    Channel _records;
+    Channel _log;
+    HostClient _client;
+};
+
+#endif // ESP_PLATFORM
+
+#endif // HOST_DEMUX_H
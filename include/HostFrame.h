@@ -0,0 +1,62 @@
+// HostFrame.h
+// Frames of the multiplexed USB host link: [channel][payload][crc8], COBS
+// encoded and terminated by a 0x00 byte, so a reader can resynchronise on
+// any delimiter. No Arduino dependency: host-side tools share this code.
+
+#ifndef HOST_FRAME_H
+#define HOST_FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Virtual channels on the link
+enum HostChannelId : uint8_t {
+    HOST_CH_DATA = 1,           // LabVIEW / ASCII records, one per frame
+    HOST_CH_LOG = 2,            // Diagnostics text, split anywhere
+    HOST_CH_CMD = 3             // Requests / responses (HostCommands.h)
+};
+
+class HostFrame {
+public:
+    static const size_t MAX_PAYLOAD = 250;
+    // Channel + payload + CRC, one COBS code byte, delimiter
+    static const size_t MAX_ENCODED = MAX_PAYLOAD + 4;
+
+    // Encode one frame into out (MAX_ENCODED bytes); returns its length
+    // including the delimiter, 0 if the payload is too long
+    static size_t encode(uint8_t channel, const uint8_t* payload, size_t len, uint8_t* out);
+
+    // CRC-8, polynomial 0x07 (SMBus), over channel and payload
+    static uint8_t crc8(const uint8_t* data, size_t len, uint8_t crc = 0);
+};
+
+// Splits a received byte stream into frames
+class HostFrameDecoder {
+public:
+    HostFrameDecoder();
+
+    // Feed one byte; true when it completed a valid frame
+    bool push(uint8_t byte);
+
+    // The last completed frame (valid until the next push)
+    uint8_t channel() const { return _frame[0]; }
+    const uint8_t* payload() const { return _frame + 1; }
+    size_t length() const { return _length; }
+
+    // Frames dropped for a bad CRC, bad COBS code or overflow
+    uint32_t getErrorCount() const { return _errors; }
+
+    void reset();
+
+private:
+    uint8_t _raw[HostFrame::MAX_ENCODED];       // Encoded bytes since the last delimiter
+    uint8_t _frame[HostFrame::MAX_ENCODED];     // Decoded channel + payload + CRC
+    size_t _rawLen;
+    size_t _length;
+    bool _overflow;
+    uint32_t _errors;
+
+    bool decode();
+};
+
+#endif // HOST_FRAME_H
@@ -0,0 +1,148 @@
+// HostLink.h
+// Data and log channels on the one USB CDC link to the host
+// Data records (LabVIEW / ASCII) are written at once. Diagnostics go to
+// HostLog, a RAM queue that loop() drains between records into the CDC space
+// a record does not need, so log text never splits a record nor delays it.
+// LINK_RAW keeps the legacy byte stream, with log text withheld unless
+// setRawLog(true): a LabVIEW reader sees records only. LINK_FRAMED tags both
+// channels in COBS frames (HostFrame.h) that a host tool splits again.
+// Input: single bytes are legacy commands; a 0x00 starts a request frame,
+// which is held for HostCommands (the link switches to LINK_FRAMED then).
+
+#ifndef HOST_LINK_H
+#define HOST_LINK_H
+
+#include <Arduino.h>
+#include "HostFrame.h"
+#include "Clock.h"
+
+enum HostLinkMode : uint8_t {
+    LINK_RAW = 0,               // Legacy stream: records (plus whole log lines if enabled)
+    LINK_FRAMED = 1             // Every write framed with its channel
+};
+
+struct HostLinkStats {
+    uint32_t dataRecords;       // Records ended by flush()
+    uint32_t dataBytes;
+    uint32_t dataMaxUs;         // Longest record write, CDC flush included
+    uint32_t logBytes;          // Log bytes sent to the host
+    uint32_t logWithheld;       // Discarded in raw mode without raw log
+    uint32_t logDropped;        // Lost with a full queue (tasks other than loop)
+    uint32_t logStalls;         // Full queue written out by the loop task
+    uint16_t logPeak;           // Most bytes queued at once
+    uint32_t rxFrames;          // Request frames received
+    uint32_t rxErrors;          // Bad, foreign-channel or timed-out frames
+};
+
+class HostLink;
+
+// Print side of the log channel (HostLog)
+class HostLogChannel : public Print {
+public:
+    explicit HostLogChannel(HostLink& link) : _link(link) {}
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+
+private:
+    HostLink& _link;
+};
+
+// Reads come from the host; writes are the data channel
+class HostLink : public Stream {
+public:
+    static const uint16_t LOG_QUEUE = 2048;     // Power of two
+    static const uint16_t DATA_RESERVE = 128;   // CDC TX space kept for the next record
+    static const uint16_t DRAIN_BUDGET = 256;   // Log bytes per update()
+    static const uint16_t RX_FRAME_TIMEOUT_MS = 500;    // Unfinished request frame
+
+    explicit HostLink(Stream& usb);
+
+    // Call from the task that writes data (loop). Until setLogQueued(true)
+    // that task's log output is written straight through.
+    void begin(HostLinkMode mode);
+    void setLogQueued(bool queued) { _logQueued = queued; }
+
+    void setMode(HostLinkMode mode);
+    HostLinkMode getMode() const { return _mode; }
+
+    // Log text between records in raw mode (off: discarded and counted)
+    void setRawLog(bool enabled) { _rawLog = enabled; }
+    bool getRawLog() const { return _rawLog; }
+
+    void setClock(Clock* clock) { _clock = clock; }
+
+    // Send queued log output while the CDC has room to spare (loop only)
+    void update();
+
+    // Send all queued log output now, blocking (loop only)
+    void flushLog();
+
+    Print& log() { return _log; }
+    const HostLinkStats& getStats() const { return _stats; }
+
+    // Next request frame (HOST_CH_CMD payload) into buf; 0 if none
+    size_t readRequest(uint8_t* buf, size_t maxLen);
+
+    // Send one frame at once (loop only), e.g. a response
+    void sendFrame(uint8_t channel, const uint8_t* payload, size_t len);
+
+    // Room for a frame that leaves DATA_RESERVE free for the next record
+    bool canSendFrame();
+
+    // Stream: legacy single-byte commands only
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    int availableForWrite() override;
+    void flush() override;                      // Ends the record
+
+private:
+    friend class HostLogChannel;
+
+    Stream& _usb;
+    HostLogChannel _log;
+    HostLinkMode _mode;
+    bool _rawLog;
+    bool _logQueued;
+    void* _owner;                               // Task that writes data
+
+    // Log queue: any task appends under the lock, loop() removes
+    uint8_t _queue[LOG_QUEUE];
+    volatile uint32_t _head;                    // Bytes ever queued
+    volatile uint32_t _tail;                    // Bytes ever sent
+
+    // Record being written (framed mode collects it into one frame)
+    uint8_t _record[HostFrame::MAX_PAYLOAD];
+    size_t _recordLen;
+    bool _inRecord;
+    uint32_t _recordStartUs;
+
+    // Host input
+    Clock* _clock;
+    HostFrameDecoder _rx;
+    bool _rxFraming;                            // Inside a request frame
+    size_t _rxFrameBytes;                       // Of the frame being received
+    uint32_t _rxLastMs;
+    int _rxLegacy;                              // Legacy byte not yet read, or -1
+    uint8_t _request[HostFrame::MAX_PAYLOAD];   // Request not yet read
+    size_t _requestLen;
+
+    HostLinkStats _stats;
+
+    size_t queueLog(const uint8_t* buffer, size_t size);
+    size_t drainLog(size_t maxBytes, bool wholeLines);
+    void sendLog(const uint8_t* buffer, size_t size);
+    void pollInput();
+    bool isOwner() const;
+    static void* currentTask();
+};
+
+extern HostLink hostLink;       // USB CDC (Serial)
+extern Print& HostLog;          // Its log channel, for diagnostics from any task
+
+#endif // HOST_LINK_H
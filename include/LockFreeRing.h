@@ -0,0 +1,325 @@
+// LockFreeRing.h
+// Lock-free rings for hand-off between tasks, ISRs and loop()
+// SPSCRing: one producer, one consumer, bounded FIFO (producer never blocks;
+// a full ring rejects and counts the item). BroadcastRing: one producer,
+// any number of consumers with their own cursors; the producer overwrites
+// the oldest slot and lapped readers detect it. No Arduino dependencies.
+
+#ifndef LOCK_FREE_RING_H
+#define LOCK_FREE_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+
+// Producer and consumer indices live on separate cache lines so the two
+// sides do not invalidate each other's line on every update
+#ifndef LOCKFREE_CACHE_LINE
+#define LOCKFREE_CACHE_LINE 64
+#endif
+
+// Hot paths are forced inline so callers marked IRAM_ATTR stay in IRAM
+#define LOCKFREE_INLINE inline __attribute__((always_inline))
+
+// ============================================================================
+// SPSCRing
+// ============================================================================
+//
+// Indices run freely (uint32_t) and are masked on access, so all N slots are
+// usable. The producer publishes head with release ordering after writing the
+// slot; the consumer publishes tail after reading it. Each side caches the
+// other side's index and only reloads it when the ring looks full / empty.
+
+template<typename T, uint32_t N>
+class SPSCRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SPSCRing size must be a power of two");
+public:
+    SPSCRing() : _head(0), _tailCache(0), _tail(0), _headCache(0), _overruns(0) {}
+
+    // ---- Producer side ----
+
+    // Append one item; false (and an overrun is counted) if the ring is full
+    LOCKFREE_INLINE bool push(const T& item) {
+        const uint32_t head = _head.load(std::memory_order_relaxed);
+        if (head - _tailCache == N) {
+            _tailCache = _tail.load(std::memory_order_acquire);
+            if (head - _tailCache == N) {
+                _overruns.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+        _buf[head & MASK] = item;
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Append up to count items with one publish; returns the number written
+    // (the rest are counted as overruns)
+    uint32_t push(const T* items, uint32_t count) {
+        const uint32_t head = _head.load(std::memory_order_relaxed);
+        uint32_t space = N - (head - _tailCache);
+        if (space < count) {
+            _tailCache = _tail.load(std::memory_order_acquire);
+            space = N - (head - _tailCache);
+        }
+        const uint32_t n = (count < space) ? count : space;
+        for (uint32_t i = 0; i < n; i++) {
+            _buf[(head + i) & MASK] = items[i];
+        }
+        if (n < count) {
+            _overruns.fetch_add(count - n, std::memory_order_relaxed);
+        }
+        _head.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+    // ---- Consumer side ----
+
+    LOCKFREE_INLINE bool pop(T& item) {
+        const uint32_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail == _headCache) {
+            _headCache = _head.load(std::memory_order_acquire);
+            if (tail == _headCache) {
+                return false;
+            }
+        }
+        item = _buf[tail & MASK];
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Remove up to max items with one publish; returns the number read
+    uint32_t pop(T* items, uint32_t max) {
+        const uint32_t tail = _tail.load(std::memory_order_relaxed);
+        _headCache = _head.load(std::memory_order_acquire);
+        const uint32_t avail = _headCache - tail;
+        const uint32_t n = (max < avail) ? max : avail;
+        for (uint32_t i = 0; i < n; i++) {
+            items[i] = _buf[(tail + i) & MASK];
+        }
+        _tail.store(tail + n, std::memory_order_release);
+        return n;
+    }
+
+    // Call fn(const T&) on every available item in place (no copy), then
+    // release them with one publish; returns the number consumed
+    template<typename Fn>
+    uint32_t consume(Fn fn) {
+        const uint32_t tail = _tail.load(std::memory_order_relaxed);
+        _headCache = _head.load(std::memory_order_acquire);
+        for (uint32_t i = tail; i != _headCache; i++) {
+            fn(const_cast<const T&>(_buf[i & MASK]));
+        }
+        _tail.store(_headCache, std::memory_order_release);
+        return _headCache - tail;
+    }
+
+    // ---- Either side ----
+
+    // Items waiting (exact from the consumer, a lower bound elsewhere)
+    uint32_t size() const {
+        return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size() == 0; }
+    static uint32_t capacity() { return N; }
+
+    // Items rejected because the ring was full
+    uint32_t overruns() const { return _overruns.load(std::memory_order_relaxed); }
+
+    // Discard contents and statistics (only while neither side is active).
+    // Both indices restart at start (tests use it to cross the 2^32 wrap).
+    void reset(uint32_t start = 0) {
+        _head.store(start, std::memory_order_relaxed);
+        _tail.store(start, std::memory_order_relaxed);
+        _tailCache = start;
+        _headCache = start;
+        _overruns.store(0, std::memory_order_release);
+    }
+
+private:
+    static const uint32_t MASK = N - 1;
+
+    // Producer line
+    alignas(LOCKFREE_CACHE_LINE) std::atomic<uint32_t> _head;
+    uint32_t _tailCache;
+    // Consumer line
+    alignas(LOCKFREE_CACHE_LINE) std::atomic<uint32_t> _tail;
+    uint32_t _headCache;
+    // Statistics
+    alignas(LOCKFREE_CACHE_LINE) std::atomic<uint32_t> _overruns;
+    alignas(LOCKFREE_CACHE_LINE) T _buf[N];
+};
+
+// ============================================================================
+// BroadcastRing
+// ============================================================================
+//
+// Every slot carries a sequence stamp: 2*seq+1 while the producer writes it,
+// 2*seq+2 once item seq is complete. A reader checks the stamp, copies the
+// payload and re-checks the stamp; a changed stamp means the producer lapped
+// it during the copy. Payload words are relaxed atomics, so the concurrent
+// copy is well-defined (plain loads/stores on 32-bit targets).
+// T must be trivially copyable.
+
+// Read position of one BroadcastRing consumer
+struct BroadcastCursor {
+    uint32_t seq;           // Next sequence number to read
+    uint32_t overruns;      // Times the producer lapped this reader
+    uint32_t dropped;       // Items skipped because of overruns
+};
+
+template<typename T, uint32_t N>
+class BroadcastRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "BroadcastRing size must be a power of two");
+public:
+    BroadcastRing() : _head(0) {
+        for (uint32_t i = 0; i < N; i++) {
+            _slots[i].stamp.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // ---- Producer side (never blocks) ----
+
+    LOCKFREE_INLINE uint32_t push(const T& item) {
+        const uint32_t seq = _head.load(std::memory_order_relaxed);
+        Slot& slot = _slots[seq & MASK];
+
+        slot.stamp.store(2 * seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        uint32_t words[WORDS];
+        memcpy(words, &item, sizeof(T));
+        for (uint32_t w = 0; w < WORDS; w++) {
+            slot.data[w].store(words[w], std::memory_order_relaxed);
+        }
+
+        slot.stamp.store(2 * seq + 2, std::memory_order_release);
+        _head.store(seq + 1, std::memory_order_release);
+        return seq;
+    }
+
+    // Push count items; returns the sequence number of the first
+    uint32_t push(const T* items, uint32_t count) {
+        const uint32_t first = _head.load(std::memory_order_relaxed);
+        for (uint32_t i = 0; i < count; i++) {
+            push(items[i]);
+        }
+        return first;
+    }
+
+    // ---- Consumer side (any number, one cursor each) ----
+
+    // Sequence number the next push will get
+    uint32_t head() const { return _head.load(std::memory_order_acquire); }
+
+    // Oldest sequence number still held
+    uint32_t oldest() const {
+        const uint32_t h = head();
+        return (h > N) ? h - N : 0;
+    }
+
+    // Cursor at the next item, or at the oldest item still held
+    BroadcastCursor attach(bool from_oldest = false) const {
+        BroadcastCursor cursor;
+        cursor.seq = from_oldest ? oldest() : head();
+        cursor.overruns = 0;
+        cursor.dropped = 0;
+        return cursor;
+    }
+
+    // Items the cursor is behind (may exceed N before the next read)
+    uint32_t lag(const BroadcastCursor& cursor) const { return head() - cursor.seq; }
+
+    // Next item for this cursor; false when caught up. A lapped cursor jumps
+    // to the oldest item still held and counts the skipped items.
+    LOCKFREE_INLINE bool read(BroadcastCursor& cursor, T& item) const {
+        for (;;) {
+            const uint32_t h = head();
+            if (cursor.seq == h) {
+                return false;
+            }
+            if (h - cursor.seq > N) {
+                skipTo(cursor, h - N);
+            }
+
+            uint32_t stamp;
+            if (!copy(cursor.seq, item, stamp)) {
+                // Slot already (being) rewritten for a newer item: lapped
+                skipTo(cursor, oldestSafe(cursor.seq, stamp));
+                continue;
+            }
+            cursor.seq++;
+            return true;
+        }
+    }
+
+    // Read up to max items; returns the number read
+    uint32_t read(BroadcastCursor& cursor, T* items, uint32_t max) const {
+        uint32_t n = 0;
+        while (n < max && read(cursor, items[n])) {
+            n++;
+        }
+        return n;
+    }
+
+    // Item seq without a cursor; false if it is not written yet or has been
+    // (or is being) overwritten
+    LOCKFREE_INLINE bool peek(uint32_t seq, T& item) const {
+        uint32_t stamp;
+        return copy(seq, item, stamp);
+    }
+
+    static uint32_t capacity() { return N; }
+
+private:
+    static const uint32_t MASK = N - 1;
+    static const uint32_t WORDS = (sizeof(T) + 3) / 4;
+
+    struct Slot {
+        std::atomic<uint32_t> stamp;
+        std::atomic<uint32_t> data[WORDS];
+    };
+
+    // Oldest item not affected by the write that left this stamp in the
+    // slot of seq (stamps wrap every 2^31 items, so work relative to seq)
+    static uint32_t oldestSafe(uint32_t seq, uint32_t stamp) {
+        const uint32_t newest = seq + (stamp - 1 - 2 * seq) / 2;  // Written or in progress
+        return newest - (N - 1);
+    }
+
+    // Stamp, payload, stamp again; item is only written if both stamps say
+    // the slot holds seq complete. stamp returns the stamp that was seen.
+    LOCKFREE_INLINE bool copy(uint32_t seq, T& item, uint32_t& stamp) const {
+        const Slot& slot = _slots[seq & MASK];
+        const uint32_t expect = 2 * seq + 2;
+        stamp = slot.stamp.load(std::memory_order_acquire);
+        if (stamp != expect) {
+            return false;
+        }
+
+        uint32_t words[WORDS];
+        for (uint32_t w = 0; w < WORDS; w++) {
+            words[w] = slot.data[w].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        stamp = slot.stamp.load(std::memory_order_relaxed);
+        if (stamp != expect) {
+            return false;
+        }
+
+        memcpy(&item, words, sizeof(T));
+        return true;
+    }
+
+    static void skipTo(BroadcastCursor& cursor, uint32_t seq) {
+        cursor.dropped += seq - cursor.seq;
+        cursor.overruns++;
+        cursor.seq = seq;
+    }
+
+    alignas(LOCKFREE_CACHE_LINE) std::atomic<uint32_t> _head;
+    alignas(LOCKFREE_CACHE_LINE) Slot _slots[N];
+};
+
+#endif // LOCK_FREE_RING_H
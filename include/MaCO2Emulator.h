@@ -0,0 +1,107 @@
+// MaCO2Emulator.h
+// Simulated MaCO2-V3 sensor presented as a Stream
+// Speaks the sensor's protocol (0x06 start byte, 0x1B ACK, 7 init bytes,
+// 8-byte checksummed packets at 8 Hz, CMD_START_PUMP / CMD_ZERO_CAL) with a
+// synthetic capnogram, so the parser and pipeline run without hardware.
+// Faults (dropped bytes, bad checksums) and a rate multiplier for stress
+// tests are configurable.
+
+#ifndef MACO2_EMULATOR_H
+#define MACO2_EMULATOR_H
+
+#include <Arduino.h>
+#include "Clock.h"
+
+struct EmulatorConfig {
+    float breath_rate_bpm;      // Breaths per minute (also reported in d[2])
+    float etco2_mmhg;           // End-tidal plateau
+    float fico2_mmhg;           // Inspired baseline
+    float noise_mmhg;           // Waveform noise (RMS)
+    float drift_mmhg_per_min;   // Baseline drift, cleared by CMD_ZERO_CAL
+    float drop_byte_prob;       // Probability a byte is lost on the line
+    float corrupt_prob;         // Probability a packet has a bad checksum
+    float rate_multiplier;      // Packet rate = 8 Hz x this (stress tests)
+    bool pump_running;          // Pump state at start (CMD_START_PUMP starts it)
+    bool handshake;             // Start with the 0x06 / ACK handshake
+    uint32_t seed;              // Noise / fault generator seed (reproducible)
+};
+
+struct EmulatorStats {
+    uint32_t packets;           // Packets generated
+    uint32_t bytes;             // Bytes put on the line
+    uint32_t droppedBytes;      // Bytes lost on purpose (drop_byte_prob)
+    uint32_t corruptPackets;    // Packets sent with a bad checksum
+    uint32_t overflowBytes;     // Bytes lost because nobody read (RX buffer full)
+    uint32_t commands;          // Command bytes received
+};
+
+class MaCO2Emulator : public Stream {
+public:
+    static const uint16_t RX_BUFFER = 256;      // Like the UART driver's buffer
+    static const uint32_t PERIOD_US = 125000;   // Nominal 8 Hz
+    static const uint32_t BYTE_US = 1042;       // 9600 baud 8N1
+
+    MaCO2Emulator();
+
+    static EmulatorConfig defaultConfig();
+
+    // Time source for the line schedule (default: hardware clock)
+    void setClock(Clock* clock) { _clock = clock; }
+
+    // (Re)start the sensor with a configuration
+    void begin(const EmulatorConfig& config);
+
+    const EmulatorConfig& getConfig() const { return _config; }
+    const EmulatorStats& getStats() const { return _stats; }
+    bool isPumpRunning() const { return _pumpRunning; }
+
+    // Stream (reads get the bytes that are due by now; writes are commands)
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t b) override;
+    using Print::write;
+
+private:
+    enum State {
+        STATE_HANDSHAKE,        // Sending 0x06 until ACKed
+        STATE_INIT,             // Sending the 7 init bytes
+        STATE_RUNNING
+    };
+
+    Clock* _clock;
+    EmulatorConfig _config;
+    EmulatorStats _stats;
+    State _state;
+    bool _pumpRunning;
+    uint32_t _rng;
+
+    // Line schedule
+    uint32_t _periodUs;
+    uint32_t _byteUs;
+    uint32_t _nextByteUs;       // Clock time (us) when the next byte is on the line
+    uint32_t _packetStartUs;
+    uint8_t _packet[8];
+    uint8_t _packetIndex;       // Next byte of _packet to send (8 = none)
+    uint8_t _initSent;
+
+    // Capnogram
+    float _cycleS;              // Position in the breath cycle (s)
+    float _offsetMmHg;          // Drift since the last zero
+    float _peakMmHg;            // Peak of the current breath
+    uint8_t _lastPeak;          // Reported in d[5]
+
+    // Received, unread bytes
+    uint8_t _rx[RX_BUFFER];
+    uint16_t _rxHead;
+    uint16_t _rxCount;
+
+    void generate();
+    void emit(uint8_t b);
+    void buildPacket();
+    float waveform(float t_s);
+    uint32_t random32();
+    float uniform();
+};
+
+#endif // MACO2_EMULATOR_H
@@ -6,6 +6,12 @@
 #define MACO2_PARSER_H
 
 #include <Arduino.h>
+#include "BreathDetector.h"
+#include "VolumetricCapno.h"
+#include "MetabolicCalc.h"
+#include "SensorChannels.h"
+#include "PacketTimestamper.h"
+#include "Clock.h"
 
 // MaCO2 sensor raw packet structure (8 bytes)
 // FINAL STRUCTURE based on actual sensor data analysis with checksum validation
@@ -25,6 +31,7 @@
 // - Look for 0x06 header (d[0])
 // - Validate checksum (d[7] must equal sum of d[0..6])
 // - Validate RR (d[2] must be <= 60)
+// - On rejection, retry from the next 0x06 among the rejected bytes
 //
 struct MaCO2Packet {
     uint8_t status1;        // d[0] - Status/Data Valid (6 = valid data)
@@ -45,18 +52,21 @@ struct CO2Data {
     uint8_t status2;            // Pump, leak, occlusion bits
     uint8_t respiratory_rate;   // RR in breaths/min
     uint8_t fco2;               // Fractional CO2
-    uint8_t fetco2;             // End-tidal CO2
+    uint8_t fetco2;             // End-tidal CO2 (from BreathDetector)
+    BreathMetrics breath;       // Last completed breath (BreathDetector)
     
-    // From ADC (added by system)
-    uint16_t o2_adc;            // O2 sensor reading (0-65535)
-    uint16_t vol_adc;           // Volume sensor reading (0-1023)
+    // From ADC (added by system), one entry per channel in SensorChannels.h
+    // (value in physical units, PIC-scaled raw for LabVIEW)
+    SensorReading sensors[SENSOR_COUNT];
     
     // Calculated values
-    float o2_percent;           // Calculated O2 percentage
-    float volume_ml;            // Calculated volume in mL
+    VolumetricBreath vcap;      // Last volumetric breath (VolumetricCapno)
+    MetabolicResult metabolic30s;   // Gas exchange, rolling 30 s (MetabolicCalc)
+    MetabolicResult metabolic60s;   // Gas exchange, rolling 1 min (MetabolicCalc)
     
     // Metadata
-    uint32_t timestamp;         // millis() when data was received
+    uint32_t timestamp;         // Sensor sample time (ms, millis() timebase)
+    uint64_t timestamp_us;      // Same, full resolution (us, micros() timebase)
     bool valid;                 // Overall data validity
 };
 
@@ -70,14 +80,17 @@ class MaCO2Parser {
 public:
     MaCO2Parser();
     
+    // Any Stream works: the UART, a UartRecorder tee or a UartReplay
+    
     // Initialize communication with MaCO2 sensor
-    bool initialize(HardwareSerial& serial, unsigned long timeout_ms = 10000);
+    bool initialize(Stream& serial, unsigned long timeout_ms = 10000);
     
-    // Parse incoming data packet (non-blocking)
-    bool parsePacket(HardwareSerial& serial, CO2Data& data);
+    // Parse the next complete packet (non-blocking). Returns after each
+    // packet; call again while it returns true to drain a backlog.
+    bool parsePacket(Stream& serial, CO2Data& data);
     
     // Send command to MaCO2 sensor
-    void sendCommand(HardwareSerial& serial, MaCO2Command cmd);
+    void sendCommand(Stream& serial, MaCO2Command cmd);
     
     // Check status flags
     bool isPumpRunning(const CO2Data& data) const;
@@ -90,15 +103,22 @@ public:
     uint32_t getErrorCount() const { return _errorCount; }
     uint32_t getLastPacketTime() const { return _lastPacketTime; }
     
+    // Cadence lock of the sample timestamps (period, raw vs reconstructed jitter)
+    const TimestampStats& getTimestampStats() const { return _timestamper.getStats(); }
+    
     // Reset statistics
     void resetStatistics();
     
+    // Time source for timeouts and timestamps (default: hardware clock)
+    void setClock(Clock* clock) { _clock = clock; }
+    
 private:
     enum ParseState {
         WAIT_FOR_DATA,
         READING_PACKET
     };
     
+    Clock* _clock;
     ParseState _state;
     MaCO2Packet _rxBuffer;
     uint8_t _rxIndex;
@@ -106,12 +126,30 @@ private:
     uint32_t _errorCount;
     uint32_t _lastPacketTime;
 
-    // End-tidal peak tracking (sensor doesn't provide separate EtCO2)
-    uint8_t _peakCO2;           // Current breath peak
-    uint8_t _lastEtCO2;         // Last completed breath's end-tidal
-    uint8_t _prevWaveform;      // Previous waveform value for edge detection
+    // Breath segmentation (sensor doesn't provide a reliable EtCO2)
+    BreathDetector _breathDetector;
+
+    // Sample timestamps from byte arrival + sensor cadence
+    PacketTimestamper _timestamper;
+    int64_t _packetArrivalUs;       // Arrival estimate of the packet in _rxBuffer
+    uint32_t _packetPeriods;        // Sensor periods since the previous packet
+    uint32_t _bytesSincePacket;     // Bytes consumed since the previous packet ended
+    
+    // Resync: after more than SYNC_LOST_ERRORS rejected packets in a row the
+    // parser is "searching" (rejections no longer logged one by one, a
+    // timeout reported every SYNC_TIMEOUT_MS)
+    static const uint8_t SYNC_LOST_ERRORS = 3;
+    static const uint32_t SYNC_TIMEOUT_MS = 5000;
+    uint8_t _consecutiveErrors;     // Rejected packets since the last valid one (saturates)
+    uint32_t _syncStartTime;        // Clock time (ms) the search started (0 = not searching)
+    bool _syncMessagePrinted;
+    uint32_t _lastByteTime;         // Clock time (ms) of the last byte read
+    
+    void markPacketEnd(Stream& serial);
 
-    bool readPacket(HardwareSerial& serial);
+    bool readPacket(Stream& serial);
+    bool validatePacket();          // Checks the 8 bytes in _rxBuffer
+    void rescan();                  // Drop a rejected header, keep what follows
     void decodePacket(const MaCO2Packet& packet, CO2Data& data);
 };
 
@@ -0,0 +1,87 @@
+// MaCO2Pty.h
+// MaCO2Emulator behind a Linux pseudo-terminal (host builds only)
+// MaCO2Pty creates a pty pair and moves bytes between the emulator and the
+// master side: what the emulator sends appears on the slave device (e.g.
+// /dev/pts/5), what is written to the slave reaches the emulator as
+// commands. Anything that opens a serial port - a host build of the
+// parser, a terminal, a LabVIEW VI under Wine - sees the sensor's protocol.
+// FdStream presents such a device (or any file descriptor) as a Stream.
+//
+//   pio run -e emulator_pty && .pio/build/emulator_pty/program --rate 4
+
+#ifndef MACO2_PTY_H
+#define MACO2_PTY_H
+
+#ifndef ESP_PLATFORM
+
+#include <Arduino.h>
+#include "MaCO2Emulator.h"
+
+class MaCO2Pty {
+public:
+    explicit MaCO2Pty(MaCO2Emulator& emulator);
+    ~MaCO2Pty();
+
+    // Create the pty (raw mode, non-blocking master); false on failure
+    bool open();
+    void close();
+    bool isOpen() const { return _master >= 0; }
+
+    // Device path for the client, e.g. "/dev/pts/5" (empty when closed)
+    const char* slavePath() const { return _slavePath; }
+
+    // Move the emulator's due bytes to the pty and the client's bytes to
+    // the emulator. Call at least every few ms; returns the bytes moved.
+    size_t pump();
+
+    uint32_t getBytesOut() const { return _bytesOut; }     // Emulator -> client
+    uint32_t getBytesIn() const { return _bytesIn; }       // Client -> emulator
+
+private:
+    MaCO2Emulator& _emulator;
+    int _master;
+    int _slaveHold;             // Keeps the slave open between clients
+    char _slavePath[64];
+
+    // Bytes taken from the emulator that the pty did not accept yet
+    uint8_t _pending[MaCO2Emulator::RX_BUFFER];
+    size_t _pendingLen;
+
+    uint32_t _bytesOut;
+    uint32_t _bytesIn;
+};
+
+// Stream over a file descriptor (serial device, pty slave, pipe), non-blocking
+class FdStream : public Stream {
+public:
+    FdStream() : _fd(-1), _peek(-1), _eof(false) {}
+    ~FdStream() { close(); }
+
+    // Open a serial device in raw mode; false on failure
+    bool open(const char* path);
+
+    // Use a descriptor that is already open (stdin, a pipe), made
+    // non-blocking; closed with the stream
+    bool attach(int fd);
+    void close();
+
+    // The input has ended (end of file, pipe closed by its writer, tty hung
+    // up) and every byte has been read
+    bool atEnd();
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t* buf, size_t len) override;
+    using Print::write;
+
+private:
+    int _fd;
+    int _peek;                  // Byte read ahead by available() / peek(), -1 if none
+    bool _eof;                  // read() returned 0
+};
+
+#endif // ESP_PLATFORM
+
+#endif // MACO2_PTY_H
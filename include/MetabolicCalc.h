@@ -0,0 +1,72 @@
+// MetabolicCalc.h
+// Indirect calorimetry from the O2, CO2 and volume channels
+// Per-breath VO2/VCO2 via the Haldane transform, aggregated over rolling
+// 30 s and 1 min windows with incremental sums (no Arduino dependencies)
+
+#ifndef METABOLIC_CALC_H
+#define METABOLIC_CALC_H
+
+#include <stdint.h>
+#include "VolumetricCapno.h"  // For VolumetricBreath
+
+// Gas exchange over one rolling window
+struct MetabolicResult {
+    float vo2_ml_min;       // O2 uptake
+    float vco2_ml_min;      // CO2 output
+    float rq;               // Respiratory quotient VCO2/VO2 (0 if undefined)
+    float ee_kcal_day;      // Energy expenditure (abbreviated Weir equation)
+    float ve_l_min;         // Expired minute volume
+    uint8_t breaths;        // Breaths in the window
+};
+
+class MetabolicCalc {
+public:
+    MetabolicCalc();
+
+    // Add a completed volumetric breath (with inspired/expired fractions).
+    // Returns false if the breath cannot be used (first breath, FiO2 too
+    // close to 100% for the Haldane transform, no volume).
+    bool addBreath(const VolumetricBreath& breath);
+
+    // Rolling window results (updated on every accepted breath)
+    const MetabolicResult& get30s() const { return _win30.result; }
+    const MetabolicResult& get60s() const { return _win60.result; }
+
+    void reset();
+
+    // Breaths kept per window (60 s at 60 breaths/min)
+    static const uint8_t WINDOW_CAPACITY = 64;
+
+private:
+    // Per-breath gas exchange (volumes in mL)
+    struct BreathGas {
+        uint32_t end_time;
+        float duration_ms;
+        float ve;
+        float vo2;
+        float vco2;
+    };
+
+    // Time-based rolling window with running sums (O(1) amortised per breath)
+    struct Window {
+        uint32_t length_ms;
+        BreathGas entries[WINDOW_CAPACITY];
+        uint8_t head;           // Next write position
+        uint8_t count;
+        float sumDuration;
+        float sumVE;
+        float sumVO2;
+        float sumVCO2;
+        MetabolicResult result;
+    };
+
+    Window _win30;
+    Window _win60;
+
+    void resetWindow(Window& w, uint32_t length_ms);
+    void push(Window& w, const BreathGas& gas);
+    void popOldest(Window& w);
+    void computeResult(Window& w);
+};
+
+#endif // METABOLIC_CALC_H
@@ -0,0 +1,69 @@
+// MicroBench.h
+// Microbenchmarks of the per-sample hot paths (device 'M', [env:microbench])
+// Each path runs in a tight loop on private instances (live state is left
+// alone) and is timed with the CPU cycle counter. Results are printed as
+// one line of JSON: ns/op, and heap allocations/op and bytes/op when the
+// firmware is built with MICROBENCH_COUNT_ALLOCS (see platformio.ini).
+
+#ifndef MICRO_BENCH_H
+#define MICRO_BENCH_H
+
+#include <Arduino.h>
+
+class WiFiManager;
+class DisplayManager;
+class SampleTimeline;
+
+struct BenchResult {
+    const char* name;
+    uint32_t ops;
+    float ns_per_op;
+    float allocs_per_op;        // < 0: not counted in this build
+    float bytes_per_op;
+};
+
+class MicroBench {
+public:
+    static const uint8_t MAX_RESULTS = 10;
+
+    MicroBench();
+
+    // Instances whose hot paths are pure enough to run on the live object
+    // (JSON serialization, waveform scaling over the shared timeline)
+    void setWiFiManager(WiFiManager* wifi) { _wifi = wifi; }
+    void setDisplayManager(DisplayManager* display) { _display = display; }
+
+    // Recorded samples for the session codec benchmark (read only)
+    void setTimeline(const SampleTimeline* timeline) { _timeline = timeline; }
+
+    // Run every benchmark and print the results as JSON
+    void runAll(Print& out);
+
+    uint8_t getResultCount() const { return _count; }
+    const BenchResult& getResult(uint8_t i) const { return _results[i]; }
+
+private:
+    WiFiManager* _wifi;
+    DisplayManager* _display;
+    const SampleTimeline* _timeline;
+    BenchResult _results[MAX_RESULTS];
+    uint8_t _count;
+
+    // Session codec compression over the benchmark trace
+    uint16_t _codecSamples;
+    uint32_t _codecBytes;
+    bool _codecRecorded;        // Trace from the timeline (else synthetic)
+
+    void benchParser();
+    void benchADC();
+    void benchDataLogger();
+    void benchJson();
+    void benchDisplay();
+    void benchSessionCodec();
+
+    // Time ops calls of fn(i) (after a short warm-up) and store the result
+    template<typename Fn>
+    void measure(const char* name, uint32_t ops, Fn fn);
+};
+
+#endif // MICRO_BENCH_H
@@ -0,0 +1,26 @@
+// NVSCalibrationStore.h
+// Calibration profiles in ESP32 NVS (Preferences)
+// One blob per sensor serial in the "calib" namespace, plus the active serial
+
+#ifndef NVS_CALIBRATION_STORE_H
+#define NVS_CALIBRATION_STORE_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "CalibrationStore.h"
+
+class NVSCalibrationStore : public CalibrationStore {
+public:
+    NVSCalibrationStore();
+
+    bool save(const CalibrationProfile& profile) override;
+    bool load(const char* serial, CalibrationProfile& profile) override;
+    bool remove(const char* serial) override;
+    bool setActive(const char* serial) override;
+    bool getActive(char* serial, uint8_t max_len) override;
+
+private:
+    Preferences _prefs;
+};
+
+#endif // NVS_CALIBRATION_STORE_H
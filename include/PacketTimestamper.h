@@ -0,0 +1,90 @@
+// PacketTimestamper.h
+// Reconstructs MaCO2 packet times from UART byte arrival and sensor cadence
+// Each packet's arrival is back-dated from the time it was parsed using the
+// bytes still queued behind it, then a line fitted to the lower envelope of
+// the last 8 s of arrivals locks onto the sensor's nominal 8 Hz cadence
+// (no Arduino dependencies)
+
+#ifndef PACKET_TIMESTAMPER_H
+#define PACKET_TIMESTAMPER_H
+
+#include <stdint.h>
+
+// Tracking quality (all times in microseconds)
+struct TimestampStats {
+    uint32_t packets;           // Packets timestamped since reset
+    uint32_t missed;            // Packets discarded between timestamped ones
+    uint32_t relocks;           // Times the loop re-acquired after a jump
+    float period_us;            // Tracked sensor period
+    float raw_jitter_us;        // RMS deviation of raw arrival intervals
+    float jitter_us;            // RMS deviation of reconstructed intervals
+    float residual_us;          // RMS of raw arrival - reconstructed time
+};
+
+class PacketTimestamper {
+public:
+    // Defaults: 9600 baud 8N1 (10 bits per byte), 8-byte packets, 8 Hz
+    PacketTimestamper(uint32_t baud = 9600, uint8_t packet_bytes = 8,
+                      uint32_t period_us = 125000);
+
+    // Arrival estimate of the last byte of a packet that was just parsed.
+    // now_us: micros() after reading that byte; queued: bytes already
+    // received behind it (UART buffer + parser look-ahead). Bytes of later
+    // packets are back-dated by whole sensor periods, not by byte times.
+    int64_t estimateArrival(uint32_t now_us, uint32_t queued);
+
+    // Fit one arrival estimate to the cadence; returns the reconstructed
+    // time (us, 64-bit micros() timebase, strictly increasing).
+    // periods: sensor periods since the previous packet, from the bytes the
+    // parser consumed in between (1 = consecutive, 2 = one packet discarded)
+    int64_t addPacket(int64_t arrival_us, uint32_t periods = 1);
+
+    const TimestampStats& getStats() const { return _stats; }
+
+    void reset();
+
+    // Tuning
+    static const uint8_t WINDOW = 128;            // Fit window (16 s at 8 Hz)
+    static const uint8_t MIN_FIT = 32;            // Points before the period is fitted
+    static const uint8_t PERIOD_SHIFT = 6;        // Period smoothing: 1/64 per packet
+    static const uint8_t SLEW_SHIFT = 6;          // Max phase step: period / 64 per packet
+    static const uint8_t STATS_SHIFT = 5;         // Statistics averaging: 1/32
+    static constexpr float PERIOD_TOLERANCE = 0.02f;  // Sensor clock +-2 %
+    static const uint32_t RELOCK_GAP_PACKETS = 40;    // 5 s without packets
+    static constexpr float RELOCK_LATE = 1.5f;        // Periods later than the cadence allows
+
+private:
+    uint32_t _byteUs_x16;       // One UART byte (us x 16)
+    uint8_t _packetBytes;
+    float _nominalPeriodUs;
+
+    // 64-bit extension of the 32-bit micros() counter
+    uint32_t _lastNowUs;
+    uint32_t _wraps;
+
+    // Recent arrivals and their cadence index (ring)
+    int64_t _arrival[WINDOW];
+    uint32_t _index[WINDOW];
+    uint8_t _head;
+    uint8_t _count;
+    uint32_t _cadenceIndex;     // Periods since lock
+
+    bool _locked;
+    int64_t _lastTimeUs;        // Last reconstructed time
+    int64_t _lastArrivalUs;     // Last raw arrival estimate
+    float _phaseUs;             // Sub-microsecond part of _lastTimeUs
+    float _periodUs;
+
+    // Mean squares for the statistics
+    float _rawVar;
+    float _outVar;
+    float _residualVar;
+
+    TimestampStats _stats;
+
+    int64_t relock(int64_t arrival_us);
+    void fitEnvelope(float& period_us, float& offset_us) const;
+    static float average(float mean, float x);
+};
+
+#endif // PACKET_TIMESTAMPER_H
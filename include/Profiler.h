@@ -0,0 +1,108 @@
+// Profiler.h
+// Scoped cycle-count profiling of the loop() hot paths
+// PROFILE_SCOPE(point) times the enclosing block and adds the duration to a
+// fixed-size histogram per point (min / avg / p50 / p99 / max). Built with
+// -DPROFILING=1 only; otherwise the scopes expand to nothing and the report
+// says the profiler is disabled. Reports: USB command 'T', GET /api/profile.
+// With -DTRACING=1 the scopes also record begin/end events (Tracer.h).
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <Arduino.h>
+#include "Tracer.h"
+
+// Instrumented code paths (one histogram each)
+enum ProfilePoint : uint8_t {
+    PROF_MACO2_PARSE = 0,       // MaCO2Parser::parsePacket
+    PROF_ADC_UPDATE,            // ADCManager::update
+    PROF_DISPLAY_UPDATE,        // DisplayManager::updateAll (rendered frames)
+    PROF_WEB_UPDATE,            // WiFiManager::update (JSON + WebSocket)
+    PROF_HOST_OUTPUT,           // DataLogger::sendData (USB CDC)
+    PROF_POINT_COUNT
+};
+
+struct ProfileSummary {
+    const char* name;
+    uint32_t count;
+    float min_us;
+    float avg_us;
+    float p50_us;               // Upper edge of the histogram bucket (<= 25 % high)
+    float p99_us;
+    float max_us;
+};
+
+class Profiler {
+public:
+    // Log-linear histogram: 4 buckets per power of two of the tick count
+    static const uint8_t SUB_BUCKETS = 4;
+    static const uint8_t BUCKETS = 124;
+
+    // Tick source: CPU cycles on the ESP32, nanoseconds elsewhere
+    static inline uint32_t ticks() {
+#ifdef ESP_PLATFORM
+        return ESP.getCycleCount();
+#else
+        return (uint32_t)nanos();
+#endif
+    }
+
+    static bool isEnabled();
+    static const char* pointName(ProfilePoint point);
+
+    // Called from loop() only (histograms are not locked)
+    static void record(ProfilePoint point, uint32_t ticks);
+    
+    // Clear all histograms; safe from any task (done by the next record())
+    static void reset();
+
+    static bool getSummary(ProfilePoint point, ProfileSummary& summary);
+
+    // Text table (serial) / JSON (web) of all points
+    static void printReport(Print& out);
+    static void printJson(Print& out);
+
+private:
+    static uint64_t nanos();
+    static float ticksPerUs();
+    static uint8_t bucketOf(uint32_t ticks);
+    static uint32_t bucketTop(uint8_t bucket);
+};
+
+#if defined(PROFILING) || defined(TRACING)
+
+class ProfileScope {
+public:
+    explicit ProfileScope(ProfilePoint point) : _point(point) {
+#ifdef TRACING
+        Tracer::begin(Profiler::pointName(point));
+#endif
+#ifdef PROFILING
+        _start = Profiler::ticks();
+#endif
+    }
+    ~ProfileScope() {
+#ifdef PROFILING
+        Profiler::record(_point, Profiler::ticks() - _start);
+#endif
+#ifdef TRACING
+        Tracer::end(Profiler::pointName(_point));
+#endif
+    }
+
+private:
+    ProfilePoint _point;
+    uint32_t _start;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(point) ProfileScope PROFILE_CONCAT(_profileScope, __LINE__)(point)
+
+#else
+
+#define PROFILE_SCOPE(point) do {} while (0)
+
+#endif
+
+#endif // PROFILER_H
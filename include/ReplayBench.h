@@ -0,0 +1,72 @@
+// ReplayBench.h
+// Replays a UART capture through a private copy of the data pipeline
+// (device 'B', test_replay_bench)
+// Parser, ADCManager on analog inputs derived from the packets (O2 follows
+// CO2, volume a 12/min cycle), VolumetricCapno with MetabolicCalc, a
+// SampleTimeline and tab-separated DataLogger output, on a VirtualClock so
+// timeouts and timestamps match the recorded run. Each stage is timed with
+// the CPU cycle counter and folds its results into an FNV-1a digest, so a
+// replay can be compared with a golden run of the same capture.
+
+#ifndef REPLAY_BENCH_H
+#define REPLAY_BENCH_H
+
+#include <Arduino.h>
+#include "Clock.h"
+#include "UartCapture.h"
+
+// Per-packet time of one pipeline stage
+enum BenchStage : uint8_t {
+    BENCH_PARSE = 0,
+    BENCH_ADC,
+    BENCH_CAPNO,
+    BENCH_TIMELINE,
+    BENCH_OUTPUT,
+    BENCH_STAGE_COUNT
+};
+
+struct ReplayBenchResult {
+    uint32_t bytes;             // Capture bytes replayed
+    uint32_t packets;           // Parsed / rejected packets, completed breaths
+    uint32_t errors;
+    uint32_t breaths;
+    uint32_t polls;
+    uint64_t duration_us;       // Recorded time
+    uint32_t elapsed_us;        // Time the replay took
+    uint32_t pollMaxUs;         // Slowest poll
+    uint64_t pollTotalUs;
+    uint64_t stageCycles[BENCH_STAGE_COUNT];
+    uint32_t stageMaxCycles[BENCH_STAGE_COUNT];
+    uint32_t digest[BENCH_STAGE_COUNT];
+};
+
+class ReplayBench {
+public:
+    static const uint32_t POLL_INTERVAL_US = 100000;    // Data update of loop()
+    static const uint8_t MAX_PACKETS_PER_POLL = 10;     // As MAX_PACKETS_PER_LOOP
+    static const size_t DIGEST_LINE = 48;               // formatDigests() room
+
+    // Replay capture (positioned at its header) and print the report.
+    // REPLAY_REALTIME steps the virtual clock 100 ms per poll, like the
+    // live scheduler; REPLAY_FAST releases one recorded chunk per poll and
+    // moves the virtual clock to its recorded time. clock times the run
+    // (the hardware clock: throughput is real CPU time). False if capture
+    // is not a capture file or the pipeline does not fit in the heap.
+    bool run(Stream& capture, ReplayMode mode, Clock& clock, Print& out);
+
+    const ReplayBenchResult& getResult() const { return _result; }
+
+    static const char* stageName(uint8_t stage);
+
+    // "XXXXXXXX XXXXXXXX ...\n", one digest per stage
+    size_t formatDigests(char* line, size_t size) const;
+
+    // Compare with a formatDigests() line and name every stage that differs;
+    // returns the number of mismatches
+    uint8_t compareDigests(const char* golden, Print& out) const;
+
+private:
+    ReplayBenchResult _result;
+};
+
+#endif // REPLAY_BENCH_H
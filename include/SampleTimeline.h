@@ -0,0 +1,68 @@
+// SampleTimeline.h
+// Central in-memory history of MaCO2 samples, shared by all consumers
+// A BroadcastRing of compact sample rows with a sequence number per sample.
+// One writer appends; every reader keeps its own TimelineCursor and reads
+// without locks, detecting lag and overruns from the sequence numbers.
+
+#ifndef SAMPLE_TIMELINE_H
+#define SAMPLE_TIMELINE_H
+
+#include <Arduino.h>
+#include "LockFreeRing.h"
+#include "MaCO2Parser.h"  // For CO2Data structure
+
+// Read position of one consumer
+typedef BroadcastCursor TimelineCursor;
+
+// Per-packet fields of one CO2Data, as stored in the ring
+struct TimelineSample {
+    uint64_t timestamp_us;
+    uint32_t timestamp;
+    uint16_t co2_waveform;
+    uint8_t fco2;
+    uint8_t fetco2;
+    uint8_t respiratory_rate;
+    uint8_t status1;
+    uint8_t status2;
+    bool valid;
+    float sensor_value[SENSOR_COUNT];
+    uint16_t sensor_pic[SENSOR_COUNT];
+};
+
+class SampleTimeline {
+public:
+    // Samples held (64 s at 8 Hz); must be a power of two
+    static const uint16_t CAPACITY = 512;
+
+    // Append one sample (single writer). Returns its sequence number.
+    uint32_t push(const CO2Data& data);
+
+    // Sequence number the next push will get (= samples written so far)
+    uint32_t head() const { return _ring.head(); }
+
+    // Oldest sequence number still held
+    uint32_t oldest() const { return _ring.oldest(); }
+
+    // Cursor positioned at the next sample (or at the oldest held sample)
+    TimelineCursor attach(bool from_oldest = false) const { return _ring.attach(from_oldest); }
+
+    // Copy the next sample's per-packet fields into out (per-breath fields
+    // of out are left untouched). Returns false when the cursor is caught up.
+    // If the writer has lapped the cursor, it jumps to the oldest sample and
+    // the skipped samples are counted in the cursor.
+    bool read(TimelineCursor& cursor, CO2Data& out) const;
+
+    // Samples waiting for a cursor (may exceed CAPACITY after an overrun)
+    uint32_t lag(const TimelineCursor& cursor) const { return _ring.lag(cursor); }
+
+    // Random access by sequence number. sampleAt() is false once the sample
+    // has been overwritten; co2At() then returns 0.
+    bool contains(uint32_t seq) const { return (uint32_t)(seq - oldest()) < head() - oldest(); }
+    bool sampleAt(uint32_t seq, TimelineSample& sample) const { return _ring.peek(seq, sample); }
+    uint16_t co2At(uint32_t seq) const;
+
+private:
+    BroadcastRing<TimelineSample, CAPACITY> _ring;
+};
+
+#endif // SAMPLE_TIMELINE_H
@@ -0,0 +1,168 @@
+// SensorBank.h
+// Per-channel conversion state generated from the Sensors list
+// Holds each channel's filter, calibration curve and lookup tables and
+// unrolls every per-sample operation at compile time (no virtual calls).
+// No Arduino dependencies.
+
+#ifndef SENSOR_BANK_H
+#define SENSOR_BANK_H
+
+#include <stdint.h>
+#include "SensorChannels.h"
+
+// Sample values carry ADC_FRAC_BITS fractional bits below the 12-bit LSB
+// (raw count x 16), so oversampled readings keep their extra resolution
+static const uint8_t ADC_FRAC_BITS = 4;
+
+// Lookup tables are indexed by the raw 12-bit count
+static const uint16_t ADC_LUT_SIZE = 4096;
+static const uint16_t ADC_LUT_MASK = ADC_LUT_SIZE - 1;
+
+// Table value at a fractional index (result << ADC_FRAC_BITS)
+template<typename T>
+inline int32_t adcLookup(const T* lut, uint16_t index_q) {
+    const uint16_t i = index_q >> ADC_FRAC_BITS;
+    const int32_t f = index_q & ((1 << ADC_FRAC_BITS) - 1);
+    const int32_t y0 = lut[i];
+    if (f == 0 || i >= ADC_LUT_SIZE - 1) {
+        return y0 * (1 << ADC_FRAC_BITS);
+    }
+    return y0 * (1 << ADC_FRAC_BITS) + ((int32_t)lut[i + 1] - y0) * f;
+}
+
+constexpr int32_t sensorPow10(uint8_t n) { return n ? 10 * sensorPow10(n - 1) : 1; }
+
+// PIC scaling table (absent for channels without a PIC format)
+template<PICFormat F>
+struct PICTable {
+    uint16_t lut[ADC_LUT_SIZE];
+
+    void build() {
+        // Same integer scaling as Arduino map(raw, 0, 4095, 0, max)
+        const uint32_t max = (F == PIC_AN0_16BIT) ? 65535 : 1023;
+        for (uint16_t raw = 0; raw < ADC_LUT_SIZE; raw++) {
+            lut[raw] = (uint16_t)((uint32_t)raw * max / (ADC_LUT_SIZE - 1));
+        }
+    }
+
+    uint16_t get(uint16_t q) const {
+        return (uint16_t)((adcLookup(lut, q) + (1 << (ADC_FRAC_BITS - 1))) >> ADC_FRAC_BITS);
+    }
+};
+
+template<>
+struct PICTable<PIC_NONE> {
+    void build() {}
+    uint16_t get(uint16_t) const { return 0; }
+};
+
+// State of one channel
+template<typename Def>
+struct SensorState {
+    // Value table unit: one tenth of the displayed resolution
+    static const int32_t VALUE_SCALE = sensorPow10(Def::DECIMALS + 1);
+
+    typename Def::Filter filter;
+    CalibrationCurve curve;
+    int32_t valueLut[ADC_LUT_SIZE];     // Calibrated value x VALUE_SCALE
+    PICTable<Def::PIC> pic;
+
+    // mv_lut == nullptr: ADC not characterized yet (built later)
+    void buildValueTable(const uint16_t* mv_lut) {
+        if (!mv_lut) return;
+        for (uint16_t raw = 0; raw < ADC_LUT_SIZE; raw++) {
+            float y = curve.evaluate(mv_lut[raw] * 0.001f);
+            if (y < Def::minValue()) y = Def::minValue();
+            if (y > Def::maxValue()) y = Def::maxValue();
+            float scaled = y * VALUE_SCALE;
+            valueLut[raw] = (int32_t)(scaled >= 0.0f ? scaled + 0.5f : scaled - 0.5f);
+        }
+    }
+
+    float value(uint16_t q) const {
+        return adcLookup(valueLut, q) * (1.0f / ((1 << ADC_FRAC_BITS) * VALUE_SCALE));
+    }
+};
+
+// Recursive bank: channel I of the list plus the bank of the remaining ones.
+// Methods taking arrays index them with the channel's position I.
+template<uint8_t I, typename List>
+class SensorBank;
+
+template<uint8_t I>
+class SensorBank<I, SensorList<>> {
+public:
+    void setDefaultCalibration() {}
+    void buildTables(const uint16_t*) {}
+    void prime(const uint16_t*) {}
+    void filter(const uint16_t*, uint16_t*) {}
+    void setWindow(uint16_t) {}
+    void convert(const uint16_t*, SensorReading*) const {}
+    float value(uint8_t, uint16_t) const { return 0.0f; }
+    bool setCurve(uint8_t, const CalibrationCurve&, const uint16_t*) { return false; }
+    const CalibrationCurve* curve(uint8_t) const { return nullptr; }
+};
+
+template<uint8_t I, typename Def, typename... Rest>
+class SensorBank<I, SensorList<Def, Rest...>> {
+public:
+    void setDefaultCalibration() {
+        Def::defaultCalibration(_state.curve);
+        _rest.setDefaultCalibration();
+    }
+
+    // Build all tables from the calibrated mV table
+    void buildTables(const uint16_t* mv_lut) {
+        _state.buildValueTable(mv_lut);
+        _state.pic.build();
+        _rest.buildTables(mv_lut);
+    }
+
+    void prime(const uint16_t* q) {
+        _state.filter.prime(q[I]);
+        _rest.prime(q);
+    }
+
+    void filter(const uint16_t* in, uint16_t* out) {
+        out[I] = (uint16_t)_state.filter.process(in[I]);
+        _rest.filter(in, out);
+    }
+
+    void setWindow(uint16_t window) {
+        _state.filter.setWindow(window);
+        _rest.setWindow(window);
+    }
+
+    // Fixed-point samples -> physical values and PIC scaling
+    void convert(const uint16_t* q, SensorReading* out) const {
+        out[I].value = _state.value(q[I]);
+        out[I].pic = _state.pic.get(q[I]);
+        _rest.convert(q, out);
+    }
+
+    // Single channel by run-time index
+    float value(uint8_t index, uint16_t q) const {
+        return (index == I) ? _state.value(q) : _rest.value(index, q);
+    }
+
+    bool setCurve(uint8_t index, const CalibrationCurve& c, const uint16_t* mv_lut) {
+        if (index != I) {
+            return _rest.setCurve(index, c, mv_lut);
+        }
+        _state.curve = c;
+        _state.buildValueTable(mv_lut);
+        return true;
+    }
+
+    const CalibrationCurve* curve(uint8_t index) const {
+        return (index == I) ? &_state.curve : _rest.curve(index);
+    }
+
+private:
+    SensorState<Def> _state;
+    SensorBank<I + 1, SensorList<Rest...>> _rest;
+};
+
+typedef SensorBank<0, Sensors> SensorBankAll;
+
+#endif // SENSOR_BANK_H
@@ -0,0 +1,189 @@
+// SensorChannels.h
+// Compile-time registry of the analog sensor channels
+// Each channel is one definition struct (name, unit, pin, filter, default
+// calibration, output formats, views); everything per channel is generated
+// from the Sensors list below: filters and tables, calibration profiles,
+// session columns, WebSocket keys, web tiles and charts, live display rows
+// and trend channels (the last three as selected by VIEWS). Outputs with a
+// fixed layout (LabVIEW record, volumetric capnography) use channels by
+// role (SENSOR_O2, SENSOR_VOLUME). No Arduino dependencies.
+//
+// Adding a channel (e.g. airway pressure):
+//   struct PressureSensor {
+//       static const char* key()   { return "paw_cmh2o"; }
+//       static const char* label() { return "Paw"; }
+//       static const char* unit()  { return "cmH2O"; }
+//       static const uint8_t PIN = 3;
+//       ...
+//   };
+//   typedef SensorList<O2Sensor, VolumeSensor, PressureSensor> Sensors;
+
+#ifndef SENSOR_CHANNELS_H
+#define SENSOR_CHANNELS_H
+
+#include <stdint.h>
+#include "FilterChain.h"
+#include "CalibrationCurve.h"
+
+// Legacy LabVIEW (PIC) scaling of a channel's raw 12-bit count
+enum PICFormat : uint8_t {
+    PIC_NONE = 0,
+    PIC_AN0_16BIT,      // 10-bit left-justified (0-65535)
+    PIC_AN1_10BIT       // 10-bit right-justified (0-1023)
+};
+
+// Where a channel is shown (SensorInfo::views)
+enum SensorView : uint8_t {
+    SENSOR_VIEW_DISPLAY = 0x01,     // Metric box on the live TFT page
+    SENSOR_VIEW_TREND = 0x02,       // TrendStore channel and trend page panel
+    SENSOR_VIEW_WEB = 0x04          // Web page tile and chart
+};
+
+// Default per-channel filter: 3-point median (spike rejection) then moving average
+static const uint16_t ADC_FILTER_MAX_WINDOW = 64;
+typedef FilterChain<SlidingMedian<3>, MovingAverage<ADC_FILTER_MAX_WINDOW>> ADCFilterChain;
+
+// ============================================================================
+// Channel definitions
+// ============================================================================
+
+// Servomex PM1111E paramagnetic O2 sensor (0-1 V)
+struct O2Sensor {
+    static const char* key()   { return "o2_percent"; }     // JSON / data key
+    static const char* label() { return "O2"; }
+    static const char* unit()  { return "%"; }
+    static const uint8_t PIN = 1;
+    static const bool PULL_DOWN = false;
+    static const uint8_t DECIMALS = 1;
+    static const PICFormat PIC = PIC_AN0_16BIT;
+    static float minValue() { return 0.0f; }
+    static float maxValue() { return 100.0f; }
+    static float chartMin() { return 0.0f; }                // Web chart y range
+    static float chartMax() { return 100.0f; }
+    static const uint8_t VIEWS = SENSOR_VIEW_DISPLAY | SENSOR_VIEW_TREND | SENSOR_VIEW_WEB;
+    static const uint16_t TREND_MIN_SPAN = 20;             // Trend panel range (tenths of unit)
+    static void defaultCalibration(CalibrationCurve& c) { c.setLinear(0.0f, 0.0f, 3.3f, 100.0f); }
+    typedef ADCFilterChain Filter;
+};
+
+// Volume transducer (weak pull-down keeps a disconnected input at 0)
+struct VolumeSensor {
+    static const char* key()   { return "volume_ml"; }
+    static const char* label() { return "Vol"; }
+    static const char* unit()  { return "mL"; }
+    static const uint8_t PIN = 2;
+    static const bool PULL_DOWN = true;
+    static const uint8_t DECIMALS = 0;
+    static const PICFormat PIC = PIC_AN1_10BIT;
+    static float minValue() { return -1.0e6f; }
+    static float maxValue() { return 1.0e6f; }
+    static float chartMin() { return 0.0f; }
+    static float chartMax() { return 1000.0f; }
+    static const uint8_t VIEWS = SENSOR_VIEW_WEB;
+    static const uint16_t TREND_MIN_SPAN = 100;
+    static void defaultCalibration(CalibrationCurve& c) { c.setLinear(0.0f, 0.0f, 1.0f, 200.0f); }
+    typedef ADCFilterChain Filter;
+};
+
+// ============================================================================
+// Registry machinery
+// ============================================================================
+
+// Run-time description of a channel (generated from its definition)
+struct SensorInfo {
+    const char* key;
+    const char* label;
+    const char* unit;
+    uint8_t pin;
+    bool pull_down;
+    uint8_t decimals;
+    PICFormat pic;
+    float min_value;
+    float max_value;
+    float chart_min;
+    float chart_max;
+    uint8_t views;          // SensorView flags
+    uint16_t trend_min_span;
+};
+
+// One converted channel value in CO2Data
+struct SensorReading {
+    float value;        // Physical units (SensorInfo::unit)
+    uint16_t pic;       // PIC-scaled raw value (0 if the channel has none)
+};
+
+template<typename... Defs>
+struct SensorList;
+
+template<>
+struct SensorList<> {
+    static const uint8_t COUNT = 0;
+};
+
+template<typename First, typename... Rest>
+struct SensorList<First, Rest...> {
+    static const uint8_t COUNT = 1 + SensorList<Rest...>::COUNT;
+    typedef First Head;
+    typedef SensorList<Rest...> Tail;
+
+    static const SensorInfo& info(uint8_t index) {
+        static const SensorInfo table[COUNT] = {
+            makeInfo<First>(), makeInfo<Rest>()...
+        };
+        return table[index];
+    }
+
+private:
+    template<typename D>
+    static SensorInfo makeInfo() {
+        SensorInfo i = { D::key(), D::label(), D::unit(), D::PIN, D::PULL_DOWN,
+                         D::DECIMALS, D::PIC, D::minValue(), D::maxValue(),
+                         D::chartMin(), D::chartMax(), D::VIEWS, D::TREND_MIN_SPAN };
+        return i;
+    }
+};
+
+// Number of channels in a list with a view flag (compile time)
+template<uint8_t View, typename List>
+struct SensorViewCount;
+
+template<uint8_t View>
+struct SensorViewCount<View, SensorList<>> {
+    static const uint8_t value = 0;
+};
+
+template<uint8_t View, typename First, typename... Rest>
+struct SensorViewCount<View, SensorList<First, Rest...>> {
+    static const uint8_t value = ((First::VIEWS & View) ? 1 : 0) +
+                                 SensorViewCount<View, SensorList<Rest...>>::value;
+};
+
+// Position of a definition in a list
+template<typename Def, typename List>
+struct SensorIndexOf;
+
+template<typename Def, typename... Rest>
+struct SensorIndexOf<Def, SensorList<Def, Rest...>> {
+    static const uint8_t value = 0;
+};
+
+template<typename Def, typename First, typename... Rest>
+struct SensorIndexOf<Def, SensorList<First, Rest...>> {
+    static const uint8_t value = 1 + SensorIndexOf<Def, SensorList<Rest...>>::value;
+};
+
+// ============================================================================
+// The channel list (single place to add a sensor)
+// ============================================================================
+
+typedef SensorList<O2Sensor, VolumeSensor> Sensors;
+
+static const uint8_t SENSOR_COUNT = Sensors::COUNT;
+static const uint8_t SENSOR_DISPLAY_COUNT = SensorViewCount<SENSOR_VIEW_DISPLAY, Sensors>::value;
+static const uint8_t SENSOR_TREND_COUNT = SensorViewCount<SENSOR_VIEW_TREND, Sensors>::value;
+
+// Indices of channels that other modules use by role
+static const uint8_t SENSOR_O2 = SensorIndexOf<O2Sensor, Sensors>::value;
+static const uint8_t SENSOR_VOLUME = SensorIndexOf<VolumeSensor, Sensors>::value;
+
+#endif // SENSOR_CHANNELS_H
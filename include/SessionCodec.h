@@ -0,0 +1,105 @@
+// SessionCodec.h
+// Compression of recorded sessions: columnar delta / zigzag varint blocks
+// Records are grouped into blocks of up to 32. A block starts with a keyframe
+// (its first record in full), so a reader can start at any block. Each field
+// then follows as one column of deltas from the previous record (timestamps:
+// delta of the delta), as zigzag varint tokens with every run of zero deltas
+// collapsed into one token. No Arduino dependency: host-side tools share
+// this code.
+//
+// File:    SessionFileHeader (16 bytes), then blocks
+// Block:   sync 0xB5, record count u8, body length u16 LE, body
+// Body:    keyframe: zigzag varint per field
+//          columns:  per field, tokens for records 1 .. count - 1
+// Token:   LEB128 of (value << 1 | run): run 1 = value + 1 zero deltas,
+//          run 0 = zigzag delta. The first byte holds 6 value bits.
+
+#ifndef SESSION_CODEC_H
+#define SESSION_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "SensorChannels.h"
+
+// One stored sample (sensor values in fixed point, SensorInfo::decimals).
+// Only the low 32 bits of timestamp_us are stored; the decoder restores the
+// rest from the ms timestamp.
+struct SessionRecord {
+    uint64_t timestamp_us;
+    uint32_t timestamp;
+    uint16_t co2_waveform;
+    uint8_t fco2;
+    uint8_t fetco2;
+    uint8_t respiratory_rate;
+    uint8_t status1;
+    uint8_t status2;
+    uint8_t valid;
+    int32_t sensors[SENSOR_COUNT];
+};
+
+// Column order in a block
+enum SessionField : uint8_t {
+    SESSION_FIELD_TIMESTAMP = 0,
+    SESSION_FIELD_TIMESTAMP_US,
+    SESSION_FIELD_CO2,
+    SESSION_FIELD_FCO2,
+    SESSION_FIELD_FETCO2,
+    SESSION_FIELD_RR,
+    SESSION_FIELD_STATUS1,
+    SESSION_FIELD_STATUS2,
+    SESSION_FIELD_VALID,
+    SESSION_FIELD_SENSORS           // One column per sensor channel from here
+};
+
+// "SES3", field count u8, block records u8, reserved u16, record count u32
+// (0xFFFFFFFF until the recording is closed), duration ms u32
+struct SessionFileHeader {
+    static const uint8_t SIZE = 16;
+    static const uint32_t OPEN = 0xFFFFFFFF;
+
+    uint8_t fields;
+    uint8_t blockRecords;
+    uint32_t records;
+    uint32_t duration_ms;
+
+    void write(uint8_t* out) const;
+    bool read(const uint8_t* in);   // false if not a session file
+};
+
+class SessionEncoder {
+public:
+    static const uint8_t BLOCK_RECORDS = 32;        // Keyframe interval (4 s at 8 Hz)
+    static const uint8_t FIELD_COUNT = SESSION_FIELD_SENSORS + SENSOR_COUNT;
+    static const uint8_t BLOCK_HEADER = 4;
+    static const uint8_t BLOCK_SYNC = 0xB5;
+    // Every value a 5-byte varint
+    static const uint16_t MAX_BLOCK = BLOCK_HEADER + 5 * FIELD_COUNT * BLOCK_RECORDS;
+
+    SessionEncoder();
+
+    // Add one record; true when the block is full (call finishBlock())
+    bool add(const SessionRecord& record);
+
+    // Encode the records added since the last block into out (MAX_BLOCK
+    // bytes) and start a new block. Returns the block length, 0 if empty.
+    size_t finishBlock(uint8_t* out);
+
+    uint8_t pending() const { return _count; }
+
+private:
+    int32_t _columns[FIELD_COUNT][BLOCK_RECORDS];
+    uint8_t _count;
+};
+
+class SessionDecoder {
+public:
+    // Length of the block that starts at in (header + body) from its 4-byte
+    // header, 0 if in is not at a block
+    static size_t blockLength(const uint8_t* in);
+
+    // Decode one complete block into out (BLOCK_RECORDS entries). Returns
+    // the records decoded, 0 for a corrupt block.
+    static uint8_t decodeBlock(const uint8_t* block, size_t len, SessionRecord* out);
+};
+
+#endif // SESSION_CODEC_H
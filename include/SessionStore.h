@@ -0,0 +1,117 @@
+// SessionStore.h
+// Recorded measurement sessions on flash (LittleFS)
+// While recording, every sample goes to /sessions/<id>.ses, compressed in
+// blocks of 32 records by SessionCodec (about 4 s of data per flash write).
+// SessionExport streams a stored session back out in bounded pieces (raw
+// byte range or CSV), so a download of any length needs a few kB of RAM.
+// File format: SessionCodec.h
+
+#ifndef SESSION_STORE_H
+#define SESSION_STORE_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include "MaCO2Parser.h"  // For CO2Data structure
+#include "SessionCodec.h"
+
+class SessionStore {
+public:
+    static const uint8_t SYNC_BLOCKS = 8;           // Commit to flash every ~32 s
+
+    SessionStore();
+
+    // Create the session directory and find the next free id
+    bool begin(fs::FS& fs);
+
+    // Start a new session; it stops by itself after max_bytes
+    bool startRecording(uint32_t max_bytes = 2000000);
+    void stopRecording();
+    bool isRecording() const { return _recordingId != 0; }
+    uint32_t getRecordingId() const { return _recordingId; }       // 0 when idle
+    uint32_t getRecordCount() const { return _records; }
+
+    // Append one sample (loop only; no-op when idle)
+    void addSample(const CO2Data& data);
+
+    // Stored sessions as a JSON array of {id, bytes, records, duration_ms,
+    // recording} (any task)
+    void printJson(Print& out) const;
+
+    fs::FS* getFS() const { return _fs; }
+
+    static void path(uint32_t id, char* out, size_t len);
+    static void fromData(const CO2Data& data, SessionRecord& record);
+
+    // Record count and duration of a file whose header was not finalized
+    // (recording cut short): walks the block headers
+    static bool scan(File& file, uint32_t& records, uint32_t& duration_ms);
+
+private:
+    fs::FS* _fs;
+    File _file;
+    volatile uint32_t _recordingId;
+    uint32_t _nextId;
+    uint32_t _maxBytes;
+    uint32_t _bytes;            // Written to the file (header included)
+    uint32_t _records;
+    uint32_t _firstMs;          // Timestamps of the first and last record
+    uint32_t _lastMs;
+    uint8_t _blocksSinceSync;
+    SessionEncoder _encoder;
+    uint8_t _block[SessionEncoder::MAX_BLOCK];
+
+    bool writeBlock();
+};
+
+// Incremental read-out of one stored session, for chunked HTTP responses
+enum SessionExportFormat {
+    SESSION_EXPORT_RAW,         // File bytes (a byte range of them)
+    SESSION_EXPORT_CSV          // Header line, then one line per record
+};
+
+// Byte range requested by an HTTP Range header
+enum RangeResult {
+    RANGE_NONE,                 // No (usable) range: send the whole file
+    RANGE_OK,
+    RANGE_UNSATISFIABLE         // Starts beyond the end: 416
+};
+
+class SessionExport {
+public:
+    static const uint16_t BLOCK_SIZE = 1024;        // Largest flash read per raw call
+
+    // Single byte range of a Range header ("bytes=a-b", "bytes=a-",
+    // "bytes=-n") of a size-byte file, clipped to it. Several ranges or any
+    // other syntax give RANGE_NONE.
+    static RangeResult parseRange(const char* header, uint32_t size, uint32_t& first, uint32_t& last);
+
+    SessionExport(fs::FS& fs, uint32_t id, SessionExportFormat format);
+
+    bool isOpen() const { return _open; }
+    uint32_t size() const { return _size; }         // File bytes
+
+    // Raw only: limit the output to bytes first..last (inclusive)
+    bool setRange(uint32_t first, uint32_t last);
+
+    // Fill buf with the next part; 0 when done
+    size_t read(uint8_t* buf, size_t maxLen);
+
+private:
+    File _file;
+    SessionExportFormat _format;
+    bool _open;
+    uint32_t _size;
+    uint32_t _remaining;        // Raw bytes still to send
+    bool _headerSent;
+    uint8_t _block[SessionEncoder::MAX_BLOCK];      // CSV: one compressed block
+    SessionRecord _records[SessionEncoder::BLOCK_RECORDS];  // and its records
+    uint8_t _recordCount;
+    uint8_t _recordPos;
+    char _line[128];            // Formatted line not yet (fully) copied out
+    uint8_t _lineLen;
+    uint8_t _linePos;
+
+    bool nextLine();
+};
+
+#endif // SESSION_STORE_H
@@ -0,0 +1,130 @@
+// Tracer.h
+// Begin/end events of pipeline stages and tasks in a RAM ring, exported as
+// Chrome trace_event JSON (open in Perfetto / chrome://tracing)
+// Built with -DTRACING=1 only; otherwise TRACE_SCOPE expands to nothing.
+// PROFILE_SCOPE points are traced too. Any task may record: slots are
+// claimed with one atomic increment, the oldest events are overwritten.
+// Each slot carries a sequence stamp (odd while written, like
+// BroadcastRing), so an export skips slots that are incomplete or were
+// reused while it copied them.
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <Arduino.h>
+#include <atomic>
+
+struct TraceEvent {
+    uint32_t ts_us;             // micros() (synchronised across both cores)
+    const char* name;           // String literal
+    uint32_t task;              // Task handle (or host thread), identifies the track
+    char phase;                 // 'B' begin, 'E' end
+};
+
+class Tracer {
+public:
+    static const uint16_t EVENTS = 2048;        // Power of two (20 B each)
+    static const uint8_t MAX_TASKS = 8;         // Named tracks
+
+    static bool isEnabled();
+
+    static inline void begin(const char* name) { record(name, 'B'); }
+    static inline void end(const char* name) { record(name, 'E'); }
+
+    // Name the calling task's track (once, from the task itself)
+    static void nameTask(const char* name);
+
+    // Forget all events (exports start after the current ones)
+    static void clear();
+
+    // Write the ring as trace_event JSON (recording pauses meanwhile)
+    static void dumpJson(Print& out);
+
+private:
+    friend class TraceExport;
+
+    struct TaskName {
+        uint32_t task;
+        const char* name;
+    };
+
+    // Event seq is complete when stamp == 2 * seq + 2 (2 * seq + 1 while
+    // it is written)
+    struct Slot {
+        std::atomic<uint32_t> stamp;
+        std::atomic<uint32_t> ts_us;
+        std::atomic<const char*> name;
+        std::atomic<uint32_t> task;
+        std::atomic<char> phase;
+    };
+
+    static Slot _slots[];
+    static std::atomic<uint32_t> _head;         // Events ever claimed
+    static std::atomic<uint32_t> _cleared;      // First event after the last clear()
+    static std::atomic<uint8_t> _readers;       // Exports in progress (recording paused)
+    static TaskName _tasks[MAX_TASKS];
+    static std::atomic<uint8_t> _taskCount;
+
+    static void record(const char* name, char phase);
+
+    // Event seq if its slot holds it complete (stamp checked before and
+    // after the copy)
+    static bool copy(uint32_t seq, TraceEvent& event);
+    static uint32_t nowUs();
+    static uint32_t currentTask();
+};
+
+// Incremental export, for chunked HTTP responses (AsyncTCP task) as well
+// as the serial dump. Recording is paused from construction to destruction;
+// events still being written when it starts are skipped.
+class TraceExport {
+public:
+    TraceExport();
+    ~TraceExport();
+
+    // Fill buf with the next part of the JSON; 0 when done
+    size_t read(uint8_t* buf, size_t maxLen);
+
+private:
+    static const uint8_t MAX_TRACKS = 16;
+
+    enum Part { PART_HEADER, PART_TASKS, PART_EVENTS, PART_FOOTER, PART_DONE };
+
+    Part _part;
+    uint32_t _next;             // Next event / track index
+    uint32_t _start;            // Oldest event in the ring
+    uint32_t _end;
+    uint32_t _prevUs;           // Raw timestamp of the previous event
+    int64_t _timeUs;            // Its time since the oldest event
+    uint32_t _tracks[MAX_TRACKS];   // Distinct tasks in the ring
+    uint8_t _trackCount;
+    bool _first;                // No comma before the next element
+    char _line[160];            // Formatted element not yet (fully) copied out
+    uint16_t _lineLen;
+    uint16_t _linePos;
+
+    bool nextLine();
+};
+
+#ifdef TRACING
+
+class TraceScope {
+public:
+    explicit TraceScope(const char* name) : _name(name) { Tracer::begin(name); }
+    ~TraceScope() { Tracer::end(_name); }
+
+private:
+    const char* _name;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(_traceScope, __LINE__)(name)
+
+#else
+
+#define TRACE_SCOPE(name) do {} while (0)
+
+#endif
+
+#endif // TRACER_H
@@ -0,0 +1,132 @@
+// TrendStore.h
+// Long-term trend storage for EtCO2, RR and the trended sensor channels
+// Incremental multi-resolution rollups (min/mean/max per 1 s, 10 s, 1 min)
+// held in fixed memory, so trend views never rescan raw samples
+
+#ifndef TREND_STORE_H
+#define TREND_STORE_H
+
+#include <Arduino.h>
+#include "MaCO2Parser.h"  // For CO2Data structure
+
+// Trended channels. All values are stored in tenths of the channel unit:
+//   EtCO2: mmHg x 10, RR: breaths/min x 10, then one channel per sensor with
+//   SENSOR_VIEW_TREND in Sensors order (unit x 10, clamped to the sensor's
+//   range and to 0..6553.4)
+enum TrendChannel : uint8_t {
+    TREND_ETCO2 = 0,
+    TREND_RR,
+    TREND_SENSOR_FIRST,
+    TREND_CHANNEL_COUNT = TREND_SENSOR_FIRST + SENSOR_TREND_COUNT
+};
+
+// Rollup resolutions
+enum TrendTier : uint8_t {
+    TREND_TIER_1S = 0,      // 1 s buckets, last 10 min
+    TREND_TIER_10S,         // 10 s buckets, last 4 h
+    TREND_TIER_1MIN,        // 1 min buckets, last 12 h
+    TREND_TIER_COUNT
+};
+
+// Zoom levels offered by the trend page
+enum TrendZoom : uint8_t {
+    TREND_ZOOM_1H = 0,
+    TREND_ZOOM_4H,
+    TREND_ZOOM_12H,
+    TREND_ZOOM_COUNT
+};
+
+// Marker for buckets without samples (sensor disconnected, gaps)
+static const uint16_t TREND_NO_DATA = 0xFFFF;
+
+// One closed bucket: min/mean/max per channel (tenths of unit)
+struct TrendBucket {
+    uint16_t min[TREND_CHANNEL_COUNT];
+    uint16_t mean[TREND_CHANNEL_COUNT];
+    uint16_t max[TREND_CHANNEL_COUNT];
+
+    bool hasData() const { return mean[0] != TREND_NO_DATA; }
+};
+
+// One rendered column of a trend view
+struct TrendColumn {
+    uint16_t min;
+    uint16_t mean;
+    uint16_t max;
+};
+
+class TrendStore {
+public:
+    TrendStore();
+
+    // Feed one sample (typically every valid MaCO2 packet, 8Hz)
+    void addSample(const CO2Data& data, uint32_t now_ms);
+
+    // Discard all history
+    void clear();
+
+    // Number of closed buckets available in a tier (0..capacity)
+    uint16_t getBucketCount(TrendTier tier) const;
+
+    // Closed bucket by age (0 = most recent)
+    const TrendBucket& getBucket(TrendTier tier, uint16_t age) const;
+
+    // Bucket length in seconds / capacity for a tier
+    static uint16_t getBucketSeconds(TrendTier tier);
+    static uint16_t getCapacity(TrendTier tier);
+
+    // Tier and bucket span backing a zoom level
+    static TrendTier getZoomTier(TrendZoom zoom);
+    static uint16_t getZoomBuckets(TrendZoom zoom);
+    static const char* getZoomName(TrendZoom zoom);
+
+    // Reduce a zoom view to `columns` min/mean/max columns (oldest first).
+    // Reads at most getZoomBuckets(zoom) precomputed buckets - never raw samples.
+    // Returns number of columns that contain data.
+    uint16_t renderColumns(TrendZoom zoom, TrendChannel channel,
+                           TrendColumn* out, uint16_t columns) const;
+
+    // Incremented every time a bucket closes in a tier (lets the display skip redraws)
+    uint32_t getRevision(TrendTier tier) const { return _revision[tier]; }
+
+    // Trend channel of a sensor, or TREND_CHANNEL_COUNT if it is not trended
+    static TrendChannel sensorChannel(uint8_t sensor);
+
+private:
+    static const uint16_t TIER_1S_CAPACITY = 600;     // 10 min
+    static const uint16_t TIER_10S_CAPACITY = 1440;   // 4 h
+    static const uint16_t TIER_1MIN_CAPACITY = 720;   // 12 h
+
+    // Open (accumulating) bucket per tier
+    struct Accumulator {
+        uint32_t bucketIndex;   // now_ms / bucket length of the open bucket
+        uint32_t sum[TREND_CHANNEL_COUNT];
+        uint16_t min[TREND_CHANNEL_COUNT];
+        uint16_t max[TREND_CHANNEL_COUNT];
+        uint16_t count;
+        bool started;
+    };
+
+    // Closed buckets (circular buffer per tier)
+    struct Ring {
+        TrendBucket* buckets;
+        uint16_t capacity;
+        uint16_t head;          // Next write position
+        uint16_t count;
+    };
+
+    TrendBucket _buckets1s[TIER_1S_CAPACITY];
+    TrendBucket _buckets10s[TIER_10S_CAPACITY];
+    TrendBucket _buckets1min[TIER_1MIN_CAPACITY];
+
+    Ring _rings[TREND_TIER_COUNT];
+    Accumulator _acc[TREND_TIER_COUNT];
+    uint32_t _revision[TREND_TIER_COUNT];
+
+    void resetAccumulator(Accumulator& acc, uint32_t bucketIndex);
+    void closeBucket(TrendTier tier);
+    void pushEmpty(TrendTier tier);
+    void pushBucket(TrendTier tier, const TrendBucket& bucket);
+};
+
+#endif // TREND_STORE_H
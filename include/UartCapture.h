@@ -0,0 +1,128 @@
+// UartCapture.h
+// Record and replay of the raw MaCO2 UART byte stream
+// UartRecorder sits between the UART and MaCO2Parser and tees every byte the
+// parser reads into a compact capture file; UartReplay plays such a file back
+// as a Stream, in real time or one chunk per poll as fast as possible.
+//
+// Capture format (little endian):
+//   header  "MCR1", uint32 baud, uint32 clock us at start, uint32 reserved
+//   chunk   varint dt_us (since previous chunk), varint length, raw bytes
+// A chunk is what the firmware got from the UART driver in one poll, so a
+// replay presents the parser with the same batches at the same times.
+
+#ifndef UART_CAPTURE_H
+#define UART_CAPTURE_H
+
+#include <Arduino.h>
+#include "Clock.h"
+
+// Capture statistics
+struct CaptureStats {
+    uint32_t bytes;             // Raw UART bytes recorded / replayed
+    uint32_t chunks;            // Chunks (polls that got data)
+    uint32_t fileBytes;         // Encoded size (header + chunks)
+    uint64_t duration_us;       // Time of the last chunk after start
+};
+
+class UartRecorder : public Stream {
+public:
+    static const uint8_t HEADER_SIZE = 16;
+    static const uint8_t MAX_CHUNK = 64;            // Bytes per chunk
+    static const uint32_t CHUNK_GAP_US = 2000;      // Reads further apart start a new chunk
+
+    explicit UartRecorder(Stream& source);
+
+    // Time source for chunk timestamps (default: hardware clock)
+    void setClock(Clock* clock) { _clock = clock; }
+
+    // Start teeing received bytes into sink (header written immediately).
+    // Recording stops by itself once max_bytes have been written.
+    bool startRecording(Print* sink, uint32_t baud, uint32_t max_bytes = 1000000);
+    void stopRecording();
+    bool isRecording() const { return _sink != nullptr; }
+    const CaptureStats& getStats() const { return _stats; }
+
+    // Stream (reads are recorded, writes go to the sensor unrecorded)
+    int available() override { return _source.available(); }
+    int read() override;
+    int peek() override { return _source.peek(); }
+    size_t write(uint8_t b) override { return _source.write(b); }
+    size_t write(const uint8_t* buf, size_t len) override { return _source.write(buf, len); }
+    void flush() override { _source.flush(); }
+    using Print::write;
+
+private:
+    Stream& _source;
+    Clock* _clock;
+    Print* _sink;
+    uint32_t _maxBytes;
+    uint32_t _lastChunkUs;      // Clock time (us) of the previous chunk (or start)
+    uint32_t _lastReadUs;       // Clock time (us) of the last recorded byte
+    uint8_t _chunk[MAX_CHUNK];
+    uint8_t _chunkLen;
+    uint32_t _chunkUs;          // Clock time (us) of the chunk's first byte
+    CaptureStats _stats;
+
+    void flushChunk();
+};
+
+enum ReplayMode {
+    REPLAY_REALTIME,            // Chunks released at their recorded times
+    REPLAY_FAST                 // One chunk per poll, no waiting
+};
+
+class UartReplay : public Stream {
+public:
+    explicit UartReplay(Stream& capture);
+
+    // Time source for REPLAY_REALTIME (default: hardware clock). With a
+    // VirtualClock the driver decides how fast "real time" runs.
+    void setClock(Clock* clock) { _clock = clock; }
+
+    // Read the header; false if this is not a capture file
+    bool begin(ReplayMode mode);
+
+    // Release the chunks that are due: in REPLAY_REALTIME those recorded up
+    // to now (clock time since begin), in REPLAY_FAST the next one. Call once
+    // per poll before parsing. Returns false once the capture is exhausted
+    // and all released bytes have been read.
+    bool update();
+
+    // Recording time of the last released chunk (us since capture start)
+    uint64_t getTime() const { return _timeUs; }
+    uint32_t getBaud() const { return _baud; }
+    bool isFinished() const { return _finished && _pos == _len; }
+    const CaptureStats& getStats() const { return _stats; }
+
+    // Stream (commands written during replay are counted and dropped)
+    int available() override { return _len - _pos; }
+    int read() override { return (_pos < _len) ? _buf[_pos++] : -1; }
+    int peek() override { return (_pos < _len) ? _buf[_pos] : -1; }
+    size_t write(uint8_t) override { _commandBytes++; return 1; }
+    using Print::write;
+    uint32_t getCommandBytes() const { return _commandBytes; }
+
+private:
+    Stream& _capture;
+    Clock* _clock;
+    ReplayMode _mode;
+    uint32_t _baud;
+    uint32_t _lastClockUs;      // Clock reading at the previous update
+    uint64_t _elapsedUs;        // Clock time since begin (REPLAY_REALTIME)
+    uint64_t _timeUs;
+    uint64_t _nextUs;           // Time of the chunk header already read
+    uint32_t _nextLen;
+    bool _havePending;
+    bool _finished;
+    uint8_t _buf[256];          // Released, unread bytes
+    uint16_t _pos;
+    uint16_t _len;
+    uint32_t _commandBytes;
+    CaptureStats _stats;
+
+    bool readChunkHeader();
+    bool releaseChunk();
+    bool readVarint(uint32_t& value);
+};
+
+#endif // UART_CAPTURE_H
@@ -0,0 +1,149 @@
+// VolumetricCapno.h
+// Volumetric capnography: CO2 x volume per breath
+// Estimates the sampling-line transport delay of CO2 versus volume with a
+// streaming cross-correlation (CO2 downstroke vs inspiratory onset), aligns the two signals and integrates
+// CO2 x flow per expiration (VCO2, Fowler dead space). Runs at the rate of
+// the ADC volume stream, with the 8 Hz CO2 interpolated to each volume
+// sample. No Arduino dependencies.
+
+#ifndef VOLUMETRIC_CAPNO_H
+#define VOLUMETRIC_CAPNO_H
+
+#include <stdint.h>
+
+// Result of one aligned expiration
+struct VolumetricBreath {
+    float vte_ml;           // Expired tidal volume
+    float vco2_ml;          // CO2 eliminated in this breath
+    float vco2_ml_min;      // CO2 elimination rate (breath VCO2 / breath period)
+    float vd_fowler_ml;     // Airway (Fowler) dead space
+    float delay_ms;         // CO2-vs-volume delay used for alignment
+    float vti_ml;           // Inspired volume of the preceding inspiration
+    float fi_o2;            // Inspired O2 fraction (volume-weighted)
+    float fi_co2;           // Inspired CO2 fraction (volume-weighted)
+    float fe_o2;            // Mixed expired O2 fraction (volume-weighted)
+    float fe_co2;           // Mixed expired CO2 fraction (volume-weighted)
+    float period_ms;        // Breath period (end to end), 0 for the first breath
+    uint32_t breath_count;  // Volumetric breaths since reset
+    uint32_t end_time;      // Timestamp (ms) at end of expiration
+};
+
+class VolumetricCapno {
+public:
+    VolumetricCapno();
+
+    // Feed one co-sampled set. O2 (if sampled from the same line) shares the
+    // CO2 transport delay. Returns true when an expiration was completed.
+    bool addSample(float co2_mmhg, float volume_ml, uint32_t timestamp_ms,
+                   float o2_percent = 0.0f);
+
+    // High-rate input: volume samples (micros() timebase) wait in a queue
+    // until the next CO2 packet, then each is processed with CO2 and O2
+    // interpolated between the packets around it. If packets stop, the
+    // oldest samples are processed with the last CO2 held. Both return true
+    // when an expiration was completed.
+    bool addVolume(float volume_ml, uint32_t t_us);
+    bool addCO2(float co2_mmhg, float o2_percent, uint64_t t_us);
+
+    // Last completed breath
+    const VolumetricBreath& getLastBreath() const { return _last; }
+
+    // Current delay estimate (ms) and whether it comes from the correlator
+    float getDelayMs() const { return _delaySamples * _periodMs; }
+    bool isDelayLocked() const { return _delayLocked; }
+
+    // Delay used until the correlator has locked (default 0 ms)
+    void setDefaultDelayMs(float delay_ms) { _defaultDelayMs = delay_ms; }
+
+    // Barometric pressure for PCO2 -> FCO2 conversion (default 760 mmHg)
+    void setBarometricPressure(float mmhg) { if (mmhg > 0.0f) _baroMmHg = mmhg; }
+
+    // Flow polarity: true if the volume signal rises during expiration (default)
+    void setExpiratoryPositive(bool positive) { _flowSign = positive ? 1.0f : -1.0f; }
+
+    // Flow threshold (mL/s) separating expiration from pause/inspiration
+    void setFlowThreshold(float ml_per_s) { _flowThreshold = ml_per_s; }
+
+    void reset();
+
+    // Delay search range and history depth (samples at the input rate)
+    static const uint16_t MAX_LAG = 320;            // 3.2 s at 100 Hz
+    static const uint16_t HISTORY = MAX_LAG + 2;    // Volume history for interpolation
+    static const uint16_t MAX_CURVE_POINTS = 512;   // Stored (volume, CO2) points per expiration
+    static const uint8_t VOLUME_QUEUE = 64;         // Volume samples awaiting CO2 (0.64 s at 100 Hz)
+
+private:
+    // Streaming cross-correlation (exponentially weighted, O(MAX_LAG) per sample)
+    float _corr[MAX_LAG];
+    uint8_t _onsetHist[MAX_LAG];    // Inspiratory-onset indicator history
+    float _prevCO2;
+    int8_t _prevPhase;              // Last flow phase (+1 exp, -1 insp)
+    float _corrMs;                  // Time integrated into the correlator
+    float _delaySamples;
+    bool _delayLocked;
+    float _defaultDelayMs;
+
+    // Volume history for delay compensation (ring)
+    float _volHist[HISTORY];
+    uint16_t _histHead;
+    uint16_t _histCount;
+
+    // Timing
+    uint32_t _lastTime;
+    float _periodMs;                // EMA of the sample interval
+    bool _primed;
+    bool _periodPrimed;
+
+    // High-rate input: queued volume samples and the CO2 packets around them
+    struct QueuedVolume {
+        float volume_ml;
+        uint32_t t_us;
+    };
+    QueuedVolume _volQueue[VOLUME_QUEUE];
+    uint8_t _queueHead;
+    uint8_t _queueCount;
+    float _co2Prev;                 // Packet before the last one
+    float _o2Prev;
+    uint64_t _co2PrevUs;
+    float _co2Last;                 // Last packet
+    float _o2Last;
+    uint64_t _co2LastUs;
+    uint8_t _co2Packets;            // Packets seen (saturates at 2)
+
+    // Aligned stream state
+    float _prevAlignedVol;
+    bool _alignedPrimed;
+    bool _expiring;
+    uint32_t _expStart;
+    uint32_t _prevBreathEnd;
+    float _vte;
+    float _vco2;
+    float _feO2Sum;                 // sum(O2 fraction * dV) over expiration
+    float _vti;                     // Inspired volume (current inspiration)
+    float _fiO2Sum;                 // sum(O2 fraction * dV) over inspiration
+    float _fiCO2Sum;                // sum(CO2 fraction * dV) over inspiration
+    float _pendingVti;              // Inspiration preceding the current expiration
+    float _pendingFiO2;
+    float _pendingFiCO2;
+    float _co2Min;
+    float _co2Max;
+    uint16_t _curveLen;
+    float _curveVol[MAX_CURVE_POINTS];
+    float _curveCO2[MAX_CURVE_POINTS];
+
+    // Configuration
+    float _baroMmHg;
+    float _flowSign;
+    float _flowThreshold;
+
+    VolumetricBreath _last;
+
+    bool releaseVolume(const QueuedVolume& v, bool held);
+    void updateCorrelation(float co2, float flow, float dt_s);
+    float delayedVolume(float delay_samples) const;
+    bool processAligned(float co2, float o2, float volume, uint32_t t, float dt_s);
+    bool finishBreath(uint32_t t);
+    float fowlerDeadSpace() const;
+};
+
+#endif // VOLUMETRIC_CAPNO_H
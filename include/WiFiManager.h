@@ -11,6 +11,18 @@
 #include <ArduinoJson.h>
 #include "MaCO2Parser.h"  // For CO2Data structure
 #include "DataLogger.h"   // For output format control
+#include "SampleTimeline.h"
+#include "LockFreeRing.h"
+#include "SessionStore.h"
+
+// Last session download (GET /api/sessions/<id>)
+struct SessionDownloadStats {
+    uint32_t id;
+    uint32_t bytes;             // Sent
+    uint32_t ms;                // Request to last block
+    uint32_t heapPeakUse;       // Free heap at the request minus the lowest seen
+    uint32_t downloads;         // Completed or aborted since boot
+};
 
 class WiFiManager {
 public:
@@ -33,7 +45,16 @@ public:
     // Set DataLogger reference (for format control)
     void setDataLogger(DataLogger* logger) { _dataLogger = logger; }
     
-    // Update with new data (broadcasts to WebSocket clients)
+    // Read from a SampleTimeline (each sample is broadcast exactly once)
+    void setTimeline(const SampleTimeline* timeline);
+    const TimelineCursor& getTimelineCursor() const { return _cursor; }
+    
+    // Serve stored sessions (/api/sessions)
+    void setSessionStore(const SessionStore* sessions) { _sessions = sessions; }
+    const SessionDownloadStats& getLastDownload() const { return _lastDownload; }
+    
+    // Update with new data (broadcasts to WebSocket clients). With a
+    // timeline, one message per new sample; per-breath fields come from data.
     void update(const CO2Data& data);
     
     // Handle WebSocket messages and execute commands
@@ -51,6 +72,8 @@ public:
     uint8_t getCommand();
     
 private:
+    friend class MicroBench;    // Benchmarks private hot paths
+    
     AsyncWebServer* _server;
     AsyncWebSocket* _ws;
     
@@ -58,20 +81,30 @@ private:
     bool _isAP;
     bool _serverRunning;
     
-    // Command queue (simple FIFO)
-    static const uint8_t CMD_QUEUE_SIZE = 10;
-    uint8_t _cmdQueue[CMD_QUEUE_SIZE];
-    uint8_t _cmdQueueHead;
-    uint8_t _cmdQueueTail;
+    // Command queue: async TCP task (producer) -> loop() (consumer)
+    static const uint8_t CMD_QUEUE_SIZE = 16;
+    SPSCRing<uint8_t, CMD_QUEUE_SIZE> _cmdQueue;
     
     // DataLogger reference (for format control)
     DataLogger* _dataLogger;
     
+    // Timeline reader
+    const SampleTimeline* _timeline;
+    TimelineCursor _cursor;
+    
+    // Stored sessions
+    const SessionStore* _sessions;
+    SessionDownloadStats _lastDownload;     // Written by the async TCP task
+    
     // Web server handlers
     void handleRoot(AsyncWebServerRequest* request);
     void handleData(AsyncWebServerRequest* request);
     void handleCommand(AsyncWebServerRequest* request);
     void handleSetFormat(AsyncWebServerRequest* request);
+    void handleProfile(AsyncWebServerRequest* request);
+    void handleTrace(AsyncWebServerRequest* request);
+    void handleSessions(AsyncWebServerRequest* request);
+    void handleSessionDownload(AsyncWebServerRequest* request, uint32_t id);
     void handleNotFound(AsyncWebServerRequest* request);
     
     // WebSocket handlers
@@ -0,0 +1,173 @@
+// Arduino.cpp (native)
+// Host implementation of the Arduino core subset in Arduino.h
+
+#include "Arduino.h"
+#include <stdarg.h>
+#include <chrono>
+#include <thread>
+#include <random>
+
+HWCDC Serial;
+EspClass ESP;
+
+// ============================================================================
+// Time, pins, misc
+// ============================================================================
+
+static uint64_t hostMicros() {
+    static const auto start = std::chrono::steady_clock::now();
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+unsigned long millis() { return (uint32_t)(hostMicros() / 1000); }
+unsigned long micros() { return (uint32_t)hostMicros(); }
+int64_t esp_timer_get_time() { return (int64_t)hostMicros(); }
+
+void delay(unsigned long ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us) {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void yield() {
+    std::this_thread::yield();
+}
+
+uint32_t EspClass::getCycleCount() {
+    static const auto start = std::chrono::steady_clock::now();
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t, uint8_t) {}
+int digitalRead(uint8_t) { return LOW; }
+void analogWrite(uint8_t, int) {}
+uint16_t analogRead(uint8_t) { return 0; }
+void analogReadResolution(int) {}
+void analogSetAttenuation(int) {}
+int digitalPinToInterrupt(int pin) { return pin; }
+void attachInterruptArg(int, void (*)(void*), void*, int) {}
+void gpio_pulldown_en(gpio_num_t) {}
+void gpio_pullup_dis(gpio_num_t) {}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max) {
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+static std::mt19937& rng() {
+    static std::mt19937 gen(12345);
+    return gen;
+}
+
+long random(long max) { return max > 0 ? (long)(rng()() % (uint32_t)max) : 0; }
+long random(long min, long max) { return max > min ? min + random(max - min) : min; }
+uint32_t esp_random() { return rng()(); }
+
+// ============================================================================
+// String
+// ============================================================================
+
+String::String(float v, unsigned int decimals) : String((double)v, decimals) {}
+
+String::String(double v, unsigned int decimals) {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+    _s = buf;
+}
+
+void String::trim() {
+    size_t a = 0;
+    size_t b = _s.size();
+    while (a < b && isspace((unsigned char)_s[a])) a++;
+    while (b > a && isspace((unsigned char)_s[b - 1])) b--;
+    _s = _s.substr(a, b - a);
+}
+
+// ============================================================================
+// Print / Stream
+// ============================================================================
+
+size_t Print::write(const uint8_t* buf, size_t len) {
+    size_t n = 0;
+    while (n < len && write(buf[n])) n++;
+    return n;
+}
+
+size_t Print::print(long v, int base) {
+    if (base == DEC) return printf("%ld", v);
+    return print((unsigned long)v, base);
+}
+
+size_t Print::print(unsigned long v, int base) {
+    return printf(base == HEX ? "%lX" : "%lu", v);
+}
+
+size_t Print::print(long long v, int base) {
+    if (base == DEC) return printf("%lld", v);
+    return print((unsigned long long)v, base);
+}
+
+size_t Print::print(unsigned long long v, int base) {
+    return printf(base == HEX ? "%llX" : "%llu", v);
+}
+
+size_t Print::print(double v, int digits) {
+    return printf("%.*f", digits, v);
+}
+
+size_t Print::printf(const char* format, ...) {
+    char small[256];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(small, sizeof(small), format, args);
+    va_end(args);
+    if (len < 0) return 0;
+    if ((size_t)len < sizeof(small)) return write((const uint8_t*)small, len);
+
+    std::string big((size_t)len + 1, '\0');
+    va_start(args, format);
+    vsnprintf(&big[0], big.size(), format, args);
+    va_end(args);
+    return write((const uint8_t*)big.data(), len);
+}
+
+size_t Stream::readBytes(uint8_t* buf, size_t len) {
+    size_t n = 0;
+    const unsigned long start = millis();
+    while (n < len) {
+        const int c = read();
+        if (c >= 0) {
+            buf[n++] = (uint8_t)c;
+        } else if (millis() - start >= _timeout) {
+            break;
+        } else {
+            yield();
+        }
+    }
+    return n;
+}
+
+int HWCDC::available() { return (int)(_rx.size() - _rxPos); }
+int HWCDC::read() { return _rxPos < _rx.size() ? (uint8_t)_rx[_rxPos++] : -1; }
+int HWCDC::peek() { return _rxPos < _rx.size() ? (uint8_t)_rx[_rxPos] : -1; }
+
+size_t HWCDC::write(uint8_t b) {
+    return write(&b, 1);
+}
+
+size_t HWCDC::write(const uint8_t* buf, size_t len) {
+    if (!_muted) fwrite(buf, 1, len, stdout);
+    return len;
+}
+
+void HWCDC::inject(const uint8_t* buf, size_t len) {
+    if (_rxPos == _rx.size()) {
+        _rx.clear();
+        _rxPos = 0;
+    }
+    _rx.append((const char*)buf, len);
+}
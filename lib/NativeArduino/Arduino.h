@@ -0,0 +1,250 @@
+// Arduino.h (native)
+// Host stand-in for the subset of the Arduino-ESP32 core used by the firmware
+// Only built for [env:native]: time comes from the host's steady clock,
+// Serial writes to stdout, pins and the ADC are inert (tests drive the
+// code through the injectable Clock / ADCSampleSource / Stream seams).
+
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <cmath>
+#include <string>
+#include <algorithm>
+
+#define IRAM_ATTR
+#define PROGMEM
+#define PI 3.1415926535897932384626433832795
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define LOW 0x0
+#define HIGH 0x1
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+#define SERIAL_8N1 0x800001c
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+enum { ADC_0db, ADC_2_5db, ADC_6db, ADC_11db };
+typedef int gpio_num_t;
+
+// ============================================================================
+// Time, pins, misc
+// ============================================================================
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+void analogWrite(uint8_t pin, int value);
+uint16_t analogRead(uint8_t pin);
+void analogReadResolution(int bits);
+void analogSetAttenuation(int attenuation);
+int digitalPinToInterrupt(int pin);
+void attachInterruptArg(int interrupt, void (*handler)(void*), void* arg, int mode);
+void gpio_pulldown_en(gpio_num_t pin);
+void gpio_pullup_dis(gpio_num_t pin);
+
+long map(long x, long in_min, long in_max, long out_min, long out_max);
+long random(long max);
+long random(long min, long max);
+uint32_t esp_random();
+
+template <class T, class L, class H>
+auto constrain(T x, L low, H high) -> decltype(x + low + high) {
+    return (x < low) ? low : ((x > high) ? high : x);
+}
+
+// ============================================================================
+// String
+// ============================================================================
+
+class String {
+public:
+    String() {}
+    String(const char* s) : _s(s ? s : "") {}
+    String(const std::string& s) : _s(s) {}
+    String(char c) : _s(1, c) {}
+    String(int v) : _s(std::to_string(v)) {}
+    String(unsigned int v) : _s(std::to_string(v)) {}
+    String(long v) : _s(std::to_string(v)) {}
+    String(unsigned long v) : _s(std::to_string(v)) {}
+    String(float v, unsigned int decimals = 2);
+    String(double v, unsigned int decimals = 2);
+
+    const char* c_str() const { return _s.c_str(); }
+    unsigned int length() const { return (unsigned int)_s.size(); }
+    bool isEmpty() const { return _s.empty(); }
+    void reserve(unsigned int n) { _s.reserve(n); }
+
+    bool concat(const char* s) { if (s) _s += s; return s != nullptr; }
+    bool concat(const String& s) { _s += s._s; return true; }
+    bool concat(char c) { _s += c; return true; }
+    String& operator+=(const String& s) { _s += s._s; return *this; }
+    String& operator+=(const char* s) { if (s) _s += s; return *this; }
+    String& operator+=(char c) { _s += c; return *this; }
+
+    bool operator==(const String& o) const { return _s == o._s; }
+    bool operator==(const char* o) const { return o && _s == o; }
+    bool operator!=(const String& o) const { return _s != o._s; }
+    bool operator!=(const char* o) const { return !(*this == o); }
+    char operator[](unsigned int i) const { return i < _s.size() ? _s[i] : 0; }
+    char charAt(unsigned int i) const { return (*this)[i]; }
+
+    bool startsWith(const String& p) const { return _s.compare(0, p._s.size(), p._s) == 0; }
+    bool endsWith(const String& p) const {
+        return _s.size() >= p._s.size() && _s.compare(_s.size() - p._s.size(), p._s.size(), p._s) == 0;
+    }
+    int indexOf(char c, unsigned int from = 0) const { return find(_s.find(c, from)); }
+    int indexOf(const String& s, unsigned int from = 0) const { return find(_s.find(s._s, from)); }
+    String substring(unsigned int from) const { return from < _s.size() ? String(_s.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const {
+        if (from > to) std::swap(from, to);
+        return from < _s.size() ? String(_s.substr(from, to - from)) : String();
+    }
+    void trim();
+    void toUpperCase() { for (char& c : _s) c = (char)toupper((unsigned char)c); }
+    long toInt() const { return atol(_s.c_str()); }
+    float toFloat() const { return (float)atof(_s.c_str()); }
+
+private:
+    std::string _s;
+    static int find(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+};
+
+inline String operator+(const String& a, const String& b) { String r(a); r += b; return r; }
+inline String operator+(const String& a, const char* b) { String r(a); r += b; return r; }
+inline String operator+(const char* a, const String& b) { String r(a); r += b; return r; }
+
+// ============================================================================
+// Print / Stream
+// ============================================================================
+
+#define DEC 10
+#define HEX 16
+
+class Print {
+public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t b) = 0;
+    virtual size_t write(const uint8_t* buf, size_t len);
+    size_t write(const char* s) { return s ? write((const uint8_t*)s, strlen(s)) : 0; }
+    size_t write(const char* buf, size_t len) { return write((const uint8_t*)buf, len); }
+    virtual int availableForWrite() { return 0; }
+    virtual void flush() {}
+
+    size_t print(const char* s) { return write(s); }
+    size_t print(const String& s) { return write(s.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int v, int base = DEC) { return print((long)v, base); }
+    size_t print(unsigned int v, int base = DEC) { return print((unsigned long)v, base); }
+    size_t print(long v, int base = DEC);
+    size_t print(unsigned long v, int base = DEC);
+    size_t print(long long v, int base = DEC);
+    size_t print(unsigned long long v, int base = DEC);
+    size_t print(double v, int digits = 2);
+
+    size_t println() { return write("\r\n"); }
+    template <typename T>
+    size_t println(const T& v) { size_t n = print(v); return n + println(); }
+    template <typename T>
+    size_t println(const T& v, int format) { size_t n = print(v, format); return n + println(); }
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long ms) { _timeout = ms; }
+    size_t readBytes(uint8_t* buf, size_t len);
+    size_t readBytes(char* buf, size_t len) { return readBytes((uint8_t*)buf, len); }
+
+protected:
+    unsigned long _timeout = 1000;
+};
+
+// USB CDC console: output to stdout, input from inject() (tests)
+class HWCDC : public Stream {
+public:
+    void begin(unsigned long baud = 115200) { (void)baud; }
+    operator bool() const { return true; }
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t* buf, size_t len) override;
+    int availableForWrite() override { return 4096; }
+    void flush() override { fflush(stdout); }
+    using Print::write;
+
+    // Bytes the "host" sends
+    void inject(const uint8_t* buf, size_t len);
+
+    // Drop console output (keeps test logs readable)
+    void setMuted(bool muted) { _muted = muted; }
+
+private:
+    std::string _rx;
+    size_t _rxPos = 0;
+    bool _muted = false;
+};
+
+extern HWCDC Serial;
+
+// UART: nothing connected; writes are discarded
+class HardwareSerial : public Stream {
+public:
+    explicit HardwareSerial(int uart) { (void)uart; }
+    void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rx = -1, int8_t tx = -1) {
+        (void)baud; (void)config; (void)rx; (void)tx;
+    }
+    void onReceive(void (*callback)(void)) { (void)callback; }
+    operator bool() const { return true; }
+
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    size_t write(uint8_t) override { return 1; }
+    using Print::write;
+};
+
+// ============================================================================
+// ESP object
+// ============================================================================
+
+class EspClass {
+public:
+    // Nanoseconds on the host (reported as a 1000 MHz CPU)
+    uint32_t getCycleCount();
+    uint32_t getCpuFreqMHz() { return 1000; }
+    uint32_t getFreeHeap() { return 0; }
+    uint32_t getMinFreeHeap() { return 0; }
+    uint32_t getMaxAllocHeap() { return 0; }
+    void restart() { exit(0); }
+};
+
+extern EspClass ESP;
+
+#include "freertos/FreeRTOS.h"
+
+#endif // NATIVE_ARDUINO_H
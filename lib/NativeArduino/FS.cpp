@@ -0,0 +1,214 @@
+// FS.cpp (native)
+// In-memory fs::FS / fs::File
+
+#include "FS.h"
+#include "LittleFS.h"
+
+fs::LittleFSFS LittleFS;
+
+namespace fs {
+
+struct File::Impl {
+    FS* fs;
+    std::string path;
+    FS::Data data;                      // Null for a directory
+    size_t pos;
+    bool writable;
+    std::vector<std::string> entries;   // Directory listing at open
+    size_t next;
+};
+
+static std::string normalize(const char* path) {
+    std::string p(path ? path : "");
+    while (p.size() > 1 && p.back() == '/') p.pop_back();
+    return p;
+}
+
+// ============================================================================
+// FS
+// ============================================================================
+
+bool FS::isDir(const std::string& path) const {
+    if (path == "/" || _dirs.count(path)) return true;
+    const std::string prefix = path + "/";
+    for (const auto& f : _files) {
+        if (f.first.compare(0, prefix.size(), prefix) == 0) return true;
+    }
+    return false;
+}
+
+File FS::open(const char* path, const char* mode, bool create) {
+    (void)create;
+    File file;
+    const std::string p = normalize(path);
+    const std::string m(mode ? mode : FILE_READ);
+
+    if (m == FILE_READ && isDir(p)) {
+        auto impl = std::make_shared<File::Impl>();
+        impl->fs = this;
+        impl->path = p;
+        impl->pos = 0;
+        impl->writable = false;
+        impl->next = 0;
+        const std::string prefix = (p == "/") ? "/" : p + "/";
+        for (const auto& f : _files) {
+            if (f.first.compare(0, prefix.size(), prefix) == 0 &&
+                f.first.find('/', prefix.size()) == std::string::npos) {
+                impl->entries.push_back(f.first);
+            }
+        }
+        file._impl = impl;
+        return file;
+    }
+
+    auto it = _files.find(p);
+    if (m == FILE_READ) {
+        if (it == _files.end()) return file;
+    } else if (m == FILE_WRITE || it == _files.end()) {
+        _files[p] = std::make_shared<std::vector<uint8_t>>();
+        it = _files.find(p);
+    }
+
+    auto impl = std::make_shared<File::Impl>();
+    impl->fs = this;
+    impl->path = p;
+    impl->data = it->second;
+    impl->pos = (m == FILE_APPEND) ? impl->data->size() : 0;
+    impl->writable = (m != FILE_READ);
+    impl->next = 0;
+    file._impl = impl;
+    return file;
+}
+
+bool FS::exists(const char* path) {
+    const std::string p = normalize(path);
+    return _files.count(p) > 0 || isDir(p);
+}
+
+bool FS::remove(const char* path) {
+    return _files.erase(normalize(path)) > 0;
+}
+
+bool FS::rename(const char* from, const char* to) {
+    auto it = _files.find(normalize(from));
+    if (it == _files.end()) return false;
+    Data data = it->second;
+    _files.erase(it);
+    _files[normalize(to)] = data;
+    return true;
+}
+
+bool FS::mkdir(const char* path) {
+    _dirs[normalize(path)] = true;
+    return true;
+}
+
+bool FS::rmdir(const char* path) {
+    return _dirs.erase(normalize(path)) > 0;
+}
+
+size_t FS::usedBytes() const {
+    size_t used = 0;
+    for (const auto& f : _files) used += f.second->size();
+    return used;
+}
+
+void FS::clear() {
+    _files.clear();
+    _dirs.clear();
+    _flushes = 0;
+}
+
+// ============================================================================
+// File
+// ============================================================================
+
+int File::available() {
+    if (!_impl || !_impl->data) return 0;
+    return (int)(_impl->data->size() - std::min(_impl->pos, _impl->data->size()));
+}
+
+int File::read() {
+    uint8_t b;
+    return read(&b, 1) == 1 ? b : -1;
+}
+
+int File::peek() {
+    if (available() <= 0) return -1;
+    return (*_impl->data)[_impl->pos];
+}
+
+size_t File::read(uint8_t* buf, size_t len) {
+    const size_t n = std::min(len, (size_t)available());
+    if (n > 0) {
+        memcpy(buf, _impl->data->data() + _impl->pos, n);
+        _impl->pos += n;
+    }
+    return n;
+}
+
+size_t File::write(const uint8_t* buf, size_t len) {
+    if (!_impl || !_impl->data || !_impl->writable) return 0;
+    std::vector<uint8_t>& data = *_impl->data;
+
+    // Growth beyond the file system's capacity is cut short
+    const size_t end = _impl->pos + len;
+    if (end > data.size()) {
+        const size_t used = _impl->fs->usedBytes();
+        const size_t room = (_impl->fs->_capacity > used) ? _impl->fs->_capacity - used : 0;
+        if (end - data.size() > room) {
+            len = data.size() + room - _impl->pos;
+        }
+        data.resize(_impl->pos + len);
+    }
+    memcpy(data.data() + _impl->pos, buf, len);
+    _impl->pos += len;
+    return len;
+}
+
+void File::flush() {
+    if (_impl) _impl->fs->_flushes++;
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+    if (!_impl || !_impl->data) return false;
+    size_t target = pos;
+    if (mode == SeekCur) target = _impl->pos + pos;
+    if (mode == SeekEnd) target = _impl->data->size() + pos;
+    if (target > _impl->data->size()) return false;
+    _impl->pos = target;
+    return true;
+}
+
+size_t File::position() const {
+    return _impl ? _impl->pos : 0;
+}
+
+size_t File::size() const {
+    return (_impl && _impl->data) ? _impl->data->size() : 0;
+}
+
+const char* File::name() const {
+    if (!_impl) return "";
+    const size_t slash = _impl->path.rfind('/');
+    return _impl->path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+}
+
+const char* File::path() const {
+    return _impl ? _impl->path.c_str() : "";
+}
+
+bool File::isDirectory() const {
+    return _impl && !_impl->data;
+}
+
+File File::openNextFile(const char* mode) {
+    if (!isDirectory() || _impl->next >= _impl->entries.size()) return File();
+    return _impl->fs->open(_impl->entries[_impl->next++].c_str(), mode);
+}
+
+void File::rewindDirectory() {
+    if (_impl) _impl->next = 0;
+}
+
+} // namespace fs
@@ -0,0 +1,97 @@
+// FS.h (native)
+// In-memory file system with the fs::FS / fs::File interface of the
+// Arduino-ESP32 core. Directories are implicit path prefixes plus the ones
+// made with mkdir(); File::name() is the base name as in core 2.x.
+
+#ifndef NATIVE_FS_H
+#define NATIVE_FS_H
+
+#include "Arduino.h"
+#include <time.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+class FS;
+
+class File : public Stream {
+public:
+    File() {}
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t b) override { return write(&b, 1); }
+    size_t write(const uint8_t* buf, size_t len) override;
+    void flush() override;
+    using Print::write;
+
+    size_t read(uint8_t* buf, size_t len);
+    bool seek(uint32_t pos, SeekMode mode = SeekSet);
+    size_t position() const;
+    size_t size() const;
+    void close() { _impl.reset(); }
+    operator bool() const { return (bool)_impl; }
+    const char* name() const;
+    const char* path() const;
+    bool isDirectory() const;
+    File openNextFile(const char* mode = FILE_READ);
+    void rewindDirectory();
+    time_t getLastWrite() const { return 0; }
+
+private:
+    friend class FS;
+    struct Impl;
+    std::shared_ptr<Impl> _impl;
+};
+
+class FS {
+public:
+    FS() {}
+    virtual ~FS() {}
+
+    File open(const char* path, const char* mode = FILE_READ, bool create = false);
+    File open(const String& path, const char* mode = FILE_READ, bool create = false) {
+        return open(path.c_str(), mode, create);
+    }
+    bool exists(const char* path);
+    bool exists(const String& path) { return exists(path.c_str()); }
+    bool remove(const char* path);
+    bool remove(const String& path) { return remove(path.c_str()); }
+    bool rename(const char* from, const char* to);
+    bool mkdir(const char* path);
+    bool rmdir(const char* path);
+
+    // Test hooks: capacity (writes beyond it are short) and flush count
+    void setCapacity(size_t bytes) { _capacity = bytes; }
+    uint32_t getFlushCount() const { return _flushes; }
+    size_t usedBytes() const;
+    void clear();
+
+private:
+    friend class File;
+    typedef std::shared_ptr<std::vector<uint8_t>> Data;
+
+    std::map<std::string, Data> _files;
+    std::map<std::string, bool> _dirs;
+    size_t _capacity = (size_t)-1;
+    uint32_t _flushes = 0;
+
+    bool isDir(const std::string& path) const;
+};
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
+
+#endif // NATIVE_FS_H
@@ -0,0 +1,27 @@
+// LittleFS.h (native)
+// LittleFS as an in-memory fs::FS (contents last for the process)
+
+#ifndef NATIVE_LITTLEFS_H
+#define NATIVE_LITTLEFS_H
+
+#include "FS.h"
+
+namespace fs {
+
+class LittleFSFS : public FS {
+public:
+    bool begin(bool formatOnFail = false, const char* basePath = "/littlefs",
+               uint8_t maxOpenFiles = 10, const char* partitionLabel = "spiffs") {
+        (void)formatOnFail; (void)basePath; (void)maxOpenFiles; (void)partitionLabel;
+        return true;
+    }
+    bool format() { clear(); return true; }
+    void end() {}
+    size_t totalBytes() const { return 1024 * 1024; }
+};
+
+} // namespace fs
+
+extern fs::LittleFSFS LittleFS;
+
+#endif // NATIVE_LITTLEFS_H
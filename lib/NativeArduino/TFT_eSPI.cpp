@@ -0,0 +1,341 @@
+// TFT_eSPI.cpp (native)
+// RGB565 framebuffer with primitive / pixel counting and PPM output
+
+#include "TFT_eSPI.h"
+
+const GFXfont FreeSansBold12pt7b = { nullptr, nullptr, 0x20, 0x7E, 29 };
+
+// Classic 5x7 GLCD font, printable ASCII (0x20-0x7E). Five columns per
+// character, bit 0 at the top; cells are 6x8 with a blank column.
+static const uint8_t GLCD_FONT[][5] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5F, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00},
+    {0x14, 0x7F, 0x14, 0x7F, 0x14}, {0x24, 0x2A, 0x7F, 0x2A, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62},
+    {0x36, 0x49, 0x56, 0x20, 0x50}, {0x00, 0x08, 0x07, 0x03, 0x00}, {0x00, 0x1C, 0x22, 0x41, 0x00},
+    {0x00, 0x41, 0x22, 0x1C, 0x00}, {0x2A, 0x1C, 0x7F, 0x1C, 0x2A}, {0x08, 0x08, 0x3E, 0x08, 0x08},
+    {0x00, 0x80, 0x70, 0x30, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x00, 0x60, 0x60, 0x00},
+    {0x20, 0x10, 0x08, 0x04, 0x02}, {0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00},
+    {0x72, 0x49, 0x49, 0x49, 0x46}, {0x21, 0x41, 0x49, 0x4D, 0x33}, {0x18, 0x14, 0x12, 0x7F, 0x10},
+    {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3C, 0x4A, 0x49, 0x49, 0x31}, {0x41, 0x21, 0x11, 0x09, 0x07},
+    {0x36, 0x49, 0x49, 0x49, 0x36}, {0x46, 0x49, 0x49, 0x29, 0x1E}, {0x00, 0x00, 0x14, 0x00, 0x00},
+    {0x00, 0x40, 0x34, 0x00, 0x00}, {0x00, 0x08, 0x14, 0x22, 0x41}, {0x14, 0x14, 0x14, 0x14, 0x14},
+    {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x59, 0x09, 0x06}, {0x3E, 0x41, 0x5D, 0x59, 0x4E},
+    {0x7C, 0x12, 0x11, 0x12, 0x7C}, {0x7F, 0x49, 0x49, 0x49, 0x36}, {0x3E, 0x41, 0x41, 0x41, 0x22},
+    {0x7F, 0x41, 0x41, 0x41, 0x3E}, {0x7F, 0x49, 0x49, 0x49, 0x41}, {0x7F, 0x09, 0x09, 0x09, 0x01},
+    {0x3E, 0x41, 0x41, 0x51, 0x73}, {0x7F, 0x08, 0x08, 0x08, 0x7F}, {0x00, 0x41, 0x7F, 0x41, 0x00},
+    {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41}, {0x7F, 0x40, 0x40, 0x40, 0x40},
+    {0x7F, 0x02, 0x1C, 0x02, 0x7F}, {0x7F, 0x04, 0x08, 0x10, 0x7F}, {0x3E, 0x41, 0x41, 0x41, 0x3E},
+    {0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E}, {0x7F, 0x09, 0x19, 0x29, 0x46},
+    {0x26, 0x49, 0x49, 0x49, 0x32}, {0x03, 0x01, 0x7F, 0x01, 0x03}, {0x3F, 0x40, 0x40, 0x40, 0x3F},
+    {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x3F, 0x40, 0x38, 0x40, 0x3F}, {0x63, 0x14, 0x08, 0x14, 0x63},
+    {0x03, 0x04, 0x78, 0x04, 0x03}, {0x61, 0x59, 0x49, 0x4D, 0x43}, {0x00, 0x7F, 0x41, 0x41, 0x41},
+    {0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x41, 0x7F}, {0x04, 0x02, 0x01, 0x02, 0x04},
+    {0x40, 0x40, 0x40, 0x40, 0x40}, {0x00, 0x03, 0x07, 0x08, 0x00}, {0x20, 0x54, 0x54, 0x78, 0x40},
+    {0x7F, 0x28, 0x44, 0x44, 0x38}, {0x38, 0x44, 0x44, 0x44, 0x28}, {0x38, 0x44, 0x44, 0x28, 0x7F},
+    {0x38, 0x54, 0x54, 0x54, 0x18}, {0x00, 0x08, 0x7E, 0x09, 0x02}, {0x18, 0xA4, 0xA4, 0x9C, 0x78},
+    {0x7F, 0x08, 0x04, 0x04, 0x78}, {0x00, 0x44, 0x7D, 0x40, 0x00}, {0x20, 0x40, 0x40, 0x3D, 0x00},
+    {0x7F, 0x10, 0x28, 0x44, 0x00}, {0x00, 0x41, 0x7F, 0x40, 0x00}, {0x7C, 0x04, 0x78, 0x04, 0x78},
+    {0x7C, 0x08, 0x04, 0x04, 0x78}, {0x38, 0x44, 0x44, 0x44, 0x38}, {0xFC, 0x18, 0x24, 0x24, 0x18},
+    {0x18, 0x24, 0x24, 0x18, 0xFC}, {0x7C, 0x08, 0x04, 0x04, 0x08}, {0x48, 0x54, 0x54, 0x54, 0x24},
+    {0x04, 0x04, 0x3F, 0x44, 0x24}, {0x3C, 0x40, 0x40, 0x20, 0x7C}, {0x1C, 0x20, 0x40, 0x20, 0x1C},
+    {0x3C, 0x40, 0x30, 0x40, 0x3C}, {0x44, 0x28, 0x10, 0x28, 0x44}, {0x4C, 0x90, 0x90, 0x90, 0x7C},
+    {0x44, 0x64, 0x54, 0x4C, 0x44}, {0x00, 0x08, 0x36, 0x41, 0x00}, {0x00, 0x00, 0x77, 0x00, 0x00},
+    {0x00, 0x41, 0x36, 0x08, 0x00}, {0x02, 0x01, 0x02, 0x04, 0x02},
+};
+
+static const char GLCD_FIRST = 0x20;
+static const char GLCD_LAST = 0x7E;
+
+TFT_eSPI::TFT_eSPI(int16_t w, int16_t h)
+    : _fb((size_t)w * h, TFT_BLACK)
+    , _panelWidth(w)
+    , _panelHeight(h)
+    , _width(w)
+    , _height(h)
+    , _rotation(0)
+    , _textColor(TFT_WHITE)
+    , _textBgColor(TFT_BLACK)
+    , _textSize(1)
+    , _textDatum(TL_DATUM)
+    , _freeFont(nullptr)
+{
+    resetDrawStats();
+}
+
+void TFT_eSPI::setRotation(uint8_t r) {
+    _rotation = r & 3;
+    const bool portrait = (_rotation & 1) == 0;
+    _width = portrait ? _panelWidth : _panelHeight;
+    _height = portrait ? _panelHeight : _panelWidth;
+}
+
+// ============================================================================
+// Building blocks (clipped, counted as pixels but not as primitives)
+// ============================================================================
+
+void TFT_eSPI::pixel(int32_t x, int32_t y, uint16_t color) {
+    if (x < 0 || y < 0 || x >= _width || y >= _height) return;
+    _fb[(size_t)y * _width + x] = color;
+    _stats.pixels++;
+}
+
+void TFT_eSPI::hline(int32_t x, int32_t y, int32_t w, uint16_t color) {
+    if (y < 0 || y >= _height || w <= 0) return;
+    int32_t x1 = x + w;
+    if (x < 0) x = 0;
+    if (x1 > _width) x1 = _width;
+    for (int32_t i = x; i < x1; i++) {
+        _fb[(size_t)y * _width + i] = color;
+    }
+    if (x1 > x) _stats.pixels += x1 - x;
+}
+
+void TFT_eSPI::vline(int32_t x, int32_t y, int32_t h, uint16_t color) {
+    if (x < 0 || x >= _width || h <= 0) return;
+    int32_t y1 = y + h;
+    if (y < 0) y = 0;
+    if (y1 > _height) y1 = _height;
+    for (int32_t j = y; j < y1; j++) {
+        _fb[(size_t)j * _width + x] = color;
+    }
+    if (y1 > y) _stats.pixels += y1 - y;
+}
+
+void TFT_eSPI::rect(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t color) {
+    for (int32_t j = 0; j < h; j++) {
+        hline(x, y + j, w, color);
+    }
+}
+
+void TFT_eSPI::circleHelper(int32_t x0, int32_t y0, int32_t r, uint8_t corners, uint16_t color) {
+    int32_t f = 1 - r;
+    int32_t ddF_x = 1;
+    int32_t ddF_y = -2 * r;
+    int32_t x = 0;
+    while (x < r) {
+        if (f >= 0) {
+            r--;
+            ddF_y += 2;
+            f += ddF_y;
+        }
+        x++;
+        ddF_x += 2;
+        f += ddF_x;
+        if (corners & 0x4) { pixel(x0 + x, y0 + r, color); pixel(x0 + r, y0 + x, color); }
+        if (corners & 0x2) { pixel(x0 + x, y0 - r, color); pixel(x0 + r, y0 - x, color); }
+        if (corners & 0x8) { pixel(x0 - r, y0 + x, color); pixel(x0 - x, y0 + r, color); }
+        if (corners & 0x1) { pixel(x0 - r, y0 - x, color); pixel(x0 - x, y0 - r, color); }
+    }
+}
+
+void TFT_eSPI::fillCircleHelper(int32_t x0, int32_t y0, int32_t r, uint8_t corners,
+                                int32_t delta, uint16_t color) {
+    int32_t f = 1 - r;
+    int32_t ddF_x = 1;
+    int32_t ddF_y = -r - r;
+    int32_t y = 0;
+    delta++;
+    while (y < r) {
+        if (f >= 0) {
+            if (corners & 0x1) hline(x0 - y, y0 + r, y + y + delta, color);
+            if (corners & 0x2) hline(x0 - y, y0 - r, y + y + delta, color);
+            r--;
+            ddF_y += 2;
+            f += ddF_y;
+        }
+        y++;
+        ddF_x += 2;
+        f += ddF_x;
+        if (corners & 0x1) hline(x0 - r, y0 + y, r + r + delta, color);
+        if (corners & 0x2) hline(x0 - r, y0 - y, r + r + delta, color);
+    }
+}
+
+// ============================================================================
+// Primitives
+// ============================================================================
+
+void TFT_eSPI::fillScreen(uint32_t color) {
+    _stats.primitives++;
+    rect(0, 0, _width, _height, (uint16_t)color);
+}
+
+void TFT_eSPI::drawPixel(int32_t x, int32_t y, uint32_t color) {
+    _stats.primitives++;
+    pixel(x, y, (uint16_t)color);
+}
+
+void TFT_eSPI::drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color) {
+    _stats.primitives++;
+    hline(x, y, w, (uint16_t)color);
+}
+
+void TFT_eSPI::drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color) {
+    _stats.primitives++;
+    vline(x, y, h, (uint16_t)color);
+}
+
+void TFT_eSPI::drawLine(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t color) {
+    _stats.primitives++;
+    const bool steep = abs(y1 - y0) > abs(x1 - x0);
+    if (steep) {
+        std::swap(x0, y0);
+        std::swap(x1, y1);
+    }
+    if (x0 > x1) {
+        std::swap(x0, x1);
+        std::swap(y0, y1);
+    }
+    const int32_t dx = x1 - x0;
+    const int32_t dy = abs(y1 - y0);
+    const int32_t ystep = (y0 < y1) ? 1 : -1;
+    int32_t err = dx >> 1;
+    for (; x0 <= x1; x0++) {
+        if (steep) pixel(y0, x0, (uint16_t)color);
+        else pixel(x0, y0, (uint16_t)color);
+        err -= dy;
+        if (err < 0) {
+            y0 += ystep;
+            err += dx;
+        }
+    }
+}
+
+void TFT_eSPI::drawRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) {
+    _stats.primitives++;
+    hline(x, y, w, (uint16_t)color);
+    hline(x, y + h - 1, w, (uint16_t)color);
+    vline(x, y + 1, h - 2, (uint16_t)color);
+    vline(x + w - 1, y + 1, h - 2, (uint16_t)color);
+}
+
+void TFT_eSPI::fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) {
+    _stats.primitives++;
+    rect(x, y, w, h, (uint16_t)color);
+}
+
+void TFT_eSPI::drawRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t r,
+                             uint32_t color) {
+    _stats.primitives++;
+    hline(x + r, y, w - r - r, (uint16_t)color);
+    hline(x + r, y + h - 1, w - r - r, (uint16_t)color);
+    vline(x, y + r, h - r - r, (uint16_t)color);
+    vline(x + w - 1, y + r, h - r - r, (uint16_t)color);
+    circleHelper(x + r, y + r, r, 1, (uint16_t)color);
+    circleHelper(x + w - r - 1, y + r, r, 2, (uint16_t)color);
+    circleHelper(x + w - r - 1, y + h - r - 1, r, 4, (uint16_t)color);
+    circleHelper(x + r, y + h - r - 1, r, 8, (uint16_t)color);
+}
+
+void TFT_eSPI::fillRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t r,
+                             uint32_t color) {
+    _stats.primitives++;
+    rect(x, y + r, w, h - r - r, (uint16_t)color);
+    fillCircleHelper(x + r, y + h - r - 1, r, 1, w - r - r - 1, (uint16_t)color);
+    fillCircleHelper(x + r, y + r, r, 2, w - r - r - 1, (uint16_t)color);
+}
+
+void TFT_eSPI::drawCircle(int32_t x0, int32_t y0, int32_t r, uint32_t color) {
+    _stats.primitives++;
+    pixel(x0, y0 + r, (uint16_t)color);
+    pixel(x0, y0 - r, (uint16_t)color);
+    pixel(x0 + r, y0, (uint16_t)color);
+    pixel(x0 - r, y0, (uint16_t)color);
+    circleHelper(x0, y0, r, 0xF, (uint16_t)color);
+}
+
+void TFT_eSPI::fillCircle(int32_t x0, int32_t y0, int32_t r, uint32_t color) {
+    _stats.primitives++;
+    hline(x0 - r, y0, r + r + 1, (uint16_t)color);
+    fillCircleHelper(x0, y0, r, 3, 0, (uint16_t)color);
+}
+
+// ============================================================================
+// Text
+// ============================================================================
+
+int16_t TFT_eSPI::textWidth(const char* string) const {
+    return string ? (int16_t)(strlen(string) * 6 * glyphScale()) : 0;
+}
+
+int16_t TFT_eSPI::fontHeight() const {
+    return (int16_t)(8 * glyphScale());
+}
+
+void TFT_eSPI::drawChar(int32_t x, int32_t y, char c, uint8_t scale) {
+    const uint8_t* glyph = GLCD_FONT[0];
+    if (c >= GLCD_FIRST && c <= GLCD_LAST) {
+        glyph = GLCD_FONT[c - GLCD_FIRST];
+    }
+    // Same colors = transparent (only the glyph is drawn), as on the board.
+    // Free fonts never paint a background.
+    const bool opaque = (_textBgColor != _textColor) && _freeFont == nullptr;
+    for (int8_t col = 0; col < 6; col++) {
+        const uint8_t bits = (col < 5) ? glyph[col] : 0;
+        for (int8_t row = 0; row < 8; row++) {
+            const bool set = (bits >> row) & 1;
+            if (!set && !opaque) continue;
+            const uint16_t color = set ? _textColor : _textBgColor;
+            for (uint8_t sy = 0; sy < scale; sy++) {
+                hline(x + col * scale, y + row * scale + sy, scale, color);
+            }
+        }
+    }
+}
+
+int16_t TFT_eSPI::drawString(const char* string, int32_t x, int32_t y) {
+    _stats.primitives++;
+    if (string == nullptr) return 0;
+
+    const int16_t w = textWidth(string);
+    const int16_t h = fontHeight();
+    switch (_textDatum) {
+        case TC_DATUM: x -= w / 2; break;
+        case TR_DATUM: x -= w; break;
+        case ML_DATUM: y -= h / 2; break;
+        case MC_DATUM: x -= w / 2; y -= h / 2; break;
+        case MR_DATUM: x -= w; y -= h / 2; break;
+        case BL_DATUM: y -= h; break;
+        case BC_DATUM: x -= w / 2; y -= h; break;
+        case BR_DATUM: x -= w; y -= h; break;
+        case L_BASELINE: y -= h - glyphScale(); break;
+        case C_BASELINE: x -= w / 2; y -= h - glyphScale(); break;
+        case R_BASELINE: x -= w; y -= h - glyphScale(); break;
+        default: break;
+    }
+
+    const uint8_t scale = glyphScale();
+    for (const char* c = string; *c; c++) {
+        drawChar(x, y, *c, scale);
+        x += 6 * scale;
+    }
+    return w;
+}
+
+// ============================================================================
+// Framebuffer access
+// ============================================================================
+
+uint16_t TFT_eSPI::readPixel(int32_t x, int32_t y) const {
+    if (x < 0 || y < 0 || x >= _width || y >= _height) return 0;
+    return _fb[(size_t)y * _width + x];
+}
+
+bool TFT_eSPI::writePPM(const char* path) const {
+    FILE* f = fopen(path, "wb");
+    if (f == nullptr) return false;
+    fprintf(f, "P6\n%d %d\n255\n", _width, _height);
+    std::vector<uint8_t> row((size_t)_width * 3);
+    for (int32_t y = 0; y < _height; y++) {
+        for (int32_t x = 0; x < _width; x++) {
+            const uint16_t c = _fb[(size_t)y * _width + x];
+            const uint8_t r5 = c >> 11;
+            const uint8_t g6 = (c >> 5) & 0x3F;
+            const uint8_t b5 = c & 0x1F;
+            row[x * 3 + 0] = (uint8_t)((r5 << 3) | (r5 >> 2));
+            row[x * 3 + 1] = (uint8_t)((g6 << 2) | (g6 >> 4));
+            row[x * 3 + 2] = (uint8_t)((b5 << 3) | (b5 >> 2));
+        }
+        fwrite(row.data(), 1, row.size(), f);
+    }
+    return fclose(f) == 0;
+}
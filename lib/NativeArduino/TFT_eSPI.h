@@ -0,0 +1,165 @@
+// TFT_eSPI.h (native)
+// Framebuffer stand-in for the TFT_eSPI calls DisplayManager makes
+// Draws into an RGB565 buffer of the panel size (170x320 portrait), counts
+// every top-level primitive and every pixel written, and dumps frames as
+// binary PPM. Shapes follow TFT_eSPI's algorithms; text uses the built-in
+// 5x7 GLCD font (font 1), and a free font is drawn as font 1 at twice the
+// text size, so frames match the board's layout rather than its glyphs.
+
+#ifndef NATIVE_TFT_ESPI_H
+#define NATIVE_TFT_ESPI_H
+
+#include "Arduino.h"
+#include <vector>
+
+#ifndef TFT_WIDTH
+#define TFT_WIDTH 170
+#endif
+#ifndef TFT_HEIGHT
+#define TFT_HEIGHT 320
+#endif
+#ifndef TFT_BL
+#define TFT_BL 38
+#endif
+
+// Colors (RGB565)
+#define TFT_BLACK       0x0000
+#define TFT_NAVY        0x000F
+#define TFT_DARKGREEN   0x03E0
+#define TFT_DARKCYAN    0x03EF
+#define TFT_MAROON      0x7800
+#define TFT_PURPLE      0x780F
+#define TFT_OLIVE       0x7BE0
+#define TFT_LIGHTGREY   0xD69A
+#define TFT_DARKGREY    0x7BEF
+#define TFT_BLUE        0x001F
+#define TFT_GREEN       0x07E0
+#define TFT_CYAN        0x07FF
+#define TFT_RED         0xF800
+#define TFT_MAGENTA     0xF81F
+#define TFT_YELLOW      0xFFE0
+#define TFT_WHITE       0xFFFF
+#define TFT_ORANGE      0xFDA0
+#define TFT_GREENYELLOW 0xB7E0
+#define TFT_PINK        0xFE19
+#define TFT_BROWN       0x9A60
+#define TFT_GOLD        0xFEA0
+#define TFT_SILVER      0xC618
+#define TFT_SKYBLUE     0x867D
+#define TFT_VIOLET      0x915C
+
+// Text reference points
+#define TL_DATUM 0
+#define TC_DATUM 1
+#define TR_DATUM 2
+#define ML_DATUM 3
+#define CL_DATUM 3
+#define MC_DATUM 4
+#define CC_DATUM 4
+#define MR_DATUM 5
+#define CR_DATUM 5
+#define BL_DATUM 6
+#define BC_DATUM 7
+#define BR_DATUM 8
+#define L_BASELINE 9
+#define C_BASELINE 10
+#define R_BASELINE 11
+
+// Adafruit GFX free font (glyph data is not used here)
+typedef struct {
+    uint16_t bitmapOffset;
+    uint8_t width, height, xAdvance;
+    int8_t xOffset, yOffset;
+} GFXglyph;
+
+typedef struct {
+    const uint8_t* bitmap;
+    const GFXglyph* glyph;
+    uint16_t first, last;
+    uint8_t yAdvance;
+} GFXfont;
+
+extern const GFXfont FreeSansBold12pt7b;
+
+// Drawing cost since the last resetDrawStats()
+struct DrawStats {
+    uint32_t primitives;    // Top-level draw calls
+    uint32_t pixels;        // Pixel writes inside the panel (overdraw counts)
+};
+
+class TFT_eSPI {
+public:
+    TFT_eSPI(int16_t w = TFT_WIDTH, int16_t h = TFT_HEIGHT);
+
+    void init(uint8_t tc = 0) { (void)tc; }
+    void begin(uint8_t tc = 0) { init(tc); }
+    void setRotation(uint8_t r);
+    uint8_t getRotation() const { return _rotation; }
+    int16_t width() const { return _width; }
+    int16_t height() const { return _height; }
+
+    // Shapes
+    void fillScreen(uint32_t color);
+    void drawPixel(int32_t x, int32_t y, uint32_t color);
+    void drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color);
+    void drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color);
+    void drawLine(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t color);
+    void drawRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color);
+    void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color);
+    void drawRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t r, uint32_t color);
+    void fillRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t r, uint32_t color);
+    void drawCircle(int32_t x, int32_t y, int32_t r, uint32_t color);
+    void fillCircle(int32_t x, int32_t y, int32_t r, uint32_t color);
+
+    // Text
+    void setTextColor(uint16_t color) { _textColor = color; _textBgColor = color; }
+    void setTextColor(uint16_t fg, uint16_t bg, bool bgfill = false) {
+        (void)bgfill;
+        _textColor = fg;
+        _textBgColor = bg;
+    }
+    void setTextSize(uint8_t size) { _textSize = (size > 0) ? size : 1; }
+    void setTextDatum(uint8_t datum) { _textDatum = datum; }
+    uint8_t getTextDatum() const { return _textDatum; }
+    void setTextFont(uint8_t font) { (void)font; _freeFont = nullptr; }
+    void setFreeFont(const GFXfont* font) { _freeFont = font; }
+    int16_t textWidth(const char* string) const;
+    int16_t fontHeight() const;
+    int16_t drawString(const char* string, int32_t x, int32_t y);
+    int16_t drawString(const String& string, int32_t x, int32_t y) {
+        return drawString(string.c_str(), x, y);
+    }
+
+    // Framebuffer access (host only)
+    uint16_t readPixel(int32_t x, int32_t y) const;
+    const DrawStats& getDrawStats() const { return _stats; }
+    void resetDrawStats() { _stats.primitives = 0; _stats.pixels = 0; }
+    bool writePPM(const char* path) const;
+
+private:
+    std::vector<uint16_t> _fb;
+    int16_t _panelWidth;
+    int16_t _panelHeight;
+    int16_t _width;
+    int16_t _height;
+    uint8_t _rotation;
+    uint16_t _textColor;
+    uint16_t _textBgColor;
+    uint8_t _textSize;
+    uint8_t _textDatum;
+    const GFXfont* _freeFont;
+    DrawStats _stats;
+
+    // Uncounted building blocks of the primitives
+    void pixel(int32_t x, int32_t y, uint16_t color);
+    void hline(int32_t x, int32_t y, int32_t w, uint16_t color);
+    void vline(int32_t x, int32_t y, int32_t h, uint16_t color);
+    void rect(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t color);
+    void circleHelper(int32_t x0, int32_t y0, int32_t r, uint8_t corners, uint16_t color);
+    void fillCircleHelper(int32_t x0, int32_t y0, int32_t r, uint8_t corners, int32_t delta,
+                          uint16_t color);
+    void drawChar(int32_t x, int32_t y, char c, uint8_t scale);
+    uint8_t glyphScale() const { return _freeFont ? _textSize * 2 : _textSize; }
+};
+
+#endif // NATIVE_TFT_ESPI_H
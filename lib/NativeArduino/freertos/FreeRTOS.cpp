@@ -0,0 +1,121 @@
+// freertos/FreeRTOS.cpp (native)
+// Tasks, delays, notifications and semaphores on std::thread
+
+#include "FreeRTOS.h"
+#include <chrono>
+#include <condition_variable>
+#include <thread>
+
+struct NativeTask {
+    std::mutex lock;
+    std::condition_variable signal;
+    uint32_t notifications = 0;
+};
+
+struct NativeSemaphore {
+    std::mutex lock;
+    std::condition_variable signal;
+    bool given = false;
+};
+
+// Every thread that asks gets a task record (the test's main thread too).
+// Records of created tasks live until the process ends, like a handle the
+// firmware might still compare against after the task has gone.
+static thread_local NativeTask* currentTask = nullptr;
+
+static std::chrono::steady_clock::time_point tickOrigin() {
+    static const auto origin = std::chrono::steady_clock::now();
+    return origin;
+}
+
+static std::chrono::steady_clock::time_point tickTime(TickType_t tick) {
+    return tickOrigin() + std::chrono::milliseconds(tick);
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - tickOrigin()).count();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    if (currentTask == nullptr) {
+        currentTask = new NativeTask();
+    }
+    return currentTask;
+}
+
+BaseType_t xTaskCreatePinnedToCore(void (*task)(void*), const char*, uint32_t, void* arg,
+                                   UBaseType_t, TaskHandle_t* handle, BaseType_t) {
+    NativeTask* record = new NativeTask();
+    if (handle != nullptr) {
+        *handle = record;
+    }
+    std::thread([task, arg, record]() {
+        currentTask = record;
+        task(arg);
+    }).detach();
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t) {
+    // The calling task's function returns right after this
+}
+
+void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+void vTaskDelayUntil(TickType_t* previousWake, TickType_t period) {
+    *previousWake += period;
+    std::this_thread::sleep_until(tickTime(*previousWake));
+}
+
+void xTaskNotifyGive(TaskHandle_t task) {
+    std::lock_guard<std::mutex> guard(task->lock);
+    task->notifications++;
+    task->signal.notify_all();
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+    NativeTask* task = xTaskGetCurrentTaskHandle();
+    std::unique_lock<std::mutex> guard(task->lock);
+    auto ready = [task]() { return task->notifications > 0; };
+    if (ticks == portMAX_DELAY) {
+        task->signal.wait(guard, ready);
+    } else if (!task->signal.wait_for(guard, std::chrono::milliseconds(ticks), ready)) {
+        return 0;
+    }
+    const uint32_t count = task->notifications;
+    task->notifications = clearOnExit ? 0 : count - 1;
+    return count;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+    return new NativeSemaphore();
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+    delete semaphore;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    std::lock_guard<std::mutex> guard(semaphore->lock);
+    if (semaphore->given) {
+        return pdFALSE;
+    }
+    semaphore->given = true;
+    semaphore->signal.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+    std::unique_lock<std::mutex> guard(semaphore->lock);
+    auto ready = [semaphore]() { return semaphore->given; };
+    if (ticks == portMAX_DELAY) {
+        semaphore->signal.wait(guard, ready);
+    } else if (!semaphore->signal.wait_for(guard, std::chrono::milliseconds(ticks), ready)) {
+        return pdFALSE;
+    }
+    semaphore->given = false;
+    return pdTRUE;
+}
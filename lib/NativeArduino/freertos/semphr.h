@@ -0,0 +1,9 @@
+// freertos/semphr.h (native)
+// Semaphores are declared with the rest of the API in FreeRTOS.h
+
+#ifndef NATIVE_FREERTOS_SEMPHR_H
+#define NATIVE_FREERTOS_SEMPHR_H
+
+#include "FreeRTOS.h"
+
+#endif // NATIVE_FREERTOS_SEMPHR_H
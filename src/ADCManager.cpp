@@ -2,185 +2,459 @@
 // Implementation of ADC management for analog sensors
 
 #include "ADCManager.h"
+#include "Profiler.h"
+#include "HostLink.h"
+#include <math.h>
 
-ADCManager::ADCManager(uint8_t o2_pin, uint8_t vol_pin)
-    : _o2Pin(o2_pin)
-    , _volPin(vol_pin)
-    , _o2_raw(0)
-    , _vol_raw(0)
-    , _o2_voltage(0.0)
-    , _vol_voltage(0.0)
+ADCManager::ADCManager()
+    : _source(nullptr)
+    , _acqStop(false)
+    , _acqTask(nullptr)
+    , _acqDone(nullptr)
+    , _sampleRateHz(0)
+    , _sampleCount(0)
+    , _pktCount(0)
+    , _volStreamHead(0)
+    , _volStreamCount(0)
+    , _volDecimation(5)
+    , _decVolSum(0)
+    , _decStartUs(0)
+    , _decCount(0)
+    , _osLog2(0)
+    , _dither(false)
+    , _ditherState(0x9E3779B9UL)
+    , _acqCycleUs(0)
+    , _acqCycleMaxUs(0)
+    , _noiseCount(0)
+    , _adcCharacterized(false)
     , _filterEnabled(true)
     , _filterSize(10)
-    , _o2FilterBuffer(nullptr)
-    , _volFilterBuffer(nullptr)
-    , _filterIndex(0)
 {
-    // Default O2 calibration (0-3.3V = 0-100% O2, linear)
-    _o2Cal.v_at_0_percent = 0.0;
-    _o2Cal.v_at_100_percent = 3.3;
+    for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+        _pins[ch] = Sensors::info(ch).pin;
+        _pktSum[ch] = 0;
+        _raw[ch] = 0;
+        _voltage[ch] = 0.0f;
+    }
+    
+    // Default calibration from the channel definitions
+    _bank.setDefaultCalibration();
     
-    // Default volume calibration (200 mL per volt, no offset)
-    _volCal.ml_per_volt = 200.0;
-    _volCal.offset_ml = 0.0;
+    memset(&_lastSample, 0, sizeof(_lastSample));
+    resetNoiseStats();
+    
+    _bank.setWindow(_filterSize);
 }
 
 bool ADCManager::begin() {
-    Serial.println("Initializing ADC Manager...");
+    HostLog.println("Initializing ADC Manager...");
     
     // Configure ADC resolution and attenuation
     analogReadResolution(12);       // 12-bit resolution (0-4095)
     analogSetAttenuation(ADC_11db); // 0-3.3V range
     
     // Characterize ADC for better accuracy
-    esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, 
+    esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11,
                             ADC_WIDTH_BIT_12, 1100, &_adcChars);
+    _adcCharacterized = true;
+    buildTables();
     
     // Configure pins as inputs
-    pinMode(_o2Pin, INPUT);
-    pinMode(_volPin, INPUT);
-    
-    // Allocate filter buffers
-    if (_filterEnabled) {
-        _o2FilterBuffer = new uint16_t[_filterSize];
-        _volFilterBuffer = new uint16_t[_filterSize];
-        
-        if (!_o2FilterBuffer || !_volFilterBuffer) {
-            Serial.println("Failed to allocate filter buffers");
-            return false;
-        }
-        
-        // Initialize filter buffers with first reading
-        uint16_t o2_init = readADC(_o2Pin);
-        uint16_t vol_init = readADC(_volPin);
-        
-        for (int i = 0; i < _filterSize; i++) {
-            _o2FilterBuffer[i] = o2_init;
-            _volFilterBuffer[i] = vol_init;
+    for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+        pinMode(_pins[ch], INPUT);
+        if (Sensors::info(ch).pull_down) {
+            gpio_pulldown_en((gpio_num_t)_pins[ch]);
+            gpio_pullup_dis((gpio_num_t)_pins[ch]);
         }
     }
     
-    Serial.println("ADC Manager initialized");
+    // Prime filters with the first reading
+    uint16_t init[SENSOR_COUNT];
+    for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+        init[ch] = readADC(ch);
+        _raw[ch] = init[ch] >> ADC_FRAC_BITS;
+    }
+    _bank.prime(init);
+    
+    HostLog.printf("ADC Manager initialized (%u channels)\n", SENSOR_COUNT);
     return true;
 }
 
 void ADCManager::update(CO2Data& data) {
-    // Read raw ADC values
-    uint16_t o2_new = readADC(_o2Pin);
-    uint16_t vol_new = readADC(_volPin);
+    PROFILE_SCOPE(PROF_ADC_UPDATE);
+    
+    uint16_t in[SENSOR_COUNT];
+    
+    if (isAcquiring()) {
+        // Mean of all samples since the previous packet (boxcar decimation)
+        poll();
+        for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+            in[ch] = (_pktCount > 0) ? (_pktSum[ch] + _pktCount / 2) / _pktCount
+                                     : _lastSample.raw[ch];
+            _pktSum[ch] = 0;
+        }
+        _pktCount = 0;
+    } else {
+        // Single conversion per packet
+        for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+            in[ch] = readADC(ch);
+        }
+    }
     
     // Apply filtering if enabled
-    if (_filterEnabled && _o2FilterBuffer && _volFilterBuffer) {
-        _o2_raw = applyFilter(_o2FilterBuffer, o2_new);
-        _vol_raw = applyFilter(_volFilterBuffer, vol_new);
+    uint16_t q[SENSOR_COUNT];
+    if (_filterEnabled) {
+        _bank.filter(in, q);
     } else {
-        _o2_raw = o2_new;
-        _vol_raw = vol_new;
+        memcpy(q, in, sizeof(q));
+    }
+    
+    // 12-bit equivalents and voltages (diagnostics)
+    const uint16_t half = 1 << (ADC_FRAC_BITS - 1);
+    const float mv_scale = 0.001f / (1 << ADC_FRAC_BITS);
+    for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+        _raw[ch] = (q[ch] + half) >> ADC_FRAC_BITS;
+        _voltage[ch] = adcLookup(_mvLut, q[ch]) * mv_scale;
+    }
+    
+    // Table lookups, interpolated on the fractional bits:
+    // physical units and PIC-compatible format for LabVIEW
+    _bank.convert(q, data.sensors);
+}
+
+bool ADCManager::startAcquisition(uint16_t sample_rate_hz) {
+    if (isAcquiring()) {
+        return true;
     }
+    if (sample_rate_hz < 200) sample_rate_hz = 200;
+    if (sample_rate_hz > 1000) sample_rate_hz = 1000;
     
-    // Convert to voltages
-    _o2_voltage = rawToVoltage(_o2_raw);
-    _vol_voltage = rawToVoltage(_vol_raw);
+    // Task is paced in whole RTOS ticks (1 ms), so the rate is 1000 / ticks
+    uint16_t period_ms = 1000 / sample_rate_hz;
+    _sampleRateHz = 1000 / period_ms;
     
-    // Convert to physical units
-    data.o2_percent = voltageToO2Percent(_o2_voltage);
-    data.volume_ml = voltageToVolume(_vol_voltage);
+    if (_acqDone == nullptr) {
+        _acqDone = xSemaphoreCreateBinary();
+        if (_acqDone == nullptr) {
+            HostLog.println("Failed to start ADC acquisition task");
+            return false;
+        }
+    }
     
-    // Scale to PIC-compatible format for LabVIEW
-    data.o2_adc = scaleToPIC_AN0(_o2_raw);
-    data.vol_adc = scaleToPIC_AN1(_vol_raw);
+    _acqRing.reset();
+    _acqStop.store(false, std::memory_order_relaxed);
+    for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+        _pktSum[ch] = 0;
+    }
+    _pktCount = 0;
+    _decVolSum = 0;
+    _decCount = 0;
+    
+    // Core 0 keeps sampling independent of loop() (display SPI, JSON) on core 1
+    BaseType_t ok = xTaskCreatePinnedToCore(acquisitionTask, "adc_acq", 3072, this,
+                                            5, &_acqTask, 0);
+    if (ok != pdPASS) {
+        _acqTask = nullptr;
+        HostLog.println("Failed to start ADC acquisition task");
+        return false;
+    }
+    
+    HostLog.printf("ADC acquisition started at %u Hz (volume stream %u Hz)\n",
+                  _sampleRateHz, _sampleRateHz / _volDecimation);
+    return true;
+}
+
+void ADCManager::stopAcquisition() {
+    if (!isAcquiring()) {
+        return;
+    }
+    _acqStop.store(true, std::memory_order_release);
+    
+    // The task finishes its current cycle (up to a few ms when heavily
+    // oversampled) and confirms; only then may the ring and settings change
+    if (xSemaphoreTake(_acqDone, pdMS_TO_TICKS(ACQ_STOP_TIMEOUT_MS)) != pdTRUE) {
+        HostLog.println("ADC acquisition task did not stop");
+        return;
+    }
+    _acqTask = nullptr;
+    poll();
 }
 
-void ADCManager::setO2Calibration(float voltage_at_0_percent, float voltage_at_100_percent) {
-    _o2Cal.v_at_0_percent = voltage_at_0_percent;
-    _o2Cal.v_at_100_percent = voltage_at_100_percent;
-    Serial.printf("O2 calibration set: 0%%=%0.3fV, 100%%=%0.3fV\n", 
-                  voltage_at_0_percent, voltage_at_100_percent);
+void ADCManager::poll() {
+    _acqRing.consume([this](const ADCSample& sample) { consumeSample(sample); });
 }
 
-void ADCManager::setVolumeCalibration(float ml_per_volt, float offset_ml) {
-    _volCal.ml_per_volt = ml_per_volt;
-    _volCal.offset_ml = offset_ml;
-    Serial.printf("Volume calibration set: %0.1f mL/V, offset=%0.1f mL\n",
-                  ml_per_volt, offset_ml);
+void ADCManager::setVolumeDecimation(uint8_t factor) {
+    if (factor < 1) factor = 1;
+    _volDecimation = factor;
+    _decVolSum = 0;
+    _decCount = 0;
 }
 
-void ADCManager::setFilterSize(uint8_t size) {
-    if (size < 1) size = 1;
-    if (size > 50) size = 50;
-    
-    if (size != _filterSize) {
-        // Reallocate buffers
-        if (_o2FilterBuffer) delete[] _o2FilterBuffer;
-        if (_volFilterBuffer) delete[] _volFilterBuffer;
-        
-        _filterSize = size;
-        _o2FilterBuffer = new uint16_t[_filterSize];
-        _volFilterBuffer = new uint16_t[_filterSize];
-        _filterIndex = 0;
-        
-        // Initialize with current reading
-        uint16_t o2_init = readADC(_o2Pin);
-        uint16_t vol_init = readADC(_volPin);
-        for (int i = 0; i < _filterSize; i++) {
-            _o2FilterBuffer[i] = o2_init;
-            _volFilterBuffer[i] = vol_init;
+uint16_t ADCManager::readVolumeStream(VolumeSample* out, uint16_t max_samples) {
+    uint16_t n = 0;
+    while (n < max_samples && _volStreamCount > 0) {
+        uint16_t oldest = (_volStreamHead + VOL_STREAM_SIZE - _volStreamCount) % VOL_STREAM_SIZE;
+        out[n++] = _volStream[oldest];
+        _volStreamCount--;
+    }
+    return n;
+}
+
+void ADCManager::setSampleSource(ADCSampleSource* source) {
+    _source = source;
+}
+
+void ADCManager::setLinearCalibration(uint8_t channel, float v0, float y0, float v1, float y1) {
+    if (channel >= SENSOR_COUNT) return;
+    
+    // An invalid line (v0 == v1) leaves an empty curve, which evaluates to 0
+    CalibrationCurve curve;
+    curve.setLinear(v0, y0, v1, y1);
+    _bank.setCurve(channel, curve, _adcCharacterized ? _mvLut : nullptr);
+    
+    const SensorInfo& info = Sensors::info(channel);
+    HostLog.printf("%s calibration set: %0.3fV=%0.1f%s, %0.3fV=%0.1f%s\n",
+                  info.label, v0, y0, info.unit, v1, y1, info.unit);
+}
+
+bool ADCManager::setCalibrationCurve(uint8_t channel, const CalPoint* points, uint8_t count,
+                                     CalibrationMode mode) {
+    if (channel >= SENSOR_COUNT) return false;
+    
+    const SensorInfo& info = Sensors::info(channel);
+    CalibrationCurve curve;
+    if (!curve.setPoints(points, count, mode)) {
+        HostLog.printf("%s calibration rejected (need 2-16 distinct points)\n", info.label);
+        return false;
+    }
+    _bank.setCurve(channel, curve, _adcCharacterized ? _mvLut : nullptr);
+    HostLog.printf("%s calibration set: %d points, %s\n", info.label, count,
+                  curve.getMode() == CAL_CUBIC_SPLINE ? "spline" : "linear");
+    return true;
+}
+
+bool ADCManager::applyProfile(const CalibrationProfile& profile) {
+    bool ok = true;
+    for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+        const ChannelCalibration& cal = profile.channels[ch];
+        if (cal.count > 0) {
+            ok &= setCalibrationCurve(ch, cal.points, cal.count, (CalibrationMode)cal.mode);
         }
     }
+    HostLog.printf("Calibration profile '%s' applied\n", profile.serial);
+    return ok;
 }
 
-uint16_t ADCManager::readADC(uint8_t pin) {
-    return analogRead(pin);
+bool ADCManager::getProfile(const char* serial, CalibrationProfile& profile) const {
+    if (!CalibrationStore::initProfile(profile, serial)) {
+        return false;
+    }
+    for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+        const CalibrationCurve* curve = _bank.curve(ch);
+        ChannelCalibration& cal = profile.channels[ch];
+        cal.mode = (uint8_t)curve->getMode();
+        cal.count = curve->getCount();
+        for (uint8_t i = 0; i < cal.count; i++) {
+            cal.points[i] = curve->getPoint(i);
+        }
+    }
+    return true;
 }
 
-float ADCManager::rawToVoltage(uint16_t raw) {
-    // Use ESP32 calibration for accurate voltage
-    uint32_t voltage_mv = esp_adc_cal_raw_to_voltage(raw, &_adcChars);
-    return voltage_mv / 1000.0;  // Convert mV to V
+void ADCManager::setFilterSize(uint8_t size) {
+    if (size < 1) size = 1;
+    if (size > ADC_FILTER_MAX_WINDOW) size = ADC_FILTER_MAX_WINDOW;
+    
+    // Window change keeps the current mean, so no re-read is needed
+    _filterSize = size;
+    _bank.setWindow(size);
 }
 
-float ADCManager::voltageToO2Percent(float voltage) {
-    // Linear interpolation between calibration points
-    float voltage_range = _o2Cal.v_at_100_percent - _o2Cal.v_at_0_percent;
+uint16_t ADCManager::readADC(uint8_t channel) {
+    const uint8_t pin = _pins[channel];
+    const uint8_t osLog2 = _osLog2;     // One factor for the whole conversion
     
-    if (voltage_range <= 0.0) {
-        return 0.0;  // Invalid calibration
+    if (osLog2 == 0) {
+        uint16_t raw = _source ? _source->read(channel) : analogRead(pin);
+        return raw << ADC_FRAC_BITS;
     }
     
-    float percent = ((voltage - _o2Cal.v_at_0_percent) / voltage_range) * 100.0;
+    // Accumulate 2^n conversions (12 + n bits)
+    const uint16_t n = 1 << osLog2;
+    uint32_t sum = 0;
+    if (_source) {
+        for (uint16_t i = 0; i < n; i++) sum += _source->read(channel);
+    } else {
+        for (uint16_t i = 0; i < n; i++) sum += analogRead(pin);
+    }
     
-    // Clamp to reasonable range
-    if (percent < 0.0) percent = 0.0;
-    if (percent > 100.0) percent = 100.0;
+    // Mean in ADC_FRAC_BITS fixed point: shift by log2(n) - FRAC. Keeping the
+    // fractional bits (instead of truncating to 12 + n/2 bits) avoids the
+    // rounding bias of quantized ties. Dither randomizes the discarded bits
+    // (stochastic rounding) instead of always rounding at half.
+    const int8_t shift = (int8_t)osLog2 - ADC_FRAC_BITS;
+    if (shift <= 0) {
+        return (uint16_t)(sum << -shift);
+    }
+    if (_dither) {
+        _ditherState ^= _ditherState << 13;
+        _ditherState ^= _ditherState >> 17;
+        _ditherState ^= _ditherState << 5;
+        sum += _ditherState & ((1UL << shift) - 1);
+    } else {
+        sum += 1UL << (shift - 1);
+    }
+    return (uint16_t)(sum >> shift);
+}
+
+void ADCManager::setOversampling(uint16_t factor, bool dither) {
+    uint8_t log2 = 0;
+    if (factor >= 4) {
+        if (factor > 256) factor = 256;
+        while ((2U << log2) <= factor) log2++;  // Round down to a power of two
+    }
+    _osLog2 = log2;
+    _dither = dither;
+    resetNoiseStats();
     
-    return percent;
+    HostLog.printf("ADC oversampling: %ux (+%u bits)%s\n",
+                  1U << log2, log2 / 2, dither ? ", dithered" : "");
 }
 
-float ADCManager::voltageToVolume(float voltage) {
-    return (voltage * _volCal.ml_per_volt) + _volCal.offset_ml;
+void ADCManager::resetNoiseStats() {
+    _noiseCount = 0;
+    for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+        _noiseSumSq[ch] = 0;
+        _noisePrev[ch] = 0;
+        _noise[ch].noise_lsb = 0.0f;
+        _noise[ch].noise_mv = 0.0f;
+        _noise[ch].enob = 0.0f;
+    }
 }
 
-uint16_t ADCManager::applyFilter(uint16_t* buffer, uint16_t newValue) {
-    // Moving average filter
-    buffer[_filterIndex] = newValue;
-    _filterIndex = (_filterIndex + 1) % _filterSize;
+void ADCManager::updateNoiseStats(const ADCSample& sample) {
+    // First differences remove the (slow) signal: var(d) = 2 * var(noise)
+    if (_noiseCount > 0) {
+        for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+            int32_t d = (int32_t)sample.raw[ch] - (int32_t)_noisePrev[ch];
+            _noiseSumSq[ch] += (uint64_t)((int64_t)d * d);
+        }
+    }
+    for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+        _noisePrev[ch] = sample.raw[ch];
+    }
     
-    uint32_t sum = 0;
-    for (int i = 0; i < _filterSize; i++) {
-        sum += buffer[i];
+    if (++_noiseCount <= NOISE_WINDOW) {
+        return;
+    }
+    
+    // Sample quantization (12-bit LSB, or the fixed-point step when
+    // oversampling) bounds the measurable floor
+    const float q_lsb = _osLog2 ? 1.0f / (1 << ADC_FRAC_BITS) : 1.0f;
+    const float min_sigma = q_lsb / sqrtf(12.0f);
+    const float mv_per_lsb = (_mvLut[ADC_LUT_SIZE - 1] - _mvLut[0]) / (float)(ADC_LUT_SIZE - 1);
+    const float frac = 1.0f / (1 << ADC_FRAC_BITS);
+    
+    for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+        float var = (float)_noiseSumSq[ch] / (2.0f * NOISE_WINDOW);
+        float sigma = sqrtf(var) * frac;
+        if (sigma < min_sigma) sigma = min_sigma;
+    
+        _noise[ch].noise_lsb = sigma;
+        _noise[ch].noise_mv = sigma * mv_per_lsb;
+        _noise[ch].enob = log2f(ADC_LUT_SIZE / (sigma * sqrtf(12.0f)));
+        _noiseSumSq[ch] = 0;
+    }
+    _noiseCount = 1;
+}
+
+void ADCManager::consumeSample(const ADCSample& sample) {
+    _lastSample = sample;
+    _sampleCount++;
+    updateNoiseStats(sample);
+    
+    // Packet-aligned accumulation (restart if update() isn't being called)
+    if (_pktCount == 0xFFFF) {
+        for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+            _pktSum[ch] = 0;
+        }
+        _pktCount = 0;
+    }
+    for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+        _pktSum[ch] += sample.raw[ch];
     }
+    _pktCount++;
+    
+    // High-rate volume stream: boxcar decimation
+    const uint16_t vol_raw = sample.raw[SENSOR_VOLUME];
+    const uint32_t vol_t = sample.t_us[SENSOR_VOLUME];
+    if (_decCount == 0) {
+        _decStartUs = vol_t;
+    }
+    _decVolSum += vol_raw;
+    _decCount++;
+    
+    if (_decCount >= _volDecimation) {
+        uint16_t vol_q = (_decVolSum + _decCount / 2) / _decCount;
     
-    return sum / _filterSize;
+        VolumeSample& out = _volStream[_volStreamHead];
+        out.t_us = _decStartUs + (vol_t - _decStartUs) / 2;
+        out.volume_ml = _bank.value(SENSOR_VOLUME, vol_q);
+        _volStreamHead = (_volStreamHead + 1) % VOL_STREAM_SIZE;
+        if (_volStreamCount < VOL_STREAM_SIZE) {
+            _volStreamCount++;  // Otherwise the oldest sample is overwritten
+        }
+    
+        _decVolSum = 0;
+        _decCount = 0;
+    }
 }
 
-uint16_t ADCManager::scaleToPIC_AN0(uint16_t raw) {
-    // PIC AN0 format: 10-bit left-justified to 16-bit (0-65535)
-    // ESP32: 12-bit (0-4095) needs to scale to 16-bit
-    return map(raw, 0, 4095, 0, 65535);
+void ADCManager::acquisitionTask(void* arg) {
+    ADCManager* self = static_cast<ADCManager*>(arg);
+    const TickType_t period = pdMS_TO_TICKS(1000 / self->_sampleRateHz);
+    TickType_t lastWake = xTaskGetTickCount();
+    Tracer::nameTask("adc_acq");
+    
+    while (!self->_acqStop.load(std::memory_order_acquire)) {
+        ADCSample sample;
+        {
+            TRACE_SCOPE("adc_convert");
+            for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+                sample.t_us[ch] = micros();
+                sample.raw[ch] = self->readADC(ch);
+            }
+        }
+    
+        // Conversion cost per output sample (all channels, incl. oversampling)
+        uint32_t cycle_us = micros() - sample.t_us[0];
+        self->_acqCycleUs = cycle_us;
+        if (cycle_us > self->_acqCycleMaxUs) self->_acqCycleMaxUs = cycle_us;
+    
+        // Consumer fell behind: the ring drops this sample and counts it
+        self->_acqRing.push(sample);
+    
+        TickType_t now = xTaskGetTickCount();
+        if ((TickType_t)(now - lastWake) >= period) {
+            // Conversions took longer than the period (heavy oversampling):
+            // resynchronise and still yield so core 0 housekeeping can run
+            lastWake = now;
+            vTaskDelay(1);
+        } else {
+            vTaskDelayUntil(&lastWake, period);
+        }
+    }
+    
+    // Last access to self: stopAcquisition() may reuse the manager from here
+    xSemaphoreGive(self->_acqDone);
+    vTaskDelete(nullptr);
 }
 
-uint16_t ADCManager::scaleToPIC_AN1(uint16_t raw) {
-    // PIC AN1 format: 10-bit right-justified (0-1023)
-    // ESP32: 12-bit (0-4095) needs to scale down to 10-bit
-    return map(raw, 0, 4095, 0, 1023);
+void ADCManager::buildTables() {
+    // Calibrated voltage per raw count; channel tables are derived from it
+    for (uint16_t raw = 0; raw < ADC_LUT_SIZE; raw++) {
+        _mvLut[raw] = (uint16_t)esp_adc_cal_raw_to_voltage(raw, &_adcChars);
+    }
+    _bank.buildTables(_mvLut);
 }
@@ -0,0 +1,266 @@
+// BreathDetector.cpp
+// Implementation of breath-by-breath waveform segmentation
+//
+// Approach:
+// - Upper/lower envelopes follow the waveform instantly in their own
+//   direction and decay slowly towards it otherwise.
+// - The midpoint between the envelopes is the phase threshold, with
+//   hysteresis of 1/8 of the envelope span, so noise on a plateau or on
+//   the baseline cannot toggle the phase.
+// - A rise of MIN_AMPLITUDE_Q8 above the inspiratory minimum also starts
+//   an expiration, and the breath ends at the midpoint of its own extremes,
+//   so a shallow breath right after a deep one (envelope still high) is
+//   detected as well.
+// - Ti and Te are measured between crossings of each breath's midpoint,
+//   interpolated between samples (the triggers above only decide the phase).
+// - The phase-III fit uses the raw samples: the smoothing lag would
+//   otherwise add the tail of the upstroke to the plateau slope.
+// Every step is a handful of integer operations (O(1) per sample).
+
+#include "BreathDetector.h"
+#include <string.h>
+
+BreathDetector::BreathDetector() {
+    reset();
+}
+
+void BreathDetector::reset() {
+    _phase = PHASE_UNKNOWN;
+    _apnea = false;
+    _smooth = 0;
+    _envHi = 0;
+    _envLo = 0;
+    _primed = false;
+    _prevT = 0;
+    _prevY = 0;
+    _inspStart = 0;
+    _lastBreathEnd = 0;
+    _inspMin = 0;
+    _expMax = 0;
+    _inspValid = false;
+    _riseN = 0;
+    _aboveT = 0;
+    _aboveY = 0;
+    _belowT = 0;
+    _belowY = 0;
+    _below = false;
+    resetPhase3();
+    memset(&_last, 0, sizeof(_last));
+}
+
+bool BreathDetector::addSample(uint8_t co2_mmhg, uint32_t t) {
+    int32_t x = (int32_t)co2_mmhg << 8;
+
+    if (!_primed) {
+        _smooth = x;
+        _envHi = x;
+        _envLo = x;
+        _lastBreathEnd = t;
+        _prevT = t;
+        _prevY = x;
+        _primed = true;
+        return false;
+    }
+
+    // Light smoothing (2-sample IIR) to suppress single-LSB flicker
+    _smooth += (x - _smooth) >> 1;
+    const int32_t y = _smooth;
+
+    // Envelope tracking
+    if (y > _envHi) _envHi = y;
+    else _envHi -= (_envHi - y) >> ENVELOPE_SHIFT;
+    if (y < _envLo) _envLo = y;
+    else _envLo += (y - _envLo) >> ENVELOPE_SHIFT;
+
+    const int32_t span = _envHi - _envLo;
+    const int32_t mid = _envLo + (span >> 1);
+    int32_t hyst = span >> 3;
+    if (hyst < (1 << 7)) hyst = 1 << 7;  // At least 0.5 mmHg
+
+    bool completed = false;
+
+    // Apnea: clear outputs so stale EtCO2/RR are not reported forever
+    if (!_apnea && (t - _lastBreathEnd) > APNEA_MS) {
+        _apnea = true;
+        _last.etco2_x10 = 0;
+        _last.rr_x10 = 0;
+    }
+
+    if (span < MIN_AMPLITUDE_Q8) {
+        // Flat signal (ambient air, disconnected line): no segmentation
+        _phase = PHASE_UNKNOWN;
+        _prevT = t;
+        _prevY = y;
+        return false;
+    }
+
+    switch (_phase) {
+        case PHASE_UNKNOWN:
+            // Synchronise on the first clear crossing, without reporting a breath
+            if (y < mid - hyst) {
+                _phase = PHASE_INSPIRATION;
+                _inspStart = t;
+                _inspMin = y;
+            } else if (y > mid + hyst) {
+                _inspMin = _envLo;
+                startExpiration(t, y);
+                _inspValid = false;
+            }
+            break;
+
+        case PHASE_INSPIRATION:
+            if (y < _inspMin) _inspMin = y;
+            if (y > mid + hyst || y > _inspMin + MIN_AMPLITUDE_Q8) {
+                startExpiration(t, y);
+            }
+            break;
+
+        case PHASE_EXPIRATION: {
+            if (y > _expMax) _expMax = y;
+            if (_riseN < RISE_SAMPLES && y > _riseY[_riseN - 1]) {
+                _riseT[_riseN] = t;
+                _riseY[_riseN] = y;
+                _riseN++;
+            }
+
+            // Phase III: upper quarter of the envelope span (alveolar plateau)
+            if (y >= _envHi - (span >> 2)) {
+                addPhase3(t, x);
+            }
+
+            // End of expiration: midpoint of this breath's own swing
+            const int32_t amplitude = _expMax - _inspMin;
+            const int32_t level = _inspMin + (amplitude >> 1);
+            if (y >= level) {
+                _aboveT = t;
+                _aboveY = y;
+                _below = false;
+            } else if (!_below) {
+                _belowT = t;
+                _belowY = y;
+                _below = true;
+            }
+            int32_t fallHyst = amplitude >> 3;
+            if (fallHyst < (1 << 7)) fallHyst = 1 << 7;
+            if (y < level - fallHyst) {
+                const uint32_t expEnd = fallCrossing(level);
+                completed = finishBreath(t, riseCrossing(level), expEnd);
+                _phase = PHASE_INSPIRATION;
+                _inspStart = expEnd;
+                _inspMin = y;
+                _inspValid = true;
+            }
+            break;
+        }
+    }
+
+    _prevT = t;
+    _prevY = y;
+    return completed;
+}
+
+void BreathDetector::startExpiration(uint32_t t, int32_t y) {
+    _phase = PHASE_EXPIRATION;
+    _expMax = y;
+    _riseT[0] = _prevT;
+    _riseY[0] = _prevY;
+    _riseT[1] = t;
+    _riseY[1] = y;
+    _riseN = 2;
+    _aboveT = t;
+    _aboveY = y;
+    _below = false;
+    resetPhase3();
+}
+
+// Time at which the line between two samples reaches level
+static uint32_t interpolate(uint32_t t0, int32_t y0, uint32_t t1, int32_t y1, int32_t level) {
+    if (y1 == y0) {
+        return t1;
+    }
+    int64_t f = (int64_t)(level - y0) * (int32_t)(t1 - t0) / (y1 - y0);
+    if (f < 0) f = 0;
+    if (f > (int64_t)(t1 - t0)) f = t1 - t0;
+    return t0 + (uint32_t)f;
+}
+
+uint32_t BreathDetector::riseCrossing(int32_t level) const {
+    for (uint8_t i = 1; i < _riseN; i++) {
+        if (_riseY[i] >= level) {
+            return interpolate(_riseT[i - 1], _riseY[i - 1], _riseT[i], _riseY[i], level);
+        }
+    }
+    return _riseT[_riseN - 1];          // Upstroke longer than the buffer
+}
+
+uint32_t BreathDetector::fallCrossing(int32_t level) const {
+    return interpolate(_aboveT, _aboveY, _belowT, _belowY, level);
+}
+
+bool BreathDetector::finishBreath(uint32_t t, uint32_t expStart, uint32_t expEnd) {
+    const uint32_t ti = expStart - _inspStart;
+    const uint32_t te = expEnd - expStart;
+    const uint32_t total = ti + te;
+
+    // Need a full inspiration + expiration of plausible length
+    if (!_inspValid || ti == 0 || total < MIN_BREATH_MS || total > MAX_BREATH_MS) {
+        return false;
+    }
+    if (_expMax - _inspMin < MIN_AMPLITUDE_Q8) {
+        return false;
+    }
+
+    // Q8 -> x10 with rounding
+    _last.etco2_x10 = (uint16_t)((_expMax * 10 + 128) >> 8);
+    _last.fico2_x10 = (uint16_t)(((_inspMin > 0 ? _inspMin : 0) * 10 + 128) >> 8);
+    _last.ti_ms = (ti > 0xFFFF) ? 0xFFFF : (uint16_t)ti;
+    _last.te_ms = (te > 0xFFFF) ? 0xFFFF : (uint16_t)te;
+    _last.phase3_slope = phase3Slope();
+    _last.rr_x10 = (uint16_t)((600000UL + total / 2) / total);
+    _last.breath_count++;
+    _last.end_time = t;
+
+    _lastBreathEnd = t;
+    _apnea = false;
+    return true;
+}
+
+void BreathDetector::resetPhase3() {
+    _p3Start = 0;
+    _p3N = 0;
+    _p3SumX = 0;
+    _p3SumY = 0;
+    _p3SumXX = 0;
+    _p3SumXY = 0;
+}
+
+void BreathDetector::addPhase3(uint32_t t, int32_t y) {
+    if (_p3N == 0) {
+        _p3Start = t;
+    }
+    int64_t x = (int64_t)(t - _p3Start);
+    _p3N++;
+    _p3SumX += x;
+    _p3SumY += y;
+    _p3SumXX += x * x;
+    _p3SumXY += x * y;
+}
+
+int16_t BreathDetector::phase3Slope() const {
+    if (_p3N < 3) {
+        return 0;
+    }
+
+    // Least squares: slope = (n*Sxy - Sx*Sy) / (n*Sxx - Sx^2), in Q8 per ms
+    int64_t den = (int64_t)_p3N * _p3SumXX - _p3SumX * _p3SumX;
+    if (den <= 0) {
+        return 0;
+    }
+    int64_t num = (int64_t)_p3N * _p3SumXY - _p3SumX * _p3SumY;
+
+    // Q8/ms -> mmHg/s x 100: * 1000 * 100 / 256
+    int64_t slope = num * 100000 / den / 256;
+    if (slope > 32767) slope = 32767;
+    if (slope < -32768) slope = -32768;
+    return (int16_t)slope;
+}
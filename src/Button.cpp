@@ -11,26 +11,31 @@ void Button::begin() {
 }
 
 void IRAM_ATTR Button::handleInterrupt() {
-    unsigned long currentTime = millis();
+    unsigned long currentTime = _clock ? _clock->millis() : millis();
     if (currentTime - _lastInterruptTime < _debounceMs) return;
     _lastInterruptTime = currentTime;
 
     if (digitalRead(_pin) == LOW) {
         // pressed
-        _pressedFlag = true;
         _pressStartTime = currentTime;
+        _events.push(EVENT_PRESS);
     } else {
         // released
-        _releasedFlag = true;
-        _pressDuration = currentTime - _pressStartTime;
-        if (_pressDuration >= _longPressMs) {
-            _longPressFlag = true;
-        }
+        bool isLong = (currentTime - _pressStartTime) >= _longPressMs;
+        _events.push(isLong ? EVENT_RELEASE_LONG : EVENT_RELEASE);
     }
 }
 
 void Button::update() {
-    // nothing fancy now, but could be expanded later
+    uint8_t event;
+    while (_events.pop(event)) {
+        if (event == EVENT_PRESS) {
+            _pressedFlag = true;
+        } else {
+            _releasedFlag = true;
+            _longPressFlag = (event == EVENT_RELEASE_LONG);
+        }
+    }
 }
 
 bool Button::wasPressed() {
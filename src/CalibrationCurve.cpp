@@ -0,0 +1,116 @@
+// CalibrationCurve.cpp
+// Implementation of multi-point calibration curves
+//
+// Spline: natural cubic spline (second derivative zero at both ends), solved
+// once in setPoints() with the tridiagonal (Thomas) algorithm. Outside the
+// points the curve continues with the end slope, so a two-point curve is
+// the usual straight line.
+
+#include "CalibrationCurve.h"
+
+CalibrationCurve::CalibrationCurve()
+    : _count(0)
+    , _mode(CAL_PIECEWISE_LINEAR)
+{
+}
+
+bool CalibrationCurve::setPoints(const CalPoint* points, uint8_t count,
+                                 CalibrationMode mode) {
+    _count = 0;
+    if (count < 2 || count > MAX_POINTS) {
+        return false;
+    }
+
+    // Insertion sort by x
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t j = i;
+        while (j > 0 && _pts[j - 1].x > points[i].x) {
+            _pts[j] = _pts[j - 1];
+            j--;
+        }
+        _pts[j] = points[i];
+    }
+    for (uint8_t i = 1; i < count; i++) {
+        if (_pts[i].x <= _pts[i - 1].x) {
+            return false;
+        }
+    }
+
+    _count = count;
+    _mode = (count >= 3) ? mode : CAL_PIECEWISE_LINEAR;
+    if (_mode == CAL_CUBIC_SPLINE) {
+        computeSpline();
+    }
+    return true;
+}
+
+bool CalibrationCurve::setLinear(float x0, float y0, float x1, float y1) {
+    CalPoint p[2] = { { x0, y0 }, { x1, y1 } };
+    return setPoints(p, 2, CAL_PIECEWISE_LINEAR);
+}
+
+void CalibrationCurve::computeSpline() {
+    const uint8_t n = _count;
+    float c[MAX_POINTS];    // Modified super-diagonal
+    float d[MAX_POINTS];    // Modified right-hand side
+
+    _m2[0] = 0.0f;
+    _m2[n - 1] = 0.0f;
+    c[0] = 0.0f;
+    d[0] = 0.0f;
+
+    // Forward sweep over the interior points
+    for (uint8_t i = 1; i < n - 1; i++) {
+        float h0 = _pts[i].x - _pts[i - 1].x;
+        float h1 = _pts[i + 1].x - _pts[i].x;
+        float rhs = 6.0f * ((_pts[i + 1].y - _pts[i].y) / h1 -
+                            (_pts[i].y - _pts[i - 1].y) / h0);
+        float diag = 2.0f * (h0 + h1) - h0 * c[i - 1];
+        c[i] = h1 / diag;
+        d[i] = (rhs - h0 * d[i - 1]) / diag;
+    }
+
+    // Back substitution
+    for (int8_t i = n - 2; i >= 1; i--) {
+        _m2[i] = d[i] - c[i] * _m2[i + 1];
+    }
+}
+
+float CalibrationCurve::endSlope(bool upper) const {
+    uint8_t i = upper ? _count - 2 : 0;
+    float h = _pts[i + 1].x - _pts[i].x;
+    float slope = (_pts[i + 1].y - _pts[i].y) / h;
+    if (_mode == CAL_CUBIC_SPLINE) {
+        // Spline derivative at the end point
+        slope += upper ? h * (2.0f * _m2[i + 1] + _m2[i]) / 6.0f
+                       : -h * (2.0f * _m2[i] + _m2[i + 1]) / 6.0f;
+    }
+    return slope;
+}
+
+float CalibrationCurve::evaluate(float x) const {
+    if (_count < 2) {
+        return 0.0f;
+    }
+
+    // Linear extrapolation outside the calibrated range
+    if (x <= _pts[0].x) {
+        return _pts[0].y + (x - _pts[0].x) * endSlope(false);
+    }
+    if (x >= _pts[_count - 1].x) {
+        return _pts[_count - 1].y + (x - _pts[_count - 1].x) * endSlope(true);
+    }
+
+    uint8_t i = 0;
+    while (x > _pts[i + 1].x) i++;
+
+    const float h = _pts[i + 1].x - _pts[i].x;
+    const float a = (_pts[i + 1].x - x) / h;
+    const float b = 1.0f - a;
+    float y = a * _pts[i].y + b * _pts[i + 1].y;
+
+    if (_mode == CAL_CUBIC_SPLINE) {
+        y += ((a * a * a - a) * _m2[i] + (b * b * b - b) * _m2[i + 1]) * h * h / 6.0f;
+    }
+    return y;
+}
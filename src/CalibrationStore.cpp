@@ -0,0 +1,123 @@
+// CalibrationStore.cpp
+// Common profile helpers and the file-backed calibration store
+
+#include "CalibrationStore.h"
+#include <stdio.h>
+#include <string.h>
+
+bool CalibrationStore::loadActive(CalibrationProfile& profile) {
+    char serial[CalibrationProfile::SERIAL_LEN];
+    if (!getActive(serial, sizeof(serial))) {
+        return false;
+    }
+    return load(serial, profile);
+}
+
+bool CalibrationStore::initProfile(CalibrationProfile& profile, const char* serial) {
+    memset(&profile, 0, sizeof(profile));
+    if (!isValidSerial(serial)) {
+        return false;
+    }
+    profile.version = CalibrationProfile::VERSION;
+    strncpy(profile.serial, serial, CalibrationProfile::SERIAL_LEN - 1);
+    return true;
+}
+
+bool CalibrationStore::isValidSerial(const char* serial) {
+    if (!serial) return false;
+    size_t len = strlen(serial);
+    if (len < 1 || len >= CalibrationProfile::SERIAL_LEN) return false;
+
+    for (size_t i = 0; i < len; i++) {
+        char c = serial[i];
+        bool ok = (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+                  (c >= '0' && c <= '9') || c == '_' || c == '-';
+        if (!ok) return false;
+    }
+    return true;
+}
+
+bool CalibrationStore::isValidProfile(const CalibrationProfile& profile) {
+    if (profile.version != CalibrationProfile::VERSION) return false;
+    if (memchr(profile.serial, 0, CalibrationProfile::SERIAL_LEN) == nullptr) return false;
+    for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+        if (profile.channels[ch].count > CalibrationCurve::MAX_POINTS) return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// FileCalibrationStore
+// ============================================================================
+
+FileCalibrationStore::FileCalibrationStore(const char* dir) {
+    strncpy(_dir, dir, sizeof(_dir) - 1);
+    _dir[sizeof(_dir) - 1] = '\0';
+}
+
+void FileCalibrationStore::profilePath(char* path, uint16_t len, const char* serial) const {
+    snprintf(path, len, "%s/%s.cal", _dir, serial);
+}
+
+bool FileCalibrationStore::save(const CalibrationProfile& profile) {
+    if (!isValidProfile(profile) || !isValidSerial(profile.serial)) {
+        return false;
+    }
+
+    char path[96];
+    profilePath(path, sizeof(path), profile.serial);
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+
+    bool ok = fwrite(&profile, sizeof(profile), 1, f) == 1;
+    return (fclose(f) == 0) && ok;
+}
+
+bool FileCalibrationStore::load(const char* serial, CalibrationProfile& profile) {
+    if (!isValidSerial(serial)) return false;
+
+    char path[96];
+    profilePath(path, sizeof(path), serial);
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+
+    bool ok = fread(&profile, sizeof(profile), 1, f) == 1;
+    fclose(f);
+    return ok && isValidProfile(profile) && strcmp(profile.serial, serial) == 0;
+}
+
+bool FileCalibrationStore::remove(const char* serial) {
+    if (!isValidSerial(serial)) return false;
+
+    char path[96];
+    profilePath(path, sizeof(path), serial);
+    return ::remove(path) == 0;
+}
+
+bool FileCalibrationStore::setActive(const char* serial) {
+    if (!isValidSerial(serial)) return false;
+
+    char path[96];
+    snprintf(path, sizeof(path), "%s/active", _dir);
+    FILE* f = fopen(path, "w");
+    if (!f) return false;
+
+    bool ok = fputs(serial, f) >= 0;
+    return (fclose(f) == 0) && ok;
+}
+
+bool FileCalibrationStore::getActive(char* serial, uint8_t max_len) {
+    char path[96];
+    snprintf(path, sizeof(path), "%s/active", _dir);
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+
+    char buf[CalibrationProfile::SERIAL_LEN + 1];
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[n] = '\0';
+
+    if (!isValidSerial(buf) || n >= max_len) return false;
+    memcpy(serial, buf, n + 1);
+    return true;
+}
@@ -0,0 +1,21 @@
+// Clock.cpp
+// Hardware clock (forwards to the Arduino core)
+
+#include "Clock.h"
+
+Clock& Clock::hardware() {
+    static HardwareClock clock;
+    return clock;
+}
+
+uint32_t IRAM_ATTR HardwareClock::millis() {
+    return ::millis();
+}
+
+uint32_t IRAM_ATTR HardwareClock::micros() {
+    return ::micros();
+}
+
+void HardwareClock::delay(uint32_t ms) {
+    ::delay(ms);
+}
@@ -2,23 +2,30 @@
 // Implementation of data logging with multiple output formats
 
 #include "DataLogger.h"
+#include "Profiler.h"
+#include "HostLink.h"
 
 DataLogger::DataLogger()
     : _outputFormat(FORMAT_LEGACY_LABVIEW)
     , _outputEnabled(true)
+    , _outputIntervalMs(100)
     , _csvEnabled(false)
     , _packetsSent(0)
     , _bytesSent(0)
+    , _timeline(nullptr)
 {
+    memset(&_cursor, 0, sizeof(_cursor));
 }
 
 bool DataLogger::begin() {
-    Serial.println("DataLogger initialized");
-    Serial.println("Tab-separated ASCII output enabled (default)");
+    HostLog.println("DataLogger initialized");
+    HostLog.println("Tab-separated ASCII output enabled (default)");
     return true;
 }
 
 void DataLogger::sendData(Stream& stream, const CO2Data& data) {
+    PROFILE_SCOPE(PROF_HOST_OUTPUT);
+    
     if (!_outputEnabled) {
         return;
     }
@@ -33,6 +40,29 @@ void DataLogger::sendData(Stream& stream, const CO2Data& data) {
     }
 }
 
+void DataLogger::setTimeline(const SampleTimeline* timeline) {
+    _timeline = timeline;
+    if (_timeline) {
+        _cursor = _timeline->attach();
+    }
+}
+
+void DataLogger::update(Stream& stream, const CO2Data& data) {
+    if (!_timeline) {
+        if (data.valid) {
+            sendData(stream, data);
+        }
+        return;
+    }
+    
+    CO2Data frame = data;
+    while (_timeline->read(_cursor, frame)) {
+        if (frame.valid) {
+            sendData(stream, frame);
+        }
+    }
+}
+
 void DataLogger::sendPICFormat(Stream& stream, const CO2Data& data) {
     char buffer[64];
     formatPICPacket(buffer, sizeof(buffer), data);
@@ -46,20 +76,28 @@ void DataLogger::sendPICFormat(Stream& stream, const CO2Data& data) {
 
 void DataLogger::sendTabSeparated(Stream& stream, const CO2Data& data) {
     // Tab-separated ASCII format (CO2 in kPa, matching web interface)
-    // CO2_kPa<TAB>O2%<TAB>RR<TAB>Volume_mL<TAB>Status1<TAB>Status2<CR><LF>
+    // CO2_kPa<TAB>O2%<TAB>RR<TAB>Volume_mL<TAB>Status1<TAB>Status2
+    //   <TAB>VO2_mL/min<TAB>VCO2_mL/min<TAB>RQ<TAB>EE_kcal/day<TAB>Time_us<CR><LF>
+    // Metabolic columns are the rolling 1 min window (0 until available);
+    // Time_us is the reconstructed packet time (micros() timebase)
 
     // Convert CO2 from mmHg to kPa (1 mmHg = 0.133322 kPa)
     float co2_kpa = data.co2_waveform * 0.133322f;
 
-    char buffer[96];
+    char buffer[128];
     snprintf(buffer, sizeof(buffer),
-        "%.1f\t%.1f\t%d\t%d\t%d\t%d\r\n",
+        "%.1f\t%.1f\t%d\t%d\t%d\t%d\t%.0f\t%.0f\t%.2f\t%.0f\t%llu\r\n",
         co2_kpa,              // CO2 waveform in kPa
-        data.o2_percent,      // O2 percentage
+        data.sensors[SENSOR_O2].value,           // O2 percentage
         data.respiratory_rate,
-        (int)data.volume_ml,  // Volume in mL
+        (int)data.sensors[SENSOR_VOLUME].value,  // Volume in mL
         data.status1,
-        data.status2
+        data.status2,
+        data.metabolic60s.vo2_ml_min,
+        data.metabolic60s.vco2_ml_min,
+        data.metabolic60s.rq,
+        data.metabolic60s.ee_kcal_day,
+        (unsigned long long)data.timestamp_us
     );
 
     size_t written = stream.print(buffer);
@@ -71,13 +109,19 @@ void DataLogger::sendTabSeparated(Stream& stream, const CO2Data& data) {
 
 void DataLogger::setOutputEnabled(bool enabled) {
     _outputEnabled = enabled;
-    Serial.printf("Host output %s\n", enabled ? "enabled" : "disabled");
+    HostLog.printf("Host output %s\n", enabled ? "enabled" : "disabled");
+}
+
+void DataLogger::setOutputInterval(uint16_t interval_ms) {
+    if (interval_ms < 10) interval_ms = 10;
+    if (interval_ms > 1000) interval_ms = 1000;
+    _outputIntervalMs = interval_ms;
 }
 
 void DataLogger::enableCSVLogging(bool enabled) {
     _csvEnabled = enabled;
     // TODO: Implement CSV file logging
-    Serial.printf("CSV logging %s (not yet implemented)\n", 
+    HostLog.printf("CSV logging %s (not yet implemented)\n", 
                   enabled ? "enabled" : "disabled");
 }
 
@@ -109,8 +153,8 @@ void DataLogger::formatPICPacket(char* buffer, size_t bufferSize, const CO2Data&
     snprintf(buffer, bufferSize,
         "\x1B%03d\t%05d\t%05d\t%c%c%c%c%c\r\n",
         co2_scaled,
-        (int)(data.o2_percent * 10.0f),
-        data.vol_adc,
+        (int)(data.sensors[SENSOR_O2].value * 10.0f),
+        data.sensors[SENSOR_VOLUME].pic,
         data.status1,
         replaceZero(data.status2, 128),
         replaceZero(data.respiratory_rate, 255),
@@ -2,6 +2,8 @@
 // Implementation of TFT display management for LilyGO T-Display S3
 
 #include "DisplayManager.h"
+#include "Profiler.h"
+#include "HostLink.h"
 
 // Layout constants for status section
 static const uint8_t STATUS_SEPARATOR_Y = 24;
@@ -9,16 +11,21 @@ static const uint8_t SSID_Y_OFFSET = 35;
 static const uint8_t IP_Y_OFFSET = 48;
 
 DisplayManager::DisplayManager()
-    : _waveformIndex(0)
+    : _clock(&Clock::hardware())
+    , _timeline(nullptr)
+    , _waveformSeq(0)
     , _waveformMin(0)
     , _waveformMax(100)
     , _lastUpdateTime(0)
     , _refreshRate(50)
     , _waveformSpeed(2)
     , _backlightBrightness(200)
+    , _trendStore(nullptr)
+    , _page(PAGE_LIVE)
+    , _trendZoom(TREND_ZOOM_1H)
+    , _trendRevision(0)
+    , _trendDirty(true)
 {
-    memset(_waveformBuffer, 0, sizeof(_waveformBuffer));
-    
     // Initialize network info
     memset(_ssid, 0, sizeof(_ssid));
     memset(_ip, 0, sizeof(_ip));
@@ -30,17 +37,19 @@ DisplayManager::DisplayManager()
     // Initialize previous values
     _prevValues.co2_waveform = 255;
     _prevValues.fco2 = 255;
-    _prevValues.o2_percent = -1;
-    _prevValues.volume_ml = -1;
     _prevValues.status2 = 255;
     memset(_prevValues.fco2_wave_str, 0, sizeof(_prevValues.fco2_wave_str));
     memset(_prevValues.fco2_str, 0, sizeof(_prevValues.fco2_str));
-    memset(_prevValues.o2_str, 0, sizeof(_prevValues.o2_str));
-    memset(_prevValues.vol_str, 0, sizeof(_prevValues.vol_str));
+    for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+        _prevValues.sensor[ch] = NAN;
+    }
+    memset(_prevValues.sensor_str, 0, sizeof(_prevValues.sensor_str));
     
     // Initialize previous title
     memset(_prevTitle, 0, sizeof(_prevTitle));
     
+    memset(&_frameStats, 0, sizeof(_frameStats));
+    
     // Define layout zones (portrait orientation: 170x320)
     _layout.header_y = 0;
     _layout.header_h = 30;  // Header section height
@@ -56,7 +65,7 @@ DisplayManager::DisplayManager()
 }
 
 bool DisplayManager::begin() {
-    Serial.println("Initializing TFT display...");
+    HostLog.println("Initializing TFT display...");
     
     // Enable display power (GPIO 15 controls display power on T-Display S3)
     pinMode(15, OUTPUT);
@@ -72,7 +81,7 @@ bool DisplayManager::begin() {
     digitalWrite(TFT_BL, HIGH);  // Turn on immediately
     setBacklight(_backlightBrightness);
     
-    Serial.println("TFT display initialized");
+    HostLog.println("TFT display initialized");
     return true;
 }
 
@@ -118,16 +127,35 @@ void DisplayManager::setOutputFormatName(const char* name) {
 
 void DisplayManager::updateAll(const CO2Data& data) {
     // Throttle updates based on refresh rate
-    if (millis() - _lastUpdateTime < _refreshRate) {
+    const uint32_t now = _clock->millis();
+    if (now - _lastUpdateTime < _refreshRate) {
         return;
     }
-    _lastUpdateTime = millis();
+    _lastUpdateTime = now;
+    PROFILE_SCOPE(PROF_DISPLAY_UPDATE);
+    
+    uint32_t start_us = micros();
+    
+    if (_page == PAGE_TREND) {
+        updateTrendPage();
+    } else {
+        // Draw all sections (header only redraws if title changed)
+        drawHeader("Ornhagen");
+        updateWaveform(data);
+        updateNumericValues(data);
+        updateStatusIndicators(data);
+    }
     
-    // Draw all sections (header only redraws if title changed)
-    drawHeader("Ornhagen");
-    updateWaveform(data);
-    updateNumericValues(data);
-    updateStatusIndicators(data);
+    // Record draw time of this frame
+    _frameStats.frame_us = micros() - start_us;
+    if (_frameStats.frame_us > _frameStats.max_frame_us) {
+        _frameStats.max_frame_us = _frameStats.frame_us;
+    }
+    _frameStats.frames++;
+}
+
+void DisplayManager::resetFrameStats() {
+    memset(&_frameStats, 0, sizeof(_frameStats));
 }
 
 void DisplayManager::updateWaveform(const CO2Data& data) {
@@ -140,6 +168,12 @@ void DisplayManager::updateWaveform(const CO2Data& data) {
     _tft.setTextSize(1);
     _tft.drawString("CO2 Waveform", 5, _layout.wave_y + _layout.wave_h - 2);
     
+    // Rescale when new samples arrived
+    if (_timeline && _timeline->head() != _waveformSeq) {
+        _waveformSeq = _timeline->head();
+        updateWaveformScale();
+    }
+    
     // Draw waveform
     plotWaveform();
 }
@@ -150,8 +184,6 @@ void DisplayManager::updateNumericValues(const CO2Data& data) {
 
     // Create temporary char buffers for string conversion
     char fco2_wave_str[8];
-    char fco2_str[8];
-    char o2_str[8];
 
     // Convert CO2 values from mmHg to kPa (1 mmHg = 0.133322 kPa)
     // FINAL CORRECTED mapping based on actual sensor data analysis:
@@ -163,7 +195,6 @@ void DisplayManager::updateNumericValues(const CO2Data& data) {
 
     // Convert values to strings with one decimal place for CO2
     snprintf(fco2_wave_str, sizeof(fco2_wave_str), "%.1f", fco2_waveform_kpa);  // FCO2 waveform
-    snprintf(o2_str, sizeof(o2_str), "%.1f", data.o2_percent);
 
     // First row: FCO2 (8Hz waveform) - FULL WIDTH
     // FCO2 box shows real-time breathing curve (updates every 125ms at 8Hz)
@@ -175,13 +206,29 @@ void DisplayManager::updateNumericValues(const CO2Data& data) {
         strncpy(_prevValues.fco2_wave_str, fco2_wave_str, sizeof(_prevValues.fco2_wave_str));
     }
 
-    // Second row: O2 - FULL WIDTH
-    if (abs(data.o2_percent - _prevValues.o2_percent) > 0.05) {  // Update if changed by > 0.05%
-        drawMetricBox(0, y_start + 50, _width, 50,
-                      "O2", _prevValues.o2_str, (const char*)o2_str, "%",
-                      TFT_SLATEBLUE);  // Slate blue for O2
-        _prevValues.o2_percent = data.o2_percent;
-        strncpy(_prevValues.o2_str, o2_str, sizeof(_prevValues.o2_str));
+    // Second row: the SENSOR_VIEW_DISPLAY channels side by side (O2 alone
+    // fills the row)
+    static const uint16_t colors[] = { TFT_SLATEBLUE, TFT_DEEPBLUE, TFT_DARKERBLUE };
+    const uint16_t box_w = _width / (SENSOR_DISPLAY_COUNT > 0 ? SENSOR_DISPLAY_COUNT : 1);
+    uint8_t box = 0;
+    for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+        const SensorInfo& info = Sensors::info(ch);
+        if (!(info.views & SENSOR_VIEW_DISPLAY)) continue;
+
+        // Redraw when the value moved by half a displayed digit
+        float step = 0.5f;
+        for (uint8_t d = 0; d < info.decimals; d++) step *= 0.1f;
+        const float value = data.sensors[ch].value;
+        if (isnan(_prevValues.sensor[ch]) || fabsf(value - _prevValues.sensor[ch]) > step) {
+            char str[8];
+            snprintf(str, sizeof(str), "%.*f", info.decimals, value);
+            drawMetricBox(box * box_w, y_start + 50, box_w, 50,
+                          info.label, _prevValues.sensor_str[ch], (const char*)str,
+                          info.unit, colors[box % 3]);
+            _prevValues.sensor[ch] = value;
+            strncpy(_prevValues.sensor_str[ch], str, sizeof(_prevValues.sensor_str[ch]));
+        }
+        box++;
     }
 }
 
@@ -241,13 +288,31 @@ void DisplayManager::updateStatusIndicators(const CO2Data& data) {
     }
 }
 
-void DisplayManager::addWaveformPoint(uint16_t co2_value) {
-    // Add point to circular buffer
-    _waveformBuffer[_waveformIndex] = co2_value;
-    _waveformIndex = (_waveformIndex + 1) % WAVEFORM_BUFFER_SIZE;
-    
-    // Update scale
-    updateWaveformScale();
+void DisplayManager::setPage(DisplayPage page) {
+    if (page == _page) {
+        return;
+    }
+    _page = page;
+    
+    if (_page == PAGE_TREND) {
+        _tft.fillScreen(TFT_LOGOBACKGROUND);
+        memset(_prevTitle, 0, sizeof(_prevTitle));
+        _trendDirty = true;
+    } else {
+        resetLivePage();
+    }
+}
+
+void DisplayManager::setTrendZoom(TrendZoom zoom) {
+    if (zoom >= TREND_ZOOM_COUNT) {
+        zoom = TREND_ZOOM_1H;
+    }
+    _trendZoom = zoom;
+    _trendDirty = true;
+}
+
+void DisplayManager::cycleTrendZoom() {
+    setTrendZoom((TrendZoom)((_trendZoom + 1) % TREND_ZOOM_COUNT));
 }
 
 void DisplayManager::setBacklight(uint8_t brightness) {
@@ -310,23 +375,26 @@ void DisplayManager::plotWaveform() {
     _tft.drawFastHLine(wave_x, wave_y + wave_h / 2, wave_w, TFT_MIDNIGHTBLUE);
     _tft.drawFastHLine(wave_x, wave_y + wave_h * 3 / 4, wave_w, TFT_MIDNIGHTBLUE);
     
+    if (!_timeline) return;
+    
     // Calculate scaling
     uint16_t range = (_waveformMax - _waveformMin);
     if (range == 0) range = 1;
     
-    // Draw simple line graph
-    for (int i = 1; i < WAVEFORM_BUFFER_SIZE; i++) {
-        int idx = (_waveformIndex + i) % WAVEFORM_BUFFER_SIZE;
-        int prev_idx = (_waveformIndex + i - 1) % WAVEFORM_BUFFER_SIZE;
+    // Draw simple line graph, newest sample at the right edge
+    const uint32_t first = _timeline->head() - WAVEFORM_POINTS;
+    for (int i = 1; i < WAVEFORM_POINTS; i++) {
+        const uint32_t seq = first + i;
+        if (!_timeline->contains(seq - 1)) continue;  // Not yet recorded
         
         // Scale to screen coordinates
-        uint16_t x1 = wave_x + ((i - 1) * wave_w / WAVEFORM_BUFFER_SIZE);
-        uint16_t x2 = wave_x + (i * wave_w / WAVEFORM_BUFFER_SIZE);
+        uint16_t x1 = wave_x + ((i - 1) * wave_w / WAVEFORM_POINTS);
+        uint16_t x2 = wave_x + (i * wave_w / WAVEFORM_POINTS);
         
         uint16_t y1 = wave_y + wave_h - 
-                     ((_waveformBuffer[prev_idx] - _waveformMin) * wave_h / range);
+                     ((_timeline->co2At(seq - 1) - _waveformMin) * wave_h / range);
         uint16_t y2 = wave_y + wave_h - 
-                     ((_waveformBuffer[idx] - _waveformMin) * wave_h / range);
+                     ((_timeline->co2At(seq) - _waveformMin) * wave_h / range);
         
         // Clamp to bounds
         y1 = constrain(y1, wave_y, wave_y + wave_h);
@@ -337,15 +405,142 @@ void DisplayManager::plotWaveform() {
     }
 }
 
+void DisplayManager::updateTrendPage() {
+    char title[32];
+    snprintf(title, sizeof(title), "Trend %s", TrendStore::getZoomName(_trendZoom));
+    drawHeader(title);
+    
+    if (!_trendStore) {
+        return;
+    }
+    
+    // Redraw only on zoom change or when a bucket of the viewed tier closes.
+    // Everything is read from precomputed rollups, so a full redraw fits in one frame.
+    uint32_t revision = _trendStore->getRevision(TrendStore::getZoomTier(_trendZoom));
+    if (!_trendDirty && revision == _trendRevision) {
+        return;
+    }
+    _trendRevision = revision;
+    _trendDirty = false;
+    
+    // Stacked panels below the header (30..320): EtCO2, RR, then every
+    // trended sensor (three panels with O2 alone)
+    const uint16_t panel_h = (SCREEN_HEIGHT - _layout.header_h) / TREND_CHANNEL_COUNT;
+    const uint16_t y0 = _layout.header_h;
+    
+    // EtCO2 stored as mmHg x 10 -> kPa, RR as bpm x 10, sensors as unit x 10
+    drawTrendPanel(y0, panel_h, TREND_ETCO2, "EtCO2", "kPa", 0.0133322f, 75, TFT_DARKERBLUE);
+    drawTrendPanel(y0 + panel_h, panel_h, TREND_RR, "RR", "bpm", 0.1f, 100, TFT_DEEPBLUE);
+    for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+        const TrendChannel channel = TrendStore::sensorChannel(ch);
+        if (channel == TREND_CHANNEL_COUNT) continue;
+        const SensorInfo& info = Sensors::info(ch);
+        drawTrendPanel(y0 + panel_h * channel, panel_h, channel, info.label, info.unit,
+                       0.1f, info.trend_min_span, TFT_SLATEBLUE);
+    }
+}
+
+void DisplayManager::drawTrendPanel(uint16_t y, uint16_t h, TrendChannel channel,
+                                    const char* label, const char* unit, float scale,
+                                    uint16_t min_span, uint16_t color) {
+    const uint16_t plot_x = 5;
+    const uint16_t plot_y = y + 14;
+    const uint16_t plot_h = h - 18;
+    
+    _tft.fillRect(0, y, SCREEN_WIDTH, h, TFT_LOGOBACKGROUND);
+    _tft.drawRect(plot_x - 1, plot_y - 1, TREND_PLOT_WIDTH + 2, plot_h + 2, TFT_MIDNIGHTBLUE);
+    
+    uint16_t filled = _trendStore->renderColumns(_trendZoom, channel,
+                                                 _trendColumns, TREND_PLOT_WIDTH);
+    
+    // Find vertical range and latest value over the rendered columns
+    uint16_t lo = 0xFFFF;
+    uint16_t hi = 0;
+    uint16_t latest = TREND_NO_DATA;
+    for (uint16_t i = 0; i < TREND_PLOT_WIDTH; i++) {
+        if (_trendColumns[i].mean == TREND_NO_DATA) continue;
+        if (_trendColumns[i].min < lo) lo = _trendColumns[i].min;
+        if (_trendColumns[i].max > hi) hi = _trendColumns[i].max;
+        latest = _trendColumns[i].mean;
+    }
+    
+    // Label with latest value
+    char text[32];
+    if (latest != TREND_NO_DATA) {
+        snprintf(text, sizeof(text), "%s %.1f %s", label, latest * scale, unit);
+    } else {
+        snprintf(text, sizeof(text), "%s -- %s", label, unit);
+    }
+    _tft.setTextColor(TFT_DEEPBLUE, TFT_LOGOBACKGROUND);
+    _tft.setTextDatum(TL_DATUM);
+    _tft.setTextSize(1);
+    _tft.drawString(text, plot_x, y + 3);
+    
+    if (filled == 0) {
+        return;
+    }
+    
+    // Ensure minimum range so flat trends don't fill the panel with noise
+    if (hi - lo < min_span) {
+        uint16_t pad = (min_span - (hi - lo)) / 2;
+        lo = (lo > pad) ? lo - pad : 0;
+        hi = lo + min_span;
+    }
+    uint32_t range = hi - lo;
+    
+    // Range annotation (right-aligned)
+    snprintf(text, sizeof(text), "%.1f-%.1f", lo * scale, hi * scale);
+    _tft.setTextColor(TFT_SLATEBLUE, TFT_LOGOBACKGROUND);
+    _tft.setTextDatum(TR_DATUM);
+    _tft.drawString(text, plot_x + TREND_PLOT_WIDTH, y + 3);
+    
+    // Mid grid line
+    _tft.drawFastHLine(plot_x, plot_y + plot_h / 2, TREND_PLOT_WIDTH, TFT_MIDNIGHTBLUE);
+    
+    // Min/max envelope as vertical bars, mean as a dot on top
+    for (uint16_t i = 0; i < TREND_PLOT_WIDTH; i++) {
+        const TrendColumn& c = _trendColumns[i];
+        if (c.mean == TREND_NO_DATA) continue;
+        
+        uint16_t y_max = plot_y + plot_h - 1 - (uint32_t)(c.max - lo) * (plot_h - 1) / range;
+        uint16_t y_min = plot_y + plot_h - 1 - (uint32_t)(c.min - lo) * (plot_h - 1) / range;
+        uint16_t y_mean = plot_y + plot_h - 1 - (uint32_t)(c.mean - lo) * (plot_h - 1) / range;
+        
+        _tft.drawFastVLine(plot_x + i, y_max, y_min - y_max + 1, TFT_LOGOBLUE);
+        _tft.drawPixel(plot_x + i, y_mean, color);
+    }
+}
+
+void DisplayManager::resetLivePage() {
+    // Full repaint of the live page after returning from another page
+    _tft.fillScreen(TFT_LOGOBACKGROUND);
+    memset(_prevTitle, 0, sizeof(_prevTitle));
+    memset(_prevFormatName, 0, sizeof(_prevFormatName));
+    
+    _prevValues.co2_waveform = 255;
+    _prevValues.fco2 = 255;
+    _prevValues.status2 = 255;
+    memset(_prevValues.fco2_wave_str, 0, sizeof(_prevValues.fco2_wave_str));
+    memset(_prevValues.fco2_str, 0, sizeof(_prevValues.fco2_str));
+    for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+        _prevValues.sensor[ch] = NAN;
+    }
+    memset(_prevValues.sensor_str, 0, sizeof(_prevValues.sensor_str));
+}
+
 void DisplayManager::updateWaveformScale() {
-    // Find min and max in buffer
+    // Find min and max over the plotted samples
     uint16_t min_val = 0xFFFF;
     uint16_t max_val = 0;
     
-    for (int i = 0; i < WAVEFORM_BUFFER_SIZE; i++) {
-        if (_waveformBuffer[i] < min_val) min_val = _waveformBuffer[i];
-        if (_waveformBuffer[i] > max_val) max_val = _waveformBuffer[i];
+    const uint32_t head = _timeline->head();
+    for (uint32_t seq = head - WAVEFORM_POINTS; seq != head; seq++) {
+        if (!_timeline->contains(seq)) continue;
+        uint16_t v = _timeline->co2At(seq);
+        if (v < min_val) min_val = v;
+        if (v > max_val) max_val = v;
     }
+    if (min_val > max_val) min_val = max_val = 0;  // No samples yet
     
     // Add some margin
     _waveformMin = (min_val > 5) ? min_val - 5 : 0;
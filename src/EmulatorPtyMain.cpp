@@ -0,0 +1,95 @@
+// EmulatorPtyMain.cpp
+// Command-line MaCO2 sensor on a pseudo-terminal ([env:emulator_pty] only)
+//
+//   program [--bpm 12] [--etco2 38] [--fico2 0] [--noise 0.3] [--drift 0]
+//           [--drop 0] [--corrupt 0] [--rate 1] [--seed 1] [--no-handshake]
+//           [--pump-off]
+//
+// Prints the slave device path, then serves it until Ctrl-C; a statistics
+// line follows every 10 s.
+
+#ifdef MACO2_PTY_MAIN
+
+#include <Arduino.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "MaCO2Pty.h"
+
+static volatile sig_atomic_t running = 1;
+
+static void onSignal(int) {
+    running = 0;
+}
+
+static bool parseArgs(int argc, char** argv, EmulatorConfig& config) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--no-handshake") == 0) {
+            config.handshake = false;
+            continue;
+        }
+        if (strcmp(arg, "--pump-off") == 0) {
+            config.pump_running = false;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            return false;
+        }
+        const float v = strtof(argv[++i], nullptr);
+        if (strcmp(arg, "--bpm") == 0)          config.breath_rate_bpm = v;
+        else if (strcmp(arg, "--etco2") == 0)   config.etco2_mmhg = v;
+        else if (strcmp(arg, "--fico2") == 0)   config.fico2_mmhg = v;
+        else if (strcmp(arg, "--noise") == 0)   config.noise_mmhg = v;
+        else if (strcmp(arg, "--drift") == 0)   config.drift_mmhg_per_min = v;
+        else if (strcmp(arg, "--drop") == 0)    config.drop_byte_prob = v;
+        else if (strcmp(arg, "--corrupt") == 0) config.corrupt_prob = v;
+        else if (strcmp(arg, "--rate") == 0)    config.rate_multiplier = v;
+        else if (strcmp(arg, "--seed") == 0)    config.seed = (uint32_t)v;
+        else return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    EmulatorConfig config = MaCO2Emulator::defaultConfig();
+    if (!parseArgs(argc, argv, config)) {
+        fprintf(stderr, "usage: %s [--bpm n] [--etco2 mmHg] [--fico2 mmHg] [--noise mmHg] [--drift mmHg/min]\n"
+                        "          [--drop p] [--corrupt p] [--rate x] [--seed n] [--no-handshake] [--pump-off]\n",
+                argv[0]);
+        return 2;
+    }
+
+    MaCO2Emulator emulator;
+    MaCO2Pty pty(emulator);
+    if (!pty.open()) {
+        perror("pty");
+        return 1;
+    }
+    emulator.begin(config);
+    printf("MaCO2 emulator on %s (%.0f Hz, %.0f breaths/min, EtCO2 %.0f mmHg)\n",
+           pty.slavePath(), 8.0f * config.rate_multiplier, config.breath_rate_bpm, config.etco2_mmhg);
+    fflush(stdout);
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    uint32_t lastReport = millis();
+    while (running) {
+        pty.pump();
+        usleep(1000);
+        if (millis() - lastReport >= 10000) {
+            lastReport = millis();
+            const EmulatorStats& s = emulator.getStats();
+            printf("%lu packets, %lu bytes out (%lu dropped, %lu lost to overflow), %lu corrupt, %lu command bytes\n",
+                   (unsigned long)s.packets, (unsigned long)pty.getBytesOut(),
+                   (unsigned long)s.droppedBytes, (unsigned long)s.overflowBytes,
+                   (unsigned long)s.corruptPackets, (unsigned long)s.commands);
+            fflush(stdout);
+        }
+    }
+    pty.close();
+    return 0;
+}
+
+#endif // MACO2_PTY_MAIN
@@ -0,0 +1,346 @@
+// HostClient.cpp
+// Implementation of the host command protocol client (host builds only)
+
+#ifndef ESP_PLATFORM
+
+#include "HostClient.h"
+
+// Little-endian fields
+static size_t put16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    return 2;
+}
+
+static size_t put32(uint8_t* p, uint32_t v) {
+    for (uint8_t i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+    return 4;
+}
+
+static uint16_t get16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static float getFloat(const uint8_t* p) {
+    const uint32_t bits = get32(p);
+    float v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+HostClient::HostClient(Stream& port)
+    : _port(port)
+    , _clock(&Clock::hardware())
+    , _dataOut(nullptr)
+    , _logOut(nullptr)
+    , _seq(0)
+    , _responseLen(0)
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+// ============================================================================
+// Requests
+// ============================================================================
+
+uint8_t HostClient::ping(HostDeviceInfo& info) {
+    uint8_t body[HostFrame::MAX_PAYLOAD];
+    size_t n = sizeof(body);
+    const uint8_t status = request(HOST_OP_PING, nullptr, 0, body, n);
+    memset(&info, 0, sizeof(info));
+    if (status != HOST_OK || n < 3) {
+        return (status == HOST_OK) ? (uint8_t)HOST_ERR_BAD_ARGS : status;
+    }
+    info.version = body[0];
+    info.maxPayload = body[1];
+    info.chunkBytes = body[2];
+    const size_t textLen = (n - 3 < sizeof(info.build)) ? n - 3 : sizeof(info.build) - 1;
+    memcpy(info.build, body + 3, textLen);
+    return HOST_OK;
+}
+
+uint8_t HostClient::getStatus(HostDeviceStatus& s) {
+    uint8_t body[HostFrame::MAX_PAYLOAD];
+    size_t n = sizeof(body);
+    const uint8_t status = request(HOST_OP_STATUS, nullptr, 0, body, n);
+    memset(&s, 0, sizeof(s));
+    if (status != HOST_OK) {
+        return status;
+    }
+    if (n < 42 || n < 42 + 4 * (size_t)body[41]) {
+        return HOST_ERR_BAD_ARGS;                   // Not a STATUS body
+    }
+    s.uptimeMs = get32(body);
+    s.packets = get32(body + 4);
+    s.packetErrors = get32(body + 8);
+    s.records = get32(body + 12);
+    s.timelineHead = get32(body + 16);
+    s.logDropped = get32(body + 20);
+    s.adcSamples = get32(body + 24);
+    s.adcOverruns = get32(body + 28);
+    s.co2Waveform = get16(body + 32);
+    s.fetco2 = body[34];
+    s.respiratoryRate = body[35];
+    s.status2 = body[36];
+    s.outputFormat = body[37];
+    s.outputEnabled = body[38] != 0;
+    s.linkMode = body[39];
+    s.dumping = body[40] != 0;
+    s.sensorCount = body[41];
+    for (uint8_t ch = 0; ch < s.sensorCount && ch < SENSOR_COUNT; ch++) {
+        s.sensors[ch] = getFloat(body + 42 + 4 * ch);
+    }
+    return HOST_OK;
+}
+
+uint8_t HostClient::getConfig(uint8_t key, uint8_t* value, size_t& len) {
+    uint8_t body[HostFrame::MAX_PAYLOAD];
+    size_t n = sizeof(body);
+    const uint8_t status = request(HOST_OP_GET_CONFIG, &key, 1, body, n);
+    if (status != HOST_OK || n < 1 || body[0] != key) {
+        len = 0;
+        return (status == HOST_OK) ? (uint8_t)HOST_ERR_BAD_ARGS : status;
+    }
+    if (n - 1 < len) len = n - 1;
+    memcpy(value, body + 1, len);
+    return HOST_OK;
+}
+
+uint8_t HostClient::setConfig(uint8_t key, const uint8_t* value, size_t len,
+                              uint8_t* applied, size_t* appliedLen) {
+    uint8_t args[HostFrame::MAX_PAYLOAD];
+    if (1 + len > sizeof(args) - 3) {
+        return HOST_ERR_BAD_ARGS;
+    }
+    args[0] = key;
+    memcpy(args + 1, value, len);
+    uint8_t body[HostFrame::MAX_PAYLOAD];
+    size_t n = sizeof(body);
+    const uint8_t status = request(HOST_OP_SET_CONFIG, args, 1 + len, body, n);
+    if (appliedLen != nullptr) {
+        size_t copy = (status == HOST_OK && n > 1) ? n - 1 : 0;
+        if (copy > *appliedLen) copy = *appliedLen;
+        memcpy(applied, body + 1, copy);
+        *appliedLen = copy;
+    }
+    return status;
+}
+
+uint8_t HostClient::setConfig16(uint8_t key, uint16_t value) {
+    uint8_t v[2];
+    put16(v, value);
+    return setConfig(key, v, sizeof(v));
+}
+
+uint8_t HostClient::sensorCommand(uint8_t command) {
+    uint8_t body[HostFrame::MAX_PAYLOAD];
+    size_t n = sizeof(body);
+    return request(HOST_OP_SENSOR_COMMAND, &command, 1, body, n);
+}
+
+uint8_t HostClient::request(uint8_t op, const uint8_t* args, size_t len,
+                            uint8_t* body, size_t& bodyLen) {
+    uint8_t req[HostFrame::MAX_PAYLOAD];
+    if (3 + len > sizeof(req)) {
+        bodyLen = 0;
+        return HOST_ERR_BAD_ARGS;
+    }
+    const uint16_t seq = ++_seq;
+    size_t n = put16(req, seq);
+    req[n++] = op;
+    if (len > 0) {
+        memcpy(req + n, args, len);
+        n += len;
+    }
+    _stats.requests++;
+
+    // A retry keeps the sequence number: the device resends its cached answer
+    for (uint8_t attempt = 0; attempt < TRIES; attempt++) {
+        if (attempt > 0) _stats.retries++;
+        send(req, n);
+        if (waitResponse(seq, op, RESPONSE_TIMEOUT_MS)) {
+            const uint8_t status = _response[3];
+            size_t copy = _responseLen - 4;
+            if (copy > bodyLen) copy = bodyLen;
+            memcpy(body, _response + 4, copy);
+            bodyLen = copy;
+            _responseLen = 0;
+            return status;
+        }
+    }
+    bodyLen = 0;
+    return NO_RESPONSE;
+}
+
+// ============================================================================
+// Dumps
+// ============================================================================
+
+uint8_t HostClient::dump(uint8_t source, Print& out, uint8_t window, uint32_t firstChunk,
+                         uint32_t* size) {
+    if (window == 0) window = 1;
+    uint8_t args[6];
+    args[0] = source;
+    args[1] = window;
+    put32(args + 2, firstChunk);
+    uint8_t body[HostFrame::MAX_PAYLOAD];
+    size_t n = sizeof(body);
+    const uint8_t status = request(HOST_OP_DUMP_START, args, sizeof(args), body, n);
+    if (status != HOST_OK) {
+        return status;
+    }
+    if (n < 11) {
+        return HOST_ERR_BAD_ARGS;
+    }
+    if (size != nullptr) *size = get32(body);
+    const uint16_t seq = _seq;
+    const uint8_t dataOp = HOST_OP_DUMP_DATA | HOST_OP_RESPONSE;
+
+    // Acknowledge every half window, so the device never waits for credit
+    const uint8_t ackEvery = (window > 1) ? (uint8_t)(window / 2) : 1;
+    uint32_t next = firstChunk;         // First chunk not received
+    uint32_t acked = firstChunk;        // Last acknowledgement sent
+    bool resending = false;             // Went back for a missing chunk
+    uint32_t lastMs = _clock->millis();
+    uint8_t idle = 0;
+
+    for (;;) {
+        if (!receive()) {
+            if (_clock->millis() - lastMs > DUMP_TIMEOUT_MS) {
+                if (++idle > TRIES) {
+                    uint8_t none[1];
+                    size_t noneLen = sizeof(none);
+                    request(HOST_OP_DUMP_CANCEL, nullptr, 0, none, noneLen);
+                    return NO_RESPONSE;
+                }
+                // Chunks or the last acknowledgement were lost
+                sendAck(next, window);
+                acked = next;
+                lastMs = _clock->millis();
+            }
+            _clock->delay(1);
+            continue;
+        }
+
+        const uint8_t* f = _response;
+        const size_t len = _responseLen;
+        _responseLen = 0;
+        if (len < 8 || get16(f) != seq || f[2] != dataOp) {
+            continue;                   // Stale response
+        }
+        lastMs = _clock->millis();
+        idle = 0;
+        const uint8_t chunkStatus = f[3];
+        const uint32_t chunk = get32(f + 4);
+
+        if (chunkStatus == HOST_DUMP_END) {
+            if (chunk == next) {
+                sendAck(next, window);  // Ends the dump on the device
+                return HOST_OK;
+            }
+            // Chunks before the end went missing
+            if (!resending) {
+                _stats.dumpResends++;
+                sendAck(next, window);
+                acked = next;
+                resending = true;
+            }
+            continue;
+        }
+        if (chunkStatus != HOST_OK) {
+            return chunkStatus;         // Overrun, timeout, read error
+        }
+
+        if (chunk == next) {
+            out.write(f + 8, len - 8);
+            next++;
+            resending = false;
+            if (next - acked >= ackEvery) {
+                sendAck(next, window);
+                acked = next;
+            }
+        } else if (chunk > next && !resending) {
+            // Go back to the first missing chunk, once per gap
+            _stats.dumpResends++;
+            sendAck(next, window);
+            acked = next;
+            resending = true;
+        }
+    }
+}
+
+void HostClient::sendAck(uint32_t next, uint8_t window) {
+    uint8_t req[3 + 5];
+    size_t n = put16(req, ++_seq);
+    req[n++] = HOST_OP_DUMP_ACK;
+    n += put32(req + n, next);
+    req[n++] = window;
+    send(req, n);
+}
+
+// ============================================================================
+// Link
+// ============================================================================
+
+void HostClient::poll() {
+    while (receive()) {
+        _responseLen = 0;               // Nobody waits for it
+    }
+}
+
+bool HostClient::receive() {
+    while (_responseLen == 0 && _port.available() > 0) {
+        if (!_rx.push((uint8_t)_port.read())) {
+            continue;
+        }
+        switch (_rx.channel()) {
+            case HOST_CH_DATA:
+                _stats.dataFrames++;
+                if (_dataOut != nullptr) _dataOut->write(_rx.payload(), _rx.length());
+                break;
+            case HOST_CH_LOG:
+                _stats.logFrames++;
+                if (_logOut != nullptr) _logOut->write(_rx.payload(), _rx.length());
+                break;
+            case HOST_CH_CMD:
+                memcpy(_response, _rx.payload(), _rx.length());
+                _responseLen = _rx.length();
+                break;
+        }
+    }
+    _stats.frameErrors = _rx.getErrorCount();
+    return _responseLen > 0;
+}
+
+bool HostClient::waitResponse(uint16_t seq, uint8_t op, uint32_t timeoutMs) {
+    const uint32_t start = _clock->millis();
+    for (;;) {
+        while (receive()) {
+            if (_responseLen >= 4 && get16(_response) == seq &&
+                _response[2] == (op | HOST_OP_RESPONSE)) {
+                return true;
+            }
+            _responseLen = 0;           // Stale response or dump chunk
+        }
+        if (_clock->millis() - start > timeoutMs) {
+            return false;
+        }
+        _clock->delay(1);
+    }
+}
+
+void HostClient::send(const uint8_t* payload, size_t len) {
+    // Two delimiters: the first ends a partial frame the device may still
+    // hold from a broken attempt, the second starts this one
+    uint8_t frame[2 + HostFrame::MAX_ENCODED];
+    frame[0] = 0x00;
+    frame[1] = 0x00;
+    const size_t n = HostFrame::encode(HOST_CH_CMD, payload, len, frame + 2);
+    _port.write(frame, 2 + n);
+}
+
+#endif // ESP_PLATFORM
@@ -0,0 +1,583 @@
+// HostCommands.cpp
+// Request handling and chunked dumps of the host command protocol
+
+#include "HostCommands.h"
+#include <LittleFS.h>
+
+// Little-endian fields
+static size_t put16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    return 2;
+}
+
+static size_t put32(uint8_t* p, uint32_t v) {
+    for (uint8_t i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+    return 4;
+}
+
+static size_t putFloat(uint8_t* p, float v) {
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return put32(p, bits);
+}
+
+static uint16_t get16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static float getFloat(const uint8_t* p) {
+    const uint32_t bits = get32(p);
+    float v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+// Timeline dump record: seq, timestamp ms, timestamp us (u64), CO2 waveform,
+// FCO2, FetCO2, RR, status1, status2, valid, then one float per sensor channel
+static const uint16_t TIMELINE_RECORD = 24 + 4 * SENSOR_COUNT;
+// Trend dump record: min[n], mean[n], max[n] (u16, tenths of unit, TrendChannel order)
+static const uint16_t TREND_RECORD = 6 * TREND_CHANNEL_COUNT;
+
+HostCommands::HostCommands(HostLink& link)
+    : _link(link)
+    , _clock(&Clock::hardware())
+    , _parser(nullptr)
+    , _adc(nullptr)
+    , _logger(nullptr)
+    , _timeline(nullptr)
+    , _trend(nullptr)
+    , _capturePath(nullptr)
+    , _recorder(nullptr)
+    , _calStore(nullptr)
+    , _pendingCommand(0)
+    , _lastLen(0)
+{
+    memset(&_dump, 0, sizeof(_dump));
+}
+
+void HostCommands::setCapture(const char* path, const UartRecorder* recorder) {
+    _capturePath = path;
+    _recorder = recorder;
+}
+
+uint8_t HostCommands::getCommand() {
+    const uint8_t cmd = _pendingCommand;
+    _pendingCommand = 0;
+    return cmd;
+}
+
+void HostCommands::update(const CO2Data& current) {
+    uint8_t req[HostFrame::MAX_PAYLOAD];
+    const size_t len = _link.readRequest(req, sizeof(req));
+    if (len > 0) {
+        handleRequest(req, len, current);
+    }
+    if (_dump.active) {
+        pumpDump();
+    }
+}
+
+// ============================================================================
+// Requests
+// ============================================================================
+
+void HostCommands::handleRequest(const uint8_t* req, size_t len, const CO2Data& current) {
+    if (len < 3) {
+        return;                         // No sequence number to answer to
+    }
+    const uint16_t seq = get16(req);
+    const uint8_t op = req[2];
+    const uint8_t* args = req + 3;
+    const size_t argLen = len - 3;
+
+    // Whoever sends frames reads frames
+    if (_link.getMode() != LINK_FRAMED) {
+        _link.setMode(LINK_FRAMED);
+    }
+
+    if (op == HOST_OP_DUMP_ACK) {
+        if (_dump.active && argLen >= 5) {
+            const uint32_t next = get32(args);
+            if (next <= _dump.next) {
+                // Anything the host is missing is sent again (go-back-N)
+                _dump.acked = next;
+                if (next < _dump.next) {
+                    _dump.next = next;
+                    _dump.endSent = false;
+                }
+                _dump.window = (args[4] == 0) ? 1 : (args[4] > MAX_WINDOW ? MAX_WINDOW : args[4]);
+                _dump.lastAckMs = _clock->millis();
+                if (_dump.acked >= _dump.chunks && _dump.endSent) {
+                    _dump.active = false;
+                    if (_file) _file.close();
+                }
+            }
+        }
+        return;
+    }
+
+    // A retransmitted request gets the same answer, without running twice
+    if (_lastLen >= 3 && get16(_last) == seq && _last[2] == (op | HOST_OP_RESPONSE)) {
+        _link.sendFrame(HOST_CH_CMD, _last, _lastLen);
+        return;
+    }
+
+    uint8_t body[HostFrame::MAX_PAYLOAD - 4];
+    size_t n = 0;
+    uint8_t status = HOST_OK;
+    bool switchToRaw = false;
+
+    switch (op) {
+        case HOST_OP_PING: {
+            body[n++] = HOST_PROTOCOL_VERSION;
+            body[n++] = (uint8_t)HostFrame::MAX_PAYLOAD;
+            body[n++] = CHUNK_BYTES;
+            const char* build = __DATE__ " " __TIME__;
+            const size_t buildLen = strlen(build);
+            memcpy(body + n, build, buildLen);
+            n += buildLen;
+            break;
+        }
+
+        case HOST_OP_STATUS: {
+            const HostLinkStats& link = _link.getStats();
+            n += put32(body + n, _clock->millis());
+            n += put32(body + n, _parser ? _parser->getPacketCount() : 0);
+            n += put32(body + n, _parser ? _parser->getErrorCount() : 0);
+            n += put32(body + n, _logger ? _logger->getPacketsSent() : 0);
+            n += put32(body + n, _timeline ? _timeline->head() : 0);
+            n += put32(body + n, link.logDropped);
+            n += put32(body + n, _adc ? _adc->getSampleCount() : 0);
+            n += put32(body + n, _adc ? _adc->getOverrunCount() : 0);
+            n += put16(body + n, current.co2_waveform);
+            body[n++] = current.fetco2;
+            body[n++] = current.respiratory_rate;
+            body[n++] = current.status2;
+            body[n++] = _logger ? (uint8_t)_logger->getOutputFormat() : 0;
+            body[n++] = (_logger && _logger->isOutputEnabled()) ? 1 : 0;
+            body[n++] = (uint8_t)_link.getMode();
+            body[n++] = _dump.active ? 1 : 0;
+            body[n++] = SENSOR_COUNT;
+            for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+                n += putFloat(body + n, current.sensors[ch].value);
+            }
+            break;
+        }
+
+        case HOST_OP_GET_CONFIG:
+        case HOST_OP_SET_CONFIG:
+            n = handleConfig(op, args, argLen, body, status);
+            switchToRaw = (op == HOST_OP_SET_CONFIG && status == HOST_OK &&
+                           args[0] == HOST_CFG_LINK_MODE && args[1] == LINK_RAW);
+            break;
+
+        case HOST_OP_SENSOR_COMMAND:
+            if (argLen < 1 || (args[0] != CMD_START_PUMP && args[0] != CMD_ZERO_CAL)) {
+                status = HOST_ERR_BAD_ARGS;
+            } else if (_pendingCommand != 0) {
+                status = HOST_ERR_BUSY;
+            } else {
+                _pendingCommand = args[0];
+            }
+            break;
+
+        case HOST_OP_DUMP_START:
+            n = startDump(args, argLen, body, status);
+            if (status == HOST_OK) {
+                _dump.seq = seq;
+            }
+            break;
+
+        case HOST_OP_DUMP_CANCEL:
+            if (_dump.active) {
+                _dump.active = false;
+                if (_file) _file.close();
+            }
+            break;
+
+        default:
+            status = HOST_ERR_UNKNOWN_OP;
+            break;
+    }
+
+    sendResponse(seq, op, status, body, n);
+    if (switchToRaw) {
+        _link.setMode(LINK_RAW);
+    }
+}
+
+size_t HostCommands::handleConfig(uint8_t op, const uint8_t* args, size_t len,
+                                  uint8_t* body, uint8_t& status) {
+    if (len < 1) {
+        status = HOST_ERR_BAD_ARGS;
+        return 0;
+    }
+    const uint8_t key = args[0];
+    const bool set = (op == HOST_OP_SET_CONFIG);
+    const uint8_t* value = args + 1;
+    const size_t valueLen = len - 1;
+
+    // Setters need the value size of the key
+    size_t need = 0;
+    switch (key) {
+        case HOST_CFG_OUTPUT_FORMAT:
+        case HOST_CFG_OUTPUT_ENABLED:
+        case HOST_CFG_LINK_MODE:
+            need = 1;
+            break;
+        case HOST_CFG_OUTPUT_INTERVAL:
+        case HOST_CFG_ADC_RATE:
+        case HOST_CFG_ADC_OVERSAMPLING:
+            need = 2;
+            break;
+        case HOST_CFG_CALIBRATION:
+            need = 17;
+            break;
+        case HOST_CFG_PROFILE_SAVE:
+        case HOST_CFG_PROFILE:
+            need = 1;
+            break;
+        default:
+            status = HOST_ERR_BAD_ARGS;
+            return 0;
+    }
+    if (set && valueLen < need) {
+        status = HOST_ERR_BAD_ARGS;
+        return 0;
+    }
+    const bool needsLogger = (key == HOST_CFG_OUTPUT_FORMAT || key == HOST_CFG_OUTPUT_ENABLED ||
+                              key == HOST_CFG_OUTPUT_INTERVAL);
+    const bool needsStore = (key == HOST_CFG_PROFILE_SAVE || key == HOST_CFG_PROFILE);
+    const bool needsADC = (key == HOST_CFG_ADC_RATE || key == HOST_CFG_ADC_OVERSAMPLING ||
+                           key == HOST_CFG_CALIBRATION || needsStore);
+    if ((needsLogger && !_logger) || (needsADC && !_adc) || (needsStore && !_calStore)) {
+        status = HOST_ERR_UNAVAILABLE;
+        return 0;
+    }
+
+    size_t n = 0;
+    body[n++] = key;
+    switch (key) {
+        case HOST_CFG_OUTPUT_FORMAT:
+            if (set) {
+                if (value[0] > FORMAT_TAB_SEPARATED) {
+                    status = HOST_ERR_BAD_ARGS;
+                    return 0;
+                }
+                _logger->setOutputFormat((OutputFormat)value[0]);
+            }
+            body[n++] = (uint8_t)_logger->getOutputFormat();
+            break;
+
+        case HOST_CFG_OUTPUT_ENABLED:
+            if (set) _logger->setOutputEnabled(value[0] != 0);
+            body[n++] = _logger->isOutputEnabled() ? 1 : 0;
+            break;
+
+        case HOST_CFG_OUTPUT_INTERVAL:
+            if (set) _logger->setOutputInterval(get16(value));
+            n += put16(body + n, _logger->getOutputInterval());
+            break;
+
+        case HOST_CFG_ADC_RATE:
+            if (set) {
+                _adc->stopAcquisition();
+                _adc->startAcquisition(get16(value));
+            }
+            n += put16(body + n, _adc->getSampleRate());
+            break;
+
+        case HOST_CFG_ADC_OVERSAMPLING:
+            if (set) {
+                // The acquisition task reads the factor during each conversion
+                const bool acquiring = _adc->isAcquiring();
+                if (acquiring) _adc->stopAcquisition();
+                _adc->setOversampling(get16(value));
+                if (acquiring) _adc->startAcquisition(_adc->getSampleRate());
+            }
+            n += put16(body + n, _adc->getOversampling());
+            break;
+
+        case HOST_CFG_LINK_MODE:
+            if (set && value[0] > LINK_FRAMED) {
+                status = HOST_ERR_BAD_ARGS;
+                return 0;
+            }
+            // A switch to raw happens after this (framed) response
+            body[n++] = set ? value[0] : (uint8_t)_link.getMode();
+            break;
+
+        case HOST_CFG_CALIBRATION: {
+            if (!set || value[0] >= SENSOR_COUNT) {
+                status = HOST_ERR_BAD_ARGS;
+                return 0;
+            }
+            _adc->setLinearCalibration(value[0], getFloat(value + 1), getFloat(value + 5),
+                                       getFloat(value + 9), getFloat(value + 13));
+            memcpy(body + n, value, need);
+            n += need;
+            break;
+        }
+
+        case HOST_CFG_PROFILE_SAVE:
+        case HOST_CFG_PROFILE: {
+            // Serial is the rest of the value, without terminator
+            char serial[CalibrationProfile::SERIAL_LEN];
+            if (set) {
+                if (valueLen >= sizeof(serial)) {
+                    status = HOST_ERR_BAD_ARGS;
+                    return 0;
+                }
+                memcpy(serial, value, valueLen);
+                serial[valueLen] = '\0';
+                if (!CalibrationStore::isValidSerial(serial)) {
+                    status = HOST_ERR_BAD_ARGS;
+                    return 0;
+                }
+                CalibrationProfile profile;
+                bool ok;
+                if (key == HOST_CFG_PROFILE_SAVE) {
+                    ok = _adc->getProfile(serial, profile) && _calStore->save(profile);
+                } else {
+                    ok = _calStore->load(serial, profile) && _adc->applyProfile(profile) &&
+                         _calStore->setActive(serial);
+                }
+                if (!ok) {
+                    status = HOST_ERR_UNAVAILABLE;
+                    return 0;
+                }
+            } else if (key == HOST_CFG_PROFILE_SAVE) {
+                status = HOST_ERR_BAD_ARGS;
+                return 0;
+            } else if (!_calStore->getActive(serial, sizeof(serial))) {
+                serial[0] = '\0';                  // No active profile
+            }
+            const size_t serialLen = strlen(serial);
+            memcpy(body + n, serial, serialLen);
+            n += serialLen;
+            break;
+        }
+    }
+    return n;
+}
+
+void HostCommands::sendResponse(uint16_t seq, uint8_t op, uint8_t status,
+                                const uint8_t* body, size_t len) {
+    size_t n = put16(_last, seq);
+    _last[n++] = op | HOST_OP_RESPONSE;
+    _last[n++] = status;
+    memcpy(_last + n, body, len);
+    _lastLen = n + len;
+    _link.sendFrame(HOST_CH_CMD, _last, _lastLen);
+}
+
+// ============================================================================
+// Dumps
+// ============================================================================
+
+size_t HostCommands::startDump(const uint8_t* args, size_t len, uint8_t* body, uint8_t& status) {
+    if (len < 2) {
+        status = HOST_ERR_BAD_ARGS;
+        return 0;
+    }
+    if (_dump.active) {
+        status = HOST_ERR_BUSY;
+        return 0;
+    }
+
+    Dump dump;
+    memset(&dump, 0, sizeof(dump));
+    dump.source = args[0];
+    dump.window = (args[1] == 0) ? 1 : (args[1] > MAX_WINDOW ? MAX_WINDOW : args[1]);
+
+    switch (dump.source) {
+        case HOST_DUMP_TIMELINE:
+            if (!_timeline) {
+                status = HOST_ERR_UNAVAILABLE;
+                return 0;
+            }
+            dump.first = _timeline->oldest();
+            dump.recordSize = TIMELINE_RECORD;
+            dump.size = (_timeline->head() - dump.first) * TIMELINE_RECORD;
+            break;
+
+        case HOST_DUMP_TREND_1S:
+        case HOST_DUMP_TREND_10S:
+        case HOST_DUMP_TREND_1MIN: {
+            if (!_trend) {
+                status = HOST_ERR_UNAVAILABLE;
+                return 0;
+            }
+            const TrendTier tier = (TrendTier)(dump.source - HOST_DUMP_TREND_1S);
+            dump.first = _trend->getRevision(tier);
+            dump.count = _trend->getBucketCount(tier);
+            dump.recordSize = TREND_RECORD;
+            dump.size = (uint32_t)dump.count * TREND_RECORD;
+            break;
+        }
+
+        case HOST_DUMP_CAPTURE:
+            if (_capturePath == nullptr) {
+                status = HOST_ERR_UNAVAILABLE;
+                return 0;
+            }
+            if (_recorder != nullptr && _recorder->isRecording()) {
+                status = HOST_ERR_BUSY;
+                return 0;
+            }
+            _file = LittleFS.open(_capturePath, FILE_READ);
+            if (!_file) {
+                status = HOST_ERR_UNAVAILABLE;
+                return 0;
+            }
+            dump.recordSize = 1;
+            dump.size = _file.size();
+            break;
+
+        default:
+            status = HOST_ERR_BAD_ARGS;
+            return 0;
+    }
+
+    dump.chunks = (dump.size + CHUNK_BYTES - 1) / CHUNK_BYTES;
+    if (len >= 6) {
+        // Resume a broken transfer
+        dump.next = get32(args + 2);
+        if (dump.next > dump.chunks) dump.next = dump.chunks;
+        dump.acked = dump.next;
+    }
+    dump.active = true;
+    dump.lastAckMs = _clock->millis();
+    _dump = dump;
+
+    size_t n = 0;
+    n += put32(body + n, dump.size);
+    n += put32(body + n, dump.chunks);
+    n += put16(body + n, dump.recordSize);
+    body[n++] = CHUNK_BYTES;
+    return n;
+}
+
+void HostCommands::pumpDump() {
+    for (uint8_t i = 0; i < CHUNKS_PER_UPDATE; i++) {
+        const bool windowFull = _dump.next >= _dump.acked + _dump.window;
+        if (windowFull || _dump.endSent) {
+            if (_clock->millis() - _dump.lastAckMs > ACK_TIMEOUT_MS) {
+                if (!_dump.endSent) {
+                    HostLog.println("# Dump: host stopped acknowledging");
+                    endDump(HOST_ERR_TIMEOUT);
+                } else {
+                    _dump.active = false;
+                    if (_file) _file.close();
+                }
+            }
+            return;
+        }
+        if (!_link.canSendFrame()) {
+            return;
+        }
+
+        uint8_t frame[HostFrame::MAX_PAYLOAD];
+        size_t n = put16(frame, _dump.seq);
+        frame[n++] = HOST_OP_DUMP_DATA | HOST_OP_RESPONSE;
+
+        if (_dump.next >= _dump.chunks) {
+            frame[n++] = HOST_DUMP_END;
+            n += put32(frame + n, _dump.chunks);
+            _link.sendFrame(HOST_CH_CMD, frame, n);
+            _dump.endSent = true;
+            continue;
+        }
+
+        const uint32_t offset = _dump.next * CHUNK_BYTES;
+        uint32_t len = _dump.size - offset;
+        if (len > CHUNK_BYTES) len = CHUNK_BYTES;
+        frame[n++] = HOST_OK;
+        n += put32(frame + n, _dump.next);
+        uint8_t status = HOST_OK;
+        if (!readDump(offset, frame + n, len, status)) {
+            endDump(status);
+            return;
+        }
+        _link.sendFrame(HOST_CH_CMD, frame, n + len);
+        _dump.next++;
+    }
+}
+
+void HostCommands::endDump(uint8_t status) {
+    uint8_t frame[8];
+    size_t n = put16(frame, _dump.seq);
+    frame[n++] = HOST_OP_DUMP_DATA | HOST_OP_RESPONSE;
+    frame[n++] = status;
+    n += put32(frame + n, _dump.next);
+    _link.sendFrame(HOST_CH_CMD, frame, n);
+    _dump.active = false;
+    if (_file) _file.close();
+}
+
+bool HostCommands::readDump(uint32_t offset, uint8_t* out, size_t len, uint8_t& status) {
+    if (_dump.source == HOST_DUMP_CAPTURE) {
+        if (!_file.seek(offset) || _file.read(out, len) != len) {
+            status = HOST_ERR_UNAVAILABLE;
+            return false;
+        }
+        return true;
+    }
+
+    // Records are generated on the fly; a chunk may start and end mid-record
+    uint8_t record[TIMELINE_RECORD > TREND_RECORD ? TIMELINE_RECORD : TREND_RECORD];
+    size_t done = 0;
+    while (done < len) {
+        const uint32_t index = (offset + done) / _dump.recordSize;
+        const uint32_t within = (offset + done) % _dump.recordSize;
+
+        if (_dump.source == HOST_DUMP_TIMELINE) {
+            TimelineCursor cursor = { _dump.first + index, 0, 0 };
+            CO2Data data;
+            memset(&data, 0, sizeof(data));
+            if (!_timeline->read(cursor, data) || cursor.dropped > 0) {
+                status = HOST_ERR_OVERRUN;
+                return false;
+            }
+            size_t n = put32(record, _dump.first + index);
+            n += put32(record + n, data.timestamp);
+            n += put32(record + n, (uint32_t)data.timestamp_us);
+            n += put32(record + n, (uint32_t)(data.timestamp_us >> 32));
+            n += put16(record + n, data.co2_waveform);
+            record[n++] = data.fco2;
+            record[n++] = data.fetco2;
+            record[n++] = data.respiratory_rate;
+            record[n++] = data.status1;
+            record[n++] = data.status2;
+            record[n++] = data.valid ? 1 : 0;
+            for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+                n += putFloat(record + n, data.sensors[ch].value);
+            }
+        } else {
+            // Buckets age as new ones close: oldest first at start, shifted
+            const TrendTier tier = (TrendTier)(_dump.source - HOST_DUMP_TREND_1S);
+            const uint32_t closed = _trend->getRevision(tier) - _dump.first;
+            const uint32_t age = (_dump.count - 1 - index) + closed;
+            if (age >= _trend->getBucketCount(tier)) {
+                status = HOST_ERR_OVERRUN;
+                return false;
+            }
+            const TrendBucket& bucket = _trend->getBucket(tier, (uint16_t)age);
+            size_t n = 0;
+            for (uint8_t c = 0; c < TREND_CHANNEL_COUNT; c++) n += put16(record + n, bucket.min[c]);
+            for (uint8_t c = 0; c < TREND_CHANNEL_COUNT; c++) n += put16(record + n, bucket.mean[c]);
+            for (uint8_t c = 0; c < TREND_CHANNEL_COUNT; c++) n += put16(record + n, bucket.max[c]);
+        }
+
+        size_t take = _dump.recordSize - within;
+        if (take > len - done) take = len - done;
+        memcpy(out + done, record + within, take);
+        done += take;
+    }
+    return true;
+}
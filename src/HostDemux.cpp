@@ -0,0 +1,67 @@
+// HostDemux.cpp
+// Implementation of the framed stream splitter (host builds only)
+
+#ifndef ESP_PLATFORM
+
+#include "HostDemux.h"
+
+// ============================================================================
+// FilePrint
+// ============================================================================
+
+bool FilePrint::open(const char* path) {
+    close();
+    _file = fopen(path, "wb");
+    return _file != nullptr;
+}
+
+void FilePrint::close() {
+    if (_file != nullptr) fclose(_file);
+    _file = nullptr;
+}
+
+size_t FilePrint::write(const uint8_t* buffer, size_t size) {
+    return _file != nullptr ? fwrite(buffer, 1, size, _file) : 0;
+}
+
+void FilePrint::flush() {
+    if (_file != nullptr) fflush(_file);
+}
+
+// ============================================================================
+// HostDemux
+// ============================================================================
+
+size_t HostDemux::Channel::write(const uint8_t* buffer, size_t size) {
+    bytes += size;
+    return _out.write(buffer, size);
+}
+
+HostDemux::HostDemux(Stream& in, Print& records, Print& log)
+    : _records(records)
+    , _log(log)
+    , _client(in)
+{
+    _client.setDataOutput(&_records);
+    _client.setLogOutput(&_log);
+}
+
+bool HostDemux::update() {
+    const HostClientStats before = _client.getStats();
+    _client.poll();
+    const HostClientStats& after = _client.getStats();
+    return after.dataFrames != before.dataFrames || after.logFrames != before.logFrames;
+}
+
+HostDemuxStats HostDemux::getStats() const {
+    const HostClientStats& client = _client.getStats();
+    HostDemuxStats stats;
+    stats.records = client.dataFrames;
+    stats.recordBytes = _records.bytes;
+    stats.logFrames = client.logFrames;
+    stats.logBytes = _log.bytes;
+    stats.frameErrors = client.frameErrors;
+    return stats;
+}
+
+#endif // ESP_PLATFORM
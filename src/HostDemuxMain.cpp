@@ -0,0 +1,73 @@
+// HostDemuxMain.cpp
+// Command-line splitter of the framed device stream ([env:host_demux] only)
+//
+//   program <device | -> <records file> <log file>
+//
+// Reads the CDC port (opened raw) or stdin ("-", e.g. a saved capture piped
+// in) and writes data records and log text to their own files, flushed as
+// they arrive. Runs until the input ends or Ctrl-C, then prints the frame
+// counts to stderr. The device must be in framed mode (USB 'F' or any
+// request of a host tool).
+
+#ifdef HOST_DEMUX_MAIN
+
+#include <Arduino.h>
+#include <signal.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "HostDemux.h"
+#include "MaCO2Pty.h"
+
+static volatile sig_atomic_t running = 1;
+
+static void onSignal(int) {
+    running = 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc != 4) {
+        fprintf(stderr, "usage: %s <device | -> <records file> <log file>\n", argv[0]);
+        return 2;
+    }
+
+    FdStream in;
+    const bool opened = (strcmp(argv[1], "-") == 0) ? in.attach(STDIN_FILENO) : in.open(argv[1]);
+    if (!opened) {
+        perror(argv[1]);
+        return 1;
+    }
+    FilePrint records;
+    FilePrint log;
+    if (!records.open(argv[2])) {
+        perror(argv[2]);
+        return 1;
+    }
+    if (!log.open(argv[3])) {
+        perror(argv[3]);
+        return 1;
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    HostDemux demux(in, records, log);
+    while (running) {
+        if (demux.update()) {
+            records.flush();
+            log.flush();
+        } else if (in.atEnd()) {
+            break;
+        } else {
+            usleep(1000);
+        }
+    }
+    records.flush();
+    log.flush();
+
+    const HostDemuxStats s = demux.getStats();
+    fprintf(stderr, "%lu records (%lu bytes), %lu log frames (%lu bytes), %lu frame errors\n",
+            (unsigned long)s.records, (unsigned long)s.recordBytes,
+            (unsigned long)s.logFrames, (unsigned long)s.logBytes, (unsigned long)s.frameErrors);
+    return 0;
+}
+
+#endif // HOST_DEMUX_MAIN
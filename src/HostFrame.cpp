@@ -0,0 +1,103 @@
+// HostFrame.cpp
+// COBS framing and CRC-8 of the USB host link
+
+#include "HostFrame.h"
+#include <string.h>
+
+uint8_t HostFrame::crc8(const uint8_t* data, size_t len, uint8_t crc) {
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+size_t HostFrame::encode(uint8_t channel, const uint8_t* payload, size_t len, uint8_t* out) {
+    if (len > MAX_PAYLOAD) {
+        return 0;
+    }
+    const uint8_t crc = crc8(payload, len, crc8(&channel, 1));
+
+    // COBS: each code byte gives the distance to the next zero. The frame is
+    // shorter than 254 bytes, so no 0xFF block split is needed.
+    size_t code = 0;
+    size_t o = 1;
+    for (size_t i = 0; i < len + 2; i++) {
+        const uint8_t b = (i == 0) ? channel : (i <= len) ? payload[i - 1] : crc;
+        if (b == 0) {
+            out[code] = (uint8_t)(o - code);
+            code = o++;
+        } else {
+            out[o++] = b;
+        }
+    }
+    out[code] = (uint8_t)(o - code);
+    out[o++] = 0x00;
+    return o;
+}
+
+// ============================================================================
+// HostFrameDecoder
+// ============================================================================
+
+HostFrameDecoder::HostFrameDecoder()
+    : _rawLen(0)
+    , _length(0)
+    , _overflow(false)
+    , _errors(0)
+{
+    memset(_frame, 0, sizeof(_frame));
+}
+
+void HostFrameDecoder::reset() {
+    _rawLen = 0;
+    _length = 0;
+    _overflow = false;
+}
+
+bool HostFrameDecoder::push(uint8_t byte) {
+    if (byte != 0x00) {
+        if (_rawLen < sizeof(_raw)) {
+            _raw[_rawLen++] = byte;
+        } else {
+            _overflow = true;
+        }
+        return false;
+    }
+
+    // Delimiter; empty frames are padding, not errors
+    bool ok = false;
+    if (_rawLen > 0 || _overflow) {
+        ok = !_overflow && decode();
+        if (!ok) {
+            _errors++;
+        }
+    }
+    _rawLen = 0;
+    _overflow = false;
+    return ok;
+}
+
+bool HostFrameDecoder::decode() {
+    size_t i = 0;
+    size_t n = 0;
+    while (i < _rawLen) {
+        const uint8_t code = _raw[i++];
+        for (uint8_t k = 1; k < code; k++) {
+            if (i >= _rawLen) {
+                return false;           // Code points past the delimiter
+            }
+            _frame[n++] = _raw[i++];
+        }
+        if (code < 0xFF && i < _rawLen) {
+            _frame[n++] = 0x00;
+        }
+    }
+    if (n < 2 || HostFrame::crc8(_frame, n - 1) != _frame[n - 1]) {
+        return false;
+    }
+    _length = n - 2;
+    return true;
+}
@@ -0,0 +1,326 @@
+// HostLink.cpp
+// Data / log multiplexing on the USB CDC link
+
+#include "HostLink.h"
+
+HostLink hostLink(Serial);
+Print& HostLog = hostLink.log();
+
+// Guards the log queue indices (one link per device)
+static portMUX_TYPE logMux = portMUX_INITIALIZER_UNLOCKED;
+
+size_t HostLogChannel::write(uint8_t c) {
+    return _link.queueLog(&c, 1);
+}
+
+size_t HostLogChannel::write(const uint8_t* buffer, size_t size) {
+    return _link.queueLog(buffer, size);
+}
+
+HostLink::HostLink(Stream& usb)
+    : _usb(usb)
+    , _log(*this)
+    , _mode(LINK_RAW)
+    , _rawLog(false)
+    , _logQueued(false)
+    , _owner(nullptr)
+    , _head(0)
+    , _tail(0)
+    , _recordLen(0)
+    , _inRecord(false)
+    , _recordStartUs(0)
+    , _clock(&Clock::hardware())
+    , _rxFraming(false)
+    , _rxFrameBytes(0)
+    , _rxLastMs(0)
+    , _rxLegacy(-1)
+    , _requestLen(0)
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+void HostLink::begin(HostLinkMode mode) {
+    _owner = currentTask();
+    setMode(mode);
+}
+
+void HostLink::setMode(HostLinkMode mode) {
+    if (_inRecord) {
+        flush();
+    }
+    flushLog();
+    _mode = mode;
+    if (_mode == LINK_FRAMED) {
+        _usb.write((uint8_t)0x00);      // Ends whatever the reader has buffered
+    }
+}
+
+// ============================================================================
+// Data channel
+// ============================================================================
+
+int HostLink::available() {
+    pollInput();
+    return (_rxLegacy >= 0) ? 1 : 0;
+}
+
+int HostLink::read() {
+    pollInput();
+    const int c = _rxLegacy;
+    _rxLegacy = -1;
+    return c;
+}
+
+int HostLink::peek() {
+    pollInput();
+    return _rxLegacy;
+}
+
+int HostLink::availableForWrite() {
+    return _usb.availableForWrite();
+}
+
+size_t HostLink::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t HostLink::write(const uint8_t* buffer, size_t size) {
+    if (!_inRecord) {
+        _inRecord = true;
+        _recordStartUs = micros();
+    }
+    _stats.dataBytes += size;
+
+    if (_mode == LINK_RAW) {
+        return _usb.write(buffer, size);
+    }
+
+    // One frame per record; longer records continue in further frames
+    for (size_t i = 0; i < size; i++) {
+        if (_recordLen == sizeof(_record)) {
+            sendFrame(HOST_CH_DATA, _record, _recordLen);
+            _recordLen = 0;
+        }
+        _record[_recordLen++] = buffer[i];
+    }
+    return size;
+}
+
+void HostLink::flush() {
+    if (_recordLen > 0) {
+        sendFrame(HOST_CH_DATA, _record, _recordLen);
+        _recordLen = 0;
+    }
+    _usb.flush();
+    if (_inRecord) {
+        _inRecord = false;
+        _stats.dataRecords++;
+        const uint32_t us = micros() - _recordStartUs;
+        if (us > _stats.dataMaxUs) _stats.dataMaxUs = us;
+    }
+}
+
+// ============================================================================
+// Host input
+// ============================================================================
+
+size_t HostLink::readRequest(uint8_t* buf, size_t maxLen) {
+    pollInput();
+    if (_requestLen == 0 || _requestLen > maxLen) {
+        _requestLen = 0;
+        return 0;
+    }
+    const size_t n = _requestLen;
+    memcpy(buf, _request, n);
+    _requestLen = 0;
+    return n;
+}
+
+void HostLink::pollInput() {
+    // Stop at a legacy byte or a complete request until it has been read
+    while (_rxLegacy < 0 && _requestLen == 0 && _usb.available() > 0) {
+        const uint8_t b = (uint8_t)_usb.read();
+        _rxLastMs = _clock->millis();
+
+        if (!_rxFraming) {
+            if (b == 0x00) {
+                _rxFraming = true;
+                _rxFrameBytes = 0;
+                _rx.reset();
+            } else {
+                _rxLegacy = b;
+            }
+            continue;
+        }
+
+        if (_rx.push(b)) {
+            if (_rx.channel() == HOST_CH_CMD) {
+                memcpy(_request, _rx.payload(), _rx.length());
+                _requestLen = _rx.length();
+                _stats.rxFrames++;
+            } else {
+                _stats.rxErrors++;
+            }
+        }
+        // Further 0x00 are padding: a host may send two to end a partial
+        // frame first, then start its own
+        if (b != 0x00) {
+            _rxFrameBytes++;
+        } else if (_rxFrameBytes > 0) {
+            _rxFraming = false;
+        }
+    }
+
+    // A lone 0x00 (or a host gone mid-frame) must not swallow legacy bytes
+    if (_rxFraming && _clock->millis() - _rxLastMs > RX_FRAME_TIMEOUT_MS) {
+        _rxFraming = false;
+        _stats.rxErrors++;
+    }
+}
+
+// ============================================================================
+// Log channel
+// ============================================================================
+
+size_t HostLink::queueLog(const uint8_t* buffer, size_t size) {
+    const bool owner = isOwner();
+    if (owner && !_logQueued) {
+        flushLog();
+        sendLog(buffer, size);
+        return size;
+    }
+
+    for (uint8_t attempt = 0; attempt < 2; attempt++) {
+        portENTER_CRITICAL(&logMux);
+        const uint32_t queued = _head - _tail;
+        if (size <= LOG_QUEUE - queued) {
+            const uint32_t at = _head & (LOG_QUEUE - 1);
+            const size_t first = (size < LOG_QUEUE - at) ? size : LOG_QUEUE - at;
+            memcpy(_queue + at, buffer, first);
+            memcpy(_queue, buffer + first, size - first);
+            _head += size;
+            if (queued + size > _stats.logPeak) _stats.logPeak = queued + size;
+            portEXIT_CRITICAL(&logMux);
+            return size;
+        }
+        portEXIT_CRITICAL(&logMux);
+
+        if (!owner) {
+            break;
+        }
+        // The loop task may block: no record is in flight while it logs
+        _stats.logStalls++;
+        flushLog();
+        if (size > LOG_QUEUE) {
+            sendLog(buffer, size);
+            return size;
+        }
+    }
+
+    portENTER_CRITICAL(&logMux);
+    _stats.logDropped += size;
+    portEXIT_CRITICAL(&logMux);
+    return 0;
+}
+
+void HostLink::update() {
+    if (_head == _tail) {
+        return;
+    }
+    const int space = _usb.availableForWrite();
+    if (space <= DATA_RESERVE) {
+        return;
+    }
+    size_t budget = space - DATA_RESERVE;
+    if (budget > DRAIN_BUDGET) budget = DRAIN_BUDGET;
+
+    // Raw text must not leave a line open for the next record to land in
+    while (budget > 0) {
+        const size_t sent = drainLog(budget, _mode == LINK_RAW);
+        if (sent == 0) break;
+        budget -= sent;
+    }
+}
+
+void HostLink::flushLog() {
+    while (drainLog(HostFrame::MAX_PAYLOAD, false) > 0) {
+    }
+}
+
+size_t HostLink::drainLog(size_t maxBytes, bool wholeLines) {
+    portENTER_CRITICAL(&logMux);
+    const uint32_t pending = _head - _tail;
+    portEXIT_CRITICAL(&logMux);
+
+    size_t n = pending;
+    if (n > maxBytes) n = maxBytes;
+    if (n > HostFrame::MAX_PAYLOAD) n = HostFrame::MAX_PAYLOAD;
+    if (n == 0) {
+        return 0;
+    }
+
+    // Bytes up to _head are complete and only this task moves _tail
+    uint8_t chunk[HostFrame::MAX_PAYLOAD];
+    for (size_t i = 0; i < n; i++) {
+        chunk[i] = _queue[(_tail + i) & (LOG_QUEUE - 1)];
+    }
+
+    if (wholeLines) {
+        size_t end = n;
+        while (end > 0 && chunk[end - 1] != '\n') end--;
+        if (end > 0) {
+            n = end;
+        } else if (n < HostFrame::MAX_PAYLOAD) {
+            return 0;                   // Wait for budget or the line's end
+        }
+    }
+
+    sendLog(chunk, n);
+    portENTER_CRITICAL(&logMux);
+    _tail += n;
+    portEXIT_CRITICAL(&logMux);
+    return n;
+}
+
+void HostLink::sendLog(const uint8_t* buffer, size_t size) {
+    if (_mode == LINK_RAW) {
+        // Text in the legacy stream would reach the LabVIEW parser
+        if (!_rawLog) {
+            _stats.logWithheld += size;
+            return;
+        }
+        _stats.logBytes += size;
+        _usb.write(buffer, size);
+        return;
+    }
+    _stats.logBytes += size;
+    while (size > 0) {
+        const size_t n = (size < HostFrame::MAX_PAYLOAD) ? size : HostFrame::MAX_PAYLOAD;
+        sendFrame(HOST_CH_LOG, buffer, n);
+        buffer += n;
+        size -= n;
+    }
+}
+
+bool HostLink::canSendFrame() {
+    return _usb.availableForWrite() > (int)(DATA_RESERVE + HostFrame::MAX_ENCODED);
+}
+
+void HostLink::sendFrame(uint8_t channel, const uint8_t* payload, size_t len) {
+    uint8_t frame[HostFrame::MAX_ENCODED];
+    const size_t n = HostFrame::encode(channel, payload, len, frame);
+    _usb.write(frame, n);
+}
+
+bool HostLink::isOwner() const {
+    return _owner == nullptr || currentTask() == _owner;
+}
+
+void* HostLink::currentTask() {
+#ifdef ESP_PLATFORM
+    return (void*)xTaskGetCurrentTaskHandle();
+#else
+    static thread_local uint8_t marker;
+    return &marker;
+#endif
+}
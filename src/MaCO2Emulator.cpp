@@ -0,0 +1,252 @@
+// MaCO2Emulator.cpp
+// Implementation of the simulated MaCO2 sensor
+//
+// Bytes are scheduled on a virtual line: one packet per period, its bytes
+// one UART byte time apart (compressed when the rate multiplier leaves less
+// than that). Every call catches up to the clock and queues the bytes that
+// are due into a 256-byte buffer, so a slow reader sees the same batches
+// and overflows as on the real UART.
+
+#include "MaCO2Emulator.h"
+#include <math.h>
+
+static const uint8_t INIT_BYTES[7] = {0x01, 0x02, 0x03, 0x00, 0x00, 0x00, 0x00};
+static const uint32_t HANDSHAKE_REPEAT_US = 500000;    // 0x06 every 0.5 s until ACKed
+
+MaCO2Emulator::MaCO2Emulator()
+    : _clock(&Clock::hardware())
+    , _state(STATE_HANDSHAKE)
+    , _pumpRunning(true)
+    , _rng(1)
+    , _periodUs(PERIOD_US)
+    , _byteUs(BYTE_US)
+    , _nextByteUs(0)
+    , _packetStartUs(0)
+    , _packetIndex(8)
+    , _initSent(0)
+    , _cycleS(0.0f)
+    , _offsetMmHg(0.0f)
+    , _peakMmHg(0.0f)
+    , _lastPeak(0)
+    , _rxHead(0)
+    , _rxCount(0)
+{
+    _config = defaultConfig();
+    memset(&_stats, 0, sizeof(_stats));
+    memset(_packet, 0, sizeof(_packet));
+}
+
+EmulatorConfig MaCO2Emulator::defaultConfig() {
+    EmulatorConfig config;
+    config.breath_rate_bpm = 12.0f;
+    config.etco2_mmhg = 38.0f;
+    config.fico2_mmhg = 0.0f;
+    config.noise_mmhg = 0.3f;
+    config.drift_mmhg_per_min = 0.0f;
+    config.drop_byte_prob = 0.0f;
+    config.corrupt_prob = 0.0f;
+    config.rate_multiplier = 1.0f;
+    config.pump_running = true;
+    config.handshake = true;
+    config.seed = 1;
+    return config;
+}
+
+void MaCO2Emulator::begin(const EmulatorConfig& config) {
+    _config = config;
+    memset(&_stats, 0, sizeof(_stats));
+    _rng = config.seed ? config.seed : 1;
+    _pumpRunning = config.pump_running;
+
+    const float multiplier = (config.rate_multiplier > 0.01f) ? config.rate_multiplier : 1.0f;
+    _periodUs = (uint32_t)(PERIOD_US / multiplier);
+    _byteUs = (_periodUs / 9 < BYTE_US) ? _periodUs / 9 : BYTE_US;
+
+    _state = config.handshake ? STATE_HANDSHAKE : STATE_RUNNING;
+    _nextByteUs = _clock->micros();
+    _packetStartUs = _nextByteUs;
+    _packetIndex = 8;
+    _initSent = 0;
+    _cycleS = 0.0f;
+    _offsetMmHg = 0.0f;
+    _peakMmHg = 0.0f;
+    _lastPeak = 0;
+    _rxHead = 0;
+    _rxCount = 0;
+}
+
+int MaCO2Emulator::available() {
+    generate();
+    return _rxCount;
+}
+
+int MaCO2Emulator::read() {
+    generate();
+    if (_rxCount == 0) {
+        return -1;
+    }
+    const uint8_t b = _rx[_rxHead];
+    _rxHead = (_rxHead + 1) % RX_BUFFER;
+    _rxCount--;
+    return b;
+}
+
+int MaCO2Emulator::peek() {
+    generate();
+    return (_rxCount > 0) ? _rx[_rxHead] : -1;
+}
+
+size_t MaCO2Emulator::write(uint8_t b) {
+    _stats.commands++;
+
+    if (b == 0x1B && _state == STATE_HANDSHAKE) {
+        // ACK: init bytes follow right away
+        _state = STATE_INIT;
+        _initSent = 0;
+        _nextByteUs = _clock->micros() + _byteUs;
+    } else if (b == 0xA5) {
+        _pumpRunning = true;                // CMD_START_PUMP
+    } else if (b == 0x5A) {
+        _offsetMmHg = 0.0f;                 // CMD_ZERO_CAL
+    }
+    return 1;
+}
+
+void MaCO2Emulator::generate() {
+    const uint32_t now = _clock->micros();
+
+    // Not polled for a long time: the line kept going, but only the last
+    // buffer-full can still be in the UART
+    if (_state == STATE_RUNNING && (int32_t)(now - _packetStartUs) > 0) {
+        const uint32_t behind = (now - _packetStartUs) / _periodUs;
+        const uint32_t keep = RX_BUFFER / 8;
+        if (behind > keep + 1) {
+            const uint32_t skipped = behind - keep;
+            _stats.overflowBytes += skipped * 8;
+            _cycleS += skipped * (_periodUs / 1e6f);
+            _packetStartUs += skipped * _periodUs;
+            _nextByteUs = _packetStartUs;
+            _packetIndex = 8;
+        }
+    } else if (_state == STATE_HANDSHAKE && (int32_t)(now - _nextByteUs) > (int32_t)HANDSHAKE_REPEAT_US) {
+        _nextByteUs = now;
+    }
+
+    while ((int32_t)(now - _nextByteUs) >= 0) {
+        switch (_state) {
+            case STATE_HANDSHAKE:
+                emit(0x06);
+                _nextByteUs += HANDSHAKE_REPEAT_US;
+                break;
+
+            case STATE_INIT:
+                emit(INIT_BYTES[_initSent++]);
+                _nextByteUs += _byteUs;
+                if (_initSent == sizeof(INIT_BYTES)) {
+                    _state = STATE_RUNNING;
+                    _packetStartUs = _nextByteUs + _periodUs;
+                    _nextByteUs = _packetStartUs;
+                    _packetIndex = 8;
+                }
+                break;
+
+            case STATE_RUNNING:
+                if (_packetIndex >= 8) {
+                    buildPacket();
+                    _packetIndex = 0;
+                }
+                if (uniform() >= _config.drop_byte_prob) {
+                    emit(_packet[_packetIndex]);
+                } else {
+                    _stats.droppedBytes++;
+                }
+                _packetIndex++;
+                if (_packetIndex < 8) {
+                    _nextByteUs += _byteUs;
+                } else {
+                    _packetStartUs += _periodUs;
+                    _nextByteUs = _packetStartUs;
+                }
+                break;
+        }
+    }
+}
+
+void MaCO2Emulator::emit(uint8_t b) {
+    _stats.bytes++;
+    if (_rxCount >= RX_BUFFER) {
+        _stats.overflowBytes++;
+        return;
+    }
+    _rx[(_rxHead + _rxCount) % RX_BUFFER] = b;
+    _rxCount++;
+}
+
+void MaCO2Emulator::buildPacket() {
+    const float dt = _periodUs / 1e6f;
+    const float cycle = 60.0f / ((_config.breath_rate_bpm > 1.0f) ? _config.breath_rate_bpm : 1.0f);
+    _cycleS += dt;
+    if (_cycleS >= cycle) {
+        _cycleS -= cycle;
+        _lastPeak = (uint8_t)(_peakMmHg + 0.5f);
+        _peakMmHg = 0.0f;
+    }
+    _offsetMmHg += _config.drift_mmhg_per_min * dt / 60.0f;
+
+    float co2 = 0.0f;
+    if (_pumpRunning) {
+        co2 = waveform(_cycleS) + _offsetMmHg;
+        // Approximately Gaussian: sum of three uniforms (variance 1/4 each)
+        co2 += _config.noise_mmhg * (uniform() + uniform() + uniform() - 1.5f) * 2.0f;
+    }
+    if (co2 < 0.0f) co2 = 0.0f;
+    if (co2 > 50.0f) co2 = 50.0f;       // Sensor waveform range
+    if (co2 > _peakMmHg) _peakMmHg = co2;
+
+    const float rr = _config.breath_rate_bpm;
+    _packet[0] = 0x06;
+    _packet[1] = _pumpRunning ? 0x00 : 0x01;       // Bit 0: pump stopped
+    _packet[2] = (uint8_t)((rr > 60.0f) ? 60 : rr + 0.5f);
+    _packet[3] = (uint8_t)(_config.fico2_mmhg + 0.5f);
+    _packet[4] = (uint8_t)(co2 + 0.5f);
+    _packet[5] = _pumpRunning ? _lastPeak : 0;
+    _packet[6] = 0;
+    uint8_t sum = 0;
+    for (uint8_t i = 0; i < 7; i++) {
+        sum += _packet[i];
+    }
+    _packet[7] = sum;
+    if (uniform() < _config.corrupt_prob) {
+        _packet[7] ^= 0x5A;
+        _stats.corruptPackets++;
+    }
+    _stats.packets++;
+}
+
+float MaCO2Emulator::waveform(float t_s) {
+    // Expiration (first 2/3 of the cycle): phase II upstroke, then a slowly
+    // rising alveolar plateau. Inspiration: fast washout to the baseline.
+    const float cycle = 60.0f / ((_config.breath_rate_bpm > 1.0f) ? _config.breath_rate_bpm : 1.0f);
+    const float te = cycle * 2.0f / 3.0f;
+    const float fi = _config.fico2_mmhg;
+    const float span = _config.etco2_mmhg - fi;
+
+    if (t_s < te) {
+        const float rise = 1.0f - expf(-t_s / (0.06f * cycle));
+        const float slope = 0.9f + 0.1f * (t_s / te);     // Phase III: last 10 %
+        return fi + span * rise * slope;
+    }
+    return fi + span * expf(-(t_s - te) / (0.03f * cycle));
+}
+
+uint32_t MaCO2Emulator::random32() {
+    // xorshift32
+    _rng ^= _rng << 13;
+    _rng ^= _rng >> 17;
+    _rng ^= _rng << 5;
+    return _rng;
+}
+
+float MaCO2Emulator::uniform() {
+    return (random32() >> 8) * (1.0f / 16777216.0f);
+}
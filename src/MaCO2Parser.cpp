@@ -2,217 +2,139 @@
 // Implementation of MaCO2 sensor communication protocol
 
 #include "MaCO2Parser.h"
+#include "Profiler.h"
+#include "HostLink.h"
 
 MaCO2Parser::MaCO2Parser()
-    : _state(WAIT_FOR_DATA)
+    : _clock(&Clock::hardware())
+    , _state(WAIT_FOR_DATA)
     , _rxIndex(0)
     , _packetCount(0)
     , _errorCount(0)
     , _lastPacketTime(0)
-    , _peakCO2(0)
-    , _lastEtCO2(0)
-    , _prevWaveform(0)
+    , _packetArrivalUs(0)
+    , _packetPeriods(1)
+    , _bytesSincePacket(0)
+    , _consecutiveErrors(0)
+    , _syncStartTime(0)
+    , _syncMessagePrinted(false)
+    , _lastByteTime(0)
 {
     memset(&_rxBuffer, 0, sizeof(_rxBuffer));
 }
 
-bool MaCO2Parser::initialize(HardwareSerial& serial, unsigned long timeout_ms) {
-    Serial.println("Initializing MaCO2 sensor...");
+bool MaCO2Parser::initialize(Stream& serial, unsigned long timeout_ms) {
+    HostLog.println("Initializing MaCO2 sensor...");
     
     // Flush any old data
     while (serial.available()) {
         serial.read();
     }
-    delay(100);
+    _clock->delay(100);
     
-    unsigned long startTime = millis();
+    unsigned long startTime = _clock->millis();
     
     // Wait for start byte (0x06) from MaCO2
-    while (millis() - startTime < timeout_ms) {
+    while (_clock->millis() - startTime < timeout_ms) {
         if (serial.available()) {
             uint8_t byte = serial.read();
-            Serial.printf("Init byte received: 0x%02X\n", byte);
+            HostLog.printf("Init byte received: 0x%02X\n", byte);
             
             if (byte == 0x06) {
                 // Send acknowledgment (ESC = 0x1B)
                 serial.write(0x1B);
                 serial.flush();  // Ensure it's sent
-                Serial.println("MaCO2 start byte received, sent ACK (0x1B)");
+                HostLog.println("MaCO2 start byte received, sent ACK (0x1B)");
                 
-                delay(50);  // Give sensor time to respond
+                _clock->delay(50);  // Give sensor time to respond
                 
                 // Read and discard 7 initialization bytes
                 int discarded = 0;
-                unsigned long ackTime = millis();
-                Serial.print("Reading init bytes: ");
-                while (discarded < 7 && (millis() - ackTime < 2000)) {
+                unsigned long ackTime = _clock->millis();
+                HostLog.print("Reading init bytes: ");
+                while (discarded < 7 && (_clock->millis() - ackTime < 2000)) {
                     if (serial.available()) {
                         uint8_t initByte = serial.read();
-                        Serial.printf("0x%02X ", initByte);
+                        HostLog.printf("0x%02X ", initByte);
                         discarded++;
                     }
-                    delay(10);
+                    _clock->delay(10);
                 }
-                Serial.println();
+                HostLog.println();
                 
                 if (discarded == 7) {
-                    Serial.println("MaCO2 sensor initialized successfully");
+                    HostLog.println("MaCO2 sensor initialized successfully");
                     _state = WAIT_FOR_DATA;
                     
                     // Flush any remaining bytes
-                    delay(100);
+                    _clock->delay(100);
                     while (serial.available()) {
                         serial.read();
                     }
                     
                     return true;
                 } else {
-                    Serial.printf("Failed to read initialization bytes (got %d/7)\n", discarded);
+                    HostLog.printf("Failed to read initialization bytes (got %d/7)\n", discarded);
                     _errorCount++;
                     return false;
                 }
             }
         }
-        delay(100);
+        _clock->delay(100);
     }
     
-    Serial.println("MaCO2 initialization timeout");
+    HostLog.println("MaCO2 initialization timeout");
     _errorCount++;
     return false;
 }
 
-bool MaCO2Parser::parsePacket(HardwareSerial& serial, CO2Data& data) {
-    // Process all available packets, but only return the most recent one
-    bool gotPacket = false;
-    int packetsProcessed = 0;
-    const int MAX_PACKETS_PER_CALL = 10;  // Limit to prevent getting stuck
-
-    while (packetsProcessed < MAX_PACKETS_PER_CALL && readPacket(serial)) {
-        // Packet received successfully
-        decodePacket(_rxBuffer, data);
-
-        data.timestamp = millis();
-        _lastPacketTime = data.timestamp;
-        _packetCount++;
-        gotPacket = true;
-        packetsProcessed++;
+bool MaCO2Parser::parsePacket(Stream& serial, CO2Data& data) {
+    PROFILE_SCOPE(PROF_MACO2_PARSE);
+    
+    // One packet per call: the caller runs its per-sample pipeline for each
+    if (!readPacket(serial)) {
+        return false;
     }
 
-    // Log if we're processing multiple packets (indicates buffer buildup)
-    if (packetsProcessed > 1) {
-        Serial.printf("# Warning: Processed %d packets in one call (buffer catchup), %d bytes remaining\n",
-                     packetsProcessed, serial.available());
-    }
+    // Timestamp first - used by breath detection
+    const int64_t t_us = _timestamper.addPacket(_packetArrivalUs, _packetPeriods);
+    data.timestamp_us = (uint64_t)t_us;
+    data.timestamp = (uint32_t)(t_us / 1000);
+    decodePacket(_rxBuffer, data);
 
-    return gotPacket;
+    _lastPacketTime = _clock->millis();
+    _packetCount++;
+    return true;
 }
 
-bool MaCO2Parser::readPacket(HardwareSerial& serial) {
-    // If we have too many consecutive errors, flush buffer and resync
-    static int consecutiveErrors = 0;
-    static uint8_t syncBuffer[16];  // Sliding window for sync search
-    static int syncBufferLen = 0;
-    static unsigned long syncStartTime = 0;
-
-    unsigned long now = millis();
+bool MaCO2Parser::readPacket(Stream& serial) {
+    unsigned long now = _clock->millis();
 
-    // If we've been searching for sync for too long (>5 seconds), flush and restart
-    if (consecutiveErrors > 3 && syncStartTime == 0) {
-        syncStartTime = now;
+    // Report a sync search that has lasted >5 seconds. The buffer is not
+    // flushed: every byte is read as it arrives, so there is no backlog to
+    // skip, and flushing could drop the first good packets after the noise.
+    if (_consecutiveErrors > SYNC_LOST_ERRORS && _syncStartTime == 0) {
+        _syncStartTime = now;
+        if (_syncStartTime == 0) _syncStartTime = 1;    // 0 = not searching
     }
 
-    if (syncStartTime > 0 && (now - syncStartTime) > 5000) {
-        Serial.println("# Sync search timeout - flushing buffer and restarting");
-        while (serial.available()) {
-            serial.read();
-        }
-        consecutiveErrors = 0;
-        syncBufferLen = 0;
-        syncStartTime = 0;
-        _state = WAIT_FOR_DATA;
-        return false;
+    if (_syncStartTime > 0 && (now - _syncStartTime) > SYNC_TIMEOUT_MS) {
+        HostLog.printf("# Sync search timeout - no valid packet for %lu ms, still searching\n",
+                      (unsigned long)(now - _syncStartTime));
+        _syncStartTime = now;
+        _errorCount++;
     }
 
     // Process bytes until we find a complete packet or run out of data
     while (serial.available()) {
         uint8_t byte = serial.read();
+        _bytesSincePacket++;
+        _lastByteTime = now;
         
         switch (_state) {
             case WAIT_FOR_DATA:
-                // Check if we need to search for sync using header
-                if (consecutiveErrors > 3) {
-                    // Only print sync message once when entering sync mode
-                    static bool syncMessagePrinted = false;
-                    if (!syncMessagePrinted) {
-                        Serial.println("# === SYNC LOST - Searching using 0x06 header + checksum ===");
-                        syncMessagePrinted = true;
-                    }
-
-                    // Collect bytes into sync buffer
-                    if (syncBufferLen < 16) {
-                        syncBuffer[syncBufferLen++] = byte;
-                    }
-
-                    // Once we have enough bytes, search for valid packet using header
-                    if (syncBufferLen >= 10) {
-                        // Try each position starting with 0x06 header
-                        for (int offset = 0; offset <= syncBufferLen - 8; offset++) {
-                            // Look for 0x06 header byte
-                            if (syncBuffer[offset] != 0x06) {
-                                continue;  // Not a header, skip
-                            }
-                            
-                            // Check if we have full packet from this position
-                            if (offset + 8 > syncBufferLen) {
-                                break;  // Not enough bytes yet
-                            }
-                            
-                            // Validate checksum
-                            uint8_t sum = 0;
-                            for (int i = 0; i < 7; i++) {
-                                sum += syncBuffer[offset + i];
-                            }
-                            uint8_t expected_checksum = syncBuffer[offset + 7];
-                            
-                            // Validate RR - must be reasonable (0-60)
-                            // Note: RR=0 is valid when sampling ambient air between test sessions
-                            uint8_t rr_test = syncBuffer[offset + 2];
-
-                            // Additional validation: check CO2 values are reasonable
-                            uint8_t fco2_test = syncBuffer[offset + 4];  // d[4] - waveform (0-50 typical)
-                            uint8_t fetco2_test = syncBuffer[offset + 5];  // d[5] - peak (0-120 typical)
-
-                            bool co2_reasonable = (fco2_test <= 50 && fetco2_test <= 120);
-
-                            if (sum == expected_checksum && rr_test <= 60 && co2_reasonable) {
-                                // Found valid packet!
-                                Serial.printf("# Found sync at offset %d: header=0x06, RR=%d, FCO2=%d, FetCO2=%d, checksum=0x%02X OK\n",
-                                            offset, rr_test, fco2_test, fetco2_test, expected_checksum);
-
-                                // Copy to rx buffer and process
-                                memcpy(&_rxBuffer, &syncBuffer[offset], sizeof(MaCO2Packet));
-                                consecutiveErrors = 0;
-                                syncBufferLen = 0;
-                                syncStartTime = 0;  // Reset sync timer
-                                _state = WAIT_FOR_DATA;
-
-                                // Reset sync message flag (declared at line 145)
-                                syncMessagePrinted = false;
-
-                                return true;
-                            }
-                        }
-                        
-                        // Shift buffer and continue searching
-                        memmove(syncBuffer, syncBuffer + 4, 12);
-                        syncBufferLen -= 4;
-                    }
-                    return false;
-                }
-                
-                // Normal operation - look for 0x06 header to start packet
+                // Look for 0x06 header to start packet
                 if (byte == 0x06) {
-                    syncBufferLen = 0;  // Reset sync buffer
                     ((uint8_t*)&_rxBuffer)[0] = byte;
                     _rxIndex = 1;
                     _state = READING_PACKET;
@@ -223,59 +145,22 @@ bool MaCO2Parser::readPacket(HardwareSerial& serial) {
                 ((uint8_t*)&_rxBuffer)[_rxIndex++] = byte;
                 
                 if (_rxIndex >= sizeof(MaCO2Packet)) {
-                    // Full packet received - validate with checksum
-                    uint8_t* bytes = (uint8_t*)&_rxBuffer;
-                    uint8_t calculated_checksum = 0;
-                    for (int i = 0; i < 7; i++) {
-                        calculated_checksum += bytes[i];
-                    }
-                    
-                    bool checksum_valid = (calculated_checksum == _rxBuffer.checksum);
-                    bool header_valid = (_rxBuffer.status1 == 0x06);
-                    bool rr_valid = (_rxBuffer.rr <= 60);  // RR can be 0-60 (0 is valid when sampling ambient air)
-
-                    if (!checksum_valid) {
-                        Serial.printf("# Checksum fail: calc=0x%02X got=0x%02X\n",
-                                    calculated_checksum, _rxBuffer.checksum);
-                        consecutiveErrors++;
-                        _state = WAIT_FOR_DATA;
-                        _rxIndex = 0;
-                        _errorCount++;
-                        break;
-                    }
-
-                    if (!header_valid) {
-                        Serial.printf("# Header fail: d[0]=0x%02X (expected 0x06)\n", _rxBuffer.status1);
-                        consecutiveErrors++;
-                        _state = WAIT_FOR_DATA;
-                        _rxIndex = 0;
-                        _errorCount++;
-                        break;
-                    }
-
-                    if (!rr_valid) {
-                        Serial.printf("# RR fail: %d (must be 0-60)\n", _rxBuffer.rr);
-                        consecutiveErrors++;
-                        _state = WAIT_FOR_DATA;
-                        _rxIndex = 0;
-                        _errorCount++;
-                        break;
-                    }
-
-                    // Additional sanity check on CO2 values
-                    if (_rxBuffer.fco2_wave > 50 || _rxBuffer.fetco2 > 120) {
-                        Serial.printf("# CO2 values out of range: FCO2=%d, FetCO2=%d\n",
-                                    _rxBuffer.fco2_wave, _rxBuffer.fetco2);
-                        consecutiveErrors++;
-                        _state = WAIT_FOR_DATA;
-                        _rxIndex = 0;
-                        _errorCount++;
+                    if (!validatePacket()) {
+                        // A false 0x06 (e.g. in the waveform) may hide the real
+                        // header among the bytes just read: retry from there
+                        rescan();
                         break;
                     }
                     
                     // Valid packet!
-                    consecutiveErrors = 0;
-                    syncStartTime = 0;  // Reset sync timer
+                    if (_consecutiveErrors > SYNC_LOST_ERRORS) {
+                        HostLog.printf("# Sync found: RR=%d, FCO2=%d, FetCO2=%d\n",
+                                      _rxBuffer.rr, _rxBuffer.fco2_wave, _rxBuffer.fetco2);
+                    }
+                    markPacketEnd(serial);
+                    _consecutiveErrors = 0;
+                    _syncStartTime = 0;  // Reset sync timer
+                    _syncMessagePrinted = false;
                     _state = WAIT_FOR_DATA;
                     _rxIndex = 0;
                     return true;
@@ -284,12 +169,13 @@ bool MaCO2Parser::readPacket(HardwareSerial& serial) {
         }
     }
     
-    // Check for timeout (no data received for 2 seconds)
+    // Check for timeout (partial packet, no data received for 2 seconds).
+    // Measured from the last byte: from the last packet, every packet split
+    // across two polls would be dropped once a 2 s gap had occurred.
     if (_state == READING_PACKET && 
-        _lastPacketTime > 0 && 
-        (millis() - _lastPacketTime) > 2000) {
-        Serial.println("MaCO2 packet timeout - resyncing");
-        consecutiveErrors++;
+        (now - _lastByteTime) > 2000) {
+        HostLog.println("MaCO2 packet timeout - resyncing");
+        if (_consecutiveErrors <= SYNC_LOST_ERRORS) _consecutiveErrors++;
         _state = WAIT_FOR_DATA;
         _rxIndex = 0;
         _errorCount++;
@@ -298,6 +184,70 @@ bool MaCO2Parser::readPacket(HardwareSerial& serial) {
     return false;
 }
 
+bool MaCO2Parser::validatePacket() {
+    uint8_t* bytes = (uint8_t*)&_rxBuffer;
+    uint8_t calculated_checksum = 0;
+    for (int i = 0; i < 7; i++) {
+        calculated_checksum += bytes[i];
+    }
+
+    const char* failure = nullptr;
+    if (calculated_checksum != _rxBuffer.checksum) {
+        failure = "Checksum";
+    } else if (_rxBuffer.status1 != 0x06) {
+        failure = "Header";
+    } else if (_rxBuffer.rr > 60) {
+        // RR can be 0-60 (0 is valid when sampling ambient air)
+        failure = "RR";
+    } else if (_rxBuffer.fco2_wave > 50 || _rxBuffer.fetco2 > 120) {
+        // Additional sanity check on CO2 values
+        failure = "CO2 range";
+    }
+    if (failure == nullptr) {
+        return true;
+    }
+
+    if (_consecutiveErrors > SYNC_LOST_ERRORS) {
+        // Sync search: one message instead of one per candidate
+        if (!_syncMessagePrinted) {
+            HostLog.println("# === SYNC LOST - Searching using 0x06 header + checksum ===");
+            _syncMessagePrinted = true;
+        }
+        return false;
+    }
+
+    HostLog.printf("# %s fail: calc=0x%02X got=0x%02X RR=%d FCO2=%d FetCO2=%d\n", failure,
+                  calculated_checksum, _rxBuffer.checksum, _rxBuffer.rr,
+                  _rxBuffer.fco2_wave, _rxBuffer.fetco2);
+    _consecutiveErrors++;
+    _errorCount++;
+    return false;
+}
+
+void MaCO2Parser::rescan() {
+    // Restart at the next 0x06 after the rejected header (or wait for one).
+    // Every byte is tried as a header at most once, so any valid packet that
+    // follows garbage is found by the time its last byte arrives.
+    uint8_t* bytes = (uint8_t*)&_rxBuffer;
+    uint8_t next = 1;
+    while (next < _rxIndex && bytes[next] != 0x06) {
+        next++;
+    }
+    _rxIndex -= next;
+    memmove(bytes, bytes + next, _rxIndex);
+    _state = (_rxIndex > 0) ? READING_PACKET : WAIT_FOR_DATA;
+}
+
+void MaCO2Parser::markPacketEnd(Stream& serial) {
+    // Arrival of the packet's last byte: bytes already received behind it are
+    // still in the UART buffer
+    _packetArrivalUs = _timestamper.estimateArrival(_clock->micros(), serial.available());
+    
+    // Sensor periods since the previous packet, from the bytes consumed in between
+    _packetPeriods = (_bytesSincePacket + sizeof(MaCO2Packet) / 2) / sizeof(MaCO2Packet);
+    _bytesSincePacket = 0;
+}
+
 void MaCO2Parser::decodePacket(const MaCO2Packet& packet, CO2Data& data) {
     uint8_t* bytes = (uint8_t*)&packet;
 
@@ -310,7 +260,7 @@ void MaCO2Parser::decodePacket(const MaCO2Packet& packet, CO2Data& data) {
 
     // Validate packet
     if (!checksum_valid) {
-        Serial.printf("# Checksum error: calc=0x%02X got=0x%02X\n",
+        HostLog.printf("# Checksum error: calc=0x%02X got=0x%02X\n",
                      calculated_checksum, packet.checksum);
         _errorCount++;
         data.valid = false;
@@ -318,7 +268,7 @@ void MaCO2Parser::decodePacket(const MaCO2Packet& packet, CO2Data& data) {
     }
 
     if (packet.rr > 60) {  // RR > 60 is physiologically impossible
-        Serial.printf("# Packet sync error: RR=%d (resetting)\n", packet.rr);
+        HostLog.printf("# Packet sync error: RR=%d (resetting)\n", packet.rr);
         _state = WAIT_FOR_DATA;
         _rxIndex = 0;
         _errorCount++;
@@ -335,37 +285,23 @@ void MaCO2Parser::decodePacket(const MaCO2Packet& packet, CO2Data& data) {
     data.co2_waveform = packet.fco2_wave;    // d[4] - 8Hz waveform curve
     data.fco2 = packet.fico2;                // d[3] - Inspired baseline (FiCO2)
 
-    // End-tidal peak tracking (sensor doesn't provide separate EtCO2 value)
-    // Detect breath cycle: when waveform drops significantly, save the peak as EtCO2
-    uint8_t currentWaveform = packet.fco2_wave;
-
-    // Track the peak during expiration
-    if (currentWaveform > _peakCO2) {
-        _peakCO2 = currentWaveform;
-    }
-
-    // Detect start of new breath (waveform drops below 25% of peak, or drops by >10)
-    // This indicates inspiration has started, so previous peak was end-tidal
-    if (_peakCO2 > 5 && currentWaveform < (_peakCO2 / 4) && _prevWaveform > currentWaveform) {
-        _lastEtCO2 = _peakCO2;  // Save the peak as end-tidal
-        _peakCO2 = currentWaveform;  // Reset for next breath
-    }
-
-    _prevWaveform = currentWaveform;
+    // Breath-by-breath segmentation of the d[4] waveform
+    // (sensor doesn't provide a usable EtCO2 value)
+    _breathDetector.addSample(packet.fco2_wave, data.timestamp);
+    data.breath = _breathDetector.getLastBreath();
 
-    // Use tracked end-tidal value (falls back to 0 until first breath detected)
-    data.fetco2 = _lastEtCO2;
+    // End-tidal CO2 of the last completed breath (0 until first breath / during apnea)
+    data.fetco2 = _breathDetector.getEtCO2();
     
     // Check data validity (d[0] should be 6 for valid data)
     data.valid = (packet.status1 == 6) && checksum_valid && isDataValid(data);
     
-    // Note: ADC values (o2_adc, vol_adc, o2_percent, volume_ml) 
-    // are filled in by ADCManager, not here
+    // Note: ADC values (data.sensors[]) are filled in by ADCManager, not here
 }
 
-void MaCO2Parser::sendCommand(HardwareSerial& serial, MaCO2Command cmd) {
+void MaCO2Parser::sendCommand(Stream& serial, MaCO2Command cmd) {
     serial.write((uint8_t)cmd);
-    Serial.printf("Sent MaCO2 command: 0x%02X\n", cmd);
+    HostLog.printf("Sent MaCO2 command: 0x%02X\n", cmd);
 }
 
 bool MaCO2Parser::isPumpRunning(const CO2Data& data) const {
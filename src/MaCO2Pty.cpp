@@ -0,0 +1,196 @@
+// MaCO2Pty.cpp
+// Implementation of the pseudo-terminal sensor emulator (host builds only)
+//
+// Both ends run in raw mode, so every byte value passes unchanged. The
+// emulator's output is only pulled while the pty accepts it: a client that
+// stops reading fills the pty, then the emulator's 256-byte buffer, which
+// overflows and counts the loss like the real UART.
+
+#ifndef ESP_PLATFORM
+
+#include "MaCO2Pty.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+static void makeRaw(int fd) {
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        cfsetispeed(&tio, B9600);
+        cfsetospeed(&tio, B9600);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+}
+
+// ============================================================================
+// MaCO2Pty
+// ============================================================================
+
+MaCO2Pty::MaCO2Pty(MaCO2Emulator& emulator)
+    : _emulator(emulator)
+    , _master(-1)
+    , _slaveHold(-1)
+    , _pendingLen(0)
+    , _bytesOut(0)
+    , _bytesIn(0)
+{
+    _slavePath[0] = '\0';
+}
+
+MaCO2Pty::~MaCO2Pty() {
+    close();
+}
+
+bool MaCO2Pty::open() {
+    close();
+    _master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (_master < 0) {
+        return false;
+    }
+    char name[sizeof(_slavePath)];
+    if (grantpt(_master) != 0 || unlockpt(_master) != 0 ||
+        ptsname_r(_master, name, sizeof(name)) != 0) {
+        close();
+        return false;
+    }
+    _slaveHold = ::open(name, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (_slaveHold < 0) {
+        close();
+        return false;
+    }
+    makeRaw(_slaveHold);
+    strcpy(_slavePath, name);
+    return true;
+}
+
+void MaCO2Pty::close() {
+    if (_slaveHold >= 0) ::close(_slaveHold);
+    if (_master >= 0) ::close(_master);
+    _slaveHold = -1;
+    _master = -1;
+    _slavePath[0] = '\0';
+    _pendingLen = 0;
+}
+
+size_t MaCO2Pty::pump() {
+    if (_master < 0) {
+        return 0;
+    }
+    size_t moved = 0;
+
+    // Client -> emulator (commands, handshake ACK)
+    uint8_t buf[64];
+    ssize_t n;
+    while ((n = ::read(_master, buf, sizeof(buf))) > 0) {
+        _emulator.write(buf, (size_t)n);
+        _bytesIn += n;
+        moved += n;
+    }
+
+    // Emulator -> client, as far as the pty takes it
+    if (_pendingLen == 0) {
+        while (_pendingLen < sizeof(_pending) && _emulator.available() > 0) {
+            _pending[_pendingLen++] = (uint8_t)_emulator.read();
+        }
+    }
+    if (_pendingLen > 0) {
+        n = ::write(_master, _pending, _pendingLen);
+        if (n > 0) {
+            memmove(_pending, _pending + n, _pendingLen - n);
+            _pendingLen -= n;
+            _bytesOut += n;
+            moved += n;
+        }
+    }
+    return moved;
+}
+
+// ============================================================================
+// FdStream
+// ============================================================================
+
+bool FdStream::open(const char* path) {
+    close();
+    _fd = ::open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (_fd < 0) {
+        return false;
+    }
+    makeRaw(_fd);
+    return true;
+}
+
+bool FdStream::attach(int fd) {
+    close();
+    const int flags = fcntl(fd, F_GETFL);
+    if (fd < 0 || flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0) {
+        return false;
+    }
+    _fd = fd;
+    return true;
+}
+
+void FdStream::close() {
+    if (_fd >= 0) ::close(_fd);
+    _fd = -1;
+    _peek = -1;
+    _eof = false;
+}
+
+bool FdStream::atEnd() {
+    if (_peek < 0 && !_eof) {
+        peek();                 // FIONREAD shows no end of file, read() does
+    }
+    return _eof && _peek < 0;
+}
+
+int FdStream::available() {
+    int n = 0;
+    if (_fd < 0 || ioctl(_fd, FIONREAD, &n) != 0) {
+        n = 0;
+    }
+    return n + (_peek >= 0 ? 1 : 0);
+}
+
+int FdStream::read() {
+    if (_peek >= 0) {
+        const int b = _peek;
+        _peek = -1;
+        return b;
+    }
+    uint8_t b;
+    const ssize_t n = (_fd >= 0) ? ::read(_fd, &b, 1) : -1;
+    if (n == 0) {
+        _eof = true;
+    }
+    return n == 1 ? b : -1;
+}
+
+int FdStream::peek() {
+    if (_peek < 0) {
+        _peek = read();
+    }
+    return _peek;
+}
+
+size_t FdStream::write(uint8_t b) {
+    return write(&b, 1);
+}
+
+size_t FdStream::write(const uint8_t* buf, size_t len) {
+    size_t done = 0;
+    while (_fd >= 0 && done < len) {
+        const ssize_t n = ::write(_fd, buf + done, len - done);
+        if (n > 0) {
+            done += n;
+        } else if (n < 0 && errno != EAGAIN && errno != EINTR) {
+            break;
+        }
+    }
+    return done;
+}
+
+#endif // ESP_PLATFORM
@@ -0,0 +1,122 @@
+// MetabolicCalc.cpp
+// Implementation of breath-by-breath indirect calorimetry
+//
+// Haldane transform (N2 is neither consumed nor produced):
+//   VI   = VE * (1 - FeO2 - FeCO2) / (1 - FiO2 - FiCO2)
+//   VO2  = VI * FiO2  - VE * FeO2
+//   VCO2 = VE * FeCO2 - VI * FiCO2
+// Energy expenditure (abbreviated Weir, L/min -> kcal/day):
+//   EE = (3.941 * VO2 + 1.106 * VCO2) * 1440
+// Volumes are taken as measured (ATP); no STPD/BTPS correction is applied.
+
+#include "MetabolicCalc.h"
+#include <string.h>
+
+// Haldane is ill-conditioned as FiO2 approaches 100%
+static const float MIN_HALDANE_DENOMINATOR = 0.02f;
+
+MetabolicCalc::MetabolicCalc() {
+    reset();
+}
+
+void MetabolicCalc::reset() {
+    resetWindow(_win30, 30000);
+    resetWindow(_win60, 60000);
+}
+
+bool MetabolicCalc::addBreath(const VolumetricBreath& breath) {
+    if (breath.period_ms <= 0.0f || breath.vte_ml <= 0.0f) {
+        return false;
+    }
+
+    const float denom = 1.0f - breath.fi_o2 - breath.fi_co2;
+    if (denom < MIN_HALDANE_DENOMINATOR) {
+        return false;
+    }
+
+    BreathGas gas;
+    gas.end_time = breath.end_time;
+    gas.duration_ms = breath.period_ms;
+    gas.ve = breath.vte_ml;
+
+    float vi = gas.ve * (1.0f - breath.fe_o2 - breath.fe_co2) / denom;
+    gas.vo2 = vi * breath.fi_o2 - gas.ve * breath.fe_o2;
+    gas.vco2 = gas.ve * breath.fe_co2 - vi * breath.fi_co2;
+
+    push(_win30, gas);
+    push(_win60, gas);
+    return true;
+}
+
+// Private helper functions
+
+void MetabolicCalc::resetWindow(Window& w, uint32_t length_ms) {
+    w.length_ms = length_ms;
+    w.head = 0;
+    w.count = 0;
+    w.sumDuration = 0.0f;
+    w.sumVE = 0.0f;
+    w.sumVO2 = 0.0f;
+    w.sumVCO2 = 0.0f;
+    memset(&w.result, 0, sizeof(w.result));
+}
+
+void MetabolicCalc::push(Window& w, const BreathGas& gas) {
+    if (w.count == WINDOW_CAPACITY) {
+        popOldest(w);
+    }
+
+    w.entries[w.head] = gas;
+    w.head = (w.head + 1) % WINDOW_CAPACITY;
+    w.count++;
+    w.sumDuration += gas.duration_ms;
+    w.sumVE += gas.ve;
+    w.sumVO2 += gas.vo2;
+    w.sumVCO2 += gas.vco2;
+
+    // Evict breaths that ended before the window start (keep at least one)
+    while (w.count > 1) {
+        const BreathGas& oldest = w.entries[(w.head + WINDOW_CAPACITY - w.count) % WINDOW_CAPACITY];
+        if (gas.end_time - oldest.end_time < w.length_ms) break;
+        popOldest(w);
+    }
+
+    computeResult(w);
+}
+
+void MetabolicCalc::popOldest(Window& w) {
+    if (w.count == 0) return;
+
+    const BreathGas& oldest = w.entries[(w.head + WINDOW_CAPACITY - w.count) % WINDOW_CAPACITY];
+    w.sumDuration -= oldest.duration_ms;
+    w.sumVE -= oldest.ve;
+    w.sumVO2 -= oldest.vo2;
+    w.sumVCO2 -= oldest.vco2;
+    w.count--;
+
+    // Drop accumulated rounding error whenever the window drains
+    if (w.count == 0) {
+        w.sumDuration = 0.0f;
+        w.sumVE = 0.0f;
+        w.sumVO2 = 0.0f;
+        w.sumVCO2 = 0.0f;
+    }
+}
+
+void MetabolicCalc::computeResult(Window& w) {
+    MetabolicResult& r = w.result;
+    r.breaths = w.count;
+
+    if (w.sumDuration <= 0.0f) {
+        memset(&r, 0, sizeof(r));
+        return;
+    }
+
+    // Rates over the time actually covered by the breaths in the window
+    const float per_min = 60000.0f / w.sumDuration;
+    r.vo2_ml_min = w.sumVO2 * per_min;
+    r.vco2_ml_min = w.sumVCO2 * per_min;
+    r.ve_l_min = w.sumVE * per_min / 1000.0f;
+    r.rq = (r.vo2_ml_min > 0.0f) ? r.vco2_ml_min / r.vo2_ml_min : 0.0f;
+    r.ee_kcal_day = (3.941f * r.vo2_ml_min + 1.106f * r.vco2_ml_min) / 1000.0f * 1440.0f;
+}
@@ -0,0 +1,473 @@
+// MicroBench.cpp
+// Implementation of the on-device microbenchmarks
+//
+// Allocation counting wraps malloc/calloc/realloc at link time
+// (-Wl,--wrap=...) and only counts calls made by the benchmarking task, so
+// other tasks allocating meanwhile (WiFi, AsyncTCP) do not show up. On the
+// host ([env:microbench]) the program defines malloc/calloc/realloc itself
+// in front of glibc's, counting calls from the benchmarking thread.
+
+#include "MicroBench.h"
+#include <new>
+#include "MaCO2Parser.h"
+#include "ADCManager.h"
+#include "DataLogger.h"
+#ifdef ESP_PLATFORM
+#include "WiFiManager.h"
+#endif
+#include "DisplayManager.h"
+#include "SampleTimeline.h"
+#include "SessionStore.h"
+#include "Clock.h"
+#include "Profiler.h"
+#include "HostLink.h"
+
+// ============================================================================
+// Allocation counting (MICROBENCH_COUNT_ALLOCS + linker wraps)
+// ============================================================================
+
+static TaskHandle_t benchTask = nullptr;    // Task being counted (nullptr: off)
+static uint32_t benchAllocs = 0;
+static uint32_t benchBytes = 0;
+
+#if defined(MICROBENCH_COUNT_ALLOCS) && defined(ESP_PLATFORM)
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    if (benchTask != nullptr && xTaskGetCurrentTaskHandle() == benchTask) {
+        benchAllocs++;
+        benchBytes += size;
+    }
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t n, size_t size) {
+    if (benchTask != nullptr && xTaskGetCurrentTaskHandle() == benchTask) {
+        benchAllocs++;
+        benchBytes += n * size;
+    }
+    return __real_calloc(n, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    if (benchTask != nullptr && xTaskGetCurrentTaskHandle() == benchTask) {
+        benchAllocs++;
+        benchBytes += size;
+    }
+    return __real_realloc(ptr, size);
+}
+}
+static const bool ALLOCS_COUNTED = true;
+#elif defined(MICROBENCH_COUNT_ALLOCS)
+// Set on the benchmarking thread only; looking up the task handle here
+// could allocate and recurse
+static thread_local bool benchThread = false;
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size) {
+    if (benchThread) {
+        benchAllocs++;
+        benchBytes += size;
+    }
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size) {
+    if (benchThread) {
+        benchAllocs++;
+        benchBytes += n * size;
+    }
+    return __libc_calloc(n, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    if (benchThread) {
+        benchAllocs++;
+        benchBytes += size;
+    }
+    return __libc_realloc(ptr, size);
+}
+}
+static const bool ALLOCS_COUNTED = true;
+#else
+static const bool ALLOCS_COUNTED = false;
+#endif
+
+#ifdef ESP_PLATFORM
+static const char* const BENCH_TARGET = "esp32-s3";
+#else
+static const char* const BENCH_TARGET = "native";    // cpu_mhz 1000: cycles are ns
+#endif
+
+// ============================================================================
+// Inputs
+// ============================================================================
+
+// Serves a byte pattern CHUNK bytes per poll, cycling through it
+class PatternStream : public Stream {
+public:
+    PatternStream(const uint8_t* data, uint16_t len, uint8_t chunk)
+        : _data(data), _len(len), _chunk(chunk), _pos(0), _avail(0) {}
+
+    void nextPoll() { _avail = _chunk; }
+
+    int available() override { return _avail; }
+    int read() override {
+        if (_avail == 0) return -1;
+        _avail--;
+        const uint8_t b = _data[_pos];
+        _pos = (_pos + 1) % _len;
+        return b;
+    }
+    int peek() override { return _avail ? _data[_pos] : -1; }
+    size_t write(uint8_t) override { return 1; }
+    using Print::write;
+
+private:
+    const uint8_t* _data;
+    uint16_t _len;
+    uint8_t _chunk;
+    uint16_t _pos;
+    uint8_t _avail;
+};
+
+// Discards output (formatting cost only)
+class NullStream : public Stream {
+public:
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    size_t write(uint8_t) override { return 1; }
+    size_t write(const uint8_t*, size_t len) override { return len; }
+    using Print::write;
+};
+
+// Slow triangle waves on every channel
+class RampSource : public ADCSampleSource {
+public:
+    RampSource() : _n(0) {}
+    uint16_t read(uint8_t channel) override {
+        _n++;
+        const uint16_t phase = (_n * (channel + 3)) & 0x1FFF;
+        return (phase < 0x1000) ? phase : 0x1FFF - phase;
+    }
+private:
+    uint32_t _n;
+};
+
+static void buildPacket(uint8_t* out, uint8_t wave, bool corrupt) {
+    out[0] = 0x06;
+    out[1] = 0x00;
+    out[2] = 12;
+    out[3] = 0;
+    out[4] = wave;
+    out[5] = 38;
+    out[6] = 0;
+    uint8_t sum = 0;
+    for (uint8_t i = 0; i < 7; i++) {
+        sum += out[i];
+    }
+    out[7] = corrupt ? sum ^ 0x5A : sum;
+}
+
+static void fillData(CO2Data& data, uint32_t i) {
+    memset(&data, 0, sizeof(data));
+    data.co2_waveform = 5 + (i % 35);
+    data.status1 = 6;
+    data.respiratory_rate = 12;
+    data.fco2 = 1;
+    data.fetco2 = 38;
+    data.sensors[SENSOR_O2].value = 20.9f;
+    data.sensors[SENSOR_O2].pic = 41000;
+    data.sensors[SENSOR_VOLUME].value = 450.0f;
+    data.sensors[SENSOR_VOLUME].pic = 512;
+    data.breath.etco2_x10 = 380;
+    data.breath.breath_count = i / 40;
+    data.timestamp_us = (uint64_t)i * 125000;
+    data.timestamp = i * 125;
+    data.valid = true;
+}
+
+// ============================================================================
+// MicroBench
+// ============================================================================
+
+MicroBench::MicroBench()
+    : _wifi(nullptr)
+    , _display(nullptr)
+    , _timeline(nullptr)
+    , _count(0)
+    , _codecSamples(0)
+    , _codecBytes(0)
+    , _codecRecorded(false)
+{
+    memset(_results, 0, sizeof(_results));
+}
+
+template<typename Fn>
+void MicroBench::measure(const char* name, uint32_t ops, Fn fn) {
+    if (_count >= MAX_RESULTS) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < 16; i++) {
+        fn(i);      // Warm-up (caches, lazy initialization)
+    }
+
+    benchAllocs = 0;
+    benchBytes = 0;
+    benchTask = xTaskGetCurrentTaskHandle();
+#if defined(MICROBENCH_COUNT_ALLOCS) && !defined(ESP_PLATFORM)
+    benchThread = true;
+#endif
+    const uint32_t start = ESP.getCycleCount();
+    for (uint32_t i = 0; i < ops; i++) {
+        fn(i);
+    }
+    const uint32_t cycles = ESP.getCycleCount() - start;
+#if defined(MICROBENCH_COUNT_ALLOCS) && !defined(ESP_PLATFORM)
+    benchThread = false;
+#endif
+    benchTask = nullptr;
+
+    BenchResult& r = _results[_count++];
+    r.name = name;
+    r.ops = ops;
+    r.ns_per_op = cycles * 1000.0f / ((float)ops * ESP.getCpuFreqMHz());
+    r.allocs_per_op = ALLOCS_COUNTED ? (float)benchAllocs / ops : -1.0f;
+    r.bytes_per_op = ALLOCS_COUNTED ? (float)benchBytes / ops : -1.0f;
+    yield();
+}
+
+void MicroBench::runAll(Print& out) {
+    _count = 0;
+    benchParser();
+    benchADC();
+    benchDataLogger();
+    benchJson();
+    benchDisplay();
+    benchSessionCodec();
+    Profiler::reset();      // Bench calls would skew the live profile
+
+    out.printf("{\"build\":\"%s %s\",\"target\":\"%s\",\"cpu_mhz\":%lu,\"allocs_counted\":%s,\"bench\":[",
+               __DATE__, __TIME__, BENCH_TARGET, (unsigned long)ESP.getCpuFreqMHz(),
+               ALLOCS_COUNTED ? "true" : "false");
+    for (uint8_t i = 0; i < _count; i++) {
+        const BenchResult& r = _results[i];
+        out.printf("%s{\"name\":\"%s\",\"ops\":%lu,\"ns_per_op\":%.1f",
+                   i ? "," : "", r.name, (unsigned long)r.ops, r.ns_per_op);
+        if (r.allocs_per_op >= 0.0f) {
+            out.printf(",\"allocs_per_op\":%.2f,\"bytes_per_op\":%.1f}", r.allocs_per_op, r.bytes_per_op);
+        } else {
+            out.print(",\"allocs_per_op\":null,\"bytes_per_op\":null}");
+        }
+    }
+    out.print(']');
+    if (_codecSamples > 0) {
+        out.printf(",\"session_codec\":{\"trace\":\"%s\",\"samples\":%u,\"bytes\":%lu,\"ratio\":%.1f}",
+                   _codecRecorded ? "timeline" : "synthetic", _codecSamples, (unsigned long)_codecBytes,
+                   (float)_codecSamples * (16 + 4 * SENSOR_COUNT) / _codecBytes);
+    }
+    out.println('}');
+}
+
+void MicroBench::benchParser() {
+    MaCO2Parser* parser = new (std::nothrow) MaCO2Parser();
+    if (parser == nullptr) {
+        return;
+    }
+    VirtualClock clock;
+    parser->setClock(&clock);
+    CO2Data data;
+    memset(&data, 0, sizeof(data));
+
+    // Clean stream: one packet per poll (byte ingestion, decode, breath
+    // detection, timestamping)
+    static uint8_t clean[16 * 8];
+    for (uint8_t k = 0; k < 16; k++) {
+        buildPacket(clean + k * 8, 5 + k * 2, false);
+    }
+    PatternStream cleanStream(clean, sizeof(clean), 8);
+    measure("parser_packet", 4000, [&](uint32_t) {
+        clock.advance(125000);
+        cleanStream.nextPoll();
+        parser->parsePacket(cleanStream, data);
+    });
+
+    // Damaged stream: bad checksums and stray bytes keep the parser in and
+    // out of sync search (op = one 8-byte poll). Includes the parser's
+    // "# Checksum fail" lines as in the field, hence fewer ops.
+    static uint8_t noisy[16 * 8 + 6];
+    for (uint8_t k = 0; k < 16; k++) {
+        buildPacket(noisy + k * 8, 5 + k * 2, (k % 4) == 1);
+    }
+    noisy[16 * 8 + 0] = 0x06;       // False headers between packets
+    noisy[16 * 8 + 1] = 0x3C;
+    noisy[16 * 8 + 2] = 0x06;
+    noisy[16 * 8 + 3] = 0xFF;
+    noisy[16 * 8 + 4] = 0x00;
+    noisy[16 * 8 + 5] = 0x06;
+    PatternStream noisyStream(noisy, sizeof(noisy), 8);
+    measure("parser_resync", 500, [&](uint32_t) {
+        clock.advance(125000);
+        noisyStream.nextPoll();
+        parser->parsePacket(noisyStream, data);
+    });
+
+    delete parser;
+}
+
+void MicroBench::benchADC() {
+    // Own instance: the live one's filters and packet accumulation stay intact
+    ADCManager* adc = new (std::nothrow) ADCManager();
+    if (adc == nullptr) {
+        HostLog.println("# Bench: not enough heap for the ADC benchmark");
+        return;
+    }
+    RampSource source;
+    adc->begin();
+    adc->setSampleSource(&source);
+    adc->setLinearCalibration(SENSOR_O2, 0.0, 0.0, 1.0, 100.0);
+    adc->setLinearCalibration(SENSOR_VOLUME, 0.0, 0.0, 1.0, 200.0);
+    adc->setFilterSize(5);
+
+    CO2Data data;
+    memset(&data, 0, sizeof(data));
+    measure("adc_update", 4000, [&](uint32_t) {
+        adc->update(data);      // Read, moving average, calibration lookups
+    });
+
+    delete adc;
+}
+
+void MicroBench::benchDataLogger() {
+    DataLogger logger;
+    CO2Data data;
+    char buffer[64];
+    measure("pic_format", 4000, [&](uint32_t i) {
+        fillData(data, i);
+        logger.formatPICPacket(buffer, sizeof(buffer), data);
+    });
+
+    NullStream sink;
+    measure("ascii_format", 4000, [&](uint32_t i) {
+        fillData(data, i);
+        logger.sendTabSeparated(sink, data);
+    });
+}
+
+// Device only: WiFiManager (AsyncWebServer) has no host build
+void MicroBench::benchJson() {
+#ifdef ESP_PLATFORM
+    if (_wifi == nullptr) {
+        return;
+    }
+    CO2Data data;
+    size_t length = 0;
+    measure("ws_json", 1000, [&](uint32_t i) {
+        fillData(data, i);
+        length += _wifi->dataToJson(data).length();
+    });
+#endif
+}
+
+void MicroBench::benchDisplay() {
+    if (_display == nullptr || _display->_timeline == nullptr) {
+        return;
+    }
+    // Deterministic in the timeline contents, so running it on the live
+    // display gives the scale the next frame would compute anyway
+    measure("waveform_scale", 4000, [&](uint32_t) {
+        _display->updateWaveformScale();
+    });
+}
+
+void MicroBench::benchSessionCodec() {
+    // Trace: what the timeline holds (up to ~64 s recorded live), or a
+    // synthetic one while it has less than a few blocks
+    static const uint16_t TRACE = SampleTimeline::CAPACITY;
+    static const uint16_t MAX_BLOCKS = TRACE / SessionEncoder::BLOCK_RECORDS + 1;
+    static const uint32_t CAPACITY = (uint32_t)TRACE * (16 + 4 * SENSOR_COUNT);  // Raw size
+    SessionRecord* trace = new (std::nothrow) SessionRecord[TRACE];
+    SessionEncoder* encoder = new (std::nothrow) SessionEncoder();
+    uint8_t* encoded = new (std::nothrow) uint8_t[CAPACITY + SessionEncoder::MAX_BLOCK];
+    uint16_t* offsets = new (std::nothrow) uint16_t[MAX_BLOCKS + 1];
+    if (trace == nullptr || encoder == nullptr || encoded == nullptr || offsets == nullptr) {
+        HostLog.println("# Bench: not enough heap for the session codec benchmark");
+        delete[] trace;
+        delete encoder;
+        delete[] encoded;
+        delete[] offsets;
+        return;
+    }
+
+    CO2Data data;
+    memset(&data, 0, sizeof(data));
+    uint16_t n = 0;
+    if (_timeline != nullptr) {
+        TimelineCursor cursor = _timeline->attach(true);
+        while (n < TRACE && _timeline->read(cursor, data)) {
+            SessionStore::fromData(data, trace[n++]);
+        }
+    }
+    _codecRecorded = n >= 4 * SessionEncoder::BLOCK_RECORDS;
+    if (!_codecRecorded) {
+        for (n = 0; n < TRACE; n++) {
+            fillData(data, n);
+            SessionStore::fromData(data, trace[n]);
+        }
+    }
+
+    // Compressed trace, kept for the decode benchmark (an incompressible
+    // trace is cut where it outgrows its raw size)
+    uint16_t blocks = 0;
+    uint32_t bytes = 0;
+    offsets[0] = 0;
+    _codecSamples = 0;
+    for (uint16_t i = 0; i < n; i++) {
+        if (!encoder->add(trace[i]) && i < n - 1) {
+            continue;
+        }
+        const uint8_t records = encoder->pending();
+        const size_t len = encoder->finishBlock(encoded + bytes);
+        if (bytes + len > CAPACITY) {
+            break;
+        }
+        bytes += len;
+        offsets[++blocks] = bytes;
+        _codecSamples += records;
+    }
+    _codecBytes = bytes;
+
+    // op = one sample; a block is encoded on every 32nd
+    uint8_t* block = encoded + bytes;       // Spare MAX_BLOCK at the end
+    measure("session_encode", 4096, [&](uint32_t i) {
+        if (encoder->add(trace[i % n])) {
+            encoder->finishBlock(block);
+        }
+    });
+    encoder->finishBlock(block);
+
+    // op = one sample; a block is decoded on its first
+    SessionRecord rows[SessionEncoder::BLOCK_RECORDS];
+    if (blocks > 0) {
+        measure("session_decode", 4096, [&](uint32_t i) {
+            if (i % SessionEncoder::BLOCK_RECORDS == 0) {
+                const uint16_t b = (i / SessionEncoder::BLOCK_RECORDS) % blocks;
+                SessionDecoder::decodeBlock(encoded + offsets[b], offsets[b + 1] - offsets[b], rows);
+            }
+        });
+    }
+
+    delete[] trace;
+    delete encoder;
+    delete[] encoded;
+    delete[] offsets;
+}
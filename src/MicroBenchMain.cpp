@@ -0,0 +1,105 @@
+// MicroBenchMain.cpp
+// Host microbenchmark program ([env:microbench] only)
+//
+//   program [results.json]
+//
+// Records 64 s of emulator data through the parser, ADC and timeline on a
+// VirtualClock (the session codec trace and the waveform the display
+// scales), then runs MicroBench and prints its JSON line to stdout, and to
+// the file if one is given, so runs on two commits can be diffed.
+
+#ifdef MICROBENCH_MAIN
+
+#include <Arduino.h>
+#include <math.h>
+#include <stdio.h>
+#include "MicroBench.h"
+#include "MaCO2Emulator.h"
+#include "MaCO2Parser.h"
+#include "ADCManager.h"
+#include "DisplayManager.h"
+#include "SampleTimeline.h"
+
+// O2 falls as CO2 rises, volume swings at 12 breaths/min (as the 'B' bench)
+class TraceAnalogSource : public ADCSampleSource {
+public:
+    uint16_t co2 = 0;
+    uint32_t packet = 0;
+    uint16_t read(uint8_t channel) override {
+        if (channel == SENSOR_O2) {
+            return (uint16_t)constrain(1800 - 8 * (int)co2, 0, 4095);
+        }
+        return (uint16_t)(2048 + 1200.0f * sinf(packet * (6.2831853f / 40)));
+    }
+};
+
+// JSON line to stdout and the results file (Serial is muted: log text
+// from the benchmarked code stays out of the JSON)
+class TeePrint : public Print {
+public:
+    explicit TeePrint(FILE* file) : _file(file) {}
+    size_t write(uint8_t c) override {
+        fputc(c, stdout);
+        if (_file != nullptr) fputc(c, _file);
+        return 1;
+    }
+    using Print::write;
+
+private:
+    FILE* _file;
+};
+
+int main(int argc, char** argv) {
+    Serial.setMuted(true);
+    VirtualClock clock;
+    MaCO2Emulator emulator;
+    MaCO2Parser parser;
+    ADCManager adc;
+    TraceAnalogSource analog;
+    SampleTimeline timeline;
+    DisplayManager display;
+
+    EmulatorConfig config = MaCO2Emulator::defaultConfig();
+    config.handshake = false;
+    emulator.setClock(&clock);
+    parser.setClock(&clock);
+    emulator.begin(config);
+    adc.setSampleSource(&analog);
+    adc.begin();
+
+    CO2Data data;
+    memset(&data, 0, sizeof(data));
+    for (uint32_t t = 0; t < 64000; t += 100) {
+        clock.advance(100000);
+        while (parser.parsePacket(emulator, data)) {
+            analog.co2 = data.co2_waveform;
+            analog.packet++;
+            adc.update(data);
+            timeline.push(data);
+        }
+    }
+
+    display.setClock(&clock);
+    display.setTimeline(&timeline);
+    display.begin();
+
+    FILE* file = nullptr;
+    if (argc > 1) {
+        file = fopen(argv[1], "w");
+        if (file == nullptr) {
+            perror(argv[1]);
+            return 1;
+        }
+    }
+    TeePrint out(file);
+    MicroBench bench;
+    bench.setDisplayManager(&display);
+    bench.setTimeline(&timeline);
+    bench.runAll(out);
+    if (file != nullptr) {
+        fclose(file);
+    }
+    return 0;
+}
+
+#endif // MICROBENCH_MAIN
@@ -0,0 +1,66 @@
+// NVSCalibrationStore.cpp
+// Implementation of NVS-backed calibration profiles
+
+#include "NVSCalibrationStore.h"
+#include "HostLink.h"
+
+static const char* NVS_NAMESPACE = "calib";
+static const char* NVS_ACTIVE_KEY = "@active";   // '@' never occurs in a serial
+
+NVSCalibrationStore::NVSCalibrationStore() {
+}
+
+bool NVSCalibrationStore::save(const CalibrationProfile& profile) {
+    if (!isValidProfile(profile) || !isValidSerial(profile.serial)) {
+        return false;
+    }
+    if (!_prefs.begin(NVS_NAMESPACE, false)) {
+        return false;
+    }
+    size_t written = _prefs.putBytes(profile.serial, &profile, sizeof(profile));
+    _prefs.end();
+
+    if (written != sizeof(profile)) {
+        HostLog.printf("Calibration: failed to save profile '%s'\n", profile.serial);
+        return false;
+    }
+    HostLog.printf("Calibration: saved profile '%s'\n", profile.serial);
+    return true;
+}
+
+bool NVSCalibrationStore::load(const char* serial, CalibrationProfile& profile) {
+    if (!isValidSerial(serial)) return false;
+    if (!_prefs.begin(NVS_NAMESPACE, true)) return false;
+
+    bool ok = _prefs.getBytesLength(serial) == sizeof(profile) &&
+              _prefs.getBytes(serial, &profile, sizeof(profile)) == sizeof(profile);
+    _prefs.end();
+
+    return ok && isValidProfile(profile) && strcmp(profile.serial, serial) == 0;
+}
+
+bool NVSCalibrationStore::remove(const char* serial) {
+    if (!isValidSerial(serial)) return false;
+    if (!_prefs.begin(NVS_NAMESPACE, false)) return false;
+
+    bool ok = _prefs.remove(serial);
+    _prefs.end();
+    return ok;
+}
+
+bool NVSCalibrationStore::setActive(const char* serial) {
+    if (!isValidSerial(serial)) return false;
+    if (!_prefs.begin(NVS_NAMESPACE, false)) return false;
+
+    bool ok = _prefs.putString(NVS_ACTIVE_KEY, serial) > 0;
+    _prefs.end();
+    return ok;
+}
+
+bool NVSCalibrationStore::getActive(char* serial, uint8_t max_len) {
+    if (!_prefs.begin(NVS_NAMESPACE, true)) return false;
+
+    size_t n = _prefs.getString(NVS_ACTIVE_KEY, serial, max_len);
+    _prefs.end();
+    return n > 0 && isValidSerial(serial);
+}
@@ -0,0 +1,183 @@
+// PacketTimestamper.cpp
+// Implementation of cadence-locked packet timestamps
+//
+// Approach:
+// - A raw arrival estimate can only be late: the loop parses packets up to
+//   ~100 ms after they arrived and the back-dating cannot see that idle time.
+//   The true cadence is therefore the lower envelope of the estimates.
+// - Over the last WINDOW packets, the period comes from the lowest point of
+//   the older and of the newer half, and the phase from the line through the
+//   lowest point overall. Polling at a different rate than 8 Hz makes the
+//   delay sweep through ~0 every second or so, so the envelope is tight.
+// - The output advances by whole periods and slews towards the fitted line
+//   (quickly down, slowly up), so it is smooth and strictly increasing.
+// - The packet index comes from the parser's byte count, not from the
+//   (up to ~0.94 period late) arrival times. An arrival that is later than
+//   that allows means the sensor paused, and like gaps over 5 s re-acquires.
+
+#include "PacketTimestamper.h"
+#include <string.h>
+#include <math.h>
+
+PacketTimestamper::PacketTimestamper(uint32_t baud, uint8_t packet_bytes, uint32_t period_us)
+    : _byteUs_x16((uint32_t)(10ULL * 1000000ULL * 16 / baud))
+    , _packetBytes(packet_bytes)
+    , _nominalPeriodUs((float)period_us)
+    , _lastNowUs(0)
+    , _wraps(0)
+{
+    reset();
+}
+
+void PacketTimestamper::reset() {
+    _locked = false;
+    _lastTimeUs = 0;
+    _lastArrivalUs = 0;
+    _phaseUs = 0.0f;
+    _periodUs = _nominalPeriodUs;
+    _cadenceIndex = 0;
+    _head = 0;
+    _count = 0;
+    _rawVar = 0.0f;
+    _outVar = 0.0f;
+    _residualVar = 0.0f;
+    memset(&_stats, 0, sizeof(_stats));
+    _stats.period_us = _periodUs;
+}
+
+int64_t PacketTimestamper::estimateArrival(uint32_t now_us, uint32_t queued) {
+    // Extend micros() to 64 bits (called at least every 71 min)
+    if (now_us < _lastNowUs) {
+        _wraps++;
+    }
+    _lastNowUs = now_us;
+    const int64_t now = ((int64_t)_wraps << 32) | now_us;
+    
+    // Queued bytes: whole packets behind ours, plus a partial one
+    const uint32_t full = queued / _packetBytes;
+    const uint32_t partial = queued % _packetBytes;
+    float back_us = full * _periodUs;
+    if (partial > 0) {
+        // The newest byte is byte 'partial' of the packet after those
+        back_us += _periodUs - (float)((_packetBytes - partial) * _byteUs_x16) / 16.0f;
+    }
+    return now - (int64_t)back_us;
+}
+
+int64_t PacketTimestamper::relock(int64_t arrival_us) {
+    // Never step back: downstream (breath timing) assumes increasing time
+    if (_stats.packets > 1 && arrival_us <= _lastTimeUs) {
+        arrival_us = _lastTimeUs + 1;
+    }
+    _locked = true;
+    _lastTimeUs = arrival_us;
+    _lastArrivalUs = arrival_us;
+    _phaseUs = 0.0f;
+    _cadenceIndex = 0;
+
+    // The packet is the first point of the new fit window
+    _arrival[0] = arrival_us;
+    _index[0] = 0;
+    _head = 1;
+    _count = 1;
+    return _lastTimeUs;
+}
+
+void PacketTimestamper::fitEnvelope(float& period_us, float& offset_us) const {
+    // Offsets from the newest point along the current period (within 16 s,
+    // so float keeps ~1 us resolution)
+    const uint8_t newest = (_head + WINDOW - 1) % WINDOW;
+    const int64_t a0 = _arrival[newest];
+    const uint32_t k0 = _index[newest];
+    const uint8_t half = _count / 2;
+    
+    float minAll = 0.0f;
+    float minOld = 1e30f, minNew = 1e30f;
+    int32_t kOld = 0, kNew = 0;
+    for (uint8_t i = 0; i < _count; i++) {
+        const uint8_t slot = (_head + WINDOW - _count + i) % WINDOW;   // Oldest first
+        const int32_t k = (int32_t)(_index[slot] - k0);                 // <= 0
+        const float d = (float)(_arrival[slot] - a0) - k * period_us;
+        if (d < minAll) minAll = d;
+        if (i < half) {
+            if (d < minOld) { minOld = d; kOld = k; }
+        } else {
+            if (d < minNew) { minNew = d; kNew = k; }
+        }
+    }
+    
+    // Period: slope between the two half-window minima
+    if (_count >= MIN_FIT && kNew > kOld) {
+        period_us += (minNew - minOld) / (float)(kNew - kOld);
+    }
+    offset_us = minAll;
+}
+
+float PacketTimestamper::average(float mean, float x) {
+    return mean + (x - mean) / (float)(1 << STATS_SHIFT);
+}
+
+int64_t PacketTimestamper::addPacket(int64_t arrival_us, uint32_t periods) {
+    _stats.packets++;
+    
+    if (!_locked) {
+        return relock(arrival_us);
+    }
+    
+    const int32_t n = (periods < 1) ? 1 : (int32_t)periods;
+    const float x = (float)(arrival_us - _lastTimeUs) - _phaseUs;
+    
+    if ((uint32_t)n > RELOCK_GAP_PACKETS || x < 0.0f ||
+        x > (n + RELOCK_LATE) * _periodUs) {
+        // Sensor paused or restarted, long outage, clock jump: start over
+        _stats.relocks++;
+        return relock(arrival_us);
+    }
+    _stats.missed += n - 1;
+    _cadenceIndex += n;
+    
+    _arrival[_head] = arrival_us;
+    _index[_head] = _cadenceIndex;
+    _head = (_head + 1) % WINDOW;
+    if (_count < WINDOW) _count++;
+    
+    // Fit the lower envelope, smooth the period
+    float fitPeriod = _periodUs;
+    float offset = 0.0f;
+    fitEnvelope(fitPeriod, offset);
+    const float predicted = n * _periodUs;
+    _periodUs += (fitPeriod - _periodUs) / (float)(1 << PERIOD_SHIFT);
+    const float lo = _nominalPeriodUs * (1.0f - PERIOD_TOLERANCE);
+    const float hi = _nominalPeriodUs * (1.0f + PERIOD_TOLERANCE);
+    if (_periodUs < lo) _periodUs = lo;
+    if (_periodUs > hi) _periodUs = hi;
+    
+    // Slew towards the fitted line: quickly down, slowly up
+    const float target = x + offset;
+    float correction = target - predicted;
+    const float maxDown = _periodUs / 4;
+    const float maxUp = _periodUs / (float)(1 << SLEW_SHIFT);
+    if (correction < -maxDown) correction = -maxDown;
+    if (correction > maxUp) correction = maxUp;
+    const float step = predicted + correction;
+    
+    // Statistics (interval deviations against whole periods)
+    const float rawDev = (float)(arrival_us - _lastArrivalUs) - predicted;
+    const float outDev = step - predicted;
+    _rawVar = average(_rawVar, rawDev * rawDev);
+    _outVar = average(_outVar, outDev * outDev);
+    _residualVar = average(_residualVar, (x - step) * (x - step));
+    
+    // Advance, keeping the sub-microsecond part
+    const float next = _phaseUs + step;
+    const int64_t whole = (int64_t)floorf(next);
+    _lastTimeUs += whole;
+    _phaseUs = next - (float)whole;
+    _lastArrivalUs = arrival_us;
+    
+    _stats.period_us = _periodUs;
+    _stats.raw_jitter_us = sqrtf(_rawVar);
+    _stats.jitter_us = sqrtf(_outVar);
+    _stats.residual_us = sqrtf(_residualVar);
+    return _lastTimeUs;
+}
@@ -0,0 +1,167 @@
+// Profiler.cpp
+// Histograms and reports for the profiling scopes
+
+#include "Profiler.h"
+#ifndef ESP_PLATFORM
+#include <chrono>
+#endif
+
+static const char* const POINT_NAMES[PROF_POINT_COUNT] = {
+    "maco2_parse",
+    "adc_update",
+    "display_update",
+    "web_update",
+    "host_output"
+};
+
+const char* Profiler::pointName(ProfilePoint point) {
+    return (point < PROF_POINT_COUNT) ? POINT_NAMES[point] : "?";
+}
+
+#ifdef PROFILING
+
+struct ProfileHistogram {
+    uint32_t count;
+    uint64_t sum;
+    uint32_t min;
+    uint32_t max;
+    uint32_t buckets[Profiler::BUCKETS];
+};
+
+static ProfileHistogram histograms[PROF_POINT_COUNT];
+static volatile bool resetPending = false;
+
+bool Profiler::isEnabled() {
+    return true;
+}
+
+void Profiler::record(ProfilePoint point, uint32_t ticks) {
+    if (resetPending) {
+        memset(histograms, 0, sizeof(histograms));
+        resetPending = false;
+    }
+    ProfileHistogram& h = histograms[point];
+    if (h.count == 0 || ticks < h.min) h.min = ticks;
+    if (ticks > h.max) h.max = ticks;
+    h.count++;
+    h.sum += ticks;
+    h.buckets[bucketOf(ticks)]++;
+}
+
+void Profiler::reset() {
+    resetPending = true;
+}
+
+bool Profiler::getSummary(ProfilePoint point, ProfileSummary& summary) {
+    const ProfileHistogram& h = histograms[point];
+    const float scale = 1.0f / ticksPerUs();
+    memset(&summary, 0, sizeof(summary));
+    summary.name = POINT_NAMES[point];
+    summary.count = h.count;
+    if (h.count == 0) {
+        return false;
+    }
+    summary.min_us = h.min * scale;
+    summary.max_us = h.max * scale;
+    summary.avg_us = (float)h.sum / h.count * scale;
+
+    // Walk the histogram to the 50th / 99th percentile rank (capped at max,
+    // since a bucket edge can lie above the largest sample)
+    const uint32_t rank50 = (h.count + 1) / 2;
+    const uint32_t rank99 = h.count - h.count / 100;
+    uint32_t seen = 0;
+    for (uint8_t b = 0; b < BUCKETS; b++) {
+        if (h.buckets[b] == 0) continue;
+        const uint32_t before = seen;
+        seen += h.buckets[b];
+        const uint32_t top = (bucketTop(b) < h.max) ? bucketTop(b) : h.max;
+        if (before < rank50 && seen >= rank50) summary.p50_us = top * scale;
+        if (before < rank99 && seen >= rank99) {
+            summary.p99_us = top * scale;
+            break;
+        }
+    }
+    return true;
+}
+
+#else
+
+bool Profiler::isEnabled() {
+    return false;
+}
+
+void Profiler::record(ProfilePoint, uint32_t) {}
+
+void Profiler::reset() {}
+
+bool Profiler::getSummary(ProfilePoint point, ProfileSummary& summary) {
+    memset(&summary, 0, sizeof(summary));
+    summary.name = POINT_NAMES[point];
+    return false;
+}
+
+#endif
+
+void Profiler::printReport(Print& out) {
+    if (!isEnabled()) {
+        out.println("# Profiler disabled (build with -DPROFILING=1)");
+        return;
+    }
+    out.println("# Profile (us)     count      min      avg      p50      p99      max");
+    for (uint8_t p = 0; p < PROF_POINT_COUNT; p++) {
+        ProfileSummary s;
+        getSummary((ProfilePoint)p, s);
+        out.printf("# %-15s %7lu %8.1f %8.1f %8.1f %8.1f %8.1f\n", s.name, (unsigned long)s.count,
+                   s.min_us, s.avg_us, s.p50_us, s.p99_us, s.max_us);
+    }
+}
+
+void Profiler::printJson(Print& out) {
+    out.printf("{\"enabled\":%s,\"points\":[", isEnabled() ? "true" : "false");
+    for (uint8_t p = 0; isEnabled() && p < PROF_POINT_COUNT; p++) {
+        ProfileSummary s;
+        getSummary((ProfilePoint)p, s);
+        out.printf("%s{\"name\":\"%s\",\"count\":%lu,\"min_us\":%.1f,\"avg_us\":%.1f,"
+                   "\"p50_us\":%.1f,\"p99_us\":%.1f,\"max_us\":%.1f}",
+                   p ? "," : "", s.name, (unsigned long)s.count,
+                   s.min_us, s.avg_us, s.p50_us, s.p99_us, s.max_us);
+    }
+    out.print("]}");
+}
+
+uint64_t Profiler::nanos() {
+#ifdef ESP_PLATFORM
+    return (uint64_t)micros() * 1000;
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+float Profiler::ticksPerUs() {
+#ifdef ESP_PLATFORM
+    return (float)ESP.getCpuFreqMHz();
+#else
+    return 1000.0f;
+#endif
+}
+
+uint8_t Profiler::bucketOf(uint32_t ticks) {
+    // 0-3 exact, then SUB_BUCKETS per power of two: [4,5), [5,6), ... [7,8),
+    // [8,10), [10,12), ...
+    if (ticks < SUB_BUCKETS) {
+        return (uint8_t)ticks;
+    }
+    const uint8_t msb = 31 - __builtin_clz(ticks);
+    return (uint8_t)(SUB_BUCKETS * (msb - 1) + ((ticks >> (msb - 2)) & (SUB_BUCKETS - 1)));
+}
+
+uint32_t Profiler::bucketTop(uint8_t bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    const uint8_t msb = bucket / SUB_BUCKETS + 1;
+    const uint32_t width = 1UL << (msb - 2);
+    const uint32_t low = (uint32_t)(SUB_BUCKETS + bucket % SUB_BUCKETS) << (msb - 2);
+    return low + (width - 1);
+}
@@ -0,0 +1,237 @@
+// ReplayBench.cpp
+// Implementation of the capture replay benchmark
+
+#include "ReplayBench.h"
+#include <new>
+#include "MaCO2Parser.h"
+#include "ADCManager.h"
+#include "VolumetricCapno.h"
+#include "MetabolicCalc.h"
+#include "SampleTimeline.h"
+#include "DataLogger.h"
+
+static const char* const BENCH_STAGE_NAMES[BENCH_STAGE_COUNT] = {
+    "parse", "adc", "capno", "timeline", "output"
+};
+
+// FNV-1a over the decoded fields, to compare a replay with a golden run
+static uint32_t digestAdd(uint32_t hash, const void* data, size_t len) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ bytes[i]) * 16777619UL;
+    }
+    return hash;
+}
+
+// Host output of the bench: every byte goes into a digest
+class DigestStream : public Stream {
+public:
+    uint32_t digest = 2166136261UL;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    size_t write(uint8_t b) override {
+        digest = digestAdd(digest, &b, 1);
+        return 1;
+    }
+    size_t write(const uint8_t* buffer, size_t len) override {
+        digest = digestAdd(digest, buffer, len);
+        return len;
+    }
+    using Print::write;
+};
+
+// Analog inputs of the bench, reproducible from the packets: O2 dips as
+// CO2 rises, volume follows a 12/min breathing cycle in packet time
+class BenchAnalogSource : public ADCSampleSource {
+public:
+    uint16_t co2 = 0;
+    uint32_t packet = 0;
+    uint16_t read(uint8_t channel) override {
+        if (channel == SENSOR_O2) {
+            return (uint16_t)constrain(1800 - 8 * (int)co2, 0, 4095);
+        }
+        return (uint16_t)(2048 + 1200.0f * sinf(packet * (6.2831853f / 40)));
+    }
+};
+
+static inline void benchTime(ReplayBenchResult& r, uint8_t stage, uint32_t since) {
+    const uint32_t cycles = ESP.getCycleCount() - since;
+    r.stageCycles[stage] += cycles;
+    if (cycles > r.stageMaxCycles[stage]) r.stageMaxCycles[stage] = cycles;
+}
+
+const char* ReplayBench::stageName(uint8_t stage) {
+    return stage < BENCH_STAGE_COUNT ? BENCH_STAGE_NAMES[stage] : "?";
+}
+
+bool ReplayBench::run(Stream& capture, ReplayMode mode, Clock& clock, Print& out) {
+    memset(&_result, 0, sizeof(_result));
+    ReplayBenchResult& r = _result;
+
+    // Recorded time runs on a virtual clock, so parser timeouts and
+    // timestamps match the original run
+    VirtualClock virtualClock;
+    UartReplay replay(capture);
+    replay.setClock(&virtualClock);
+    if (!replay.begin(mode)) {
+        return false;
+    }
+
+    // Own pipeline so the live breath / timestamp / calorimetry state is
+    // untouched
+    MaCO2Parser* parser = new (std::nothrow) MaCO2Parser();
+    ADCManager* adc = new (std::nothrow) ADCManager();
+    VolumetricCapno* capno = new (std::nothrow) VolumetricCapno();
+    MetabolicCalc* metabolic = new (std::nothrow) MetabolicCalc();
+    SampleTimeline* timeline = new (std::nothrow) SampleTimeline();
+    DataLogger* logger = new (std::nothrow) DataLogger();
+    if (!parser || !adc || !capno || !metabolic || !timeline || !logger) {
+        out.println("# Bench: not enough heap for the replay pipeline");
+        delete parser;
+        delete adc;
+        delete capno;
+        delete metabolic;
+        delete timeline;
+        delete logger;
+        return false;
+    }
+    BenchAnalogSource analog;
+    DigestStream output;
+    parser->setClock(&virtualClock);
+    adc->setSampleSource(&analog);
+    adc->begin();
+    logger->setOutputFormat(FORMAT_TAB_SEPARATED);
+    logger->setTimeline(timeline);
+    CO2Data data;
+    memset(&data, 0, sizeof(data));
+
+    for (uint8_t i = 0; i < BENCH_STAGE_COUNT; i++) r.digest[i] = 2166136261UL;
+    const uint32_t start = clock.micros();
+
+    while (replay.update()) {
+        if (mode == REPLAY_FAST) {
+            virtualClock.set(replay.getTime());
+        } else {
+            virtualClock.advance(POLL_INTERVAL_US);
+        }
+        const uint32_t t0 = clock.micros();
+        uint8_t got = 0;
+        for (;;) {
+            uint32_t c = ESP.getCycleCount();
+            if (got >= MAX_PACKETS_PER_POLL || !parser->parsePacket(replay, data)) {
+                break;
+            }
+            benchTime(r, BENCH_PARSE, c);
+            got++;
+            const uint8_t fields[] = {
+                (uint8_t)data.co2_waveform, data.status1, data.status2,
+                data.respiratory_rate, data.fco2, data.fetco2, data.valid
+            };
+            r.digest[BENCH_PARSE] = digestAdd(r.digest[BENCH_PARSE], fields, sizeof(fields));
+            r.digest[BENCH_PARSE] = digestAdd(r.digest[BENCH_PARSE], &data.breath, sizeof(data.breath));
+            r.digest[BENCH_PARSE] = digestAdd(r.digest[BENCH_PARSE], &data.timestamp_us, sizeof(data.timestamp_us));
+
+            c = ESP.getCycleCount();
+            analog.co2 = data.co2_waveform;
+            analog.packet = parser->getPacketCount();
+            adc->update(data);
+            benchTime(r, BENCH_ADC, c);
+            for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+                r.digest[BENCH_ADC] = digestAdd(r.digest[BENCH_ADC], &data.sensors[ch].value, sizeof(float));
+                r.digest[BENCH_ADC] = digestAdd(r.digest[BENCH_ADC], &data.sensors[ch].pic, sizeof(uint16_t));
+            }
+
+            c = ESP.getCycleCount();
+            if (capno->addSample(data.co2_waveform, data.sensors[SENSOR_VOLUME].value,
+                                 data.timestamp, data.sensors[SENSOR_O2].value)) {
+                metabolic->addBreath(capno->getLastBreath());
+                data.metabolic60s = metabolic->get60s();
+                r.breaths++;
+            }
+            data.vcap = capno->getLastBreath();
+            benchTime(r, BENCH_CAPNO, c);
+            r.digest[BENCH_CAPNO] = digestAdd(r.digest[BENCH_CAPNO], &data.vcap, sizeof(data.vcap));
+            r.digest[BENCH_CAPNO] = digestAdd(r.digest[BENCH_CAPNO], &data.metabolic60s,
+                                              offsetof(MetabolicResult, breaths));
+
+            c = ESP.getCycleCount();
+            timeline->push(data);
+            benchTime(r, BENCH_TIMELINE, c);
+
+            c = ESP.getCycleCount();
+            logger->update(output, data);
+            benchTime(r, BENCH_OUTPUT, c);
+        }
+        const uint32_t dt = clock.micros() - t0;
+        r.polls++;
+        r.pollTotalUs += dt;
+        if (dt > r.pollMaxUs) r.pollMaxUs = dt;
+        if ((r.polls & 63) == 0) {
+            yield();
+        }
+    }
+    r.digest[BENCH_OUTPUT] = output.digest;
+    // The timeline stage is covered by the output, which reads it back
+    r.digest[BENCH_TIMELINE] = digestAdd(r.digest[BENCH_TIMELINE], &r.digest[BENCH_OUTPUT], sizeof(uint32_t));
+
+    r.elapsed_us = clock.micros() - start;
+    r.packets = parser->getPacketCount();
+    r.errors = parser->getErrorCount();
+    const CaptureStats& stats = replay.getStats();
+    r.bytes = stats.bytes;
+    r.duration_us = stats.duration_us;
+
+    out.printf("# Bench (%s): %lu bytes, %lu packets (%lu errors, %lu breaths) from %.1f s of capture in %lu ms (%.0fx real time)\n",
+               mode == REPLAY_FAST ? "fast" : "real time",
+               (unsigned long)r.bytes, (unsigned long)r.packets,
+               (unsigned long)r.errors, (unsigned long)r.breaths,
+               r.duration_us / 1e6, (unsigned long)(r.elapsed_us / 1000),
+               r.elapsed_us > 0 ? (float)r.duration_us / r.elapsed_us : 0.0f);
+    out.printf("# Bench: %.0f bytes/s, pipeline %lu us/poll (max %lu)\n",
+               r.elapsed_us > 0 ? r.bytes * 1e6f / r.elapsed_us : 0.0f,
+               (unsigned long)(r.polls > 0 ? r.pollTotalUs / r.polls : 0), (unsigned long)r.pollMaxUs);
+    const float mhz = (float)ESP.getCpuFreqMHz();
+    for (uint8_t i = 0; i < BENCH_STAGE_COUNT; i++) {
+        out.printf("# Bench: %-8s %7.2f us/packet (max %7.2f)  digest 0x%08lX\n",
+                   BENCH_STAGE_NAMES[i],
+                   r.packets > 0 ? r.stageCycles[i] / mhz / r.packets : 0.0f,
+                   r.stageMaxCycles[i] / mhz, (unsigned long)r.digest[i]);
+    }
+
+    delete logger;
+    delete timeline;
+    delete metabolic;
+    delete capno;
+    delete adc;
+    delete parser;
+    return true;
+}
+
+size_t ReplayBench::formatDigests(char* line, size_t size) const {
+    size_t len = 0;
+    for (uint8_t i = 0; i < BENCH_STAGE_COUNT && len < size; i++) {
+        len += snprintf(line + len, size - len, "%08lX%c", (unsigned long)_result.digest[i],
+                        i + 1 < BENCH_STAGE_COUNT ? ' ' : '\n');
+    }
+    return len < size ? len : size - 1;
+}
+
+uint8_t ReplayBench::compareDigests(const char* golden, Print& out) const {
+    uint8_t mismatches = 0;
+    const char* p = golden;
+    for (uint8_t i = 0; i < BENCH_STAGE_COUNT; i++) {
+        char* end;
+        const uint32_t expect = strtoul(p, &end, 16);
+        if (end == p || expect != _result.digest[i]) {
+            out.printf("# Bench: %s digest MISMATCH (golden 0x%08lX)\n",
+                       BENCH_STAGE_NAMES[i], (unsigned long)expect);
+            mismatches++;
+        }
+        p = end;
+    }
+    if (mismatches == 0) {
+        out.println("# Bench: all digests match the golden run");
+    }
+    return mismatches;
+}
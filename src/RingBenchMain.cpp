@@ -0,0 +1,222 @@
+// RingBenchMain.cpp
+// Host benchmark of the LockFreeRing hand-offs ([env:ring_bench] only)
+//
+//   program [items]
+//
+// A producer and a consumer thread move items (default 4000000) through
+// SPSCRing<uint32_t, 256>, then through BroadcastRing with two readers:
+// items per second, unpaced, and for SPSCRing the rejected pushes. Then
+// paced pushes carry their steady-clock push time, and the consumer (or
+// each reader) records push-to-read latency; p50 / p99 / max of 20000
+// hand-offs. One JSON line to stdout, so runs on two commits can be diffed.
+// Latency needs a core per thread: on one core it measures the scheduler.
+
+#ifdef RING_BENCH_MAIN
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "LockFreeRing.h"
+
+static const uint32_t LATENCY_ITEMS = 20000;
+static const uint32_t LATENCY_GAP_NS = 20000;       // Producer pacing
+static const uint32_t BROADCAST_READERS = 2;
+
+struct Stamped {
+    uint32_t seq;
+    uint32_t pushLo;        // steady_clock ns of the push
+    uint32_t pushHi;
+};
+
+static uint64_t nowNs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static Stamped stamp(uint32_t seq) {
+    const uint64_t t = nowNs();
+    Stamped s = { seq, (uint32_t)t, (uint32_t)(t >> 32) };
+    return s;
+}
+
+static uint64_t age(const Stamped& s) {
+    return nowNs() - (((uint64_t)s.pushHi << 32) | s.pushLo);
+}
+
+static void pace(uint64_t until) {
+    while (nowNs() < until) {
+        std::this_thread::yield();
+    }
+}
+
+struct Latency {
+    uint64_t p50;
+    uint64_t p99;
+    uint64_t max;
+};
+
+static Latency percentiles(std::vector<uint64_t>& ns) {
+    Latency l = { 0, 0, 0 };
+    if (ns.empty()) return l;
+    std::sort(ns.begin(), ns.end());
+    l.p50 = ns[ns.size() / 2];
+    l.p99 = ns[ns.size() * 99 / 100];
+    l.max = ns.back();
+    return l;
+}
+
+// ============================================================================
+// SPSCRing
+// ============================================================================
+
+static SPSCRing<uint32_t, 256> spscItems;
+static SPSCRing<Stamped, 256> spscStamped;
+
+static double spscThroughput(uint32_t items, uint32_t& rejected) {
+    spscItems.reset();
+    const uint64_t start = nowNs();
+    std::thread producer([items]() {
+        uint32_t next = 0;
+        while (next < items) {
+            if (spscItems.push(next)) next++;
+            else std::this_thread::yield();
+        }
+    });
+    uint32_t received = 0;
+    uint32_t batch[32];
+    while (received < items) {
+        const uint32_t n = spscItems.pop(batch, 32);
+        if (n == 0) std::this_thread::yield();
+        received += n;
+    }
+    producer.join();
+    rejected = spscItems.overruns();
+    return items * 1e9 / (double)(nowNs() - start);
+}
+
+static Latency spscLatency() {
+    spscStamped.reset();
+    std::thread producer([]() {
+        uint64_t next = nowNs();
+        for (uint32_t i = 0; i < LATENCY_ITEMS; i++) {
+            pace(next);
+            spscStamped.push(stamp(i));
+            next += LATENCY_GAP_NS;
+        }
+    });
+    std::vector<uint64_t> ns;
+    ns.reserve(LATENCY_ITEMS);
+    Stamped s;
+    while (ns.size() < LATENCY_ITEMS) {
+        if (spscStamped.pop(s)) ns.push_back(age(s));
+        else std::this_thread::yield();
+    }
+    producer.join();
+    return percentiles(ns);
+}
+
+// ============================================================================
+// BroadcastRing
+// ============================================================================
+
+static BroadcastRing<uint32_t, 256> broadcastItems;
+static BroadcastRing<Stamped, 256> broadcastStamped;
+
+// Producer never waits: readers that fall behind drop items
+static double broadcastThroughput(uint32_t items, uint32_t& dropped) {
+    std::atomic<bool> done(false);
+    std::atomic<uint32_t> totalDropped(0);
+    std::vector<std::thread> readers;
+    const uint32_t first = broadcastItems.head();
+    for (uint32_t r = 0; r < BROADCAST_READERS; r++) {
+        readers.emplace_back([&]() {
+            BroadcastCursor cursor = broadcastItems.attach();
+            cursor.seq = first;
+            uint32_t batch[32];
+            while (cursor.seq - first < items) {
+                if (broadcastItems.read(cursor, batch, 32) == 0) {
+                    if (done.load()) break;
+                    std::this_thread::yield();
+                }
+            }
+            totalDropped += cursor.dropped;
+        });
+    }
+    const uint64_t start = nowNs();
+    for (uint32_t i = 0; i < items; i++) {
+        broadcastItems.push(i);
+        if ((i & 63) == 63) std::this_thread::yield();      // Let readers in on one core
+    }
+    const double rate = items * 1e9 / (double)(nowNs() - start);
+    done = true;
+    for (std::thread& t : readers) t.join();
+    dropped = totalDropped;
+    return rate;
+}
+
+static Latency broadcastLatency(uint32_t& dropped) {
+    std::vector<uint64_t> ns[BROADCAST_READERS];
+    uint32_t lost[BROADCAST_READERS] = {};
+    std::vector<std::thread> readers;
+    const uint32_t first = broadcastStamped.head();
+    for (uint32_t r = 0; r < BROADCAST_READERS; r++) {
+        ns[r].reserve(LATENCY_ITEMS);
+        readers.emplace_back([&, r]() {
+            BroadcastCursor cursor = broadcastStamped.attach();
+            cursor.seq = first;
+            Stamped s;
+            while (cursor.seq - first < LATENCY_ITEMS) {
+                if (broadcastStamped.read(cursor, s)) ns[r].push_back(age(s));
+                else std::this_thread::yield();
+            }
+            lost[r] = cursor.dropped;
+        });
+    }
+    uint64_t next = nowNs();
+    for (uint32_t i = 0; i < LATENCY_ITEMS; i++) {
+        pace(next);
+        broadcastStamped.push(stamp(i));
+        next += LATENCY_GAP_NS;
+    }
+    for (std::thread& t : readers) t.join();
+
+    std::vector<uint64_t> all;
+    dropped = 0;
+    for (uint32_t r = 0; r < BROADCAST_READERS; r++) {
+        all.insert(all.end(), ns[r].begin(), ns[r].end());
+        dropped += lost[r];
+    }
+    return percentiles(all);
+}
+
+int main(int argc, char** argv) {
+    const uint32_t items = (argc > 1) ? (uint32_t)strtoul(argv[1], nullptr, 0) : 4000000;
+
+    uint32_t rejected = 0;
+    const double spscRate = spscThroughput(items, rejected);
+    const Latency spscLat = spscLatency();
+    uint32_t dropped = 0;
+    const double broadcastRate = broadcastThroughput(items, dropped);
+    uint32_t latencyDropped = 0;
+    const Latency broadcastLat = broadcastLatency(latencyDropped);
+
+    printf("{\"target\":\"native\",\"cores\":%u,\"items\":%lu,\"latency_items\":%lu,\"gap_ns\":%lu,"
+           "\"spsc\":{\"ops_per_s\":%.0f,\"rejected\":%lu,\"p50_ns\":%llu,\"p99_ns\":%llu,\"max_ns\":%llu},"
+           "\"broadcast\":{\"readers\":%lu,\"ops_per_s\":%.0f,\"dropped\":%lu,"
+           "\"p50_ns\":%llu,\"p99_ns\":%llu,\"max_ns\":%llu,\"latency_dropped\":%lu}}\n",
+           std::thread::hardware_concurrency(), (unsigned long)items,
+           (unsigned long)LATENCY_ITEMS, (unsigned long)LATENCY_GAP_NS,
+           spscRate, (unsigned long)rejected, (unsigned long long)spscLat.p50,
+           (unsigned long long)spscLat.p99, (unsigned long long)spscLat.max,
+           (unsigned long)BROADCAST_READERS, broadcastRate, (unsigned long)dropped,
+           (unsigned long long)broadcastLat.p50, (unsigned long long)broadcastLat.p99,
+           (unsigned long long)broadcastLat.max, (unsigned long)latencyDropped);
+    return 0;
+}
+
+#endif // RING_BENCH_MAIN
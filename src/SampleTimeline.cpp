@@ -0,0 +1,51 @@
+// SampleTimeline.cpp
+// Implementation of the shared sample timeline
+//
+// Rows are copied in and out of the BroadcastRing, whose per-slot sequence
+// stamps detect a row that the writer overwrote while a reader copied it.
+
+#include "SampleTimeline.h"
+
+uint32_t SampleTimeline::push(const CO2Data& data) {
+    TimelineSample sample;
+    sample.timestamp_us = data.timestamp_us;
+    sample.timestamp = data.timestamp;
+    sample.co2_waveform = data.co2_waveform;
+    sample.fco2 = data.fco2;
+    sample.fetco2 = data.fetco2;
+    sample.respiratory_rate = data.respiratory_rate;
+    sample.status1 = data.status1;
+    sample.status2 = data.status2;
+    sample.valid = data.valid;
+    for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+        sample.sensor_value[ch] = data.sensors[ch].value;
+        sample.sensor_pic[ch] = data.sensors[ch].pic;
+    }
+    return _ring.push(sample);
+}
+
+bool SampleTimeline::read(TimelineCursor& cursor, CO2Data& out) const {
+    TimelineSample sample;
+    if (!_ring.read(cursor, sample)) {
+        return false;
+    }
+    out.timestamp_us = sample.timestamp_us;
+    out.timestamp = sample.timestamp;
+    out.co2_waveform = sample.co2_waveform;
+    out.fco2 = sample.fco2;
+    out.fetco2 = sample.fetco2;
+    out.respiratory_rate = sample.respiratory_rate;
+    out.status1 = sample.status1;
+    out.status2 = sample.status2;
+    out.valid = sample.valid;
+    for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+        out.sensors[ch].value = sample.sensor_value[ch];
+        out.sensors[ch].pic = sample.sensor_pic[ch];
+    }
+    return true;
+}
+
+uint16_t SampleTimeline::co2At(uint32_t seq) const {
+    TimelineSample sample;
+    return _ring.peek(seq, sample) ? sample.co2_waveform : 0;
+}
@@ -0,0 +1,299 @@
+// SessionCodec.cpp
+// Implementation of the session block codec
+
+#include "SessionCodec.h"
+#include <string.h>
+
+static const uint8_t FILE_MAGIC[4] = {'S', 'E', 'S', '3'};
+
+static void putU16(uint8_t* out, uint16_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+}
+
+static void putU32(uint8_t* out, uint32_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+    out[2] = (uint8_t)(value >> 16);
+    out[3] = (uint8_t)(value >> 24);
+}
+
+static uint32_t getU32(const uint8_t* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) |
+           ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+static inline uint32_t zigzag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t z) {
+    return (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+}
+
+// Unsigned LEB128: 7 bits per byte, high bit = more bytes follow
+static inline uint8_t* putVarint(uint8_t* out, uint32_t value) {
+    while (value >= 0x80) {
+        *out++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (uint8_t)value;
+    return out;
+}
+
+// Token: run flag in bit 0 of the first byte, then 6 + 7n value bits. The
+// value is the full 32-bit zigzag, so no 64-bit shift is needed.
+static inline uint8_t* putToken(uint8_t* out, uint32_t value, uint8_t run) {
+    const uint8_t low = (uint8_t)(((value & 0x3F) << 1) | run);
+    value >>= 6;
+    if (value == 0) {
+        *out++ = low;
+        return out;
+    }
+    *out++ = low | 0x80;
+    return putVarint(out, value);
+}
+
+// Bounded readers: false at the end of the input or on an overlong varint
+static inline bool getVarint(const uint8_t*& in, const uint8_t* end, uint32_t& value) {
+    value = 0;
+    for (uint8_t shift = 0; shift < 35; shift += 7) {
+        if (in == end) {
+            return false;
+        }
+        const uint8_t b = *in++;
+        value |= (uint32_t)(b & 0x7F) << shift;
+        if ((b & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline bool getToken(const uint8_t*& in, const uint8_t* end, uint32_t& value, uint8_t& run) {
+    if (in == end) {
+        return false;
+    }
+    const uint8_t b = *in++;
+    run = b & 1;
+    value = (b >> 1) & 0x3F;
+    if ((b & 0x80) == 0) {
+        return true;
+    }
+    uint32_t rest;
+    if (!getVarint(in, end, rest) || rest > (0xFFFFFFFFu >> 6)) {
+        return false;
+    }
+    value |= rest << 6;
+    return true;
+}
+
+// Timestamps are near-periodic: their second difference is mostly 0
+static inline bool secondOrder(uint8_t field) {
+    return field == SESSION_FIELD_TIMESTAMP || field == SESSION_FIELD_TIMESTAMP_US;
+}
+
+// Full us time from its low 32 bits and the ms time (ms = us / 1000): the
+// low words differ by less than 1000 us
+static inline uint64_t fullMicros(uint32_t ms, uint32_t low) {
+    const uint64_t approx = (uint64_t)ms * 1000;
+    return approx + (int32_t)(low - (uint32_t)approx);
+}
+
+// ============================================================================
+// File header
+// ============================================================================
+
+void SessionFileHeader::write(uint8_t* out) const {
+    memcpy(out, FILE_MAGIC, 4);
+    out[4] = fields;
+    out[5] = blockRecords;
+    putU16(out + 6, 0);
+    putU32(out + 8, records);
+    putU32(out + 12, duration_ms);
+}
+
+bool SessionFileHeader::read(const uint8_t* in) {
+    if (memcmp(in, FILE_MAGIC, 4) != 0) {
+        return false;
+    }
+    fields = in[4];
+    blockRecords = in[5];
+    records = getU32(in + 8);
+    duration_ms = getU32(in + 12);
+    return true;
+}
+
+// ============================================================================
+// Encoder
+// ============================================================================
+
+SessionEncoder::SessionEncoder()
+    : _count(0)
+{
+}
+
+bool SessionEncoder::add(const SessionRecord& record) {
+    const uint8_t i = _count;
+    _columns[SESSION_FIELD_TIMESTAMP][i] = (int32_t)record.timestamp;
+    _columns[SESSION_FIELD_TIMESTAMP_US][i] = (int32_t)(uint32_t)record.timestamp_us;
+    _columns[SESSION_FIELD_CO2][i] = record.co2_waveform;
+    _columns[SESSION_FIELD_FCO2][i] = record.fco2;
+    _columns[SESSION_FIELD_FETCO2][i] = record.fetco2;
+    _columns[SESSION_FIELD_RR][i] = record.respiratory_rate;
+    _columns[SESSION_FIELD_STATUS1][i] = record.status1;
+    _columns[SESSION_FIELD_STATUS2][i] = record.status2;
+    _columns[SESSION_FIELD_VALID][i] = record.valid;
+    for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+        _columns[SESSION_FIELD_SENSORS + ch][i] = record.sensors[ch];
+    }
+    _count = i + 1;
+    return _count == BLOCK_RECORDS;
+}
+
+size_t SessionEncoder::finishBlock(uint8_t* out) {
+    const uint8_t count = _count;
+    if (count == 0) {
+        return 0;
+    }
+    _count = 0;
+
+    uint8_t* p = out + BLOCK_HEADER;
+    for (uint8_t f = 0; f < FIELD_COUNT; f++) {
+        p = putVarint(p, zigzag(_columns[f][0]));
+    }
+
+    for (uint8_t f = 0; f < FIELD_COUNT; f++) {
+        const int32_t* col = _columns[f];
+        const bool order2 = secondOrder(f);
+        uint32_t prev = (uint32_t)col[0];
+        uint32_t prevDelta = 0;
+        uint32_t zeros = 0;
+        for (uint8_t i = 1; i < count; i++) {
+            // Unsigned arithmetic: wrapping deltas (e.g. millis()) round-trip
+            const uint32_t delta = (uint32_t)col[i] - prev;
+            prev = (uint32_t)col[i];
+            const uint32_t v = order2 ? delta - prevDelta : delta;
+            prevDelta = delta;
+            if (v == 0) {
+                zeros++;
+                continue;
+            }
+            if (zeros > 0) {
+                p = putToken(p, zeros - 1, 1);
+                zeros = 0;
+            }
+            p = putToken(p, zigzag((int32_t)v), 0);
+        }
+        if (zeros > 0) {
+            p = putToken(p, zeros - 1, 1);
+        }
+    }
+
+    const size_t body = p - out - BLOCK_HEADER;
+    out[0] = BLOCK_SYNC;
+    out[1] = count;
+    putU16(out + 2, (uint16_t)body);
+    return BLOCK_HEADER + body;
+}
+
+// ============================================================================
+// Decoder
+// ============================================================================
+
+size_t SessionDecoder::blockLength(const uint8_t* in) {
+    if (in[0] != SessionEncoder::BLOCK_SYNC || in[1] == 0 ||
+        in[1] > SessionEncoder::BLOCK_RECORDS) {
+        return 0;
+    }
+    const size_t body = in[2] | (in[3] << 8);
+    if (body > SessionEncoder::MAX_BLOCK - SessionEncoder::BLOCK_HEADER) {
+        return 0;
+    }
+    return SessionEncoder::BLOCK_HEADER + body;
+}
+
+uint8_t SessionDecoder::decodeBlock(const uint8_t* block, size_t len, SessionRecord* out) {
+    if (len < SessionEncoder::BLOCK_HEADER || blockLength(block) != len) {
+        return 0;
+    }
+    const uint8_t count = block[1];
+    const uint8_t* in = block + SessionEncoder::BLOCK_HEADER;
+    const uint8_t* end = block + len;
+
+    uint32_t key[SessionEncoder::FIELD_COUNT];
+    for (uint8_t f = 0; f < SessionEncoder::FIELD_COUNT; f++) {
+        uint32_t z;
+        if (!getVarint(in, end, z)) {
+            return 0;
+        }
+        key[f] = (uint32_t)unzigzag(z);
+    }
+
+    uint32_t col[SessionEncoder::BLOCK_RECORDS];
+    for (uint8_t f = 0; f < SessionEncoder::FIELD_COUNT; f++) {
+        const bool order2 = secondOrder(f);
+        uint32_t value = key[f];
+        uint32_t delta = 0;
+        col[0] = value;
+        uint8_t i = 1;
+        while (i < count) {
+            uint32_t t;
+            uint8_t run;
+            if (!getToken(in, end, t, run)) {
+                return 0;
+            }
+            if (run) {
+                // Zero first (or second) differences
+                if (t >= (uint32_t)(count - i)) {
+                    return 0;
+                }
+                for (uint32_t k = 0; k <= t; k++) {
+                    if (!order2) delta = 0;
+                    value += delta;
+                    col[i++] = value;
+                }
+            } else {
+                const uint32_t v = (uint32_t)unzigzag(t);
+                delta = order2 ? delta + v : v;
+                value += delta;
+                col[i++] = value;
+            }
+        }
+
+        // Scatter the column into the records
+        switch (f) {
+            case SESSION_FIELD_TIMESTAMP:
+                for (i = 0; i < count; i++) out[i].timestamp = col[i];
+                break;
+            case SESSION_FIELD_TIMESTAMP_US:       // After the ms column
+                for (i = 0; i < count; i++) out[i].timestamp_us = fullMicros(out[i].timestamp, col[i]);
+                break;
+            case SESSION_FIELD_CO2:
+                for (i = 0; i < count; i++) out[i].co2_waveform = (uint16_t)col[i];
+                break;
+            case SESSION_FIELD_FCO2:
+                for (i = 0; i < count; i++) out[i].fco2 = (uint8_t)col[i];
+                break;
+            case SESSION_FIELD_FETCO2:
+                for (i = 0; i < count; i++) out[i].fetco2 = (uint8_t)col[i];
+                break;
+            case SESSION_FIELD_RR:
+                for (i = 0; i < count; i++) out[i].respiratory_rate = (uint8_t)col[i];
+                break;
+            case SESSION_FIELD_STATUS1:
+                for (i = 0; i < count; i++) out[i].status1 = (uint8_t)col[i];
+                break;
+            case SESSION_FIELD_STATUS2:
+                for (i = 0; i < count; i++) out[i].status2 = (uint8_t)col[i];
+                break;
+            case SESSION_FIELD_VALID:
+                for (i = 0; i < count; i++) out[i].valid = (uint8_t)col[i];
+                break;
+            default:
+                for (i = 0; i < count; i++) out[i].sensors[f - SESSION_FIELD_SENSORS] = (int32_t)col[i];
+                break;
+        }
+    }
+    return (in == end) ? count : 0;
+}
@@ -0,0 +1,71 @@
+// SessionCsvMain.cpp
+// Converts a downloaded session file to CSV ([env:session_csv] only)
+//
+//   program <session.ses> [out.csv]
+//
+// The file is loaded into the host LittleFS and read out through
+// SessionExport, so the lines are the ones GET /api/sessions/<id>?format=csv
+// serves. Without out.csv the CSV goes to stdout. A file cut short by a
+// reset converts up to its last whole block.
+
+#ifdef SESSION_CSV_MAIN
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <stdio.h>
+#include "SessionStore.h"
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "usage: %s <session.ses> [out.csv]\n", argv[0]);
+        return 2;
+    }
+
+    FILE* in = fopen(argv[1], "rb");
+    if (in == nullptr) {
+        perror(argv[1]);
+        return 1;
+    }
+    Serial.setMuted(true);              // SessionStore logs to HostLog
+    SessionStore store;
+    store.begin(LittleFS);
+    char name[32];
+    SessionStore::path(1, name, sizeof(name));
+    File file = LittleFS.open(name, FILE_WRITE);
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+        file.write(buf, n);
+    }
+    fclose(in);
+    file.close();
+
+    SessionExport csv(LittleFS, 1, SESSION_EXPORT_CSV);
+    if (!csv.isOpen()) {
+        fprintf(stderr, "%s: not a session file of this firmware\n", argv[1]);
+        return 1;
+    }
+    FILE* out = (argc == 3) ? fopen(argv[2], "wb") : stdout;
+    if (out == nullptr) {
+        perror(argv[2]);
+        return 1;
+    }
+    uint32_t lines = 0;
+    while ((n = csv.read(buf, sizeof(buf))) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            if (buf[i] == '\n') lines++;
+        }
+        if (fwrite(buf, 1, n, out) != n) {
+            perror(argc == 3 ? argv[2] : "stdout");
+            return 1;
+        }
+    }
+    if (out != stdout && fclose(out) != 0) {
+        perror(argv[2]);
+        return 1;
+    }
+    fprintf(stderr, "%lu records\n", (unsigned long)(lines > 0 ? lines - 1 : 0));
+    return 0;
+}
+
+#endif // SESSION_CSV_MAIN
@@ -0,0 +1,425 @@
+// SessionStore.cpp
+// Implementation of session recording and export
+
+#include "SessionStore.h"
+#include "HostLink.h"
+
+static const char* const SESSION_DIR = "/sessions";
+
+static int32_t pow10i(uint8_t decimals) {
+    int32_t p = 1;
+    while (decimals-- > 0) p *= 10;
+    return p;
+}
+
+// Session id from a directory entry ("12.ses" or "/sessions/12.ses"), 0 if none
+static uint32_t idFromName(const char* name) {
+    const char* slash = strrchr(name, '/');
+    if (slash) name = slash + 1;
+    char* end = nullptr;
+    const unsigned long id = strtoul(name, &end, 10);
+    return (end != name && strcmp(end, ".ses") == 0) ? (uint32_t)id : 0;
+}
+
+// ============================================================================
+// Records
+// ============================================================================
+
+void SessionStore::path(uint32_t id, char* out, size_t len) {
+    snprintf(out, len, "%s/%lu.ses", SESSION_DIR, (unsigned long)id);
+}
+
+void SessionStore::fromData(const CO2Data& data, SessionRecord& record) {
+    record.timestamp_us = data.timestamp_us;
+    record.timestamp = data.timestamp;
+    record.co2_waveform = data.co2_waveform;
+    record.fco2 = data.fco2;
+    record.fetco2 = data.fetco2;
+    record.respiratory_rate = data.respiratory_rate;
+    record.status1 = data.status1;
+    record.status2 = data.status2;
+    record.valid = data.valid ? 1 : 0;
+    for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+        const float scaled = data.sensors[ch].value * pow10i(Sensors::info(ch).decimals);
+        record.sensors[ch] = (int32_t)(scaled < 0.0f ? scaled - 0.5f : scaled + 0.5f);
+    }
+}
+
+static bool writeHeader(File& file, uint32_t records, uint32_t duration_ms) {
+    SessionFileHeader info;
+    info.fields = SessionEncoder::FIELD_COUNT;
+    info.blockRecords = SessionEncoder::BLOCK_RECORDS;
+    info.records = records;
+    info.duration_ms = duration_ms;
+    uint8_t header[SessionFileHeader::SIZE];
+    info.write(header);
+    return file.write(header, sizeof(header)) == sizeof(header);
+}
+
+// Decode the block at pos; returns its record count, 0 if unreadable
+static uint8_t readBlock(File& file, uint32_t pos, uint8_t* block, SessionRecord* rows) {
+    const uint8_t h = SessionEncoder::BLOCK_HEADER;
+    if (!file.seek(pos) || file.read(block, h) != h) {
+        return 0;
+    }
+    const size_t len = SessionDecoder::blockLength(block);
+    if (len == 0 || file.read(block + h, len - h) != len - h) {
+        return 0;
+    }
+    return SessionDecoder::decodeBlock(block, len, rows);
+}
+
+bool SessionStore::scan(File& file, uint32_t& records, uint32_t& duration_ms) {
+    records = 0;
+    duration_ms = 0;
+    uint32_t pos = SessionFileHeader::SIZE;
+    uint32_t lastBlock = 0;
+    uint8_t header[SessionEncoder::BLOCK_HEADER];
+    while (file.seek(pos) && file.read(header, sizeof(header)) == sizeof(header)) {
+        const size_t len = SessionDecoder::blockLength(header);
+        if (len == 0 || pos + len > file.size()) {
+            break;              // Torn or corrupt block: the session ends here
+        }
+        records += header[1];
+        lastBlock = pos;
+        pos += len;
+    }
+    if (records == 0) {
+        return false;
+    }
+
+    // First timestamp from the first block, last from the last block
+    uint8_t block[SessionEncoder::MAX_BLOCK];
+    SessionRecord rows[SessionEncoder::BLOCK_RECORDS];
+    if (readBlock(file, SessionFileHeader::SIZE, block, rows) == 0) {
+        return false;
+    }
+    const uint32_t firstMs = rows[0].timestamp;
+    const uint8_t n = readBlock(file, lastBlock, block, rows);
+    if (n == 0) {
+        return false;
+    }
+    duration_ms = rows[n - 1].timestamp - firstMs;
+    return true;
+}
+
+// ============================================================================
+// Recording
+// ============================================================================
+
+SessionStore::SessionStore()
+    : _fs(nullptr)
+    , _recordingId(0)
+    , _nextId(1)
+    , _maxBytes(0)
+    , _bytes(0)
+    , _records(0)
+    , _firstMs(0)
+    , _lastMs(0)
+    , _blocksSinceSync(0)
+{
+}
+
+bool SessionStore::begin(fs::FS& fs) {
+    _fs = &fs;
+    if (!_fs->exists(SESSION_DIR) && !_fs->mkdir(SESSION_DIR)) {
+        HostLog.printf("# Sessions: cannot create %s\n", SESSION_DIR);
+        _fs = nullptr;
+        return false;
+    }
+
+    File dir = _fs->open(SESSION_DIR);
+    uint32_t count = 0;
+    for (File entry = dir.openNextFile(); entry; entry = dir.openNextFile()) {
+        const uint32_t id = idFromName(entry.name());
+        if (id == 0) continue;
+        count++;
+        if (id >= _nextId) _nextId = id + 1;
+    }
+    HostLog.printf("# Sessions: %lu stored, next id %lu\n",
+                   (unsigned long)count, (unsigned long)_nextId);
+    return true;
+}
+
+bool SessionStore::startRecording(uint32_t max_bytes) {
+    if (_fs == nullptr) {
+        return false;
+    }
+    stopRecording();
+
+    char name[32];
+    path(_nextId, name, sizeof(name));
+    _file = _fs->open(name, FILE_WRITE);
+    if (!_file) {
+        HostLog.printf("# Session: cannot open %s\n", name);
+        return false;
+    }
+
+    // Record count and duration are filled in when the recording stops
+    if (!writeHeader(_file, SessionFileHeader::OPEN, 0)) {
+        HostLog.println("# Session: header write failed");
+        _file.close();
+        return false;
+    }
+
+    _maxBytes = max_bytes;
+    _bytes = SessionFileHeader::SIZE;
+    _records = 0;
+    _blocksSinceSync = 0;
+    _encoder.finishBlock(_block);       // Drops anything left from a failed session
+    _recordingId = _nextId++;
+    HostLog.printf("# Session %lu started: %s\n", (unsigned long)_recordingId, name);
+    return true;
+}
+
+void SessionStore::stopRecording() {
+    if (_recordingId == 0) {
+        return;
+    }
+    writeBlock();
+    if (!_file.seek(0) || !writeHeader(_file, _records, _lastMs - _firstMs)) {
+        HostLog.println("# Session: header update failed (listing scans the file)");
+    }
+    _file.close();
+    HostLog.printf("# Session %lu stopped: %lu records, %lu bytes\n",
+                   (unsigned long)_recordingId, (unsigned long)_records, (unsigned long)_bytes);
+    _recordingId = 0;
+}
+
+void SessionStore::addSample(const CO2Data& data) {
+    if (_recordingId == 0) {
+        return;
+    }
+    // Stop while the largest possible block still fits
+    if (_encoder.pending() == 0 && _bytes + SessionEncoder::MAX_BLOCK > _maxBytes) {
+        HostLog.printf("# Session: size limit reached (%lu bytes)\n", (unsigned long)_bytes);
+        stopRecording();
+        return;
+    }
+
+    SessionRecord record;
+    fromData(data, record);
+    if (_records == 0) _firstMs = record.timestamp;
+    _lastMs = record.timestamp;
+    _records++;
+
+    if (_encoder.add(record) && !writeBlock()) {
+        HostLog.println("# Session: flash write failed (file system full?)");
+        stopRecording();
+    }
+}
+
+bool SessionStore::writeBlock() {
+    const size_t len = _encoder.finishBlock(_block);
+    if (len == 0) {
+        return true;
+    }
+    const size_t written = _file.write(_block, len);
+    _bytes += written;
+    const bool ok = (written == len);
+
+    // LittleFS keeps unsynced data out of the file until a sync or close
+    if (++_blocksSinceSync >= SYNC_BLOCKS) {
+        _file.flush();
+        _blocksSinceSync = 0;
+    }
+    return ok;
+}
+
+void SessionStore::printJson(Print& out) const {
+    out.print('[');
+    if (_fs == nullptr) {
+        out.print(']');
+        return;
+    }
+
+    File dir = _fs->open(SESSION_DIR);
+    bool first = true;
+    for (File entry = dir.openNextFile(); entry; entry = dir.openNextFile()) {
+        const uint32_t id = idFromName(entry.name());
+        if (id == 0) continue;
+
+        const uint32_t size = entry.size();
+        uint32_t records = 0;
+        uint32_t duration = 0;
+        SessionFileHeader info;
+        uint8_t header[SessionFileHeader::SIZE];
+        if (id == _recordingId) {
+            records = _records;
+            duration = _lastMs - _firstMs;
+        } else if (entry.read(header, sizeof(header)) == sizeof(header) && info.read(header)) {
+            if (info.records != SessionFileHeader::OPEN) {
+                records = info.records;
+                duration = info.duration_ms;
+            } else {
+                scan(entry, records, duration);
+            }
+        }
+
+        out.printf("%s{\"id\":%lu,\"bytes\":%lu,\"records\":%lu,\"duration_ms\":%lu,\"recording\":%s}",
+                   first ? "" : ",", (unsigned long)id, (unsigned long)size,
+                   (unsigned long)records, (unsigned long)duration,
+                   id == _recordingId ? "true" : "false");
+        first = false;
+    }
+    out.print(']');
+}
+
+// ============================================================================
+// Export
+// ============================================================================
+
+SessionExport::SessionExport(fs::FS& fs, uint32_t id, SessionExportFormat format)
+    : _format(format)
+    , _open(false)
+    , _size(0)
+    , _remaining(0)
+    , _headerSent(false)
+    , _recordCount(0)
+    , _recordPos(0)
+    , _lineLen(0)
+    , _linePos(0)
+{
+    char name[32];
+    SessionStore::path(id, name, sizeof(name));
+    if (!fs.exists(name)) {
+        return;
+    }
+    _file = fs.open(name, FILE_READ);
+    if (!_file) {
+        return;
+    }
+    _size = _file.size();
+    _remaining = _size;
+
+    if (_format == SESSION_EXPORT_CSV) {
+        // Only the layout this firmware writes can be converted
+        uint8_t header[SessionFileHeader::SIZE];
+        SessionFileHeader info;
+        if (_file.read(header, sizeof(header)) != sizeof(header) || !info.read(header) ||
+            info.fields != SessionEncoder::FIELD_COUNT) {
+            _file.close();
+            return;
+        }
+    }
+    _open = true;
+}
+
+RangeResult SessionExport::parseRange(const char* header, uint32_t size, uint32_t& first, uint32_t& last) {
+    if (strncmp(header, "bytes=", 6) != 0 || strchr(header, ',') != nullptr || size == 0) {
+        return RANGE_NONE;
+    }
+    const char* p = header + 6;
+    char* end = nullptr;
+    if (*p == '-') {
+        const unsigned long suffix = strtoul(p + 1, &end, 10);
+        if (end == p + 1 || *end != '\0') return RANGE_NONE;
+        if (suffix == 0) return RANGE_UNSATISFIABLE;
+        first = (suffix < size) ? size - suffix : 0;
+        last = size - 1;
+        return RANGE_OK;
+    }
+    const unsigned long from = strtoul(p, &end, 10);
+    if (end == p || *end != '-') return RANGE_NONE;
+    p = end + 1;
+    last = size - 1;
+    if (*p != '\0') {
+        const unsigned long to = strtoul(p, &end, 10);
+        if (end == p || *end != '\0') return RANGE_NONE;
+        if (to < last) last = to;
+    }
+    if (from >= size || from > last) return RANGE_UNSATISFIABLE;
+    first = from;
+    return RANGE_OK;
+}
+
+bool SessionExport::setRange(uint32_t first, uint32_t last) {
+    if (!_open || _format != SESSION_EXPORT_RAW || first > last || last >= _size ||
+        !_file.seek(first)) {
+        return false;
+    }
+    _remaining = last - first + 1;
+    return true;
+}
+
+size_t SessionExport::read(uint8_t* buf, size_t maxLen) {
+    if (!_open) {
+        return 0;
+    }
+
+    if (_format == SESSION_EXPORT_RAW) {
+        size_t n = (maxLen < BLOCK_SIZE) ? maxLen : BLOCK_SIZE;
+        if (n > _remaining) n = _remaining;
+        if (n == 0) {
+            return 0;
+        }
+        n = _file.read(buf, n);
+        _remaining -= n;
+        return n;
+    }
+
+    size_t total = 0;
+    while (total < maxLen) {
+        if (_linePos == _lineLen && !nextLine()) {
+            break;
+        }
+        size_t n = _lineLen - _linePos;
+        if (n > maxLen - total) n = maxLen - total;
+        memcpy(buf + total, _line + _linePos, n);
+        _linePos += n;
+        total += n;
+    }
+    return total;
+}
+
+bool SessionExport::nextLine() {
+    _linePos = 0;
+    _lineLen = 0;
+
+    if (!_headerSent) {
+        _headerSent = true;
+        int len = snprintf(_line, sizeof(_line),
+                           "time_ms,time_us,co2_waveform,fco2,fetco2,rr,status1,status2,valid");
+        for (uint8_t ch = 0; ch < SENSOR_COUNT && len < (int)sizeof(_line); ch++) {
+            len += snprintf(_line + len, sizeof(_line) - len, ",%s", Sensors::info(ch).key);
+        }
+        if (len < (int)sizeof(_line) - 1) {
+            _line[len++] = '\n';
+            _lineLen = len;
+        }
+        return _lineLen > 0;
+    }
+
+    // Decode one block at a time; a torn or corrupt block ends the session
+    if (_recordPos == _recordCount) {
+        const uint8_t h = SessionEncoder::BLOCK_HEADER;
+        if (_file.read(_block, h) != h) {
+            return false;
+        }
+        const size_t len = SessionDecoder::blockLength(_block);
+        if (len == 0 || _file.read(_block + h, len - h) != len - h) {
+            return false;
+        }
+        _recordCount = SessionDecoder::decodeBlock(_block, len, _records);
+        _recordPos = 0;
+        if (_recordCount == 0) {
+            return false;
+        }
+    }
+
+    const SessionRecord& r = _records[_recordPos++];
+    int len = snprintf(_line, sizeof(_line), "%lu,%llu,%u,%u,%u,%u,%u,%u,%u",
+                       (unsigned long)r.timestamp, (unsigned long long)r.timestamp_us, r.co2_waveform, r.fco2, r.fetco2,
+                       r.respiratory_rate, r.status1, r.status2, r.valid);
+    for (uint8_t ch = 0; ch < SENSOR_COUNT && len < (int)sizeof(_line); ch++) {
+        const uint8_t decimals = Sensors::info(ch).decimals;
+        len += snprintf(_line + len, sizeof(_line) - len, ",%.*f",
+                        decimals, (double)r.sensors[ch] / pow10i(decimals));
+    }
+    if (len >= (int)sizeof(_line) - 1) {
+        len = sizeof(_line) - 2;
+    }
+    _line[len++] = '\n';
+    _lineLen = len;
+    return true;
+}
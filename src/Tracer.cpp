@@ -0,0 +1,257 @@
+// Tracer.cpp
+// Trace event ring and Chrome trace_event export
+
+#include "Tracer.h"
+#ifndef ESP_PLATFORM
+#include <chrono>
+#endif
+
+#ifdef TRACING
+Tracer::Slot Tracer::_slots[Tracer::EVENTS];
+#else
+Tracer::Slot Tracer::_slots[1];     // Never written
+#endif
+std::atomic<uint32_t> Tracer::_head(0);
+std::atomic<uint32_t> Tracer::_cleared(0);
+std::atomic<uint8_t> Tracer::_readers(0);
+Tracer::TaskName Tracer::_tasks[Tracer::MAX_TASKS];
+std::atomic<uint8_t> Tracer::_taskCount(0);
+
+bool Tracer::isEnabled() {
+#ifdef TRACING
+    return true;
+#else
+    return false;
+#endif
+}
+
+void Tracer::record(const char* name, char phase) {
+#ifdef TRACING
+    if (_readers.load(std::memory_order_relaxed) != 0) {
+        return;
+    }
+    const uint32_t seq = _head.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = _slots[seq & (EVENTS - 1)];
+
+    // Take the slot unless a writer lapped by the whole ring while it was
+    // preempted is still filling it; then this event is dropped, as two
+    // writers in one slot could mix their fields
+    uint32_t stamp = slot.stamp.load(std::memory_order_relaxed);
+    if ((stamp & 1) != 0 ||
+        !slot.stamp.compare_exchange_strong(stamp, 2 * seq + 1, std::memory_order_relaxed)) {
+        return;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.ts_us.store(nowUs(), std::memory_order_relaxed);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.task.store(currentTask(), std::memory_order_relaxed);
+    slot.phase.store(phase, std::memory_order_relaxed);
+    slot.stamp.store(2 * seq + 2, std::memory_order_release);
+#else
+    (void)name;
+    (void)phase;
+#endif
+}
+
+void Tracer::nameTask(const char* name) {
+    const uint32_t task = currentTask();
+    const uint8_t count = _taskCount.load(std::memory_order_acquire);
+    for (uint8_t i = 0; i < count; i++) {
+        if (_tasks[i].task == task) {
+            _tasks[i].name = name;
+            return;
+        }
+    }
+    const uint8_t slot = _taskCount.fetch_add(1, std::memory_order_acq_rel);
+    if (slot >= MAX_TASKS) {
+        _taskCount.store(MAX_TASKS, std::memory_order_release);
+        return;
+    }
+    _tasks[slot].task = task;
+    _tasks[slot].name = name;
+}
+
+void Tracer::clear() {
+    // Sequence numbers keep counting, so no stale slot can pass for a new
+    // event
+    _cleared.store(_head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+bool Tracer::copy(uint32_t seq, TraceEvent& event) {
+    const Slot& slot = _slots[seq & (EVENTS - 1)];
+    const uint32_t expect = 2 * seq + 2;
+    if (slot.stamp.load(std::memory_order_acquire) != expect) {
+        return false;
+    }
+    event.ts_us = slot.ts_us.load(std::memory_order_relaxed);
+    event.name = slot.name.load(std::memory_order_relaxed);
+    event.task = slot.task.load(std::memory_order_relaxed);
+    event.phase = slot.phase.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.stamp.load(std::memory_order_relaxed) == expect;
+}
+
+void Tracer::dumpJson(Print& out) {
+    TraceExport trace;
+    uint8_t buf[256];
+    size_t len;
+    while ((len = trace.read(buf, sizeof(buf))) > 0) {
+        out.write(buf, len);
+    }
+    out.println();
+}
+
+uint32_t Tracer::nowUs() {
+#ifdef ESP_PLATFORM
+    return micros();
+#else
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+uint32_t Tracer::currentTask() {
+#ifdef ESP_PLATFORM
+    return (uint32_t)(uintptr_t)xTaskGetCurrentTaskHandle();
+#else
+    static thread_local uint8_t marker;
+    return (uint32_t)(uintptr_t)&marker;
+#endif
+}
+
+// ============================================================================
+// TraceExport
+// ============================================================================
+
+TraceExport::TraceExport()
+    : _part(PART_HEADER)
+    , _next(0)
+    , _start(0)
+    , _end(0)
+    , _prevUs(0)
+    , _timeUs(0)
+    , _trackCount(0)
+    , _first(true)
+    , _lineLen(0)
+    , _linePos(0)
+{
+    // Pause recording. Writers that passed the pause check before it are
+    // not waited for: their slots fail the stamp check and are skipped.
+    Tracer::_readers.fetch_add(1, std::memory_order_acq_rel);
+
+    _end = Tracer::_head.load(std::memory_order_acquire);
+    _start = (_end > Tracer::EVENTS) ? _end - Tracer::EVENTS : 0;
+    const uint32_t cleared = Tracer::_cleared.load(std::memory_order_relaxed);
+    if (_end - cleared < _end - _start) {
+        _start = cleared;
+    }
+
+    // Tracks (tasks) present in the ring, and the time origin
+    bool origin = false;
+    for (uint32_t i = _start; i < _end; i++) {
+        TraceEvent e;
+        if (!Tracer::copy(i, e)) {
+            continue;
+        }
+        if (!origin) {
+            _prevUs = e.ts_us;
+            origin = true;
+        }
+        const uint32_t task = e.task;
+        uint8_t t = 0;
+        while (t < _trackCount && _tracks[t] != task) t++;
+        if (t == _trackCount && _trackCount < MAX_TRACKS) {
+            _tracks[_trackCount++] = task;
+        }
+    }
+}
+
+TraceExport::~TraceExport() {
+    Tracer::_readers.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+size_t TraceExport::read(uint8_t* buf, size_t maxLen) {
+    size_t len = 0;
+    while (len < maxLen) {
+        if (_linePos == _lineLen && !nextLine()) {
+            break;
+        }
+        size_t n = _lineLen - _linePos;
+        if (n > maxLen - len) n = maxLen - len;
+        memcpy(buf + len, _line + _linePos, n);
+        _linePos += n;
+        len += n;
+    }
+    return len;
+}
+
+bool TraceExport::nextLine() {
+    _linePos = 0;
+    _lineLen = 0;
+    int n = 0;
+    switch (_part) {
+        case PART_HEADER:
+            n = snprintf(_line, sizeof(_line), "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+            _part = PART_TASKS;
+            _next = 0;
+            break;
+
+        case PART_TASKS: {
+            if (_next >= _trackCount) {
+                // Events follow; rewind to the oldest one
+                _part = PART_EVENTS;
+                _next = _start;
+                return nextLine();
+            }
+            const uint32_t task = _tracks[_next++];
+            const char* name = nullptr;
+            const uint8_t count = Tracer::_taskCount.load(std::memory_order_acquire);
+            for (uint8_t i = 0; i < count && i < Tracer::MAX_TASKS; i++) {
+                if (Tracer::_tasks[i].task == task) name = Tracer::_tasks[i].name;
+            }
+            if (name != nullptr) {
+                n = snprintf(_line, sizeof(_line),
+                             "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%lu,\"args\":{\"name\":\"%s\"}}",
+                             _first ? "" : ",", (unsigned long)task, name);
+            } else {
+                n = snprintf(_line, sizeof(_line),
+                             "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%lu,\"args\":{\"name\":\"task %08lx\"}}",
+                             _first ? "" : ",", (unsigned long)task, (unsigned long)task);
+            }
+            _first = false;
+            break;
+        }
+
+        case PART_EVENTS: {
+            TraceEvent e;
+            while (_next < _end && !Tracer::copy(_next, e)) {
+                _next++;        // Incomplete or reused since the export started
+            }
+            if (_next >= _end) {
+                _part = PART_FOOTER;
+                return nextLine();
+            }
+            _next++;
+            // Tasks claim slots slightly out of time order: signed steps
+            _timeUs += (int32_t)(e.ts_us - _prevUs);
+            _prevUs = e.ts_us;
+            n = snprintf(_line, sizeof(_line), "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lld,\"pid\":1,\"tid\":%lu}",
+                         _first ? "" : ",", e.name, e.phase, (long long)_timeUs, (unsigned long)e.task);
+            _first = false;
+            break;
+        }
+
+        case PART_FOOTER:
+            n = snprintf(_line, sizeof(_line), "]}");
+            _part = PART_DONE;
+            break;
+
+        case PART_DONE:
+            return false;
+    }
+    if (n < 0) n = 0;
+    if (n >= (int)sizeof(_line)) n = sizeof(_line) - 1;
+    _lineLen = n;
+    return true;
+}
@@ -0,0 +1,232 @@
+// TrendStore.cpp
+// Implementation of multi-resolution trend rollups
+
+#include "TrendStore.h"
+
+TrendStore::TrendStore() {
+    _rings[TREND_TIER_1S].buckets = _buckets1s;
+    _rings[TREND_TIER_1S].capacity = TIER_1S_CAPACITY;
+    _rings[TREND_TIER_10S].buckets = _buckets10s;
+    _rings[TREND_TIER_10S].capacity = TIER_10S_CAPACITY;
+    _rings[TREND_TIER_1MIN].buckets = _buckets1min;
+    _rings[TREND_TIER_1MIN].capacity = TIER_1MIN_CAPACITY;
+
+    memset(_revision, 0, sizeof(_revision));
+    clear();
+}
+
+void TrendStore::clear() {
+    for (int t = 0; t < TREND_TIER_COUNT; t++) {
+        _rings[t].head = 0;
+        _rings[t].count = 0;
+        resetAccumulator(_acc[t], 0);
+        _acc[t].started = false;
+        _revision[t]++;
+    }
+}
+
+void TrendStore::addSample(const CO2Data& data, uint32_t now_ms) {
+    // Convert to tenths of unit (see TrendChannel)
+    uint16_t values[TREND_CHANNEL_COUNT];
+    values[TREND_ETCO2] = (uint16_t)data.fetco2 * 10;
+    values[TREND_RR] = (uint16_t)data.respiratory_rate * 10;
+
+    uint8_t c = TREND_SENSOR_FIRST;
+    for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+        const SensorInfo& info = Sensors::info(ch);
+        if (!(info.views & SENSOR_VIEW_TREND)) continue;
+        float v = data.sensors[ch].value;
+        if (v < info.min_value) v = info.min_value;
+        if (v > info.max_value) v = info.max_value;
+        v = v * 10.0f + 0.5f;
+        if (v < 0.0f) v = 0.0f;
+        if (v > TREND_NO_DATA - 1) v = TREND_NO_DATA - 1;
+        values[c++] = (uint16_t)v;
+    }
+
+    for (int t = 0; t < TREND_TIER_COUNT; t++) {
+        TrendTier tier = (TrendTier)t;
+        Accumulator& acc = _acc[t];
+        uint32_t index = now_ms / (getBucketSeconds(tier) * 1000UL);
+
+        if (!acc.started) {
+            resetAccumulator(acc, index);
+            acc.started = true;
+        } else if (index != acc.bucketIndex) {
+            // Close the open bucket, then pad any gap with empty buckets
+            closeBucket(tier);
+
+            uint32_t gap = (index > acc.bucketIndex) ? index - acc.bucketIndex - 1 : 0;
+            if (gap > _rings[t].capacity) gap = _rings[t].capacity;
+            for (uint32_t i = 0; i < gap; i++) {
+                pushEmpty(tier);
+            }
+
+            resetAccumulator(acc, index);
+        }
+
+        // Accumulate (O(1) per tier and channel)
+        for (int c = 0; c < TREND_CHANNEL_COUNT; c++) {
+            acc.sum[c] += values[c];
+            if (values[c] < acc.min[c]) acc.min[c] = values[c];
+            if (values[c] > acc.max[c]) acc.max[c] = values[c];
+        }
+        acc.count++;
+    }
+}
+
+uint16_t TrendStore::getBucketCount(TrendTier tier) const {
+    return _rings[tier].count;
+}
+
+const TrendBucket& TrendStore::getBucket(TrendTier tier, uint16_t age) const {
+    const Ring& ring = _rings[tier];
+    uint16_t idx = (ring.head + ring.capacity - 1 - (age % ring.capacity)) % ring.capacity;
+    return ring.buckets[idx];
+}
+
+TrendChannel TrendStore::sensorChannel(uint8_t sensor) {
+    if (sensor >= SENSOR_COUNT || !(Sensors::info(sensor).views & SENSOR_VIEW_TREND)) {
+        return TREND_CHANNEL_COUNT;
+    }
+    uint8_t c = TREND_SENSOR_FIRST;
+    for (uint8_t ch = 0; ch < sensor; ch++) {
+        if (Sensors::info(ch).views & SENSOR_VIEW_TREND) c++;
+    }
+    return (TrendChannel)c;
+}
+
+uint16_t TrendStore::getBucketSeconds(TrendTier tier) {
+    switch (tier) {
+        case TREND_TIER_1S:   return 1;
+        case TREND_TIER_10S:  return 10;
+        case TREND_TIER_1MIN: return 60;
+        default:              return 1;
+    }
+}
+
+uint16_t TrendStore::getCapacity(TrendTier tier) {
+    switch (tier) {
+        case TREND_TIER_1S:   return TIER_1S_CAPACITY;
+        case TREND_TIER_10S:  return TIER_10S_CAPACITY;
+        case TREND_TIER_1MIN: return TIER_1MIN_CAPACITY;
+        default:              return 0;
+    }
+}
+
+TrendTier TrendStore::getZoomTier(TrendZoom zoom) {
+    // 1 h and 4 h read the 10 s tier, 12 h reads the 1 min tier
+    return (zoom == TREND_ZOOM_12H) ? TREND_TIER_1MIN : TREND_TIER_10S;
+}
+
+uint16_t TrendStore::getZoomBuckets(TrendZoom zoom) {
+    switch (zoom) {
+        case TREND_ZOOM_1H:  return 360;    // 360 x 10 s
+        case TREND_ZOOM_4H:  return 1440;   // 1440 x 10 s
+        case TREND_ZOOM_12H: return 720;    // 720 x 1 min
+        default:             return 360;
+    }
+}
+
+const char* TrendStore::getZoomName(TrendZoom zoom) {
+    switch (zoom) {
+        case TREND_ZOOM_1H:  return "1h";
+        case TREND_ZOOM_4H:  return "4h";
+        case TREND_ZOOM_12H: return "12h";
+        default:             return "?";
+    }
+}
+
+uint16_t TrendStore::renderColumns(TrendZoom zoom, TrendChannel channel,
+                                   TrendColumn* out, uint16_t columns) const {
+    const TrendTier tier = getZoomTier(zoom);
+    const uint32_t span = getZoomBuckets(zoom);
+    const uint32_t available = getBucketCount(tier);
+    uint16_t filled = 0;
+
+    // Column 0 is the oldest; the newest bucket lands in the last column.
+    // Bucket position p (0 = oldest in window) has age (span - 1 - p).
+    for (uint16_t col = 0; col < columns; col++) {
+        uint32_t p_start = (uint32_t)col * span / columns;
+        uint32_t p_end = (uint32_t)(col + 1) * span / columns;
+
+        uint16_t col_min = 0xFFFF;
+        uint16_t col_max = 0;
+        uint32_t col_sum = 0;
+        uint16_t col_n = 0;
+
+        for (uint32_t p = p_start; p < p_end; p++) {
+            uint32_t age = span - 1 - p;
+            if (age >= available) continue;  // Older than recorded history
+
+            const TrendBucket& b = getBucket(tier, (uint16_t)age);
+            if (!b.hasData()) continue;
+
+            if (b.min[channel] < col_min) col_min = b.min[channel];
+            if (b.max[channel] > col_max) col_max = b.max[channel];
+            col_sum += b.mean[channel];
+            col_n++;
+        }
+
+        if (col_n > 0) {
+            out[col].min = col_min;
+            out[col].mean = (uint16_t)(col_sum / col_n);
+            out[col].max = col_max;
+            filled++;
+        } else {
+            out[col].min = TREND_NO_DATA;
+            out[col].mean = TREND_NO_DATA;
+            out[col].max = TREND_NO_DATA;
+        }
+    }
+
+    return filled;
+}
+
+// Private helper functions
+
+void TrendStore::resetAccumulator(Accumulator& acc, uint32_t bucketIndex) {
+    acc.bucketIndex = bucketIndex;
+    for (int c = 0; c < TREND_CHANNEL_COUNT; c++) {
+        acc.sum[c] = 0;
+        acc.min[c] = 0xFFFF;
+        acc.max[c] = 0;
+    }
+    acc.count = 0;
+}
+
+void TrendStore::closeBucket(TrendTier tier) {
+    const Accumulator& acc = _acc[tier];
+    if (acc.count == 0) {
+        pushEmpty(tier);
+        return;
+    }
+
+    TrendBucket bucket;
+    for (int c = 0; c < TREND_CHANNEL_COUNT; c++) {
+        bucket.min[c] = acc.min[c];
+        bucket.mean[c] = (uint16_t)((acc.sum[c] + acc.count / 2) / acc.count);
+        bucket.max[c] = acc.max[c];
+    }
+    pushBucket(tier, bucket);
+}
+
+void TrendStore::pushEmpty(TrendTier tier) {
+    TrendBucket bucket;
+    for (int c = 0; c < TREND_CHANNEL_COUNT; c++) {
+        bucket.min[c] = TREND_NO_DATA;
+        bucket.mean[c] = TREND_NO_DATA;
+        bucket.max[c] = TREND_NO_DATA;
+    }
+    pushBucket(tier, bucket);
+}
+
+void TrendStore::pushBucket(TrendTier tier, const TrendBucket& bucket) {
+    Ring& ring = _rings[tier];
+    ring.buckets[ring.head] = bucket;
+    ring.head = (ring.head + 1) % ring.capacity;
+    if (ring.count < ring.capacity) {
+        ring.count++;
+    }
+    _revision[tier]++;
+}
@@ -0,0 +1,265 @@
+// UartCapture.cpp
+// Implementation of raw UART capture and replay
+
+#include "UartCapture.h"
+#include "HostLink.h"
+
+static const uint8_t CAPTURE_MAGIC[4] = {'M', 'C', 'R', '1'};
+
+// Unsigned LEB128: 7 bits per byte, high bit = more bytes follow
+static uint8_t encodeVarint(uint32_t value, uint8_t* out) {
+    uint8_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+static void putU32(uint8_t* out, uint32_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+    out[2] = (uint8_t)(value >> 16);
+    out[3] = (uint8_t)(value >> 24);
+}
+
+static uint32_t getU32(const uint8_t* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) |
+           ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+// ============================================================================
+// UartRecorder
+// ============================================================================
+
+UartRecorder::UartRecorder(Stream& source)
+    : _source(source)
+    , _clock(&Clock::hardware())
+    , _sink(nullptr)
+    , _maxBytes(0)
+    , _lastChunkUs(0)
+    , _lastReadUs(0)
+    , _chunkLen(0)
+    , _chunkUs(0)
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+bool UartRecorder::startRecording(Print* sink, uint32_t baud, uint32_t max_bytes) {
+    if (sink == nullptr) {
+        return false;
+    }
+    stopRecording();
+
+    const uint32_t now = _clock->micros();
+    uint8_t header[HEADER_SIZE];
+    memcpy(header, CAPTURE_MAGIC, 4);
+    putU32(header + 4, baud);
+    putU32(header + 8, now);
+    putU32(header + 12, 0);
+    if (sink->write(header, HEADER_SIZE) != HEADER_SIZE) {
+        HostLog.println("# Capture: header write failed");
+        return false;
+    }
+
+    memset(&_stats, 0, sizeof(_stats));
+    _stats.fileBytes = HEADER_SIZE;
+    _sink = sink;
+    _maxBytes = max_bytes;
+    _lastChunkUs = now;
+    _chunkLen = 0;
+    return true;
+}
+
+void UartRecorder::stopRecording() {
+    if (_sink == nullptr) {
+        return;
+    }
+    flushChunk();
+    _sink->flush();
+    _sink = nullptr;
+}
+
+int UartRecorder::read() {
+    const int b = _source.read();
+    if (b < 0 || _sink == nullptr) {
+        return b;
+    }
+
+    // Bytes read in one poll form one chunk
+    const uint32_t now = _clock->micros();
+    if (_chunkLen > 0 && (_chunkLen == MAX_CHUNK || now - _lastReadUs > CHUNK_GAP_US)) {
+        flushChunk();
+        if (_sink == nullptr) {
+            return b;           // Size limit reached
+        }
+    }
+    if (_chunkLen == 0) {
+        _chunkUs = now;
+    }
+    _chunk[_chunkLen++] = (uint8_t)b;
+    _lastReadUs = now;
+    return b;
+}
+
+void UartRecorder::flushChunk() {
+    if (_chunkLen == 0) {
+        return;
+    }
+
+    uint8_t header[10];
+    const uint32_t dt = _chunkUs - _lastChunkUs;
+    uint8_t n = encodeVarint(dt, header);
+    n += encodeVarint(_chunkLen, header + n);
+
+    const uint32_t size = n + _chunkLen;
+    if (_stats.fileBytes + size > _maxBytes) {
+        HostLog.printf("# Capture: size limit reached (%lu bytes)\n", (unsigned long)_stats.fileBytes);
+        _chunkLen = 0;
+        _sink->flush();
+        _sink = nullptr;
+        return;
+    }
+    _sink->write(header, n);
+    _sink->write(_chunk, _chunkLen);
+
+    _stats.bytes += _chunkLen;
+    _stats.chunks++;
+    _stats.fileBytes += size;
+    _stats.duration_us += dt;
+    _lastChunkUs = _chunkUs;
+    _chunkLen = 0;
+}
+
+// ============================================================================
+// UartReplay
+// ============================================================================
+
+UartReplay::UartReplay(Stream& capture)
+    : _capture(capture)
+    , _clock(&Clock::hardware())
+    , _mode(REPLAY_FAST)
+    , _baud(0)
+    , _lastClockUs(0)
+    , _elapsedUs(0)
+    , _timeUs(0)
+    , _nextUs(0)
+    , _nextLen(0)
+    , _havePending(false)
+    , _finished(true)
+    , _pos(0)
+    , _len(0)
+    , _commandBytes(0)
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+bool UartReplay::begin(ReplayMode mode) {
+    uint8_t header[UartRecorder::HEADER_SIZE];
+    if (_capture.readBytes(header, sizeof(header)) != sizeof(header) ||
+        memcmp(header, CAPTURE_MAGIC, 4) != 0) {
+        HostLog.println("# Replay: not a capture file");
+        _finished = true;
+        return false;
+    }
+
+    _mode = mode;
+    _baud = getU32(header + 4);
+    _lastClockUs = _clock->micros();
+    _elapsedUs = 0;
+    _timeUs = 0;
+    _havePending = false;
+    _finished = false;
+    _pos = 0;
+    _len = 0;
+    _commandBytes = 0;
+    memset(&_stats, 0, sizeof(_stats));
+    _stats.fileBytes = sizeof(header);
+    return true;
+}
+
+bool UartReplay::update() {
+    if (_finished) {
+        return _pos < _len;
+    }
+
+    if (_mode == REPLAY_FAST) {
+        releaseChunk();
+    } else {
+        // 64-bit elapsed time (the 32-bit clock wraps every 71 min)
+        const uint32_t now = _clock->micros();
+        _elapsedUs += now - _lastClockUs;
+        _lastClockUs = now;
+        while (!_finished) {
+            if (!_havePending && !readChunkHeader()) {
+                break;
+            }
+            if (_nextUs > _elapsedUs) {
+                break;
+            }
+            if (!releaseChunk()) {
+                break;          // Buffer full; rest on the next poll
+            }
+        }
+    }
+    return !isFinished();
+}
+
+bool UartReplay::readChunkHeader() {
+    uint32_t dt = 0;
+    if (!readVarint(dt) || !readVarint(_nextLen) ||
+        _nextLen == 0 || _nextLen > UartRecorder::MAX_CHUNK) {
+        _finished = true;       // End of capture (or truncated / corrupt)
+        return false;
+    }
+    _nextUs = _timeUs + dt;
+    _havePending = true;
+    return true;
+}
+
+bool UartReplay::releaseChunk() {
+    if (!_havePending && !readChunkHeader()) {
+        return false;
+    }
+
+    // Make room for the chunk behind the unread bytes
+    if (_pos > 0) {
+        memmove(_buf, _buf + _pos, _len - _pos);
+        _len -= _pos;
+        _pos = 0;
+    }
+    if (_len + _nextLen > sizeof(_buf)) {
+        return false;
+    }
+
+    const size_t got = _capture.readBytes(_buf + _len, _nextLen);
+    _len += got;
+    _havePending = false;
+    _stats.fileBytes += got;
+    _timeUs = _nextUs;
+    _stats.bytes += got;
+    _stats.chunks++;
+    _stats.duration_us = _timeUs;
+    if (got != _nextLen) {
+        _finished = true;
+        return false;
+    }
+    return true;
+}
+
+bool UartReplay::readVarint(uint32_t& value) {
+    value = 0;
+    for (uint8_t shift = 0; shift < 35; shift += 7) {
+        const int b = _capture.read();
+        if (b < 0) {
+            return false;
+        }
+        _stats.fileBytes++;
+        value |= (uint32_t)(b & 0x7F) << shift;
+        if ((b & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,363 @@
+// VolumetricCapno.cpp
+// Implementation of volumetric capnography (delay alignment, VCO2, dead space)
+//
+// Delay estimation:
+// - At the onset of inspiration fresh gas reaches the airway immediately, so
+//   the CO2 downstroke lags the inspiratory flow onset only by the transport
+//   delay of the sampling line (unlike the upstroke, which also includes the
+//   anatomical dead space washout).
+// - The CO2 fall rate is therefore cross-correlated with an inspiratory-onset
+//   indicator over lags 0..MAX_LAG-1 using exponentially weighted sums.
+// - The lag with the highest correlation (refined by parabolic interpolation)
+//   is the transport delay.
+// Alignment pairs CO2(t) with volume(t - delay), interpolated from a short
+// volume history. Per expiration the aligned stream is integrated:
+//   VCO2 = sum(PCO2 / Pb * dV),  Fowler VD = volume at 50% of the phase II rise
+// Inspired and mixed expired gas fractions (O2, CO2) are volume-weighted
+// means over the inspiration and the following expiration.
+//
+// High-rate input: the volume stream (~100 Hz) is far denser than the CO2
+// packets (8 Hz), so volume samples are queued until the packet after them
+// has arrived and CO2/O2 are interpolated linearly to each sample time.
+// Averaging and warm-up are in time rather than samples, so the correlator
+// behaves the same at any input rate.
+
+#include "VolumetricCapno.h"
+#include <string.h>
+
+// Correlation averaging time constant (ms)
+static const float CORR_TIME_MS = 32000.0f;
+// Time before the correlator result is trusted (ms)
+static const float CORR_WARMUP_MS = 32000.0f;
+// Minimum correlation peak to accept a delay estimate: CO2 fall rate
+// (mmHg/s) x onset rate (1/s); 0.1 mmHg per sample at 8 Hz
+static const float CORR_MIN_PEAK = 6.4f;
+// Minimum expired volume for a valid breath (mL)
+static const float MIN_VTE_ML = 10.0f;
+// Longest expiration accepted (ms)
+static const uint32_t MAX_EXPIRATION_MS = 30000;
+
+VolumetricCapno::VolumetricCapno()
+    : _defaultDelayMs(0.0f)
+    , _baroMmHg(760.0f)
+    , _flowSign(1.0f)
+    , _flowThreshold(10.0f)
+{
+    reset();
+}
+
+void VolumetricCapno::reset() {
+    memset(_corr, 0, sizeof(_corr));
+    memset(_onsetHist, 0, sizeof(_onsetHist));
+    _prevCO2 = 0.0f;
+    _prevPhase = 0;
+    _corrMs = 0.0f;
+    _delaySamples = 0.0f;
+    _delayLocked = false;
+
+    memset(_volHist, 0, sizeof(_volHist));
+    _histHead = 0;
+    _histCount = 0;
+
+    _lastTime = 0;
+    _periodMs = 125.0f;     // Nominal MaCO2 packet interval
+    _primed = false;
+    _periodPrimed = false;
+
+    _queueHead = 0;
+    _queueCount = 0;
+    _co2Prev = 0.0f;
+    _o2Prev = 0.0f;
+    _co2PrevUs = 0;
+    _co2Last = 0.0f;
+    _o2Last = 0.0f;
+    _co2LastUs = 0;
+    _co2Packets = 0;
+
+    _prevAlignedVol = 0.0f;
+    _alignedPrimed = false;
+    _expiring = false;
+    _expStart = 0;
+    _prevBreathEnd = 0;
+    _vte = 0.0f;
+    _vco2 = 0.0f;
+    _feO2Sum = 0.0f;
+    _vti = 0.0f;
+    _fiO2Sum = 0.0f;
+    _fiCO2Sum = 0.0f;
+    _pendingVti = 0.0f;
+    _pendingFiO2 = 0.0f;
+    _pendingFiCO2 = 0.0f;
+    _co2Min = 0.0f;
+    _co2Max = 0.0f;
+    _curveLen = 0;
+
+    memset(&_last, 0, sizeof(_last));
+}
+
+bool VolumetricCapno::addSample(float co2_mmhg, float volume_ml, uint32_t t,
+                                float o2_percent) {
+    if (!_primed) {
+        for (uint16_t i = 0; i < HISTORY; i++) {
+            _volHist[i] = volume_ml;
+        }
+        _histHead = 0;
+        _histCount = HISTORY;
+        _prevCO2 = co2_mmhg;
+        _lastTime = t;
+        _primed = true;
+        return false;
+    }
+
+    // Track the sample interval (samples stamped in the same call have dt = 0)
+    uint32_t dt = t - _lastTime;
+    _lastTime = t;
+    if (dt > 0 && dt < 1000) {
+        if (!_periodPrimed) {
+            _periodMs = (float)dt;
+            _periodPrimed = true;
+        }
+        _periodMs += ((float)dt - _periodMs) * 0.05f;
+    }
+    const float dt_s = _periodMs / 1000.0f;
+
+    // Raw (unaligned) flow for the correlator
+    float prevVol = _volHist[(_histHead + HISTORY - 1) % HISTORY];
+    float flow = (volume_ml - prevVol) * _flowSign / dt_s;
+
+    _volHist[_histHead] = volume_ml;
+    _histHead = (_histHead + 1) % HISTORY;
+
+    updateCorrelation(co2_mmhg, flow, dt_s);
+
+    // Align: CO2 now belongs to the volume seen `delay` samples ago
+    float delay = _delayLocked ? _delaySamples : _defaultDelayMs / _periodMs;
+    float alignedVol = delayedVolume(delay);
+
+    return processAligned(co2_mmhg, o2_percent, alignedVol, t, dt_s);
+}
+
+bool VolumetricCapno::addVolume(float volume_ml, uint32_t t_us) {
+    bool completed = false;
+    if (_queueCount == VOLUME_QUEUE) {
+        // No CO2 for a while: hold the last value for the oldest sample
+        completed = releaseVolume(_volQueue[_queueHead], true);
+        _queueHead = (_queueHead + 1) % VOLUME_QUEUE;
+        _queueCount--;
+    }
+    QueuedVolume& slot = _volQueue[(_queueHead + _queueCount) % VOLUME_QUEUE];
+    slot.volume_ml = volume_ml;
+    slot.t_us = t_us;
+    _queueCount++;
+    return completed;
+}
+
+bool VolumetricCapno::addCO2(float co2_mmhg, float o2_percent, uint64_t t_us) {
+    _co2Prev = _co2Last;
+    _o2Prev = _o2Last;
+    _co2PrevUs = _co2LastUs;
+    _co2Last = co2_mmhg;
+    _o2Last = o2_percent;
+    _co2LastUs = t_us;
+    if (_co2Packets < 2) _co2Packets++;
+
+    // Release every sample up to this packet (later ones wait for the next)
+    bool completed = false;
+    while (_queueCount > 0) {
+        const QueuedVolume& v = _volQueue[_queueHead];
+        if ((int32_t)(v.t_us - (uint32_t)t_us) > 0) {
+            break;
+        }
+        completed |= releaseVolume(v, _co2Packets < 2);
+        _queueHead = (_queueHead + 1) % VOLUME_QUEUE;
+        _queueCount--;
+    }
+    return completed;
+}
+
+bool VolumetricCapno::releaseVolume(const QueuedVolume& v, bool held) {
+    // Volume time on the 64-bit packet timeline (micros() wraps every 71 min)
+    const int64_t t = (int64_t)_co2LastUs + (int32_t)(v.t_us - (uint32_t)_co2LastUs);
+    float co2 = _co2Last;
+    float o2 = _o2Last;
+    if (!held && t < (int64_t)_co2LastUs && _co2LastUs > _co2PrevUs) {
+        float f = (float)(t - (int64_t)_co2PrevUs) / (float)(_co2LastUs - _co2PrevUs);
+        if (f < 0.0f) f = 0.0f;
+        co2 = _co2Prev + (_co2Last - _co2Prev) * f;
+        o2 = _o2Prev + (_o2Last - _o2Prev) * f;
+    }
+    return addSample(co2, v.volume_ml, (uint32_t)(t / 1000), o2);
+}
+
+void VolumetricCapno::updateCorrelation(float co2, float flow, float dt_s) {
+    // Inspiratory onset: flow phase changes to inspiration on this sample
+    int8_t phase = (flow > _flowThreshold) ? 1 : ((flow < -_flowThreshold) ? -1 : _prevPhase);
+    uint8_t onset = (phase < 0 && _prevPhase >= 0) ? 1 : 0;
+    _prevPhase = phase;
+
+    // Shift onset history (index 0 = current sample)
+    memmove(&_onsetHist[1], &_onsetHist[0], MAX_LAG - 1);
+    _onsetHist[0] = onset;
+
+    // CO2 fall rate (mmHg/s, positive on the downstroke)
+    const float fall = (_prevCO2 - co2) / dt_s;
+    _prevCO2 = co2;
+
+    // R[k] = E[ fall(t) * onset(t - k) / dt ]
+    const float alpha = _periodMs / CORR_TIME_MS;
+    const float weight = fall / dt_s;
+    for (uint16_t k = 0; k < MAX_LAG; k++) {
+        _corr[k] += (weight * _onsetHist[k] - _corr[k]) * alpha;
+    }
+
+    _corrMs += _periodMs;
+    if (_corrMs < CORR_WARMUP_MS) {
+        return;
+    }
+    _corrMs = CORR_WARMUP_MS;
+
+    uint16_t best = 0;
+    for (uint16_t k = 1; k < MAX_LAG; k++) {
+        if (_corr[k] > _corr[best]) best = k;
+    }
+
+    if (_corr[best] < CORR_MIN_PEAK) {
+        _delayLocked = false;
+        return;
+    }
+
+    // Parabolic interpolation around the peak for sub-sample resolution
+    float offset = 0.0f;
+    if (best > 0 && best < MAX_LAG - 1) {
+        float l = _corr[best - 1];
+        float c0 = _corr[best];
+        float r = _corr[best + 1];
+        float den = l - 2.0f * c0 + r;
+        if (den < 0.0f) {
+            offset = 0.5f * (l - r) / den;
+        }
+    }
+
+    _delaySamples = (float)best + offset;
+    _delayLocked = true;
+}
+
+float VolumetricCapno::delayedVolume(float delay_samples) const {
+    if (delay_samples < 0.0f) delay_samples = 0.0f;
+    if (delay_samples > (float)(HISTORY - 2)) delay_samples = (float)(HISTORY - 2);
+
+    uint16_t i0 = (uint16_t)delay_samples;
+    float frac = delay_samples - (float)i0;
+
+    // i samples back from the newest entry
+    float v0 = _volHist[(_histHead + HISTORY - 1 - i0) % HISTORY];
+    float v1 = _volHist[(_histHead + HISTORY - 2 - i0) % HISTORY];
+    return v0 + (v1 - v0) * frac;
+}
+
+bool VolumetricCapno::processAligned(float co2, float o2, float volume, uint32_t t, float dt_s) {
+    if (!_alignedPrimed) {
+        _prevAlignedVol = volume;
+        _alignedPrimed = true;
+        return false;
+    }
+
+    float dV = (volume - _prevAlignedVol) * _flowSign;
+    _prevAlignedVol = volume;
+    float flow = dV / dt_s;
+    const float fo2 = o2 / 100.0f;
+    const float fco2 = co2 / _baroMmHg;
+
+    if (!_expiring) {
+        if (flow < -_flowThreshold) {
+            // Inspiration: volume-weighted inspired fractions
+            _vti -= dV;
+            _fiO2Sum -= fo2 * dV;
+            _fiCO2Sum -= fco2 * dV;
+        }
+        if (flow <= _flowThreshold) {
+            return false;
+        }
+        // Start of expiration (close the inspiration that preceded it)
+        _pendingVti = _vti;
+        _pendingFiO2 = (_vti > 0.0f) ? _fiO2Sum / _vti : fo2;
+        _pendingFiCO2 = (_vti > 0.0f) ? _fiCO2Sum / _vti : 0.0f;
+        _vti = 0.0f;
+        _fiO2Sum = 0.0f;
+        _fiCO2Sum = 0.0f;
+
+        _expiring = true;
+        _expStart = t;
+        _vte = 0.0f;
+        _vco2 = 0.0f;
+        _feO2Sum = 0.0f;
+        _co2Min = co2;
+        _co2Max = co2;
+        _curveLen = 0;
+    } else if (flow < -_flowThreshold) {
+        // Inspiratory flow: the expiration is complete
+        _expiring = false;
+        bool completed = finishBreath(t);
+        // This sample already belongs to the next inspiration
+        _vti = -dV;
+        _fiO2Sum = -fo2 * dV;
+        _fiCO2Sum = -fco2 * dV;
+        return completed;
+    } else if (t - _expStart > MAX_EXPIRATION_MS) {
+        _expiring = false;     // Not a breath (sensor disconnected, drift)
+        return false;
+    }
+
+    // Net (signed) integration so noise during pauses cancels out
+    _vte += dV;
+    _vco2 += fco2 * dV;
+    _feO2Sum += fo2 * dV;
+    if (co2 < _co2Min) _co2Min = co2;
+    if (co2 > _co2Max) _co2Max = co2;
+    if (_curveLen < MAX_CURVE_POINTS) {
+        _curveVol[_curveLen] = _vte;
+        _curveCO2[_curveLen] = co2;
+        _curveLen++;
+    }
+    return false;
+}
+
+bool VolumetricCapno::finishBreath(uint32_t t) {
+    if (_vte < MIN_VTE_ML) {
+        return false;
+    }
+
+    _last.vte_ml = _vte;
+    _last.vco2_ml = _vco2;
+    _last.vd_fowler_ml = fowlerDeadSpace();
+    _last.delay_ms = _delayLocked ? getDelayMs() : _defaultDelayMs;
+
+    _last.vti_ml = _pendingVti;
+    _last.fi_o2 = _pendingFiO2;
+    _last.fi_co2 = _pendingFiCO2;
+    _last.fe_o2 = _feO2Sum / _vte;
+    _last.fe_co2 = _vco2 / _vte;
+
+    uint32_t period = (_prevBreathEnd > 0) ? t - _prevBreathEnd : 0;
+    _last.period_ms = (float)period;
+    _last.vco2_ml_min = (period > 0) ? _vco2 * 60000.0f / (float)period : 0.0f;
+    _last.breath_count++;
+    _last.end_time = t;
+    _prevBreathEnd = t;
+    return true;
+}
+
+float VolumetricCapno::fowlerDeadSpace() const {
+    // Volume at which CO2 crosses the midpoint of the phase II rise
+    float level = _co2Min + 0.5f * (_co2Max - _co2Min);
+
+    for (uint16_t i = 1; i < _curveLen; i++) {
+        if (_curveCO2[i] >= level) {
+            float c0 = _curveCO2[i - 1];
+            float c1 = _curveCO2[i];
+            float frac = (c1 > c0) ? (level - c0) / (c1 - c0) : 0.0f;
+            return _curveVol[i - 1] + (_curveVol[i] - _curveVol[i - 1]) * frac;
+        }
+    }
+    return 0.0f;
+}
@@ -3,22 +3,82 @@
 
 #include "WiFiManager.h"
 #include "ChartJS.h"
+#include "Profiler.h"
+#include "HostLink.h"
+#include <memory>
 
 // Store pointer for static callback
 static WiFiManager* _instance = nullptr;
 
+// One session download; lives as long as its response (async TCP task).
+// Throughput and heap use are reported when the response is freed.
+class SessionDownload {
+public:
+    SessionDownload(fs::FS& fs, uint32_t id, SessionExportFormat format,
+                    uint32_t heapStart, SessionDownloadStats& report)
+        : _session(fs, id, format)
+        , _report(report)
+        , _id(id)
+        , _startMs(millis())
+        , _lastMs(_startMs)
+        , _heapStart(heapStart)
+        , _heapMin(heapStart)
+        , _bytes(0)
+    {
+    }
+
+    ~SessionDownload() {
+        if (_bytes == 0) {
+            return;
+        }
+        const uint32_t ms = _lastMs - _startMs;
+        _report.id = _id;
+        _report.bytes = _bytes;
+        _report.ms = ms;
+        _report.heapPeakUse = _heapStart - _heapMin;
+        _report.downloads++;
+        HostLog.printf("# Session %lu download: %lu bytes in %lu ms (%.1f kB/s), peak heap use %lu bytes\n",
+                       (unsigned long)_id, (unsigned long)_bytes, (unsigned long)ms,
+                       ms > 0 ? (float)_bytes / ms : 0.0f, (unsigned long)(_heapStart - _heapMin));
+    }
+
+    SessionExport& session() { return _session; }
+
+    size_t read(uint8_t* buffer, size_t maxLen) {
+        const size_t n = _session.read(buffer, maxLen);
+        if (n > 0) {
+            _bytes += n;
+            _lastMs = millis();
+        }
+        const uint32_t freeHeap = ESP.getFreeHeap();
+        if (freeHeap < _heapMin) _heapMin = freeHeap;
+        return n;
+    }
+
+private:
+    SessionExport _session;
+    SessionDownloadStats& _report;
+    uint32_t _id;
+    uint32_t _startMs;
+    uint32_t _lastMs;
+    uint32_t _heapStart;
+    uint32_t _heapMin;
+    uint32_t _bytes;
+};
+
 WiFiManager::WiFiManager(uint16_t port)
     : _server(nullptr)
     , _ws(nullptr)
     , _port(port)
     , _isAP(false)
     , _serverRunning(false)
-    , _cmdQueueHead(0)
-    , _cmdQueueTail(0)
     , _dataLogger(nullptr)
+    , _timeline(nullptr)
+    , _sessions(nullptr)
 {
     _instance = this;
-    memset(_cmdQueue, 0, sizeof(_cmdQueue));
+    memset(&_cursor, 0, sizeof(_cursor));
+    memset(&_lastDownload, 0, sizeof(_lastDownload));
 }
 
 WiFiManager::~WiFiManager() {
@@ -28,7 +88,7 @@ WiFiManager::~WiFiManager() {
 }
 
 bool WiFiManager::beginAP(const char* ssid, const char* password) {
-    Serial.println("Starting WiFi Access Point...");
+    HostLog.println("Starting WiFi Access Point...");
     
     _isAP = true;
     
@@ -41,19 +101,19 @@ bool WiFiManager::beginAP(const char* ssid, const char* password) {
     }
     
     if (!success) {
-        Serial.println("Failed to start AP");
+        HostLog.println("Failed to start AP");
         return false;
     }
     
     IPAddress ip = WiFi.softAPIP();
-    Serial.printf("AP Started: SSID='%s'\n", ssid);
-    Serial.printf("IP Address: %s\n", ip.toString().c_str());
+    HostLog.printf("AP Started: SSID='%s'\n", ssid);
+    HostLog.printf("IP Address: %s\n", ip.toString().c_str());
     
     return true;
 }
 
 bool WiFiManager::beginStation(const char* ssid, const char* password, unsigned long timeout_ms) {
-    Serial.printf("Connecting to WiFi: %s\n", ssid);
+    HostLog.printf("Connecting to WiFi: %s\n", ssid);
     
     _isAP = false;
     WiFi.mode(WIFI_STA);
@@ -62,22 +122,22 @@ bool WiFiManager::beginStation(const char* ssid, const char* password, unsigned
     unsigned long startTime = millis();
     while (WiFi.status() != WL_CONNECTED && (millis() - startTime) < timeout_ms) {
         delay(500);
-        Serial.print(".");
+        HostLog.print(".");
     }
-    Serial.println();
+    HostLog.println();
     
     if (WiFi.status() != WL_CONNECTED) {
-        Serial.println("Failed to connect to WiFi");
+        HostLog.println("Failed to connect to WiFi");
         return false;
     }
     
-    Serial.printf("Connected! IP: %s\n", WiFi.localIP().toString().c_str());
+    HostLog.printf("Connected! IP: %s\n", WiFi.localIP().toString().c_str());
     return true;
 }
 
 bool WiFiManager::startServer() {
     if (_serverRunning) {
-        Serial.println("Server already running");
+        HostLog.println("Server already running");
         return true;
     }
     
@@ -110,6 +170,23 @@ bool WiFiManager::startServer() {
     _server->on("/api/setFormat", HTTP_GET, [this](AsyncWebServerRequest* request) {
         handleSetFormat(request);
     });
+    
+    _server->on("/api/profile", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleProfile(request);
+    });
+    
+    _server->on("/api/trace", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleTrace(request);
+    });
+    
+    // Also matches /api/sessions/<id>. The filter runs before the headers no
+    // handler asked for are dropped, and keeps Range (resumed downloads).
+    _server->on("/api/sessions", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handleSessions(request);
+    }).setFilter([](AsyncWebServerRequest* request) {
+        request->addInterestingHeader("Range");
+        return true;
+    });
 
     // Serve Chart.js from embedded gzip data (no internet required)
     _server->on("/chart.min.js", HTTP_GET, [](AsyncWebServerRequest* request) {
@@ -127,7 +204,7 @@ bool WiFiManager::startServer() {
     _server->begin();
     _serverRunning = true;
     
-    Serial.println("Web server started");
+    HostLog.println("Web server started");
     return true;
 }
 
@@ -135,16 +212,33 @@ void WiFiManager::stopServer() {
     if (_server && _serverRunning) {
         _server->end();
         _serverRunning = false;
-        Serial.println("Web server stopped");
+        HostLog.println("Web server stopped");
+    }
+}
+
+void WiFiManager::setTimeline(const SampleTimeline* timeline) {
+    _timeline = timeline;
+    if (_timeline) {
+        _cursor = _timeline->attach();
     }
 }
 
 void WiFiManager::update(const CO2Data& data) {
     if (!_serverRunning) return;
+    PROFILE_SCOPE(PROF_WEB_UPDATE);
     
     // Broadcast to all WebSocket clients
-    String json = dataToJson(data);
-    _ws->textAll(json);
+    if (!_timeline) {
+        String json = dataToJson(data);
+        _ws->textAll(json);
+        return;
+    }
+    
+    CO2Data frame = data;
+    while (_timeline->read(_cursor, frame)) {
+        String json = dataToJson(frame);
+        _ws->textAll(json);
+    }
 }
 
 void WiFiManager::loop() {
@@ -166,14 +260,12 @@ IPAddress WiFiManager::getIP() const {
 }
 
 bool WiFiManager::hasCommand() {
-    return _cmdQueueHead != _cmdQueueTail;
+    return !_cmdQueue.empty();
 }
 
 uint8_t WiFiManager::getCommand() {
-    if (!hasCommand()) return 0;
-    
-    uint8_t cmd = _cmdQueue[_cmdQueueTail];
-    _cmdQueueTail = (_cmdQueueTail + 1) % CMD_QUEUE_SIZE;
+    uint8_t cmd = 0;
+    _cmdQueue.pop(cmd);
     return cmd;
 }
 
@@ -225,7 +317,7 @@ void WiFiManager::handleSetFormat(AsyncWebServerRequest* request) {
     // Set format via external reference (passed to WiFiManager)
     if (_dataLogger) {
         _dataLogger->setOutputFormat(format == 0 ? FORMAT_LEGACY_LABVIEW : FORMAT_TAB_SEPARATED);
-        Serial.printf("Output format changed to: %s\n", 
+        HostLog.printf("Output format changed to: %s\n", 
                      format == 0 ? "Legacy LabVIEW" : "Tab-Separated ASCII");
         request->send(200, "text/plain", "OK");
     } else {
@@ -233,20 +325,134 @@ void WiFiManager::handleSetFormat(AsyncWebServerRequest* request) {
     }
 }
 
+void WiFiManager::handleProfile(AsyncWebServerRequest* request) {
+    // Histograms are written by loop() without locking: a report taken
+    // mid-update can be off by one sample, which is fine for profiling.
+    // ?reset clears them after the report (interval measurements).
+    AsyncResponseStream* response = request->beginResponseStream("application/json");
+    Profiler::printJson(*response);
+    request->send(response);
+    
+    if (request->hasParam("reset")) {
+        Profiler::reset();
+    }
+}
+
+void WiFiManager::handleTrace(AsyncWebServerRequest* request) {
+    // Streamed in chunks straight from the ring (~80 bytes per event, too
+    // much to build in RAM); recording is paused until the export is freed
+    // together with the response
+    std::shared_ptr<TraceExport> trace = std::make_shared<TraceExport>();
+    AsyncWebServerResponse* response = request->beginChunkedResponse("application/json",
+        [trace](uint8_t* buffer, size_t maxLen, size_t) -> size_t {
+            return trace->read(buffer, maxLen);
+        });
+    response->addHeader("Content-Disposition", "attachment; filename=\"trace.json\"");
+    request->send(response);
+}
+
+void WiFiManager::handleSessions(AsyncWebServerRequest* request) {
+    static const size_t BASE_LEN = sizeof("/api/sessions") - 1;
+    const char* url = request->url().c_str();
+    if (url[BASE_LEN] == '/') {
+        handleSessionDownload(request, strtoul(url + BASE_LEN + 1, nullptr, 10));
+        return;
+    }
+    if (!_sessions) {
+        request->send(500, "text/plain", "Session storage not available");
+        return;
+    }
+    
+    const SessionDownloadStats& d = _lastDownload;
+    AsyncResponseStream* response = request->beginResponseStream("application/json");
+    response->printf("{\"recording\":%lu,\"sessions\":", (unsigned long)_sessions->getRecordingId());
+    _sessions->printJson(*response);
+    response->printf(",\"lastDownload\":{\"id\":%lu,\"bytes\":%lu,\"ms\":%lu,\"kBps\":%.1f,\"heapPeakUse\":%lu,\"downloads\":%lu}}",
+                     (unsigned long)d.id, (unsigned long)d.bytes, (unsigned long)d.ms,
+                     d.ms > 0 ? (float)d.bytes / d.ms : 0.0f,
+                     (unsigned long)d.heapPeakUse, (unsigned long)d.downloads);
+    request->send(response);
+}
+
+void WiFiManager::handleSessionDownload(AsyncWebServerRequest* request, uint32_t id) {
+    if (!_sessions || !_sessions->getFS()) {
+        request->send(500, "text/plain", "Session storage not available");
+        return;
+    }
+    if (id != 0 && id == _sessions->getRecordingId()) {
+        request->send(409, "text/plain", "Session is recording");
+        return;
+    }
+    
+    // Streamed from flash in blocks: the file is never held in RAM.
+    // ?format=csv converts on the fly (chunked, no Range support).
+    const bool csv = request->hasParam("format") && request->getParam("format")->value() == "csv";
+    const uint32_t heapStart = ESP.getFreeHeap();
+    std::shared_ptr<SessionDownload> download = std::make_shared<SessionDownload>(
+        *_sessions->getFS(), id, csv ? SESSION_EXPORT_CSV : SESSION_EXPORT_RAW, heapStart, _lastDownload);
+    if (!download->session().isOpen() || download->session().size() == 0) {
+        request->send(404, "text/plain", "Session not found");
+        return;
+    }
+    
+    AwsResponseFiller filler = [download](uint8_t* buffer, size_t maxLen, size_t) -> size_t {
+        return download->read(buffer, maxLen);
+    };
+    char header[64];
+    AsyncWebServerResponse* response;
+    if (csv) {
+        response = request->beginChunkedResponse("text/csv", filler);
+    } else {
+        // Range lets a client resume a broken download
+        const uint32_t size = download->session().size();
+        uint32_t first = 0;
+        uint32_t last = size - 1;
+        const RangeResult range = request->hasHeader("Range")
+            ? SessionExport::parseRange(request->getHeader("Range")->value().c_str(), size, first, last)
+            : RANGE_NONE;
+        if (range == RANGE_UNSATISFIABLE) {
+            response = request->beginResponse(416, "text/plain", "Range not satisfiable");
+            snprintf(header, sizeof(header), "bytes */%lu", (unsigned long)size);
+            response->addHeader("Content-Range", header);
+            request->send(response);
+            return;
+        }
+        if (range == RANGE_OK && !download->session().setRange(first, last)) {
+            request->send(500, "text/plain", "Session read failed");
+            return;
+        }
+        response = request->beginResponse("application/octet-stream", last - first + 1, filler);
+        if (range == RANGE_OK) {
+            response->setCode(206);
+            snprintf(header, sizeof(header), "bytes %lu-%lu/%lu",
+                     (unsigned long)first, (unsigned long)last, (unsigned long)size);
+            response->addHeader("Content-Range", header);
+        }
+        response->addHeader("Accept-Ranges", "bytes");
+    }
+    snprintf(header, sizeof(header), "attachment; filename=\"session-%lu.%s\"",
+             (unsigned long)id, csv ? "csv" : "ses");
+    response->addHeader("Content-Disposition", header);
+    request->send(response);
+}
+
 void WiFiManager::handleNotFound(AsyncWebServerRequest* request) {
     request->send(404, "text/plain", "Not found");
 }
 
 void WiFiManager::onWebSocketEvent(AsyncWebSocket* server, AsyncWebSocketClient* client,
                                    AwsEventType type, void* arg, uint8_t* data, size_t len) {
+    TRACE_SCOPE("ws_event");
+    
     switch (type) {
         case WS_EVT_CONNECT:
-            Serial.printf("WebSocket client #%u connected from %s\n", 
+            Tracer::nameTask("async_tcp");
+            HostLog.printf("WebSocket client #%u connected from %s\n", 
                          client->id(), client->remoteIP().toString().c_str());
             break;
             
         case WS_EVT_DISCONNECT:
-            Serial.printf("WebSocket client #%u disconnected\n", client->id());
+            HostLog.printf("WebSocket client #%u disconnected\n", client->id());
             break;
             
         case WS_EVT_DATA: {
@@ -285,12 +491,39 @@ String WiFiManager::dataToJson(const CO2Data& data) {
     doc["fetco2"] = data.fetco2;
     doc["fco2"] = data.fco2;
     doc["rr"] = data.respiratory_rate;
-    doc["o2_percent"] = data.o2_percent;
-    doc["volume_ml"] = data.volume_ml;
+    for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+        doc[Sensors::info(ch).key] = data.sensors[ch].value;
+    }
     doc["status1"] = data.status1;
     doc["status2"] = data.status2;
     doc["valid"] = data.valid;
     
+    // Breath-by-breath metrics (last completed breath)
+    doc["fico2_wave"] = data.breath.fico2_x10 / 10.0f;
+    doc["ti_ms"] = data.breath.ti_ms;
+    doc["te_ms"] = data.breath.te_ms;
+    doc["p3_slope"] = data.breath.phase3_slope / 100.0f;
+    doc["rr_wave"] = data.breath.rr_x10 / 10.0f;
+    doc["breaths"] = data.breath.breath_count;
+    
+    // Volumetric capnography (last aligned expiration)
+    doc["vte_ml"] = data.vcap.vte_ml;
+    doc["vco2_ml"] = data.vcap.vco2_ml;
+    doc["vco2_ml_min"] = data.vcap.vco2_ml_min;
+    doc["vd_ml"] = data.vcap.vd_fowler_ml;
+    doc["co2_delay_ms"] = data.vcap.delay_ms;
+    
+    // Indirect calorimetry (rolling 30 s / 1 min windows)
+    doc["vo2_30s"] = data.metabolic30s.vo2_ml_min;
+    doc["vco2_30s"] = data.metabolic30s.vco2_ml_min;
+    doc["rq_30s"] = data.metabolic30s.rq;
+    doc["ee_30s"] = data.metabolic30s.ee_kcal_day;
+    doc["vo2_60s"] = data.metabolic60s.vo2_ml_min;
+    doc["vco2_60s"] = data.metabolic60s.vco2_ml_min;
+    doc["rq_60s"] = data.metabolic60s.rq;
+    doc["ee_60s"] = data.metabolic60s.ee_kcal_day;
+    doc["ve_l_min"] = data.metabolic60s.ve_l_min;
+    
     // Status flags (bit=0 means OK for pump, bit=1 means problem for leak/occlusion)
     doc["pump_running"] = (data.status2 & 0x01) == 0;  // 0=running, 1=stopped
     doc["leak_detected"] = (data.status2 & 0x02) != 0;
@@ -302,19 +535,16 @@ String WiFiManager::dataToJson(const CO2Data& data) {
 }
 
 void WiFiManager::enqueueCommand(uint8_t cmd) {
-    uint8_t nextHead = (_cmdQueueHead + 1) % CMD_QUEUE_SIZE;
-    if (nextHead != _cmdQueueTail) {
-        _cmdQueue[_cmdQueueHead] = cmd;
-        _cmdQueueHead = nextHead;
-        Serial.printf("Command enqueued: 0x%02X\n", cmd);
+    if (_cmdQueue.push(cmd)) {
+        HostLog.printf("Command enqueued: 0x%02X\n", cmd);
     } else {
-        Serial.println("Command queue full!");
+        HostLog.println("Command queue full!");
     }
 }
 
 // HTML page with embedded CSS and JavaScript
 String WiFiManager::getIndexHTML() {
-    return R"rawliteral(
+    String html = R"rawliteral(
 <!DOCTYPE html>
 <html>
 <head>
@@ -532,7 +762,7 @@ String WiFiManager::getIndexHTML() {
         </div>
 
         <!-- Instant Values -->
-        <div class="metrics-grid">
+        <div class="metrics-grid" id="metrics">
             <div class="metric-card">
                 <div class="metric-label">End-Tidal CO₂ [kPa]</div>
                 <div class="metric-value" id="fetco2">--</div>
@@ -547,16 +777,6 @@ String WiFiManager::getIndexHTML() {
                 <div class="metric-label">RR [bpm]</div>
                 <div class="metric-value" id="rr">--</div>
             </div>
-
-            <div class="metric-card">
-                <div class="metric-label">O₂ [%]</div>
-                <div class="metric-value" id="o2">--</div>
-            </div>
-
-            <div class="metric-card">
-                <div class="metric-label">Volume [mL]</div>
-                <div class="metric-value" id="volume">--</div>
-            </div>
         </div>
 
         <!-- Charts -->
@@ -565,15 +785,8 @@ String WiFiManager::getIndexHTML() {
             <canvas id="co2Chart"></canvas>
         </div>
 
-        <div class="chart-container">
-            <div class="chart-title">O₂</div>
-            <canvas id="o2Chart"></canvas>
-        </div>
-
-        <div class="chart-container">
-            <div class="chart-title">Volume</div>
-            <canvas id="volumeChart"></canvas>
-        </div>
+        <!-- One chart per sensor channel (SENSORS) -->
+        <div id="sensorCharts"></div>
 
         <!-- Controls -->
         <div class="controls">
@@ -625,13 +838,17 @@ String WiFiManager::getIndexHTML() {
         // Chart configuration
         const maxDataPoints = 960; // 2 minutes at 8 Hz (8 * 60 * 2)
         
+        // Sensor channels shown on this page (generated from the firmware's sensor list)
+        const SENSORS = /*SENSORS*/[];
+        const SENSOR_COLORS = ['75, 192, 192', '255, 99, 132', '255, 159, 64', '153, 102, 255'];
+        
         // Chart.js instances
-        let co2Chart, o2Chart, volumeChart;
+        let co2Chart;
+        let sensorCharts = {};
         
         // Data buffers
         let co2Data = [];
-        let o2Data = [];
-        let volumeData = [];
+        let sensorData = {};
         let timeLabels = [];
         
         // Complete data storage for export (includes all received data)
@@ -692,8 +909,11 @@ String WiFiManager::getIndexHTML() {
             document.getElementById('fetco2').textContent = ((data.fetco2 || 0) * 0.133322).toFixed(1);
             document.getElementById('fco2').textContent = ((data.co2_waveform || 0) * 0.133322).toFixed(1);
             document.getElementById('rr').textContent = data.rr || '--';
-            document.getElementById('o2').textContent = data.o2_percent ? data.o2_percent.toFixed(1) : '--';
-            document.getElementById('volume').textContent = data.volume_ml ? Math.round(data.volume_ml) : '--';
+            SENSORS.forEach(s => {
+                const v = data[s.key];
+                document.getElementById('sensor_' + s.key).textContent =
+                    (typeof v === 'number') ? v.toFixed(s.decimals) : '--';
+            });
             
             // Update status indicators
             updateStatus('pumpStatus', data.pump_running, 'Pump', 'Pump!');
@@ -709,33 +929,31 @@ String WiFiManager::getIndexHTML() {
                 recordingStartTime = now;
             }
             
-            dataLog.push({
+            const row = {
                 timestamp: now.toISOString(),
                 elapsed_seconds: (now - recordingStartTime) / 1000,
                 co2_waveform: (data.co2_waveform || 0) * 0.133322,
                 fetco2: (data.fetco2 || 0) * 0.133322,
                 fco2: (data.fco2 || 0) * 0.133322,
-                rr: data.rr || 0,
-                o2_percent: data.o2_percent || 0,
-                volume_ml: data.volume_ml || 0,
-                pump_running: data.pump_running || false,
-                leak_detected: data.leak_detected || false,
-                occlusion_detected: data.occlusion_detected || false,
-                status1: data.status1 || 0,
-                status2: data.status2 || 0
-            });
+                rr: data.rr || 0
+            };
+            SENSORS.forEach(s => { row[s.key] = data[s.key] || 0; });
+            row.pump_running = data.pump_running || false;
+            row.leak_detected = data.leak_detected || false;
+            row.occlusion_detected = data.occlusion_detected || false;
+            row.status1 = data.status1 || 0;
+            row.status2 = data.status2 || 0;
+            dataLog.push(row);
             
             // Update chart data
             co2Data.push((data.co2_waveform || 0) * 0.133322);  // Convert mmHg to kPa
-            o2Data.push(data.o2_percent || 0);
-            volumeData.push(data.volume_ml || 0);
+            SENSORS.forEach(s => sensorData[s.key].push(data[s.key] || 0));
             timeLabels.push(timeStr);
             
             // Keep only last maxDataPoints in charts
             if (co2Data.length > maxDataPoints) {
                 co2Data.shift();
-                o2Data.shift();
-                volumeData.shift();
+                SENSORS.forEach(s => sensorData[s.key].shift());
                 timeLabels.shift();
             }
             
@@ -771,13 +989,33 @@ String WiFiManager::getIndexHTML() {
             co2Chart.data.datasets[0].data = co2Data;
             co2Chart.update('none'); // Update without animation for performance
             
-            o2Chart.data.labels = timeLabels;
-            o2Chart.data.datasets[0].data = o2Data;
-            o2Chart.update('none');
-            
-            volumeChart.data.labels = timeLabels;
-            volumeChart.data.datasets[0].data = volumeData;
-            volumeChart.update('none');
+            SENSORS.forEach(s => {
+                const chart = sensorCharts[s.key];
+                chart.data.labels = timeLabels;
+                chart.data.datasets[0].data = sensorData[s.key];
+                chart.update('none');
+            });
+        }
+        
+        // Value tile and chart container per sensor channel
+        function buildSensorViews() {
+            const metrics = document.getElementById('metrics');
+            const charts = document.getElementById('sensorCharts');
+            SENSORS.forEach(s => {
+                sensorData[s.key] = [];
+                
+                const card = document.createElement('div');
+                card.className = 'metric-card';
+                card.innerHTML = `<div class="metric-label">${s.label} [${s.unit}]</div>` +
+                                 `<div class="metric-value" id="sensor_${s.key}">--</div>`;
+                metrics.appendChild(card);
+                
+                const container = document.createElement('div');
+                container.className = 'chart-container';
+                container.innerHTML = `<div class="chart-title">${s.label}</div>` +
+                                      `<canvas id="chart_${s.key}"></canvas>`;
+                charts.appendChild(container);
+            });
         }
         
         function sendCommand(cmd) {
@@ -870,64 +1108,37 @@ String WiFiManager::getIndexHTML() {
                 }
             });
             
-            // O2 Chart
-            o2Chart = new Chart(document.getElementById('o2Chart'), {
-                ...chartConfig,
-                data: {
-                    labels: timeLabels,
-                    datasets: [{
-                        data: o2Data,
-                        borderColor: 'rgb(75, 192, 192)',
-                        backgroundColor: 'rgba(75, 192, 192, 0.1)',
-                        borderWidth: 2,
-                        fill: true
-                    }]
-                },
-                options: {
-                    ...chartConfig.options,
-                    scales: {
-                        ...chartConfig.options.scales,
-                        y: {
-                            ...chartConfig.options.scales.y,
-                            min: 0,
-                            max: 100,
-                            title: {
-                                display: true,
-                                text: 'O₂ (%)'
+            // Sensor charts
+            SENSORS.forEach((s, i) => {
+                const color = SENSOR_COLORS[i % SENSOR_COLORS.length];
+                sensorCharts[s.key] = new Chart(document.getElementById('chart_' + s.key), {
+                    ...chartConfig,
+                    data: {
+                        labels: timeLabels,
+                        datasets: [{
+                            data: sensorData[s.key],
+                            borderColor: `rgb(${color})`,
+                            backgroundColor: `rgba(${color}, 0.1)`,
+                            borderWidth: 2,
+                            fill: true
+                        }]
+                    },
+                    options: {
+                        ...chartConfig.options,
+                        scales: {
+                            ...chartConfig.options.scales,
+                            y: {
+                                ...chartConfig.options.scales.y,
+                                title: {
+                                    display: true,
+                                    text: `${s.label} (${s.unit})`
+                                },
+                                suggestedMin: s.min,
+                                suggestedMax: s.max
                             }
                         }
                     }
-                }
-            });
-            
-            // Volume Chart
-            volumeChart = new Chart(document.getElementById('volumeChart'), {
-                ...chartConfig,
-                data: {
-                    labels: timeLabels,
-                    datasets: [{
-                        data: volumeData,
-                        borderColor: 'rgb(255, 99, 132)',
-                        backgroundColor: 'rgba(255, 99, 132, 0.1)',
-                        borderWidth: 2,
-                        fill: true
-                    }]
-                },
-                options: {
-                    ...chartConfig.options,
-                    scales: {
-                        ...chartConfig.options.scales,
-                        y: {
-                            ...chartConfig.options.scales.y,
-                            title: {
-                                display: true,
-                                text: 'Volume (mL)'
-                            },
-                            suggestedMin: 0,
-                            suggestedMax: 1000
-                        }
-                    }
-                }
+                });
             });
         }
         
@@ -938,11 +1149,14 @@ String WiFiManager::getIndexHTML() {
             }
             
             // Create CSV header
-            let csv = 'Timestamp,Elapsed(s),CO2_Waveform(kPa),FetCO2(kPa),FiCO2(kPa),RR(bpm),O2(%),Volume(mL),Pump_Running,Leak_Detected,Occlusion_Detected,Status1,Status2\n';
+            let csv = 'Timestamp,Elapsed(s),CO2_Waveform(kPa),FetCO2(kPa),FiCO2(kPa),RR(bpm),' +
+                      SENSORS.map(s => `${s.label}(${s.unit}),`).join('') +
+                      'Pump_Running,Leak_Detected,Occlusion_Detected,Status1,Status2\n';
 
             // Add data rows
             dataLog.forEach(row => {
-                csv += `${row.timestamp},${row.elapsed_seconds.toFixed(3)},${row.co2_waveform.toFixed(2)},${row.fetco2.toFixed(2)},${row.fco2.toFixed(2)},${row.rr},${row.o2_percent.toFixed(2)},${row.volume_ml.toFixed(1)},${row.pump_running},${row.leak_detected},${row.occlusion_detected},${row.status1},${row.status2}\n`;
+                const sensors = SENSORS.map(s => row[s.key].toFixed(s.decimals + 1) + ',').join('');
+                csv += `${row.timestamp},${row.elapsed_seconds.toFixed(3)},${row.co2_waveform.toFixed(2)},${row.fetco2.toFixed(2)},${row.fco2.toFixed(2)},${row.rr},${sensors}${row.pump_running},${row.leak_detected},${row.occlusion_detected},${row.status1},${row.status2}\n`;
             });
             
             // Create download
@@ -980,8 +1194,7 @@ String WiFiManager::getIndexHTML() {
                         fetco2: 'kPa',
                         fco2: 'kPa',
                         rr: 'bpm',
-                        o2_percent: '%',
-                        volume_ml: 'mL'
+                        ...Object.fromEntries(SENSORS.map(s => [s.key, s.unit]))
                     }
                 },
                 data: dataLog
@@ -1015,8 +1228,7 @@ String WiFiManager::getIndexHTML() {
             // Clear all data
             dataLog = [];
             co2Data = [];
-            o2Data = [];
-            volumeData = [];
+            SENSORS.forEach(s => { sensorData[s.key] = []; });
             timeLabels = [];
             recordingStartTime = null;
             
@@ -1032,6 +1244,7 @@ String WiFiManager::getIndexHTML() {
         
         // Initialize on page load
         window.addEventListener('load', function() {
+            buildSensorViews();
             initCharts();
             initWebSocket();
         });
@@ -1039,6 +1252,25 @@ String WiFiManager::getIndexHTML() {
 </body>
 </html>
 )rawliteral";
+
+    // Sensor tiles and charts are built by the page from this list
+    JsonDocument doc;
+    JsonArray sensors = doc.to<JsonArray>();
+    for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+        const SensorInfo& info = Sensors::info(ch);
+        if (!(info.views & SENSOR_VIEW_WEB)) continue;
+        JsonObject s = sensors.add<JsonObject>();
+        s["key"] = info.key;
+        s["label"] = info.label;
+        s["unit"] = info.unit;
+        s["decimals"] = info.decimals;
+        s["min"] = info.chart_min;
+        s["max"] = info.chart_max;
+    }
+    String list;
+    serializeJson(doc, list);
+    html.replace("/*SENSORS*/[]", list);
+    return html;
 }
 
 String WiFiManager::getStyleCSS() {
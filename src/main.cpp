@@ -3,12 +3,27 @@
 // Coordinates all subsystems and manages data flow
 
 #include <Arduino.h>
+#include <LittleFS.h>
 #include "MaCO2Parser.h"
 #include "ADCManager.h"
 #include "DisplayManager.h"
 #include "WiFiManager.h"
 #include "DataLogger.h"
+#include "TrendStore.h"
+#include "SampleTimeline.h"
+#include "VolumetricCapno.h"
+#include "MetabolicCalc.h"
+#include "NVSCalibrationStore.h"
 #include "Button.hpp"
+#include "UartCapture.h"
+#include "MaCO2Emulator.h"
+#include "MicroBench.h"
+#include "ReplayBench.h"
+#include "Profiler.h"
+#include "Tracer.h"
+#include "HostLink.h"
+#include "HostCommands.h"
+#include "SessionStore.h"
 
 // ============================================================================
 // Configuration
@@ -22,8 +37,6 @@ const bool WIFI_AP_MODE = true;  // true = Access Point, false = Station
 // Pin Definitions
 #define UART_RX_MACO2   18  // U1_RXD - Dedicated UART1 RX pin
 #define UART_TX_MACO2   17  // U1_TXD - Dedicated UART1 TX pin
-#define O2_SENSOR_PIN   1
-#define VOL_SENSOR_PIN  2
 #define BUTTON_PIN      14  // IO14 - Pump start button
 #define BOOT0_PIN        0  // GPIO0 - Format toggle button
 
@@ -32,29 +45,86 @@ const bool WIFI_AP_MODE = true;  // true = Access Point, false = Station
 #define DISPLAY_UPDATE_INTERVAL_MS  50    // 20Hz display refresh
 #define WIFI_UPDATE_INTERVAL_MS     125   // 8Hz web update (match sensor nominal rate)
 #define LABVIEW_UPDATE_INTERVAL_MS  200   // 5Hz LabVIEW output (reduced to prevent timing issues)
+#define MAX_PACKETS_PER_LOOP        10    // Backlog packets handled per data update
+
+// Raw MaCO2 UART capture (LittleFS), ~90 bytes/s at 8 Hz
+#define CAPTURE_PATH        "/uart.mcr"
+#define CAPTURE_MAX_BYTES   1000000       // ~3 h
+#define BENCH_GOLDEN_PATH   "/uart.golden" // Bench digests of the capture's first run
+#define MACO2_BAUD          9600
+
+// Recorded sessions (LittleFS /sessions), ~3-4 bytes per sample at 8 Hz
+#define SESSION_MAX_BYTES   2000000       // ~18 h
+
+// USB host link: legacy byte stream (LabVIEW) unless built with
+// -DHOST_LINK_FRAMED=1; USB command 'F' switches at run time
+#ifdef HOST_LINK_FRAMED
+#define HOST_LINK_MODE      LINK_FRAMED
+#else
+#define HOST_LINK_MODE      LINK_RAW
+#endif
+
+// Log text in the raw stream (between records) only with -DHOST_LOG_RAW=1;
+// USB command 'L' toggles it
+#ifndef HOST_LOG_RAW
+#define HOST_LOG_RAW        0
+#endif
 
 // ============================================================================
 // Global Objects
 // ============================================================================
 
 HardwareSerial SerialMaCO2(1);  // UART1 for MaCO2 sensor
+#ifdef MACO2_EMULATOR
+MaCO2Emulator maco2Emulator;            // Simulated sensor instead of UART1
+UartRecorder maco2Link(maco2Emulator);
+#else
+UartRecorder maco2Link(SerialMaCO2);    // Tee for raw captures (pass-through otherwise)
+#endif
+Stream* maco2Source = &maco2Link;       // Parser input: live link or a replay
+
+// Capture / replay state
+File captureFile;
+UartReplay* liveReplay = nullptr;       // Real-time replay into the live pipeline
 
 MaCO2Parser maco2Parser;
-ADCManager adcManager(O2_SENSOR_PIN, VOL_SENSOR_PIN);
+ADCManager adcManager;  // Channels and pins: SensorChannels.h
 DisplayManager displayManager;
 WiFiManager wifiManager;
 DataLogger dataLogger;
+TrendStore trendStore;
+SampleTimeline timeline;            // Shared sample history (single writer: loop)
+VolumetricCapno volCapno;
+MetabolicCalc metabolicCalc;
+NVSCalibrationStore calibrationStore;
 Button pumpButton(BUTTON_PIN, 1000, 50);  // IO14, 1000ms long press, 50ms debounce
-Button formatButton(BOOT0_PIN, 1000, 50); // GPIO0 (BOOT0), format toggle
+Button formatButton(BOOT0_PIN, 1000, 50); // GPIO0 (BOOT0), format toggle / trend page
+
+MicroBench microBench;              // Hot-path microbenchmarks (serial 'M')
+HostCommands hostCommands(hostLink);    // Framed requests and dumps over USB
+SessionStore sessionStore;          // Recorded sessions (serial 'S', /api/sessions)
 
 CO2Data currentData;
 
+// Time source of the scheduler and all components (a VirtualClock can be
+// swapped in to run recordings faster than real time)
+Clock* systemClock = &Clock::hardware();
+
 // Timing variables
 unsigned long lastDataUpdate = 0;
 unsigned long lastDisplayUpdate = 0;
 unsigned long lastWiFiUpdate = 0;
 unsigned long lastLabViewUpdate = 0;
 
+// Forward declarations
+void toggleCapture();
+void toggleSession();
+void toggleReplay();
+void stopReplay();
+void runReplayBench();
+void printStatus();
+bool feedVolumeStream();
+
 // ============================================================================
 // Setup
 // ============================================================================
@@ -62,31 +132,29 @@ unsigned long lastLabViewUpdate = 0;
 void setup() {
     // Initialize USB CDC serial for debugging and LabVIEW
     Serial.begin(115200);
+    hostLink.setRawLog(HOST_LOG_RAW);
+    hostLink.begin(HOST_LINK_MODE);
     delay(1000);
+    Tracer::nameTask("loop");
     
-    Serial.println("\n=================================");
-    Serial.println("MedAir CO2 Monitor - ESP32");
-    Serial.println("=================================\n");
+    HostLog.println("\n=================================");
+    HostLog.println("MedAir CO2 Monitor - ESP32");
+    HostLog.println("=================================\n");
     
     // Initialize Display
-    Serial.println("Initializing display...");
+    HostLog.println("Initializing display...");
     if (!displayManager.begin()) {
-        Serial.println("ERROR: Display initialization failed!");
+        HostLog.println("ERROR: Display initialization failed!");
         while(1) delay(1000);
     }
     displayManager.showSplash("Teknosofen", "Initializing...");
     delay(1000);
     
     // Initialize ADC Manager
-    Serial.println("Initializing ADC...");
-    
-    // Configure volume sensor pin with weak pull-down
-    pinMode(VOL_SENSOR_PIN, INPUT);
-    gpio_pulldown_en((gpio_num_t)VOL_SENSOR_PIN);
-    gpio_pullup_dis((gpio_num_t)VOL_SENSOR_PIN);
+    HostLog.println("Initializing ADC...");
     
     if (!adcManager.begin()) {
-        Serial.println("ERROR: ADC initialization failed!");
+        HostLog.println("ERROR: ADC initialization failed!");
         while(1) delay(1000);
     }
     
@@ -95,38 +163,72 @@ void setup() {
     
     // Set ADC calibration (adjust these for your sensors)
     // O2 sensor: 0V = 0%, 1V = 100% (0-1V input range)
-    adcManager.setO2Calibration(0.0, 1.0);
+    adcManager.setLinearCalibration(SENSOR_O2, 0.0, 0.0, 1.0, 100.0);
     
     // Volume sensor: 200 mL per volt (example value)
-    adcManager.setVolumeCalibration(200.0, 0.0);
+    adcManager.setLinearCalibration(SENSOR_VOLUME, 0.0, 0.0, 1.0, 200.0);
+    
+    // Stored multi-point calibration for the active sensor serial (if any)
+    CalibrationProfile calProfile;
+    if (calibrationStore.loadActive(calProfile)) {
+        adcManager.applyProfile(calProfile);
+    } else {
+        HostLog.println("No stored calibration profile - using defaults");
+    }
+    
+    // High-rate ADC sampling (500 Hz), 16x oversampled (+2 bits),
+    // volume stream decimated to 100 Hz
+    adcManager.setOversampling(16);
+    adcManager.setVolumeDecimation(5);
+    adcManager.startAcquisition(500);
+    
+    // One time source for every component that schedules or times out
+    maco2Parser.setClock(systemClock);
+    maco2Link.setClock(systemClock);
+    displayManager.setClock(systemClock);
+    hostLink.setClock(systemClock);
+    hostCommands.setClock(systemClock);
     
     // Initialize MaCO2 communication
-    Serial.println("Initializing MaCO2 communication...");
+    HostLog.println("Initializing MaCO2 communication...");
     displayManager.showSplash("Teknosofen", "Connecting sensor...");
-    SerialMaCO2.begin(9600, SERIAL_8N1, UART_RX_MACO2, UART_TX_MACO2);
+#ifdef MACO2_EMULATOR
+    maco2Emulator.setClock(systemClock);
+    maco2Emulator.begin(MaCO2Emulator::defaultConfig());
+    HostLog.println("MaCO2 emulator active (MACO2_EMULATOR) - UART1 not used");
+#else
+    SerialMaCO2.begin(MACO2_BAUD, SERIAL_8N1, UART_RX_MACO2, UART_TX_MACO2);
+#endif
     
-    if (!maco2Parser.initialize(SerialMaCO2, 10000)) {
-        Serial.println("WARNING: MaCO2 initialization timeout");
-        Serial.println("Continuing anyway - sensor may connect later");
+    if (!maco2Parser.initialize(maco2Link, 10000)) {
+        HostLog.println("WARNING: MaCO2 initialization timeout");
+        HostLog.println("Continuing anyway - sensor may connect later");
         delay(1000);
     }
     
     // Initialize WiFi
-    Serial.println("Initializing WiFi...");
+    HostLog.println("Initializing WiFi...");
     if (WIFI_AP_MODE) {
         if (wifiManager.beginAP(WIFI_SSID, WIFI_PASSWORD)) {
-            Serial.printf("AP Mode: SSID='%s', IP=%s\n", 
+            HostLog.printf("AP Mode: SSID='%s', IP=%s\n", 
                          WIFI_SSID, wifiManager.getIP().toString().c_str());
         } else {
-            Serial.println("WARNING: WiFi AP failed to start");
+            HostLog.println("WARNING: WiFi AP failed to start");
         }
     }
     
     // Start web server
     if (wifiManager.startServer()) {
-        Serial.println("Web server started");
+        HostLog.println("Web server started");
     } else {
-        Serial.println("WARNING: Web server failed to start");
+        HostLog.println("WARNING: Web server failed to start");
+    }
+    
+    // Flash file system for raw UART captures
+    if (!LittleFS.begin(true)) {
+        HostLog.println("WARNING: LittleFS mount failed - UART capture and sessions unavailable");
+    } else {
+        sessionStore.begin(LittleFS);
     }
     
     // Initialize Data Logger
@@ -137,10 +239,14 @@ void setup() {
     dataLogger.setOutputEnabled(true);  // Enable host output via USB CDC
     
     // Initialize Buttons
-    Serial.println("Initializing buttons...");
+    HostLog.println("Initializing buttons...");
     pumpButton.begin();
     formatButton.begin();
-    Serial.println("IO14: pump start | BOOT0: toggle output format");
+    if (systemClock != &Clock::hardware()) {
+        pumpButton.setClock(systemClock);
+        formatButton.setClock(systemClock);
+    }
+    HostLog.println("IO14: pump start | BOOT0: toggle output format (long press: trend page)");
     
     // Show ready screen with IP
     char ipStr[32];
@@ -152,12 +258,30 @@ void setup() {
     displayManager.clearScreen();
     displayManager.setNetworkInfo(WIFI_SSID, wifiManager.getIP().toString().c_str());
     displayManager.setOutputFormatName(dataLogger.getOutputFormat() == FORMAT_LEGACY_LABVIEW ? "Out: LabVIEW" : "Out: ASCII");
+    displayManager.setTrendStore(&trendStore);
+    displayManager.setTimeline(&timeline);
+    wifiManager.setTimeline(&timeline);
+    wifiManager.setSessionStore(&sessionStore);
+    dataLogger.setTimeline(&timeline);
+    hostCommands.setParser(&maco2Parser);
+    hostCommands.setADCManager(&adcManager);
+    hostCommands.setDataLogger(&dataLogger);
+    hostCommands.setTimeline(&timeline);
+    hostCommands.setTrendStore(&trendStore);
+    hostCommands.setCapture(CAPTURE_PATH, &maco2Link);
+    hostCommands.setCalibrationStore(&calibrationStore);
+    microBench.setWiFiManager(&wifiManager);
+    microBench.setDisplayManager(&displayManager);
+    microBench.setTimeline(&timeline);
     
-    Serial.println("\n=== System Ready ===");
-    Serial.println("USB CDC: LabVIEW data output enabled");
-    Serial.printf("WiFi: Connect to '%s' and open http://%s\n", 
+    HostLog.println("\n=== System Ready ===");
+    HostLog.println("USB CDC: LabVIEW data output enabled");
+    HostLog.printf("WiFi: Connect to '%s' and open http://%s\n", 
                   WIFI_SSID, wifiManager.getIP().toString().c_str());
-    Serial.println("====================\n");
+    HostLog.println("====================\n");
+    
+    // From here on diagnostics wait for gaps between data records
+    hostLink.setLogQueued(true);
     
     // Initialize current data structure
     memset(&currentData, 0, sizeof(currentData));
@@ -168,23 +292,74 @@ void setup() {
 // ============================================================================
 
 void loop() {
-    unsigned long now = millis();
+    unsigned long now = systemClock->millis();
+    
+    // Drain high-rate ADC samples every iteration (ring holds ~0.5 s)
+    adcManager.poll();
     
     // -------------------------------------------------------------------------
     // Data Acquisition (10Hz - faster than sensor to prevent buffer buildup)
     // -------------------------------------------------------------------------
     if (now - lastDataUpdate >= DATA_UPDATE_INTERVAL_MS) {
         lastDataUpdate = now;
+        TRACE_SCOPE("sample_pipeline");
 
-        // Parse MaCO2 data (non-blocking)
-        if (maco2Parser.parsePacket(SerialMaCO2, currentData)) {
-            // Got new data from sensor
+        // Release recorded bytes that are due when replaying a capture
+        if (liveReplay != nullptr && !liveReplay->update()) {
+            stopReplay();
+        }
+        
+        // High-rate volume samples wait in VolumetricCapno for the next packet
+        bool breathDone = feedVolumeStream();
+        
+        // Parse MaCO2 data (non-blocking), one packet at a time: every packet
+        // of a backlog goes through the pipeline and into the timeline
+        uint8_t packets = 0;
+        while (packets < MAX_PACKETS_PER_LOOP &&
+               maco2Parser.parsePacket(*maco2Source, currentData)) {
+            packets++;
             
             // Update ADC readings
             adcManager.update(currentData);
             
-            // Add waveform point to display buffer
-            displayManager.addWaveformPoint(currentData.co2_waveform);
+            // Volumetric capnography (delay-aligned CO2/O2 x volume): at the
+            // volume stream rate, or per packet without the acquisition task
+            if (adcManager.isAcquiring()) {
+                breathDone |= volCapno.addCO2(currentData.co2_waveform,
+                                              currentData.sensors[SENSOR_O2].value,
+                                              currentData.timestamp_us);
+            } else {
+                breathDone |= volCapno.addSample(currentData.co2_waveform,
+                                                 currentData.sensors[SENSOR_VOLUME].value,
+                                                 currentData.timestamp,
+                                                 currentData.sensors[SENSOR_O2].value);
+            }
+            if (breathDone) {
+                // Indirect calorimetry, once per completed breath
+                metabolicCalc.addBreath(volCapno.getLastBreath());
+                currentData.metabolic30s = metabolicCalc.get30s();
+                currentData.metabolic60s = metabolicCalc.get60s();
+                breathDone = false;
+            }
+            currentData.vcap = volCapno.getLastBreath();
+            
+            // Publish to the shared timeline (display, web, host output)
+            timeline.push(currentData);
+            sessionStore.addSample(currentData);
+            
+            // Feed long-term trend rollups
+            if (currentData.valid) {
+                trendStore.addSample(currentData, currentData.timestamp);
+            }
+        }
+        
+        if (breathDone) {
+            // Completed on held CO2 (no packets): still counts for calorimetry
+            metabolicCalc.addBreath(volCapno.getLastBreath());
+        }
+        if (packets > 1) {
+            HostLog.printf("# Warning: Processed %u packets in one update (buffer catchup), %d bytes remaining\n",
+                          packets, maco2Source->available());
         }
     }
     
@@ -207,12 +382,10 @@ void loop() {
     // -------------------------------------------------------------------------
     // Host Output (8Hz) - Legacy LabVIEW or Tab-Separated format
     // -------------------------------------------------------------------------
-    if (now - lastLabViewUpdate >= DATA_UPDATE_INTERVAL_MS) {  // 8Hz same as data rate
+    if (now - lastLabViewUpdate >= dataLogger.getOutputInterval()) {  // 100 ms default, same as data rate
         lastLabViewUpdate = now;
 
-        if (currentData.valid) {
-            dataLogger.sendData(Serial, currentData);
-        }
+        dataLogger.update(hostLink, currentData);
     }
     
     // -------------------------------------------------------------------------
@@ -222,35 +395,79 @@ void loop() {
     // Handle pump button press
     pumpButton.update();
     if (pumpButton.wasPressed()) {
-        Serial.println("Button pressed - sending pump start command");
-        maco2Parser.sendCommand(SerialMaCO2, CMD_START_PUMP);
+        HostLog.println("Button pressed - sending pump start command");
+        maco2Parser.sendCommand(*maco2Source, CMD_START_PUMP);
     }
 
-    // Handle format toggle button (BOOT0)
+    // Handle BOOT0 button (acts on release so short and long press can be told apart)
+    //   long press:            toggle live / trend page
+    //   short press on trend:  cycle zoom 1h -> 4h -> 12h
+    //   short press on live:   toggle output format
     formatButton.update();
-    if (formatButton.wasPressed()) {
-        OutputFormat newFormat = (dataLogger.getOutputFormat() == FORMAT_LEGACY_LABVIEW)
-                                 ? FORMAT_TAB_SEPARATED : FORMAT_LEGACY_LABVIEW;
-        dataLogger.setOutputFormat(newFormat);
-        const char* formatName = (newFormat == FORMAT_LEGACY_LABVIEW) ? "Out: LabVIEW" : "Out: ASCII";
-        displayManager.setOutputFormatName(formatName);
-        Serial.printf("Output format switched to: %s\n", formatName);
+    if (formatButton.wasReleased()) {
+        if (formatButton.wasLongPress()) {
+            DisplayPage page = (displayManager.getPage() == PAGE_LIVE) ? PAGE_TREND : PAGE_LIVE;
+            displayManager.setPage(page);
+            HostLog.printf("Display page: %s\n", page == PAGE_TREND ? "trend" : "live");
+        } else if (displayManager.getPage() == PAGE_TREND) {
+            displayManager.cycleTrendZoom();
+            HostLog.printf("Trend zoom: %s\n", TrendStore::getZoomName(displayManager.getTrendZoom()));
+        } else {
+            OutputFormat newFormat = (dataLogger.getOutputFormat() == FORMAT_LEGACY_LABVIEW)
+                                     ? FORMAT_TAB_SEPARATED : FORMAT_LEGACY_LABVIEW;
+            dataLogger.setOutputFormat(newFormat);
+            const char* formatName = (newFormat == FORMAT_LEGACY_LABVIEW) ? "Out: LabVIEW" : "Out: ASCII";
+            displayManager.setOutputFormatName(formatName);
+            HostLog.printf("Output format switched to: %s\n", formatName);
+        }
     }
     
     // Commands from web interface
     if (wifiManager.hasCommand()) {
         uint8_t cmd = wifiManager.getCommand();
-        maco2Parser.sendCommand(SerialMaCO2, (MaCO2Command)cmd);
+        maco2Parser.sendCommand(*maco2Source, (MaCO2Command)cmd);
     }
     
-    // Commands from LabVIEW via USB CDC
-    if (Serial.available()) {
-        uint8_t cmd = Serial.read();
+    // Commands from the host protocol (status, config, dumps)
+    hostCommands.update(currentData);
+    if (hostCommands.hasCommand()) {
+        maco2Parser.sendCommand(*maco2Source, (MaCO2Command)hostCommands.getCommand());
+    }
+    
+    // Commands from LabVIEW via USB CDC (legacy single bytes)
+    if (hostLink.available()) {
+        uint8_t cmd = hostLink.read();
         if (cmd == CMD_START_PUMP || cmd == CMD_ZERO_CAL) {
-            maco2Parser.sendCommand(SerialMaCO2, (MaCO2Command)cmd);
+            maco2Parser.sendCommand(*maco2Source, (MaCO2Command)cmd);
+        } else if (cmd == 'R') {
+            toggleCapture();            // Start / stop raw UART capture
+        } else if (cmd == 'S') {
+            toggleSession();            // Start / stop session recording
+        } else if (cmd == 'P') {
+            toggleReplay();             // Replay capture through the live pipeline
+        } else if (cmd == 'B') {
+            runReplayBench();           // Replay capture as fast as possible
+        } else if (cmd == 'M') {
+            microBench.runAll(HostLog); // Hot-path microbenchmarks (JSON line)
+        } else if (cmd == 'T') {
+            Profiler::printReport(HostLog); // Loop time per hot path
+        } else if (cmd == 't') {
+            Profiler::reset();
+        } else if (cmd == 'I') {
+            printStatus();              // Counters, readings and link / ADC health
+        } else if (cmd == 'X') {
+            Tracer::dumpJson(HostLog);  // Chrome trace_event JSON (one line)
+        } else if (cmd == 'F') {
+            // Toggle framed data / log channels (HostFrame.h)
+            hostLink.setMode(hostLink.getMode() == LINK_RAW ? LINK_FRAMED : LINK_RAW);
+        } else if (cmd == 'L') {
+            hostLink.setRawLog(!hostLink.getRawLog());  // Log text in the raw stream
         }
     }
     
+    // Queued diagnostics, in the CDC space the next record does not need
+    hostLink.update();
+    
     // WiFi manager loop (handles WebSocket events)
     wifiManager.loop();
     
@@ -263,29 +480,199 @@ void loop() {
 // ============================================================================
 
 void printStatus() {
-    Serial.println("\n=== System Status ===");
-    Serial.printf("MaCO2 Packets: %lu (errors: %lu)\n", 
+    HostLog.println("\n=== System Status ===");
+    HostLog.printf("MaCO2 Packets: %lu (errors: %lu)\n", 
                   maco2Parser.getPacketCount(), 
                   maco2Parser.getErrorCount());
-    Serial.printf("LabVIEW Packets: %lu (%lu bytes)\n",
+#ifdef MACO2_EMULATOR
+    const EmulatorStats& emu = maco2Emulator.getStats();
+    HostLog.printf("Emulator: %lu packets, %lu corrupt, %lu bytes dropped, %lu overflowed\n",
+                  emu.packets, emu.corruptPackets, emu.droppedBytes, emu.overflowBytes);
+#endif
+    const TimestampStats& ts = maco2Parser.getTimestampStats();
+    HostLog.printf("Sample clock: period %.1f us, jitter %.0f us raw / %.0f us fitted (%lu missed, %lu relocks)\n",
+                  ts.period_us, ts.raw_jitter_us, ts.jitter_us,
+                  ts.missed, ts.relocks);
+    HostLog.printf("LabVIEW Packets: %lu (%lu bytes)\n",
                   dataLogger.getPacketsSent(),
                   dataLogger.getBytesSent());
-    Serial.printf("WiFi Clients: %d\n", wifiManager.getClientCount());
-    Serial.printf("O2: %.1f%% (raw: %d, %.3fV)\n",
-                  currentData.o2_percent,
-                  adcManager.getO2Raw(),
-                  adcManager.getO2Voltage());
-    Serial.printf("Vol: %.1f mL (raw: %d, %.3fV)\n",
-                  currentData.volume_ml,
-                  adcManager.getVolRaw(),
-                  adcManager.getVolVoltage());
-    Serial.printf("CO2: FetCO2=%d, FCO2=%d, RR=%d\n",
+    const HostLinkStats& link = hostLink.getStats();
+    HostLog.printf("Host link: %s, %lu records (max %lu us), log %lu bytes (%lu dropped, %lu withheld, %lu stalls, peak %u)\n",
+                   hostLink.getMode() == LINK_FRAMED ? "framed" : "raw",
+                   link.dataRecords, link.dataMaxUs, link.logBytes,
+                   link.logDropped, link.logWithheld, link.logStalls, link.logPeak);
+    HostLog.printf("WiFi Clients: %d\n", wifiManager.getClientCount());
+    const SessionDownloadStats& dl = wifiManager.getLastDownload();
+    HostLog.printf("Sessions: recording %lu (%lu records), last download %lu bytes in %lu ms, peak heap use %lu\n",
+                  sessionStore.getRecordingId(), sessionStore.getRecordCount(),
+                  dl.bytes, dl.ms, dl.heapPeakUse);
+    const FrameStats& frame = displayManager.getFrameStats();
+    HostLog.printf("Display: %lu us/frame (max %lu), %lu frames\n",
+                  frame.frame_us, frame.max_frame_us, frame.frames);
+    for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+        const SensorInfo& info = Sensors::info(ch);
+        HostLog.printf("%s: %.*f %s (raw: %d, %.3fV)\n",
+                      info.label, info.decimals, currentData.sensors[ch].value, info.unit,
+                      adcManager.getRaw(ch),
+                      adcManager.getVoltage(ch));
+    }
+    const TimelineCursor& webCursor = wifiManager.getTimelineCursor();
+    const TimelineCursor& hostCursor = dataLogger.getTimelineCursor();
+    HostLog.printf("Timeline: %lu samples, web lag %lu (%lu dropped), host lag %lu (%lu dropped)\n",
+                  timeline.head(),
+                  timeline.lag(webCursor), webCursor.dropped,
+                  timeline.lag(hostCursor), hostCursor.dropped);
+    HostLog.printf("ADC acq: %lu samples, %lu overruns, %lu us/sample (max %lu, %ux)\n",
+                  adcManager.getSampleCount(),
+                  adcManager.getOverrunCount(),
+                  adcManager.getCycleUs(),
+                  adcManager.getCycleMaxUs(),
+                  adcManager.getOversampling());
+    for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+        const ADCNoiseStats& noise = adcManager.getNoiseStats(ch);
+        HostLog.printf("ADC noise: %s %.2f LSB (%.2f mV, ENOB %.1f)\n",
+                      Sensors::info(ch).label, noise.noise_lsb, noise.noise_mv, noise.enob);
+    }
+    HostLog.printf("CO2: FetCO2=%d, FCO2=%d, RR=%d\n",
                   currentData.fetco2,
                   currentData.fco2,
                   currentData.respiratory_rate);
-    Serial.printf("Status: Pump=%s, Leak=%s, Occlusion=%s\n",
+    HostLog.printf("Status: Pump=%s, Leak=%s, Occlusion=%s\n",
                   maco2Parser.isPumpRunning(currentData) ? "ON" : "OFF",
                   maco2Parser.isLeakDetected(currentData) ? "YES" : "NO",
                   maco2Parser.isOcclusionDetected(currentData) ? "YES" : "NO");
-    Serial.println("====================\n");
+    HostLog.println("====================\n");
+}
+
+// ============================================================================
+// Session recording
+// ============================================================================
+
+void toggleSession() {
+    if (sessionStore.isRecording()) {
+        sessionStore.stopRecording();
+    } else if (!sessionStore.startRecording(SESSION_MAX_BYTES)) {
+        HostLog.println("# Session: cannot start (LittleFS unavailable?)");
+    }
+}
+
+// ============================================================================
+// Raw UART capture / replay
+// ============================================================================
+
+void toggleCapture() {
+    if (maco2Link.isRecording()) {
+        maco2Link.stopRecording();
+        captureFile.close();
+        const CaptureStats& stats = maco2Link.getStats();
+        HostLog.printf("# Capture stopped: %lu bytes in %lu chunks, %.1f s, file %lu bytes\n",
+                      stats.bytes, stats.chunks, stats.duration_us / 1e6, stats.fileBytes);
+        return;
+    }
+    if (liveReplay != nullptr) {
+        HostLog.println("# Capture: not while replaying");
+        return;
+    }
+    
+    captureFile = LittleFS.open(CAPTURE_PATH, FILE_WRITE);
+    if (!captureFile || !maco2Link.startRecording(&captureFile, MACO2_BAUD, CAPTURE_MAX_BYTES)) {
+        HostLog.println("# Capture: cannot open " CAPTURE_PATH);
+        captureFile.close();
+        return;
+    }
+    LittleFS.remove(BENCH_GOLDEN_PATH);     // The next bench run is the new golden run
+    HostLog.println("# Capture started: " CAPTURE_PATH);
+}
+
+void toggleReplay() {
+    if (liveReplay != nullptr) {
+        stopReplay();
+        return;
+    }
+    if (maco2Link.isRecording()) {
+        HostLog.println("# Replay: stop the capture first");
+        return;
+    }
+    
+    captureFile = LittleFS.open(CAPTURE_PATH, FILE_READ);
+    liveReplay = new UartReplay(captureFile);
+    liveReplay->setClock(systemClock);
+    if (!captureFile || !liveReplay->begin(REPLAY_REALTIME)) {
+        stopReplay();
+        return;
+    }
+    
+    // The recorded stream starts mid-packet: resync like after a sensor restart
+    maco2Parser.resetStatistics();
+    maco2Source = liveReplay;
+    HostLog.println("# Replay started (real time): " CAPTURE_PATH);
+}
+
+void stopReplay() {
+    if (liveReplay == nullptr) {
+        return;
+    }
+    const CaptureStats& stats = liveReplay->getStats();
+    HostLog.printf("# Replay stopped: %lu bytes, %.1f s, %lu packets (%lu errors)\n",
+                  stats.bytes, stats.duration_us / 1e6,
+                  maco2Parser.getPacketCount(), maco2Parser.getErrorCount());
+    maco2Source = &maco2Link;
+    delete liveReplay;
+    liveReplay = nullptr;
+    captureFile.close();
+}
+
+// Drain the ADC volume stream into VolumetricCapno (true if a breath completed)
+bool feedVolumeStream() {
+    VolumeSample samples[32];
+    bool completed = false;
+    uint16_t n;
+    while ((n = adcManager.readVolumeStream(samples, 32)) > 0) {
+        for (uint16_t i = 0; i < n; i++) {
+            completed |= volCapno.addVolume(samples[i].volume_ml, samples[i].t_us);
+        }
+    }
+    return completed;
+}
+
+void runReplayBench() {
+    if (maco2Link.isRecording() || liveReplay != nullptr) {
+        HostLog.println("# Bench: stop capture / replay first");
+        return;
+    }
+    
+    // Real-time replay on a virtual clock: 100 ms polls like the live scheduler
+    File file = LittleFS.open(CAPTURE_PATH, FILE_READ);
+    if (!file) {
+        HostLog.println("# Bench: no capture (" CAPTURE_PATH ")");
+        return;
+    }
+    ReplayBench bench;
+    const bool ran = bench.run(file, REPLAY_REALTIME, Clock::hardware(), HostLog);
+    file.close();
+    if (!ran) {
+        return;
+    }
+    
+    // The first run of a capture is its golden run; later runs must match
+    char line[ReplayBench::DIGEST_LINE];
+    const size_t len = bench.formatDigests(line, sizeof(line));
+    File golden = LittleFS.open(BENCH_GOLDEN_PATH, FILE_READ);
+    if (golden && golden.size() > 0) {
+        char stored[sizeof(line)];
+        const int n = golden.read((uint8_t*)stored, sizeof(stored) - 1);
+        stored[n > 0 ? n : 0] = '\0';
+        golden.close();
+        bench.compareDigests(stored, HostLog);
+    } else {
+        golden.close();
+        golden = LittleFS.open(BENCH_GOLDEN_PATH, FILE_WRITE);
+        if (golden && golden.print(line) == len) {
+            HostLog.println("# Bench: digests stored as golden run (" BENCH_GOLDEN_PATH ")");
+        } else {
+            HostLog.println("# Bench: cannot write " BENCH_GOLDEN_PATH);
+        }
+        golden.close();
+    }
+    Profiler::reset();          // Bench parses would skew the live profile
 }
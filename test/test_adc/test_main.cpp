@@ -0,0 +1,165 @@
+// test_adc
+// ADCManager acquisition task on the host (tasks are threads)
+// A synthetic ADCSampleSource counts every conversion, so the tests can see
+// exactly when the task runs. Run under -fsanitize=thread for the races.
+// A noisy source (2 LSB RMS, fractional mean) shows the oversampling gain in
+// the measured noise floor and ENOB, and the CPU cost per output sample.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <atomic>
+#include <chrono>
+#include "ADCManager.h"
+
+// Constant mid-scale counts; counts every read
+class CountingSource : public ADCSampleSource {
+public:
+    uint16_t read(uint8_t channel) override {
+        (void)channel;
+        reads.fetch_add(1, std::memory_order_relaxed);
+        return 2048;
+    }
+    std::atomic<uint32_t> reads{0};
+};
+
+// Fractional mean per channel plus white noise of NOISE_LSB RMS, quantized
+// to 12 bits like the SAR converter
+class NoisySource : public ADCSampleSource {
+public:
+    static constexpr float NOISE_LSB = 2.0f;
+    uint16_t read(uint8_t channel) override {
+        // Sum of four uniforms: near-Gaussian, variance 4 / 12 of the span
+        float u = 0.0f;
+        for (int i = 0; i < 4; i++) {
+            _state ^= _state << 13;
+            _state ^= _state >> 17;
+            _state ^= _state << 5;
+            u += (_state >> 8) * (1.0f / 16777216.0f) - 0.5f;
+        }
+        const float mean = channel == 0 ? 1000.3f : 3000.7f;
+        const float v = mean + u * NOISE_LSB * 1.7320508f;
+        return (uint16_t)(v + 0.5f);
+    }
+
+private:
+    uint32_t _state = 0x12345678;
+};
+
+static ADCManager* adc;
+static CountingSource* source;
+
+void setUp() {
+    Serial.setMuted(true);
+    source = new CountingSource();
+    adc = new ADCManager();
+    adc->setSampleSource(source);
+}
+
+void tearDown() {
+    adc->stopAcquisition();
+    delete adc;
+    delete source;
+    Serial.setMuted(false);
+}
+
+void test_acquisition_produces_samples() {
+    TEST_ASSERT_TRUE(adc->startAcquisition(1000));
+    TEST_ASSERT_TRUE(adc->isAcquiring());
+    delay(100);
+    adc->poll();
+    TEST_ASSERT_UINT32_WITHIN(40, 100, adc->getSampleCount());
+    TEST_ASSERT_EQUAL_UINT32(0, adc->getOverrunCount());
+}
+
+// No conversion may happen once stopAcquisition() has returned
+void test_stop_waits_for_the_task() {
+    for (int i = 0; i < 50; i++) {
+        TEST_ASSERT_TRUE(adc->startAcquisition(1000));
+        delay(3);
+        adc->stopAcquisition();
+        TEST_ASSERT_FALSE(adc->isAcquiring());
+        const uint32_t reads = source->reads.load();
+        delay(5);
+        TEST_ASSERT_EQUAL_UINT32(reads, source->reads.load());
+    }
+}
+
+// Slow conversions (heavy oversampling): stop still waits for the cycle
+void test_stop_during_long_conversion() {
+    adc->setOversampling(256);
+    TEST_ASSERT_TRUE(adc->startAcquisition(200));
+    delay(20);
+    adc->stopAcquisition();
+    const uint32_t reads = source->reads.load();
+    delay(20);
+    TEST_ASSERT_EQUAL_UINT32(reads, source->reads.load());
+    TEST_ASSERT_GREATER_THAN(0, reads);
+}
+
+// Noise floor and ENOB measured by the acquisition task, per factor
+void test_oversampling_gain() {
+    NoisySource noisy;
+    adc->setSampleSource(&noisy);
+    adc->begin();
+    const float inputLsb = sqrtf(NoisySource::NOISE_LSB * NoisySource::NOISE_LSB + 1.0f / 12.0f);
+    const uint16_t factors[] = { 1, 4, 16, 64, 256 };
+    float enob1 = 0.0f;
+    for (uint16_t factor : factors) {
+        adc->setOversampling(factor);
+        TEST_ASSERT_TRUE(adc->startAcquisition(1000));
+        // One noise window (256 samples) completes; poll so the ring never fills
+        for (int i = 0; i < 10; i++) {
+            delay(50);
+            adc->poll();
+        }
+        adc->stopAcquisition();
+        adc->poll();
+        TEST_ASSERT_EQUAL_UINT32(0, adc->getOverrunCount());
+
+        const ADCNoiseStats& n = adc->getNoiseStats(0);
+        const float expected = inputLsb / sqrtf((float)factor);
+        char line[120];
+        snprintf(line, sizeof(line), "%3ux: noise %.3f LSB (expected %.3f), ENOB %.2f, %.3f mV",
+                 factor, n.noise_lsb, expected, n.enob, n.noise_mv);
+        TEST_MESSAGE(line);
+        TEST_ASSERT_FLOAT_WITHIN(0.2f * expected, expected, n.noise_lsb);
+        TEST_ASSERT_FLOAT_WITHIN(0.2f * expected, expected, adc->getNoiseStats(1).noise_lsb);
+        if (factor == 1) {
+            enob1 = n.enob;
+        } else {
+            // Half a bit per doubling of the factor
+            TEST_ASSERT_FLOAT_WITHIN(0.35f, enob1 + 0.5f * log2f((float)factor), n.enob);
+        }
+    }
+}
+
+// Conversion cost per output sample (both channels), single-read path
+void test_oversampling_cost() {
+    NoisySource noisy;
+    adc->setSampleSource(&noisy);
+    adc->begin();
+    CO2Data data;
+    const uint16_t factors[] = { 1, 4, 16, 64, 256 };
+    for (uint16_t factor : factors) {
+        adc->setOversampling(factor);
+        const int reps = 200000 / factor;
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < reps; i++) adc->update(data);
+        const double ns = std::chrono::duration<double, std::nano>(
+                              std::chrono::steady_clock::now() - t0).count() / reps;
+        char line[100];
+        snprintf(line, sizeof(line), "%3ux: %.0f ns per output sample (%.1f ns per conversion)",
+                 factor, ns, ns / (factor * SENSOR_COUNT));
+        TEST_MESSAGE(line);
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_acquisition_produces_samples);
+    RUN_TEST(test_stop_waits_for_the_task);
+    RUN_TEST(test_stop_during_long_conversion);
+    RUN_TEST(test_oversampling_gain);
+    RUN_TEST(test_oversampling_cost);
+    return UNITY_END();
+}
@@ -0,0 +1,178 @@
+// test_adc_lut
+// Table conversion (SensorBank) against the float path it replaced
+// For every raw count the table value must equal the float conversion
+// (esp_adc_cal mV -> CalibrationCurve -> clamp) within 1 LSB of the table
+// unit, one tenth of the displayed resolution. Fractional (oversampled)
+// indexes must stay within 1 displayed LSB, and the PIC tables must equal
+// map(). Linear, piecewise-linear and spline curves on a non-linear ADC
+// characteristic are covered; the cost of both paths is reported.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <chrono>
+#include "ADCManager.h"
+#include "SensorBank.h"
+
+static uint16_t mvLut[ADC_LUT_SIZE];
+
+// ESP32-like characteristic: offset, gain and a bow near the top
+static float referenceMv(uint16_t raw) {
+    const float x = raw / 4095.0f;
+    return 142.0f + 2980.0f * x + 120.0f * x * x * x;
+}
+
+static void buildMvTable() {
+    for (uint16_t raw = 0; raw < ADC_LUT_SIZE; raw++) {
+        mvLut[raw] = (uint16_t)(referenceMv(raw) + 0.5f);
+    }
+}
+
+// The float path of ADCManager before the tables
+template<typename Def>
+static float floatValue(const CalibrationCurve& curve, float mv) {
+    float y = curve.evaluate(mv * 0.001f);
+    if (y < Def::minValue()) y = Def::minValue();
+    if (y > Def::maxValue()) y = Def::maxValue();
+    return y;
+}
+
+static long arduinoMap(long x, long in_min, long in_max, long out_min, long out_max) {
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+// Worst error of one channel's table against the float path, in table units
+template<typename Def>
+static void checkChannel(const char* name, uint8_t channel, SensorBankAll& bank) {
+    const float unit = 1.0f / SensorState<Def>::VALUE_SCALE;      // Table LSB
+    const float shown = 10.0f * unit;                             // Display LSB
+    const CalibrationCurve& curve = *bank.curve(channel);
+    float worstRaw = 0.0f, worstFrac = 0.0f;
+
+    for (uint16_t raw = 0; raw < ADC_LUT_SIZE; raw++) {
+        const float ref = floatValue<Def>(curve, mvLut[raw]);
+        const float lut = bank.value(channel, raw << ADC_FRAC_BITS);
+        worstRaw = fmaxf(worstRaw, fabsf(lut - ref) / unit);
+
+        // Oversampled readings between two counts
+        if (raw + 1 < ADC_LUT_SIZE) {
+            for (uint16_t f = 1; f < (1 << ADC_FRAC_BITS); f++) {
+                const float mv = mvLut[raw] + (mvLut[raw + 1] - mvLut[raw]) *
+                                 (float)f / (1 << ADC_FRAC_BITS);
+                const float err = fabsf(bank.value(channel, (raw << ADC_FRAC_BITS) | f) -
+                                        floatValue<Def>(curve, mv));
+                worstFrac = fmaxf(worstFrac, err / shown);
+            }
+        }
+    }
+
+    char line[120];
+    snprintf(line, sizeof(line), "%-24s max |table - float| %.3f table LSB, %.3f shown LSB between counts",
+             name, worstRaw, worstFrac);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_LESS_OR_EQUAL(1.0f, worstRaw);
+    TEST_ASSERT_LESS_OR_EQUAL(1.0f, worstFrac);
+}
+
+static SensorBankAll* bank;
+
+void setUp() {
+    bank = new SensorBankAll();
+    bank->setDefaultCalibration();
+    bank->buildTables(mvLut);
+}
+
+void tearDown() { delete bank; }
+
+void test_default_calibration() {
+    checkChannel<O2Sensor>("O2 default (linear)", SENSOR_O2, *bank);
+    checkChannel<VolumeSensor>("Volume default (linear)", SENSOR_VOLUME, *bank);
+}
+
+void test_piecewise_linear() {
+    const CalPoint points[] = { { 0.10f, 0.0f }, { 0.50f, 21.0f }, { 1.20f, 60.0f }, { 2.90f, 100.0f } };
+    CalibrationCurve curve;
+    TEST_ASSERT_TRUE(curve.setPoints(points, 4, CAL_PIECEWISE_LINEAR));
+    bank->setCurve(SENSOR_O2, curve, mvLut);
+    checkChannel<O2Sensor>("O2 piecewise, clamped", SENSOR_O2, *bank);
+}
+
+void test_cubic_spline() {
+    const CalPoint points[] = { { 0.2f, -400.0f }, { 0.9f, -50.0f }, { 1.6f, 80.0f },
+                                { 2.4f, 500.0f }, { 3.1f, 1400.0f } };
+    CalibrationCurve curve;
+    TEST_ASSERT_TRUE(curve.setPoints(points, 5, CAL_CUBIC_SPLINE));
+    bank->setCurve(SENSOR_VOLUME, curve, mvLut);
+    checkChannel<VolumeSensor>("Volume spline", SENSOR_VOLUME, *bank);
+}
+
+void test_pic_tables_equal_map() {
+    SensorReading out[SENSOR_COUNT];
+    for (uint16_t raw = 0; raw < ADC_LUT_SIZE; raw++) {
+        uint16_t q[SENSOR_COUNT];
+        for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) q[ch] = raw << ADC_FRAC_BITS;
+        bank->convert(q, out);
+        TEST_ASSERT_EQUAL_UINT16(arduinoMap(raw, 0, 4095, 0, 65535), out[SENSOR_O2].pic);
+        TEST_ASSERT_EQUAL_UINT16(arduinoMap(raw, 0, 4095, 0, 1023), out[SENSOR_VOLUME].pic);
+    }
+}
+
+// Through ADCManager: unfiltered single reads of a synthetic source
+class FixedSource : public ADCSampleSource {
+public:
+    uint16_t value = 0;
+    uint16_t read(uint8_t) override { return value; }
+};
+
+void test_adc_manager_uses_the_tables() {
+    Serial.setMuted(true);
+    ADCManager* adc = new ADCManager();
+    FixedSource source;
+    adc->setSampleSource(&source);
+    adc->begin();
+    adc->setFilterEnabled(false);
+    CalibrationCurve o2;
+    o2.setLinear(0.0f, 0.0f, 3.3f, 100.0f);
+    CO2Data data;
+    for (uint16_t raw = 0; raw < ADC_LUT_SIZE; raw += 97) {
+        source.value = raw;
+        adc->update(data);
+        const float ref = floatValue<O2Sensor>(o2, esp_adc_cal_raw_to_voltage(raw, nullptr));
+        TEST_ASSERT_FLOAT_WITHIN(0.01f, ref, data.sensors[SENSOR_O2].value);
+        TEST_ASSERT_EQUAL_UINT16(raw, adc->getRaw(SENSOR_O2));
+    }
+    delete adc;
+    Serial.setMuted(false);
+}
+
+void test_cost() {
+    const CalibrationCurve& curve = *bank->curve(SENSOR_O2);
+    volatile float sink = 0.0f;
+    const int reps = 64;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; r++) {
+        for (uint16_t q = 0; q < ADC_LUT_SIZE; q++) sink = sink + bank->value(SENSOR_O2, q << 4);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; r++) {
+        for (uint16_t q = 0; q < ADC_LUT_SIZE; q++) sink = sink + floatValue<O2Sensor>(curve, mvLut[q]);
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    const double n = (double)reps * ADC_LUT_SIZE;
+    char line[100];
+    snprintf(line, sizeof(line), "table %.2f ns/conversion, float path %.2f ns/conversion",
+             std::chrono::duration<double, std::nano>(t1 - t0).count() / n,
+             std::chrono::duration<double, std::nano>(t2 - t1).count() / n);
+    TEST_MESSAGE(line);
+}
+
+int main(int argc, char** argv) {
+    buildMvTable();
+    UNITY_BEGIN();
+    RUN_TEST(test_default_calibration);
+    RUN_TEST(test_piecewise_linear);
+    RUN_TEST(test_cubic_spline);
+    RUN_TEST(test_pic_tables_equal_map);
+    RUN_TEST(test_adc_manager_uses_the_tables);
+    RUN_TEST(test_cost);
+    return UNITY_END();
+}
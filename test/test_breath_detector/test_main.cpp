@@ -0,0 +1,361 @@
+// test_breath_detector
+// BreathDetector accuracy against synthetic capnograms with known breaths
+// Each scenario generates an 8 Hz, whole-mmHg waveform (as the MaCO2 d[4]
+// byte) with exact per-breath truth: EtCO2, FiCO2, Ti, Te, phase-III slope
+// and RR. The detector's breaths are matched to the truth and the mean
+// absolute errors are reported and bounded; the cost per sample is timed.
+// A recorded UART capture can be replayed with BREATH_TRACE=<file.mcr>
+// (waveform RR against the sensor's own rr byte).
+
+#include <Arduino.h>
+#include <unity.h>
+#include <chrono>
+#include <vector>
+#include "BreathDetector.h"
+#include "MaCO2Parser.h"
+#include "MaCO2Emulator.h"
+#include "UartCapture.h"
+
+static const uint32_t SAMPLE_MS = 125;          // Sensor cadence (8 Hz)
+
+struct Scenario {
+    const char* name;
+    float rr_bpm;
+    float ti_fraction;          // Ti / (Ti + Te)
+    float etco2_mmhg;           // End of plateau
+    float fico2_mmhg;           // Inspired baseline
+    float slope_mmhg_s;         // Phase III slope
+    float noise_mmhg;           // RMS
+    float shallow_etco2_mmhg;   // Every other breath (0 = all alike)
+    uint32_t seconds;
+};
+
+struct TrueBreath {
+    uint32_t end_ms;            // End of expiration
+    float etco2;
+    float fico2;
+    float ti_ms;
+    float te_ms;
+    float slope;
+    float rr;
+};
+
+// Upstroke / downstroke duration (phase II and the inspiratory fall)
+static const float EDGE_MS = 250.0f;
+
+class Capnogram {
+public:
+    explicit Capnogram(const Scenario& s) : _s(s), _seed(12345) {}
+
+    // Waveform at t, with the truth of every breath that ends by then
+    float at(uint32_t t_ms) {
+        const float period = 60000.0f / _s.rr_bpm;
+        const float ti = period * _s.ti_fraction;
+        const float te = period - ti;
+        const uint32_t n = (uint32_t)(t_ms / period);
+        const float u = t_ms - n * period;                 // Inspiration first
+        const float peak = (_s.shallow_etco2_mmhg > 0 && (n & 1)) ? _s.shallow_etco2_mmhg
+                                                                 : _s.etco2_mmhg;
+        const float slope = (_s.shallow_etco2_mmhg > 0 && (n & 1)) ? 0.0f : _s.slope_mmhg_s;
+        const float plateauStart = peak - slope * (te - EDGE_MS) / 1000.0f;
+        const float prevPeak = (_s.shallow_etco2_mmhg > 0 && n > 0 && !(n & 1))
+                                   ? _s.shallow_etco2_mmhg : _s.etco2_mmhg;
+
+        if (n >= _truth.size()) {
+            TrueBreath b;
+            b.end_ms = (uint32_t)((n + 1) * period);
+            b.etco2 = peak;
+            b.fico2 = _s.fico2_mmhg;
+            b.ti_ms = ti;
+            b.te_ms = te;
+            b.slope = slope;
+            b.rr = _s.rr_bpm;
+            _truth.push_back(b);
+        }
+
+        float v;
+        if (u < EDGE_MS) {
+            v = prevPeak + (_s.fico2_mmhg - prevPeak) * (u / EDGE_MS);
+            if (n == 0) v = _s.fico2_mmhg;
+        } else if (u < ti) {
+            v = _s.fico2_mmhg;
+        } else if (u < ti + EDGE_MS) {
+            v = _s.fico2_mmhg + (plateauStart - _s.fico2_mmhg) * ((u - ti) / EDGE_MS);
+        } else {
+            v = plateauStart + slope * (u - ti - EDGE_MS) / 1000.0f;
+        }
+        return v + _s.noise_mmhg * gaussian();
+    }
+
+    static uint8_t quantize(float v) {
+        const float r = roundf(v);
+        return (uint8_t)(r < 0 ? 0 : (r > 255 ? 255 : r));
+    }
+
+    const std::vector<TrueBreath>& truth() const { return _truth; }
+
+private:
+    Scenario _s;
+    uint32_t _seed;
+    std::vector<TrueBreath> _truth;
+
+    float uniform() {
+        _seed = _seed * 1664525u + 1013904223u;
+        return ((_seed >> 8) + 0.5f) / 16777216.0f;
+    }
+
+    float gaussian() {
+        return sqrtf(-2.0f * logf(uniform())) * cosf(6.2831853f * uniform());
+    }
+};
+
+struct Accuracy {
+    uint32_t expected;
+    uint32_t detected;
+    uint32_t matched;
+    float etco2;                // Mean absolute errors
+    float fico2;
+    float ti_ms;
+    float te_ms;
+    float slope;
+    float rr;
+};
+
+// Detected breath k belongs to the true breath whose expiration it ends
+static Accuracy evaluate(const Scenario& s) {
+    Capnogram wave(s);
+    BreathDetector detector;
+    std::vector<BreathMetrics> found;
+    const uint32_t samples = s.seconds * 1000 / SAMPLE_MS;
+    for (uint32_t i = 0; i < samples; i++) {
+        const uint32_t t = i * SAMPLE_MS;
+        if (detector.addSample(Capnogram::quantize(wave.at(t)), t)) {
+            found.push_back(detector.getLastBreath());
+        }
+    }
+
+    Accuracy a;
+    memset(&a, 0, sizeof(a));
+    const std::vector<TrueBreath>& truth = wave.truth();
+    const float period = 60000.0f / s.rr_bpm;
+    for (const TrueBreath& b : truth) {
+        if (b.end_ms + period <= samples * SAMPLE_MS) a.expected++;
+    }
+    a.detected = found.size();
+    for (const BreathMetrics& m : found) {
+        // The falling crossing lags the true end by part of the downstroke
+        const int32_t k = (int32_t)floorf((m.end_time - EDGE_MS) / period + 0.5f) - 1;
+        if (k < 1 || k >= (int32_t)truth.size()) continue;     // Skip the first breath
+        const TrueBreath& b = truth[k];
+        a.matched++;
+        a.etco2 += fabsf(m.etco2_x10 / 10.0f - b.etco2);
+        a.fico2 += fabsf(m.fico2_x10 / 10.0f - b.fico2);
+        a.ti_ms += fabsf((float)m.ti_ms - b.ti_ms);
+        a.te_ms += fabsf((float)m.te_ms - b.te_ms);
+        a.slope += fabsf(m.phase3_slope / 100.0f - b.slope);
+        a.rr += fabsf(m.rr_x10 / 10.0f - b.rr);
+    }
+    if (a.matched > 0) {
+        a.etco2 /= a.matched;
+        a.fico2 /= a.matched;
+        a.ti_ms /= a.matched;
+        a.te_ms /= a.matched;
+        a.slope /= a.matched;
+        a.rr /= a.matched;
+    }
+
+    char line[240];
+    snprintf(line, sizeof(line),
+             "%-10s breaths %lu/%lu  |err| EtCO2 %.2f mmHg  FiCO2 %.2f mmHg  Ti %.0f ms  "
+             "Te %.0f ms  slope %.2f mmHg/s  RR %.2f bpm",
+             s.name, (unsigned long)a.detected, (unsigned long)a.expected, a.etco2, a.fico2,
+             a.ti_ms, a.te_ms, a.slope, a.rr);
+    TEST_MESSAGE(line);
+    return a;
+}
+
+// Every breath found, values within about one sensor LSB / one sample
+static void assertAccurate(const Accuracy& a, float etco2_tol, float rr_tol) {
+    TEST_ASSERT_UINT32_WITHIN(1, a.expected, a.detected);
+    TEST_ASSERT_GREATER_OR_EQUAL(a.expected - 2, a.matched);
+    TEST_ASSERT_LESS_OR_EQUAL(etco2_tol, a.etco2);
+    TEST_ASSERT_LESS_OR_EQUAL(1.0f, a.fico2);
+    TEST_ASSERT_LESS_OR_EQUAL((float)SAMPLE_MS, a.ti_ms);
+    TEST_ASSERT_LESS_OR_EQUAL((float)SAMPLE_MS, a.te_ms);
+    TEST_ASSERT_LESS_OR_EQUAL(rr_tol, a.rr);
+}
+
+void setUp() {}
+void tearDown() {}
+
+//                       name          RR  Ti/T  EtCO2 FiCO2 slope noise shallow  s
+void test_normal() {
+    const Scenario s = { "normal",     12, 0.33f, 38,  0,    1.0f, 0.3f, 0,     120 };
+    const Accuracy a = evaluate(s);
+    assertAccurate(a, 1.0f, 0.5f);
+    TEST_ASSERT_LESS_OR_EQUAL(0.25f, a.slope);
+}
+
+void test_tachypnea() {
+    const Scenario s = { "tachypnea",  30, 0.40f, 32,  0,    0.5f, 0.3f, 0,     60 };
+    assertAccurate(evaluate(s), 1.0f, 1.5f);
+}
+
+void test_bradypnea() {
+    const Scenario s = { "bradypnea",   6, 0.25f, 45,  0,    1.5f, 0.3f, 0,     240 };
+    const Accuracy a = evaluate(s);
+    assertAccurate(a, 1.0f, 0.2f);
+    TEST_ASSERT_LESS_OR_EQUAL(0.25f, a.slope);
+}
+
+void test_rebreathing() {
+    const Scenario s = { "rebreath",   15, 0.35f, 40,  6,    1.0f, 0.3f, 0,     120 };
+    assertAccurate(evaluate(s), 1.0f, 0.5f);
+}
+
+void test_noisy() {
+    const Scenario s = { "noisy",      12, 0.33f, 38,  0,    1.0f, 1.0f, 0,     120 };
+    assertAccurate(evaluate(s), 2.5f, 0.5f);
+}
+
+void test_shallow() {
+    const Scenario s = { "shallow",    20, 0.40f,  8,  0,    0.0f, 0.3f, 0,     120 };
+    assertAccurate(evaluate(s), 1.0f, 1.0f);
+}
+
+void test_alternating_deep_and_shallow() {
+    const Scenario s = { "alternate",  12, 0.33f, 38,  0,    1.0f, 0.3f, 10,    120 };
+    assertAccurate(evaluate(s), 1.0f, 0.5f);
+}
+
+void test_flat_line_reports_nothing() {
+    BreathDetector detector;
+    uint32_t breaths = 0;
+    for (uint32_t i = 0; i < 800; i++) {
+        breaths += detector.addSample((i % 7 == 0) ? 2 : 1, i * SAMPLE_MS);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, breaths);
+    TEST_ASSERT_TRUE(detector.isApnea());
+    TEST_ASSERT_EQUAL_UINT8(0, detector.getEtCO2());
+}
+
+// End to end: emulated sensor bytes through MaCO2Parser
+void test_emulator_through_parser() {
+    VirtualClock clock;
+    MaCO2Emulator emulator;
+    MaCO2Parser parser;
+    emulator.setClock(&clock);
+    parser.setClock(&clock);
+    EmulatorConfig config = MaCO2Emulator::defaultConfig();
+    config.handshake = false;
+    config.breath_rate_bpm = 15.0f;
+    config.etco2_mmhg = 36.0f;
+    emulator.begin(config);
+
+    CO2Data data;
+    memset(&data, 0, sizeof(data));
+    for (uint32_t t = 0; t < 120000; t += 10) {
+        clock.advance(10000);
+        parser.parsePacket(emulator, data);
+    }
+    TEST_ASSERT_UINT32_WITHIN(3, 30 - 2, data.breath.breath_count);
+    TEST_ASSERT_UINT32_WITHIN(5, 150, data.breath.rr_x10);
+    TEST_ASSERT_UINT32_WITHIN(2, 36, data.fetco2);
+}
+
+void test_cost_per_sample() {
+    const Scenario s = { "cost", 15, 0.35f, 38, 0, 1.0f, 0.5f, 0, 0 };
+    Capnogram wave(s);
+    std::vector<uint8_t> samples(1 << 20);
+    for (size_t i = 0; i < samples.size(); i++) {
+        samples[i] = Capnogram::quantize(wave.at((uint32_t)(i * SAMPLE_MS)));
+    }
+    BreathDetector detector;
+    uint32_t breaths = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < samples.size(); i++) {
+        breaths += detector.addSample(samples[i], (uint32_t)(i * SAMPLE_MS));
+    }
+    const double ns = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - start).count() / samples.size();
+
+    char line[80];
+    snprintf(line, sizeof(line), "%.1f ns/sample (%lu breaths)", ns, (unsigned long)breaths);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_GREATER_THAN(0, breaths);
+    TEST_ASSERT_LESS_THAN(1000.0, ns);
+}
+
+// Capture replay
+class MemoryStream : public Stream {
+public:
+    explicit MemoryStream(const std::vector<uint8_t>& data) : _data(data), _pos(0) {}
+    int available() override { return (int)(_data.size() - _pos); }
+    int read() override { return _pos < _data.size() ? _data[_pos++] : -1; }
+    int peek() override { return _pos < _data.size() ? _data[_pos] : -1; }
+    size_t write(uint8_t) override { return 1; }
+    using Print::write;
+
+private:
+    const std::vector<uint8_t>& _data;
+    size_t _pos;
+};
+
+void test_recorded_trace() {
+    const char* path = getenv("BREATH_TRACE");
+    if (path == nullptr) {
+        TEST_IGNORE_MESSAGE("set BREATH_TRACE=<capture.mcr> to check a recording");
+    }
+    FILE* f = fopen(path, "rb");
+    TEST_ASSERT_NOT_NULL(f);
+    std::vector<uint8_t> bytes;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) bytes.insert(bytes.end(), buf, buf + n);
+    fclose(f);
+
+    VirtualClock clock;
+    MemoryStream file(bytes);
+    UartReplay replay(file);
+    MaCO2Parser parser;
+    replay.setClock(&clock);
+    parser.setClock(&clock);
+    TEST_ASSERT_TRUE_MESSAGE(replay.begin(REPLAY_REALTIME), "not a UART capture");
+
+    CO2Data data;
+    memset(&data, 0, sizeof(data));
+    uint32_t lastCount = 0, compared = 0;
+    float rrError = 0;
+    while (replay.update() || !replay.isFinished()) {
+        clock.advance(100000);
+        while (parser.parsePacket(replay, data)) {
+            if (data.breath.breath_count != lastCount && data.respiratory_rate > 0) {
+                lastCount = data.breath.breath_count;
+                rrError += fabsf(data.breath.rr_x10 / 10.0f - data.respiratory_rate);
+                compared++;
+            }
+        }
+    }
+    char line[120];
+    snprintf(line, sizeof(line), "%lu packets, %lu breaths, |RR wave - RR sensor| %.2f bpm",
+             (unsigned long)parser.getPacketCount(), (unsigned long)data.breath.breath_count,
+             compared ? rrError / compared : 0.0f);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_GREATER_THAN(0, compared);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_normal);
+    RUN_TEST(test_tachypnea);
+    RUN_TEST(test_bradypnea);
+    RUN_TEST(test_rebreathing);
+    RUN_TEST(test_noisy);
+    RUN_TEST(test_shallow);
+    RUN_TEST(test_alternating_deep_and_shallow);
+    RUN_TEST(test_flat_line_reports_nothing);
+    RUN_TEST(test_emulator_through_parser);
+    RUN_TEST(test_cost_per_sample);
+    RUN_TEST(test_recorded_trace);
+    return UNITY_END();
+}
@@ -0,0 +1,204 @@
+// test_calibration_store
+// FileCalibrationStore on the host file system
+// Profiles are saved to a fresh temporary directory and read back: round
+// trip of every channel, the active serial, removal, and rejection of bad
+// serials and of damaged, truncated or renamed profile files. The last test
+// stores ADCManager's calibration and applies it to a second instance, as
+// the host PROFILE_SAVE / PROFILE commands do.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "CalibrationStore.h"
+#include "ADCManager.h"
+
+static char dir[64];
+static FileCalibrationStore* store;
+
+static void profilePath(char* path, size_t len, const char* serial) {
+    snprintf(path, len, "%s/%s.cal", dir, serial);
+}
+
+// Profile with a spline on O2 and a 3-point line on volume
+static void makeProfile(CalibrationProfile& p, const char* serial) {
+    TEST_ASSERT_TRUE(CalibrationStore::initProfile(p, serial));
+    ChannelCalibration& o2 = p.channels[SENSOR_O2];
+    o2.mode = CAL_CUBIC_SPLINE;
+    o2.count = 4;
+    for (uint8_t i = 0; i < o2.count; i++) {
+        o2.points[i] = { 0.1f + 0.3f * i, 21.0f * i + 0.5f * i * i };
+    }
+    ChannelCalibration& vol = p.channels[SENSOR_VOLUME];
+    vol.mode = CAL_PIECEWISE_LINEAR;
+    vol.count = 3;
+    vol.points[0] = { 0.0f, -50.0f };
+    vol.points[1] = { 1.0f, 150.0f };
+    vol.points[2] = { 2.5f, 600.0f };
+}
+
+void setUp() {
+    strcpy(dir, "/tmp/calstoreXXXXXX");
+    TEST_ASSERT_NOT_NULL(mkdtemp(dir));
+    store = new FileCalibrationStore(dir);
+}
+
+void tearDown() {
+    delete store;
+    char cmd[96];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+    system(cmd);
+}
+
+void test_round_trip() {
+    CalibrationProfile saved, loaded;
+    makeProfile(saved, "MA-0042");
+    TEST_ASSERT_TRUE(store->save(saved));
+    memset(&loaded, 0xA5, sizeof(loaded));
+    TEST_ASSERT_TRUE(store->load("MA-0042", loaded));
+    TEST_ASSERT_EQUAL_MEMORY(&saved, &loaded, sizeof(saved));
+    TEST_ASSERT_FALSE(store->load("MA-0043", loaded));
+}
+
+void test_active_profile() {
+    CalibrationProfile a, b, loaded;
+    makeProfile(a, "A1");
+    makeProfile(b, "B_2");
+    b.channels[SENSOR_O2].points[0].y = 1.0f;
+    TEST_ASSERT_TRUE(store->save(a));
+    TEST_ASSERT_TRUE(store->save(b));
+
+    char serial[CalibrationProfile::SERIAL_LEN];
+    TEST_ASSERT_FALSE(store->getActive(serial, sizeof(serial)));
+    TEST_ASSERT_FALSE(store->loadActive(loaded));
+
+    TEST_ASSERT_TRUE(store->setActive("B_2"));
+    TEST_ASSERT_TRUE(store->getActive(serial, sizeof(serial)));
+    TEST_ASSERT_EQUAL_STRING("B_2", serial);
+    TEST_ASSERT_TRUE(store->loadActive(loaded));
+    TEST_ASSERT_EQUAL_MEMORY(&b, &loaded, sizeof(b));
+
+    // Survives a new store instance (reboot)
+    FileCalibrationStore again(dir);
+    TEST_ASSERT_TRUE(again.setActive("A1"));
+    TEST_ASSERT_TRUE(store->loadActive(loaded));
+    TEST_ASSERT_EQUAL_MEMORY(&a, &loaded, sizeof(a));
+
+    // Too small a buffer for the serial
+    char tiny[2];
+    TEST_ASSERT_FALSE(store->getActive(tiny, sizeof(tiny)));
+}
+
+void test_remove() {
+    CalibrationProfile p;
+    makeProfile(p, "GONE");
+    TEST_ASSERT_TRUE(store->save(p));
+    TEST_ASSERT_TRUE(store->remove("GONE"));
+    TEST_ASSERT_FALSE(store->load("GONE", p));
+    TEST_ASSERT_FALSE(store->remove("GONE"));
+}
+
+void test_invalid_serials() {
+    const char* bad[] = { "", "0123456789abcdef", "a/b", "../x", "sp ace", "dot.cal" };
+    CalibrationProfile p;
+    for (const char* s : bad) {
+        TEST_ASSERT_FALSE_MESSAGE(CalibrationStore::isValidSerial(s), s);
+        TEST_ASSERT_FALSE(CalibrationStore::initProfile(p, s));
+        TEST_ASSERT_FALSE(store->load(s, p));
+        TEST_ASSERT_FALSE(store->setActive(s));
+    }
+    TEST_ASSERT_TRUE(CalibrationStore::isValidSerial("0123456789abcde"));    // 15 chars
+
+    // A profile whose serial field was patched past the check
+    makeProfile(p, "OK");
+    strcpy(p.serial, "a/b");
+    TEST_ASSERT_FALSE(store->save(p));
+}
+
+void test_damaged_files_are_rejected() {
+    CalibrationProfile p, loaded;
+    makeProfile(p, "DMG");
+    char path[96];
+    profilePath(path, sizeof(path), "DMG");
+
+    // Truncated
+    TEST_ASSERT_TRUE(store->save(p));
+    TEST_ASSERT_EQUAL_INT(0, truncate(path, sizeof(p) - 1));
+    TEST_ASSERT_FALSE(store->load("DMG", loaded));
+
+    // Other layout version
+    CalibrationProfile old = p;
+    old.version = CalibrationProfile::VERSION - 1;
+    FILE* f = fopen(path, "wb");
+    fwrite(&old, sizeof(old), 1, f);
+    fclose(f);
+    TEST_ASSERT_FALSE(store->load("DMG", loaded));
+
+    // Point count beyond the curve capacity
+    CalibrationProfile big = p;
+    big.channels[SENSOR_O2].count = CalibrationCurve::MAX_POINTS + 1;
+    f = fopen(path, "wb");
+    fwrite(&big, sizeof(big), 1, f);
+    fclose(f);
+    TEST_ASSERT_FALSE(store->load("DMG", loaded));
+
+    // Copied under another serial
+    TEST_ASSERT_TRUE(store->save(p));
+    char other[96];
+    profilePath(other, sizeof(other), "OTHER");
+    TEST_ASSERT_EQUAL_INT(0, rename(path, other));
+    TEST_ASSERT_FALSE(store->load("OTHER", loaded));
+
+    // Active file naming an invalid serial
+    snprintf(path, sizeof(path), "%s/active", dir);
+    f = fopen(path, "w");
+    fputs("../etc", f);
+    fclose(f);
+    char serial[CalibrationProfile::SERIAL_LEN];
+    TEST_ASSERT_FALSE(store->getActive(serial, sizeof(serial)));
+}
+
+// Save the calibration of one ADCManager, apply it to another
+void test_adc_profile_round_trip() {
+    Serial.setMuted(true);
+    ADCManager* a = new ADCManager();
+    ADCManager* b = new ADCManager();
+    a->begin();
+    b->begin();
+
+    const CalPoint o2[] = { { 0.05f, 0.0f }, { 0.4f, 21.0f }, { 0.9f, 50.0f }, { 1.8f, 100.0f } };
+    TEST_ASSERT_TRUE(a->setCalibrationCurve(SENSOR_O2, o2, 4, CAL_CUBIC_SPLINE));
+    a->setLinearCalibration(SENSOR_VOLUME, 0.2f, -100.0f, 2.2f, 700.0f);
+
+    CalibrationProfile saved, loaded;
+    TEST_ASSERT_FALSE(a->getProfile("bad serial", saved));
+    TEST_ASSERT_TRUE(a->getProfile("LAB-7", saved));
+    TEST_ASSERT_EQUAL_UINT8(4, saved.channels[SENSOR_O2].count);
+    TEST_ASSERT_EQUAL_UINT8(CAL_CUBIC_SPLINE, saved.channels[SENSOR_O2].mode);
+    TEST_ASSERT_EQUAL_UINT8(2, saved.channels[SENSOR_VOLUME].count);
+    TEST_ASSERT_TRUE(store->save(saved));
+    TEST_ASSERT_TRUE(store->setActive("LAB-7"));
+
+    TEST_ASSERT_TRUE(store->loadActive(loaded));
+    TEST_ASSERT_TRUE(b->applyProfile(loaded));
+    CalibrationProfile applied;
+    TEST_ASSERT_TRUE(b->getProfile("LAB-7", applied));
+    TEST_ASSERT_EQUAL_MEMORY(&saved, &applied, sizeof(saved));
+
+    delete a;
+    delete b;
+    Serial.setMuted(false);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_active_profile);
+    RUN_TEST(test_remove);
+    RUN_TEST(test_invalid_serials);
+    RUN_TEST(test_damaged_files_are_rejected);
+    RUN_TEST(test_adc_profile_round_trip);
+    return UNITY_END();
+}
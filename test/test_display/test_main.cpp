@@ -0,0 +1,311 @@
+// test_display
+// DisplayManager rendered into the host framebuffer (lib/NativeArduino)
+// A replay driver steps a CO2Data stream through the loop()'s pipeline on a
+// VirtualClock: MaCO2 bytes -> MaCO2Parser -> SampleTimeline / TrendStore ->
+// DisplayManager::updateAll every 50 ms. Per-frame draw time, primitives and
+// pixels are reported, and the final live and trend pages are compared with
+// the golden frames in golden/.
+//
+//   UPDATE_GOLDEN=1              rewrite the golden frames
+//   DISPLAY_REPLAY=<file.mcr>    replay a recorded UART capture (report only)
+//   DISPLAY_DUMP=<dir>           write every 20th frame as PPM
+
+#include <Arduino.h>
+#include <unity.h>
+#include <vector>
+#include "DisplayManager.h"
+#include "MaCO2Emulator.h"
+#include "UartCapture.h"
+
+#ifndef PROJECT_DIR
+#define PROJECT_DIR "."
+#endif
+
+static const char* GOLDEN_DIR = PROJECT_DIR "/test/test_display/golden";
+static const uint32_t STEP_MS = 10;             // loop() granularity
+static const uint32_t DATA_INTERVAL_MS = 100;   // As in main.cpp
+static const uint32_t DISPLAY_INTERVAL_MS = 50;
+
+// Capture file bytes as a Stream (input of UartReplay)
+class MemoryStream : public Stream {
+public:
+    explicit MemoryStream(const std::vector<uint8_t>& data) : _data(data), _pos(0) {}
+    int available() override { return (int)(_data.size() - _pos); }
+    int read() override { return _pos < _data.size() ? _data[_pos++] : -1; }
+    int peek() override { return _pos < _data.size() ? _data[_pos] : -1; }
+    size_t write(uint8_t) override { return 1; }
+    using Print::write;
+
+private:
+    const std::vector<uint8_t>& _data;
+    size_t _pos;
+};
+
+struct FrameReport {
+    uint32_t frames;
+    uint64_t totalUs;
+    uint32_t maxUs;
+    uint64_t totalPrimitives;
+    uint32_t maxPrimitives;
+    uint64_t totalPixels;
+    uint32_t maxPixels;
+};
+
+// The part of loop() that feeds and refreshes the display
+class DisplayReplay {
+public:
+    explicit DisplayReplay(Stream& source) : _source(source) {
+        memset(&_data, 0, sizeof(_data));
+        memset(&_report, 0, sizeof(_report));
+        _parser.setClock(&clock);
+        _display.setClock(&clock);
+        _display.setTimeline(&_timeline);
+        _display.setTrendStore(&_trend);
+        // Boot sequence of setup()
+        _display.begin();
+        _display.showSplash("Ready!", "192.168.4.1");
+        _display.clearScreen();
+        _display.setNetworkInfo("EAGLEHAGEN", "192.168.4.1");
+        _display.setOutputFormatName("Out: LabVIEW");
+    }
+
+    // Advance the clock by ms, running the data and display schedules
+    void run(uint32_t ms, UartReplay* replay = nullptr, const char* dumpDir = nullptr) {
+        for (uint32_t t = 0; t < ms; t += STEP_MS) {
+            clock.advance(STEP_MS * 1000);
+            const uint32_t now = clock.millis();
+            if (now - _lastData >= DATA_INTERVAL_MS) {
+                _lastData = now;
+                if (replay != nullptr) replay->update();
+                while (_parser.parsePacket(_source, _data)) {
+                    // Slowly varying analog channels in place of the ADC
+                    const float phase = (float)(now % 5000) / 5000.0f;
+                    _data.sensors[SENSOR_O2].value = 20.9f + 0.4f * sinf(phase * 6.2832f);
+                    _data.sensors[SENSOR_VOLUME].value = 250.0f * sinf(phase * 6.2832f);
+                    _timeline.push(_data);
+                    if (_data.valid) {
+                        _trend.addSample(_data, _data.timestamp);
+                    }
+                }
+            }
+            if (now - _lastDisplay >= DISPLAY_INTERVAL_MS) {
+                _lastDisplay = now;
+                frame(dumpDir);
+            }
+        }
+    }
+
+    void setPage(DisplayPage page) { _display.setPage(page); }
+    const TFT_eSPI& tft() const { return _display.getTFT(); }
+    const FrameReport& report() const { return _report; }
+    uint32_t packets() const { return _parser.getPacketCount(); }
+
+    VirtualClock clock;
+
+private:
+    Stream& _source;
+    MaCO2Parser _parser;
+    SampleTimeline _timeline;
+    TrendStore _trend;
+    DisplayManager _display;
+    CO2Data _data;
+    FrameReport _report;
+    uint32_t _lastData = 0;
+    uint32_t _lastDisplay = 0;
+
+    void frame(const char* dumpDir) {
+        const DrawStats before = tft().getDrawStats();
+        const uint32_t framesBefore = _display.getFrameStats().frames;
+        _display.updateAll(_data);
+        if (_display.getFrameStats().frames == framesBefore) {
+            return;                     // Throttled
+        }
+        const uint32_t us = _display.getFrameStats().frame_us;
+        const uint32_t primitives = tft().getDrawStats().primitives - before.primitives;
+        const uint32_t pixels = tft().getDrawStats().pixels - before.pixels;
+        _report.frames++;
+        _report.totalUs += us;
+        _report.totalPrimitives += primitives;
+        _report.totalPixels += pixels;
+        if (us > _report.maxUs) _report.maxUs = us;
+        if (primitives > _report.maxPrimitives) _report.maxPrimitives = primitives;
+        if (pixels > _report.maxPixels) _report.maxPixels = pixels;
+
+        if (dumpDir != nullptr && _report.frames % 20 == 0) {
+            char path[256];
+            snprintf(path, sizeof(path), "%s/frame_%05lu.ppm", dumpDir,
+                     (unsigned long)_report.frames);
+            tft().writePPM(path);
+        }
+    }
+};
+
+static void printReport(const char* name, const FrameReport& r) {
+    if (r.frames == 0) return;
+    char line[200];
+    snprintf(line, sizeof(line),
+             "%s: %lu frames, %.1f us/frame (max %lu), %.1f prims/frame (max %lu), "
+             "%.0f px/frame (max %lu)",
+             name, (unsigned long)r.frames, (double)r.totalUs / r.frames, (unsigned long)r.maxUs,
+             (double)r.totalPrimitives / r.frames, (unsigned long)r.maxPrimitives,
+             (double)r.totalPixels / r.frames, (unsigned long)r.maxPixels);
+    TEST_MESSAGE(line);
+}
+
+// ============================================================================
+// Golden frames
+// ============================================================================
+
+static bool readPPM(const char* path, int& w, int& h, std::vector<uint8_t>& rgb) {
+    FILE* f = fopen(path, "rb");
+    if (f == nullptr) return false;
+    int maxval = 0;
+    const bool ok = fscanf(f, "P6 %d %d %d", &w, &h, &maxval) == 3 && maxval == 255 &&
+                    fgetc(f) != EOF;
+    if (ok) {
+        rgb.resize((size_t)w * h * 3);
+        const bool complete = fread(rgb.data(), 1, rgb.size(), f) == rgb.size();
+        fclose(f);
+        return complete;
+    }
+    fclose(f);
+    return false;
+}
+
+// Pixels that differ from golden/<name>.ppm; a mismatch leaves the frame
+// next to it as <name>.actual.ppm
+static void checkGolden(const TFT_eSPI& tft, const char* name) {
+    char golden[256];
+    char actual[256];
+    snprintf(golden, sizeof(golden), "%s/%s.ppm", GOLDEN_DIR, name);
+    snprintf(actual, sizeof(actual), "%s/%s.actual.ppm", GOLDEN_DIR, name);
+
+    if (getenv("UPDATE_GOLDEN") != nullptr) {
+        TEST_ASSERT_TRUE_MESSAGE(tft.writePPM(golden), golden);
+        TEST_MESSAGE("golden frame rewritten");
+        return;
+    }
+
+    // Compare through the same RGB565 -> RGB888 conversion the dump uses
+    TEST_ASSERT_TRUE_MESSAGE(tft.writePPM(actual), actual);
+    int gw = 0, gh = 0, aw = 0, ah = 0;
+    std::vector<uint8_t> expected, got;
+    TEST_ASSERT_TRUE_MESSAGE(readPPM(golden, gw, gh, expected),
+                             "missing golden frame (run with UPDATE_GOLDEN=1)");
+    TEST_ASSERT_TRUE(readPPM(actual, aw, ah, got));
+    TEST_ASSERT_EQUAL(gw, aw);
+    TEST_ASSERT_EQUAL(gh, ah);
+
+    uint32_t diff = 0;
+    int x0 = aw, y0 = ah, x1 = -1, y1 = -1;
+    for (int y = 0; y < ah; y++) {
+        for (int x = 0; x < aw; x++) {
+            const size_t i = ((size_t)y * aw + x) * 3;
+            if (memcmp(&expected[i], &got[i], 3) != 0) {
+                diff++;
+                x0 = std::min(x0, x);
+                y0 = std::min(y0, y);
+                x1 = std::max(x1, x);
+                y1 = std::max(y1, y);
+            }
+        }
+    }
+    if (diff == 0) {
+        remove(actual);
+        return;
+    }
+    char msg[400];
+    snprintf(msg, sizeof(msg), "%s: %lu pixels differ in (%d,%d)-(%d,%d), see %s", name,
+             (unsigned long)diff, x0, y0, x1, y1, actual);
+    TEST_FAIL_MESSAGE(msg);
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+static MaCO2Emulator* emulator;
+static DisplayReplay* replay;
+
+void setUp() {
+    Serial.setMuted(true);
+    EmulatorConfig config = MaCO2Emulator::defaultConfig();
+    config.handshake = false;
+    config.seed = 27;
+    emulator = new MaCO2Emulator();
+    replay = new DisplayReplay(*emulator);
+    emulator->setClock(&replay->clock);
+    emulator->begin(config);
+}
+
+void tearDown() {
+    delete replay;
+    delete emulator;
+    Serial.setMuted(false);
+}
+
+void test_live_page() {
+    replay->run(60000, nullptr, getenv("DISPLAY_DUMP"));
+    printReport("live", replay->report());
+
+    // 8 Hz packets, one frame per 50 ms
+    TEST_ASSERT_UINT32_WITHIN(10, 480, replay->packets());
+    TEST_ASSERT_EQUAL_UINT32(1200, replay->report().frames);
+    // Waveform area cleared and redrawn every frame, everything else only on change
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(170 * 120, replay->report().totalPixels / replay->report().frames);
+    TEST_ASSERT_LESS_THAN(170 * 320, replay->report().totalPixels / replay->report().frames);
+    checkGolden(replay->tft(), "live");
+}
+
+void test_trend_page() {
+    replay->run(120000);
+    replay->setPage(PAGE_TREND);
+    replay->run(2000);
+    printReport("trend", replay->report());
+    checkGolden(replay->tft(), "trend");
+}
+
+void test_page_switch_repaints_everything() {
+    replay->run(5000);
+    replay->setPage(PAGE_TREND);
+    replay->setPage(PAGE_LIVE);
+    const DrawStats before = replay->tft().getDrawStats();
+    replay->run(DISPLAY_INTERVAL_MS);
+    const DrawStats& after = replay->tft().getDrawStats();
+    // Header, waveform, both metric boxes and the status area come back
+    TEST_ASSERT_GREATER_THAN(170 * 200, after.pixels - before.pixels);
+}
+
+void test_replay_capture() {
+    const char* path = getenv("DISPLAY_REPLAY");
+    if (path == nullptr) {
+        TEST_IGNORE_MESSAGE("set DISPLAY_REPLAY=<capture.mcr> to replay a recording");
+    }
+    FILE* f = fopen(path, "rb");
+    TEST_ASSERT_NOT_NULL(f);
+    std::vector<uint8_t> bytes;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) bytes.insert(bytes.end(), buf, buf + n);
+    fclose(f);
+
+    MemoryStream file(bytes);
+    UartReplay uart(file);
+    DisplayReplay capture(uart);
+    uart.setClock(&capture.clock);
+    TEST_ASSERT_TRUE_MESSAGE(uart.begin(REPLAY_REALTIME), "not a UART capture");
+    while (!uart.isFinished()) {
+        capture.run(1000, &uart, getenv("DISPLAY_DUMP"));
+    }
+    printReport("capture", capture.report());
+    TEST_ASSERT_GREATER_THAN(0, capture.packets());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_live_page);
+    RUN_TEST(test_trend_page);
+    RUN_TEST(test_page_switch_repaints_everything);
+    RUN_TEST(test_replay_capture);
+    return UNITY_END();
+}
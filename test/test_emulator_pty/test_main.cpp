@@ -0,0 +1,181 @@
+// test_emulator_pty
+// MaCO2Emulator served on a Linux pseudo-terminal, read back through the pty
+// A pump thread moves bytes between the emulator and the pty master, as the
+// emulator_pty program does; the test opens the slave device with FdStream
+// like a serial port and runs MaCO2Parser on real time. Covered: the
+// 0x06 / ACK / init-byte handshake, packet rate and content at 4x, commands
+// written to the device reaching the emulator, injected faults, and a
+// client that stops reading.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <atomic>
+#include <thread>
+#include "MaCO2Parser.h"
+#include "MaCO2Pty.h"
+
+static MaCO2Emulator* emulator;
+static MaCO2Pty* pty;
+static FdStream* port;
+static std::thread pumpThread;
+static std::atomic<bool> pumping(false);
+
+static void startPump() {
+    pumping = true;
+    pumpThread = std::thread([]() {
+        while (pumping) {
+            pty->pump();
+            delay(1);
+        }
+    });
+}
+
+// The emulator is only touched by the pump thread while it runs
+static void stopPump() {
+    if (pumping.exchange(false)) {
+        pumpThread.join();
+    }
+}
+
+static void start(const EmulatorConfig& config) {
+    emulator->begin(config);
+    startPump();
+}
+
+void setUp() {
+    Serial.setMuted(true);
+    emulator = new MaCO2Emulator();
+    pty = new MaCO2Pty(*emulator);
+    port = new FdStream();
+    TEST_ASSERT_TRUE(pty->open());
+    TEST_ASSERT_EQUAL_INT(0, strncmp("/dev/pts/", pty->slavePath(), 9));
+    TEST_ASSERT_TRUE(port->open(pty->slavePath()));
+}
+
+void tearDown() {
+    stopPump();
+    delete port;
+    delete pty;
+    delete emulator;
+    Serial.setMuted(false);
+}
+
+// Parse for ms of real time; returns packets decoded
+static uint32_t parseFor(MaCO2Parser& parser, CO2Data& data, uint32_t ms) {
+    const uint32_t start = millis();
+    uint32_t packets = 0;
+    while (millis() - start < ms) {
+        while (parser.parsePacket(*port, data)) {
+            packets++;
+        }
+        delay(2);
+    }
+    return packets;
+}
+
+void test_handshake_and_packets() {
+    EmulatorConfig config = MaCO2Emulator::defaultConfig();
+    config.rate_multiplier = 4.0f;
+    config.breath_rate_bpm = 40.0f;
+    config.etco2_mmhg = 40.0f;
+    start(config);
+
+    MaCO2Parser parser;
+    TEST_ASSERT_TRUE(parser.initialize(*port, 3000));
+    CO2Data data;
+    memset(&data, 0, sizeof(data));
+    const uint32_t packets = parseFor(parser, data, 4000);
+    stopPump();
+
+    char line[100];
+    snprintf(line, sizeof(line), "%lu packets in 4 s at 32 Hz, %lu bytes through the pty",
+             (unsigned long)packets, (unsigned long)pty->getBytesOut());
+    TEST_MESSAGE(line);
+    TEST_ASSERT_UINT32_WITHIN(10, 128, packets);
+    TEST_ASSERT_EQUAL_UINT32(0, parser.getErrorCount());
+    TEST_ASSERT_EQUAL_UINT32(0, emulator->getStats().overflowBytes);
+    TEST_ASSERT_UINT32_WITHIN(3, 40, data.fetco2);
+    TEST_ASSERT_TRUE(parser.isPumpRunning(data));
+}
+
+void test_commands_reach_the_emulator() {
+    EmulatorConfig config = MaCO2Emulator::defaultConfig();
+    config.handshake = false;
+    config.pump_running = false;
+    start(config);
+
+    MaCO2Parser parser;
+    CO2Data data;
+    memset(&data, 0, sizeof(data));
+    TEST_ASSERT_GREATER_THAN_UINT32(0, parseFor(parser, data, 500));
+    TEST_ASSERT_FALSE(parser.isPumpRunning(data));
+
+    parser.sendCommand(*port, CMD_START_PUMP);
+    parseFor(parser, data, 500);
+    TEST_ASSERT_TRUE(parser.isPumpRunning(data));
+    stopPump();
+    TEST_ASSERT_EQUAL_UINT32(1, emulator->getStats().commands);
+    TEST_ASSERT_EQUAL_UINT32(1, pty->getBytesIn());
+}
+
+// Dropped bytes and bad checksums: the parser resyncs and keeps decoding
+void test_faults_through_the_pty() {
+    EmulatorConfig config = MaCO2Emulator::defaultConfig();
+    config.handshake = false;
+    config.rate_multiplier = 8.0f;
+    config.drop_byte_prob = 0.005f;
+    config.corrupt_prob = 0.05f;
+    config.seed = 7;
+    start(config);
+
+    MaCO2Parser parser;
+    CO2Data data;
+    memset(&data, 0, sizeof(data));
+    const uint32_t packets = parseFor(parser, data, 3000);
+    stopPump();
+
+    const EmulatorStats& s = emulator->getStats();
+    char line[140];
+    snprintf(line, sizeof(line), "%lu sent, %lu decoded, %lu corrupt, %lu bytes dropped, %lu parser errors",
+             (unsigned long)s.packets, (unsigned long)packets, (unsigned long)s.corruptPackets,
+             (unsigned long)s.droppedBytes, (unsigned long)parser.getErrorCount());
+    TEST_MESSAGE(line);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, s.corruptPackets);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, parser.getErrorCount());
+    // Every packet neither corrupted nor hit by a dropped byte gets through
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(s.packets - s.corruptPackets - 2 * s.droppedBytes - 2, packets);
+}
+
+// A client that stops reading: the pty fills (about 20 kB on Linux), then
+// the emulator's UART buffer overflows; reading again drains the backlog
+// and resumes with fresh packets
+void test_stalled_client() {
+    EmulatorConfig config = MaCO2Emulator::defaultConfig();
+    config.handshake = false;
+    config.rate_multiplier = 128.0f;
+    start(config);
+    delay(4000);                    // ~32 kB at 1024 packets/s
+
+    MaCO2Parser parser;
+    CO2Data data;
+    memset(&data, 0, sizeof(data));
+    const uint32_t packets = parseFor(parser, data, 1000);
+    stopPump();
+
+    const EmulatorStats& s = emulator->getStats();
+    char line[120];
+    snprintf(line, sizeof(line), "%lu sent, %lu bytes lost to overflow, %lu decoded after the stall",
+             (unsigned long)s.packets, (unsigned long)s.overflowBytes, (unsigned long)packets);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, s.overflowBytes);
+    TEST_ASSERT_GREATER_THAN_UINT32(s.packets / 2, packets);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_handshake_and_packets);
+    RUN_TEST(test_commands_reach_the_emulator);
+    RUN_TEST(test_faults_through_the_pty);
+    RUN_TEST(test_stalled_client);
+    return UNITY_END();
+}
@@ -0,0 +1,207 @@
+// test_filter_chain
+// FilterChain stages against naive references, and cost per sample
+// Each stage is compared sample by sample with a straightforward O(window)
+// implementation on a pseudo-random ADC-like signal. The benchmark times
+// the running-sum MovingAverage and the naive average for windows 1..1024;
+// the running sum must stay flat while the naive cost grows with the window.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include "FilterChain.h"
+#include "SensorChannels.h"
+
+static const size_t SIGNAL_LEN = 1 << 16;
+static std::vector<int32_t> signal;
+
+// 12-bit counts << 4 with noise and occasional spikes
+static void makeSignal() {
+    signal.resize(SIGNAL_LEN);
+    uint32_t seed = 32;
+    for (size_t i = 0; i < SIGNAL_LEN; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        int32_t v = 2048 + (int32_t)(800.0f * sinf(i * 0.001f)) + (int32_t)((seed >> 24) & 15) - 8;
+        if ((seed & 0x3FF) == 0) v = (seed >> 12) & 4095;  // Spike
+        signal[i] = v << 4;
+    }
+}
+
+static int32_t roundedMean(int64_t sum, int32_t n) {
+    return (int32_t)((sum >= 0 ? sum + n / 2 : sum - n / 2) / n);
+}
+
+// Naive moving average over the last `window` samples (primed with x0)
+class NaiveAverage {
+public:
+    NaiveAverage(uint16_t window, int32_t x0) : _hist(window, x0) {}
+    int32_t process(int32_t x) {
+        _hist.erase(_hist.begin());
+        _hist.push_back(x);
+        int64_t sum = 0;
+        for (int32_t v : _hist) sum += v;
+        return roundedMean(sum, (int32_t)_hist.size());
+    }
+
+private:
+    std::vector<int32_t> _hist;
+};
+
+void setUp() {}
+void tearDown() {}
+
+void test_moving_average_matches_naive() {
+    const uint16_t windows[] = { 1, 2, 3, 10, 33, 64 };
+    for (uint16_t w : windows) {
+        MovingAverage<64> fast;
+        fast.setWindow(w);
+        fast.prime(signal[0]);
+        NaiveAverage naive(w, signal[0]);
+        for (size_t i = 0; i < 20000; i++) {
+            TEST_ASSERT_EQUAL_INT32(naive.process(signal[i]), fast.process(signal[i]));
+        }
+    }
+}
+
+void test_set_window_keeps_the_mean() {
+    MovingAverage<64> avg;
+    avg.setWindow(10);
+    for (int i = 0; i < 10; i++) avg.process(1000 + i);
+    const int32_t before = avg.process(1010);
+    avg.setWindow(40);
+    TEST_ASSERT_EQUAL_UINT16(40, avg.getWindow());
+    // A constant input equal to the mean leaves the output unchanged
+    TEST_ASSERT_EQUAL_INT32(before, avg.process(before));
+    avg.setWindow(1000);
+    TEST_ASSERT_EQUAL_UINT16(64, avg.getWindow());
+}
+
+void test_median_matches_naive() {
+    SlidingMedian<5> med;
+    med.prime(signal[0]);
+    std::vector<int32_t> hist(5, signal[0]);
+    for (size_t i = 0; i < 20000; i++) {
+        hist.erase(hist.begin());
+        hist.push_back(signal[i]);
+        std::vector<int32_t> sorted = hist;
+        std::sort(sorted.begin(), sorted.end());
+        TEST_ASSERT_EQUAL_INT32(sorted[2], med.process(signal[i]));
+    }
+}
+
+void test_median_rejects_single_spikes() {
+    SlidingMedian<3> med;
+    med.prime(100);
+    TEST_ASSERT_EQUAL_INT32(100, med.process(100));
+    TEST_ASSERT_EQUAL_INT32(100, med.process(4000));
+    TEST_ASSERT_EQUAL_INT32(100, med.process(100));
+}
+
+void test_fir_boxcar_and_custom() {
+    FIRFilter<4> fir;
+    fir.prime(0);
+    int32_t y = 0;
+    for (int i = 0; i < 4; i++) y = fir.process(4000);
+    TEST_ASSERT_INT32_WITHIN(1, 4000, y);               // 32767/4 per tap
+
+    const int16_t newestOnly[4] = { 32767, 0, 0, 0 };
+    fir.setCoefficients(newestOnly);
+    TEST_ASSERT_INT32_WITHIN(1, 1234, fir.process(1234));
+}
+
+void test_iir_converges() {
+    ExpIIR<3> iir;
+    iir.prime(0);
+    int32_t y = 0;
+    for (int i = 0; i < 200; i++) y = iir.process(1000);
+    TEST_ASSERT_INT32_WITHIN(1, 1000, y);
+}
+
+// The ADC chain: median of 3, then the moving average
+void test_adc_chain_order() {
+    ADCFilterChain chain;
+    chain.setWindow(4);
+    chain.prime(1600);
+    NaiveAverage avg(4, 1600);
+    SlidingMedian<3> med;
+    med.prime(1600);
+    for (size_t i = 0; i < 20000; i++) {
+        TEST_ASSERT_EQUAL_INT32(avg.process(med.process(signal[i])), chain.process(signal[i]));
+    }
+}
+
+template<typename F>
+static double nsPerSample(F& filter) {
+    volatile int32_t sink = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int rep = 0; rep < 4; rep++) {
+        for (size_t i = 0; i < SIGNAL_LEN; i++) sink = sink + filter.process(signal[i]);
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+           (4.0 * SIGNAL_LEN);
+}
+
+// Plain-array O(window) average (what the running sum replaced)
+template<uint16_t MAX>
+class LoopAverage {
+public:
+    explicit LoopAverage(uint16_t window) : _window(window), _index(0) {
+        for (uint16_t i = 0; i < MAX; i++) _buf[i] = 0;
+    }
+    int32_t process(int32_t x) {
+        _buf[_index] = x;
+        if (++_index >= _window) _index = 0;
+        int64_t sum = 0;
+        for (uint16_t i = 0; i < _window; i++) sum += _buf[i];
+        return roundedMean(sum, _window);
+    }
+
+private:
+    int32_t _buf[MAX];
+    uint16_t _window;
+    uint16_t _index;
+};
+
+void test_cost_is_flat_in_the_window() {
+    const uint16_t windows[] = { 1, 4, 16, 64, 256, 1024 };
+    double fastNs[6], loopNs[6];
+    for (int k = 0; k < 6; k++) {
+        MovingAverage<1024>* fast = new MovingAverage<1024>();
+        fast->setWindow(windows[k]);
+        LoopAverage<1024>* loop = new LoopAverage<1024>(windows[k]);
+        fastNs[k] = nsPerSample(*fast);
+        loopNs[k] = nsPerSample(*loop);
+        delete fast;
+        delete loop;
+
+        char line[120];
+        snprintf(line, sizeof(line), "window %4u: running sum %6.2f ns/sample, loop %8.2f ns/sample",
+                 windows[k], fastNs[k], loopNs[k]);
+        TEST_MESSAGE(line);
+    }
+    ADCFilterChain chain;
+    chain.setWindow(10);
+    char line[80];
+    snprintf(line, sizeof(line), "ADC chain (median 3 + average 10): %.2f ns/sample",
+             nsPerSample(chain));
+    TEST_MESSAGE(line);
+
+    // Flat (within timer noise) while the loop grows with the window
+    TEST_ASSERT_LESS_THAN(3.0 * fastNs[0] + 2.0, fastNs[5]);
+    TEST_ASSERT_GREATER_THAN(10.0 * fastNs[5], loopNs[5]);
+}
+
+int main(int argc, char** argv) {
+    makeSignal();
+    UNITY_BEGIN();
+    RUN_TEST(test_moving_average_matches_naive);
+    RUN_TEST(test_set_window_keeps_the_mean);
+    RUN_TEST(test_median_matches_naive);
+    RUN_TEST(test_median_rejects_single_spikes);
+    RUN_TEST(test_fir_boxcar_and_custom);
+    RUN_TEST(test_iir_converges);
+    RUN_TEST(test_adc_chain_order);
+    RUN_TEST(test_cost_is_flat_in_the_window);
+    return UNITY_END();
+}
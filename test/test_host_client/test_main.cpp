@@ -0,0 +1,349 @@
+// test_host_client
+// HostClient against HostCommands and HostLink, end to end on the host
+// A device thread runs the loop() side (HostCommands::update, the ADC ring,
+// HostLink::update) on one end of an in-memory link; the test drives the
+// other end with HostClient. Covered: PING / STATUS decoding, configuration
+// (including ADC oversampling while acquisition runs), a timeline dump
+// checked record by record, the same dump and a request over a link that
+// loses bytes (go-back-N and retries), and data / log frames split back
+// into their outputs. Run under -fsanitize=thread for the device / client
+// handover.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "HostClient.h"
+#include "HostCommands.h"
+
+// One direction of the link; drops every dropEvery-th byte when set
+class Pipe {
+public:
+    void write(const uint8_t* buf, size_t len) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (size_t i = 0; i < len; i++) {
+            if (dropEvery != 0 && ++_count % dropEvery == 0) {
+                dropped++;
+                continue;
+            }
+            _bytes.push_back((char)buf[i]);
+        }
+    }
+    int read(bool take) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_pos == _bytes.size()) return -1;
+        const uint8_t b = (uint8_t)_bytes[_pos];
+        if (take && ++_pos == _bytes.size()) {
+            _bytes.clear();
+            _pos = 0;
+        }
+        return b;
+    }
+    int available() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return (int)(_bytes.size() - _pos);
+    }
+
+    std::atomic<uint32_t> dropEvery{0};
+    std::atomic<uint32_t> dropped{0};
+
+private:
+    std::mutex _mutex;
+    std::string _bytes;
+    size_t _pos = 0;
+    uint32_t _count = 0;
+};
+
+class PipeEnd : public Stream {
+public:
+    PipeEnd(Pipe& in, Pipe& out) : _in(in), _out(out) {}
+    int available() override { return _in.available(); }
+    int read() override { return _in.read(true); }
+    int peek() override { return _in.read(false); }
+    size_t write(uint8_t b) override { return write(&b, 1); }
+    size_t write(const uint8_t* buf, size_t len) override {
+        _out.write(buf, len);
+        return len;
+    }
+    using Print::write;
+    int availableForWrite() override { return 4096; }
+
+private:
+    Pipe& _in;
+    Pipe& _out;
+};
+
+// Collects what the client passes on
+class StringPrint : public Print {
+public:
+    size_t write(uint8_t c) override {
+        text += (char)c;
+        return 1;
+    }
+    using Print::write;
+    std::string text;
+};
+
+static const uint16_t TIMELINE_RECORD = 24 + 4 * SENSOR_COUNT;
+
+static Pipe toDevice;
+static Pipe toHost;
+static PipeEnd* deviceEnd;
+static PipeEnd* hostEnd;
+static HostLink* link;
+static HostCommands* commands;
+static ADCManager* adc;
+static DataLogger* logger;
+static SampleTimeline* timeline;
+static std::thread deviceThread;
+static std::atomic<bool> running(false);
+static std::atomic<uint32_t> recordsToSend(0);
+
+class ConstantSource : public ADCSampleSource {
+public:
+    uint16_t read(uint8_t channel) override { return channel == 0 ? 1000 : 3000; }
+};
+static ConstantSource source;
+
+// loop() of the device: everything on the link is touched by this thread only
+static void startDevice() {
+    running = true;
+    deviceThread = std::thread([]() {
+        link->begin(LINK_RAW);
+        link->setLogQueued(true);
+        CO2Data current;
+        memset(&current, 0, sizeof(current));
+        current.fetco2 = 38;
+        current.respiratory_rate = 12;
+        while (running) {
+            adc->poll();
+            commands->update(current);
+            while (recordsToSend > 0) {
+                link->printf("record %lu\r\n", (unsigned long)recordsToSend.load());
+                link->flush();
+                link->log().printf("# log %lu\n", (unsigned long)recordsToSend.load());
+                recordsToSend--;
+            }
+            link->update();
+            delay(1);
+        }
+        link->flushLog();
+    });
+}
+
+static void stopDevice() {
+    if (running.exchange(false)) {
+        deviceThread.join();
+    }
+}
+
+void setUp() {
+    Serial.setMuted(true);
+    toDevice.dropEvery = 0;
+    toHost.dropEvery = 0;
+    deviceEnd = new PipeEnd(toDevice, toHost);
+    hostEnd = new PipeEnd(toHost, toDevice);
+    link = new HostLink(*deviceEnd);
+    commands = new HostCommands(*link);
+    adc = new ADCManager();
+    logger = new DataLogger();
+    timeline = new SampleTimeline();
+
+    adc->setSampleSource(&source);
+    adc->begin();
+    commands->setADCManager(adc);
+    commands->setDataLogger(logger);
+    commands->setTimeline(timeline);
+
+    // 300 samples at 8 Hz with a recognizable pattern
+    CO2Data data;
+    memset(&data, 0, sizeof(data));
+    for (uint32_t i = 0; i < 300; i++) {
+        data.timestamp = 1000 + 125 * i;
+        data.timestamp_us = 5000000000ULL + 125000ULL * i;
+        data.co2_waveform = (uint16_t)(i % 50);
+        data.fetco2 = 38;
+        data.respiratory_rate = 12;
+        data.valid = true;
+        data.sensors[0].value = 20.9f - 0.01f * i;
+        timeline->push(data);
+    }
+}
+
+void tearDown() {
+    stopDevice();
+    adc->stopAcquisition();
+    delete commands;
+    delete link;
+    delete timeline;
+    delete logger;
+    delete adc;
+    delete hostEnd;
+    delete deviceEnd;
+    // Leftovers from a failed test
+    while (toDevice.read(true) >= 0) {}
+    while (toHost.read(true) >= 0) {}
+    Serial.setMuted(false);
+}
+
+void test_ping_and_status() {
+    startDevice();
+    HostClient client(*hostEnd);
+    HostDeviceInfo info;
+    TEST_ASSERT_EQUAL_UINT8(HOST_OK, client.ping(info));
+    TEST_ASSERT_EQUAL_UINT8(HOST_PROTOCOL_VERSION, info.version);
+    TEST_ASSERT_EQUAL_UINT8(HostFrame::MAX_PAYLOAD, info.maxPayload);
+    TEST_ASSERT_EQUAL_UINT8(HostCommands::CHUNK_BYTES, info.chunkBytes);
+    TEST_ASSERT_EQUAL_INT(0, strncmp(__DATE__, info.build, strlen(__DATE__)));
+
+    HostDeviceStatus status;
+    TEST_ASSERT_EQUAL_UINT8(HOST_OK, client.getStatus(status));
+    TEST_ASSERT_EQUAL_UINT32(300, status.timelineHead);
+    TEST_ASSERT_EQUAL_UINT8(38, status.fetco2);
+    TEST_ASSERT_EQUAL_UINT8(12, status.respiratoryRate);
+    TEST_ASSERT_EQUAL_UINT8(LINK_FRAMED, status.linkMode);  // The first request switched it
+    TEST_ASSERT_FALSE(status.dumping);
+    TEST_ASSERT_EQUAL_UINT8(SENSOR_COUNT, status.sensorCount);
+    TEST_ASSERT_EQUAL_UINT32(2, client.getStats().requests);
+    TEST_ASSERT_EQUAL_UINT32(0, client.getStats().retries);
+}
+
+void test_config() {
+    adc->startAcquisition(500);
+    startDevice();
+    HostClient client(*hostEnd);
+
+    TEST_ASSERT_EQUAL_UINT8(HOST_OK, client.setConfig16(HOST_CFG_OUTPUT_INTERVAL, 200));
+    uint8_t value[4];
+    size_t len = sizeof(value);
+    TEST_ASSERT_EQUAL_UINT8(HOST_OK, client.getConfig(HOST_CFG_OUTPUT_INTERVAL, value, len));
+    TEST_ASSERT_EQUAL_UINT32(2, len);
+    TEST_ASSERT_EQUAL_UINT16(200, value[0] | (value[1] << 8));
+
+    // Oversampling while the acquisition task converts: stopped, set, restarted
+    uint8_t factor[2] = {16, 0};
+    uint8_t applied[4];
+    size_t appliedLen = sizeof(applied);
+    TEST_ASSERT_EQUAL_UINT8(HOST_OK, client.setConfig(HOST_CFG_ADC_OVERSAMPLING, factor, 2,
+                                                      applied, &appliedLen));
+    TEST_ASSERT_EQUAL_UINT32(2, appliedLen);
+    TEST_ASSERT_EQUAL_UINT8(16, applied[0]);
+    delay(50);
+    HostDeviceStatus status;
+    TEST_ASSERT_EQUAL_UINT8(HOST_OK, client.getStatus(status));
+    stopDevice();
+    TEST_ASSERT_TRUE(adc->isAcquiring());
+    TEST_ASSERT_EQUAL_UINT16(500, adc->getSampleRate());
+    TEST_ASSERT_EQUAL_UINT16(16, adc->getOversampling());
+    TEST_ASSERT_GREATER_THAN_UINT32(0, status.adcSamples);
+
+    startDevice();
+    TEST_ASSERT_EQUAL_UINT8(HOST_ERR_BAD_ARGS, client.setConfig8(HOST_CFG_OUTPUT_FORMAT, 9));
+    TEST_ASSERT_EQUAL_UINT8(HOST_ERR_BAD_ARGS, client.setConfig8(0x7F, 0));
+    TEST_ASSERT_EQUAL_UINT8(HOST_ERR_BAD_ARGS, client.sensorCommand('x'));
+}
+
+// Every record of the dump matches the timeline sample
+static void checkTimelineDump(const std::string& bytes) {
+    TEST_ASSERT_EQUAL_UINT32(300 * TIMELINE_RECORD, bytes.size());
+    for (uint32_t i = 0; i < 300; i++) {
+        const uint8_t* r = (const uint8_t*)bytes.data() + i * TIMELINE_RECORD;
+        uint32_t seq, ms, usLow, usHigh;
+        float o2;
+        memcpy(&seq, r, 4);
+        memcpy(&ms, r + 4, 4);
+        memcpy(&usLow, r + 8, 4);
+        memcpy(&usHigh, r + 12, 4);
+        memcpy(&o2, r + 24, 4);
+        TEST_ASSERT_EQUAL_UINT32(i, seq);
+        TEST_ASSERT_EQUAL_UINT32(1000 + 125 * i, ms);
+        TEST_ASSERT_TRUE((((uint64_t)usHigh << 32) | usLow) == 5000000000ULL + 125000ULL * i);
+        TEST_ASSERT_EQUAL_UINT16(i % 50, r[16] | (r[17] << 8));
+        TEST_ASSERT_EQUAL_UINT8(38, r[19]);
+        TEST_ASSERT_EQUAL_UINT8(1, r[23]);
+        TEST_ASSERT_FLOAT_WITHIN(0.001f, 20.9f - 0.01f * i, o2);
+    }
+}
+
+void test_timeline_dump() {
+    startDevice();
+    HostClient client(*hostEnd);
+    StringPrint out;
+    uint32_t size = 0;
+    TEST_ASSERT_EQUAL_UINT8(HOST_OK, client.dump(HOST_DUMP_TIMELINE, out, 8, 0, &size));
+    TEST_ASSERT_EQUAL_UINT32(300 * TIMELINE_RECORD, size);
+    checkTimelineDump(out.text);
+    TEST_ASSERT_EQUAL_UINT32(0, client.getStats().dumpResends);
+
+    // The device finished the dump: a new one starts, resuming at chunk 20
+    StringPrint tail;
+    TEST_ASSERT_EQUAL_UINT8(HOST_OK, client.dump(HOST_DUMP_TIMELINE, tail, 64, 20));
+    TEST_ASSERT_TRUE(tail.text == out.text.substr(20 * HostCommands::CHUNK_BYTES));
+    TEST_ASSERT_EQUAL_UINT8(HOST_ERR_UNAVAILABLE, client.dump(HOST_DUMP_CAPTURE, tail));
+}
+
+// Lost bytes break frames in both directions: requests are retried and the
+// dump goes back to each missing chunk
+void test_lossy_link() {
+    startDevice();
+    HostClient client(*hostEnd);
+    toHost.dropEvery = 3001;
+    StringPrint out;
+    TEST_ASSERT_EQUAL_UINT8(HOST_OK, client.dump(HOST_DUMP_TIMELINE, out, 16));
+    checkTimelineDump(out.text);
+    const HostClientStats& s = client.getStats();
+    TEST_ASSERT_GREATER_THAN_UINT32(0, s.frameErrors);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, s.dumpResends);
+
+    toHost.dropEvery = 0;
+    toDevice.dropEvery = 2;         // The next request never arrives whole...
+    HostDeviceStatus status;
+    const uint32_t dropped = toDevice.dropped;
+    std::thread heal([]() {
+        delay(HostClient::RESPONSE_TIMEOUT_MS / 2);
+        toDevice.dropEvery = 0;     // ...until its retry
+    });
+    TEST_ASSERT_EQUAL_UINT8(HOST_OK, client.getStatus(status));
+    heal.join();
+    TEST_ASSERT_GREATER_THAN_UINT32(dropped, toDevice.dropped.load());
+    TEST_ASSERT_GREATER_THAN_UINT32(0, client.getStats().retries);
+
+    char line[120];
+    snprintf(line, sizeof(line), "%lu bytes lost, %lu frame errors, %lu go-back-N, %lu retries",
+             (unsigned long)(toHost.dropped + toDevice.dropped), (unsigned long)s.frameErrors,
+             (unsigned long)s.dumpResends, (unsigned long)s.retries);
+    TEST_MESSAGE(line);
+}
+
+void test_data_and_log_channels() {
+    startDevice();
+    HostClient client(*hostEnd);
+    StringPrint data;
+    StringPrint log;
+    client.setDataOutput(&data);
+    client.setLogOutput(&log);
+    HostDeviceInfo info;
+    TEST_ASSERT_EQUAL_UINT8(HOST_OK, client.ping(info));       // Framed from here
+
+    recordsToSend = 3;
+    const uint32_t start = millis();
+    while (log.text.size() < 3 * 8 && millis() - start < 1000) {
+        client.poll();
+        delay(1);
+    }
+    TEST_ASSERT_EQUAL_STRING("record 3\r\nrecord 2\r\nrecord 1\r\n", data.text.c_str());
+    TEST_ASSERT_EQUAL_STRING("# log 3\n# log 2\n# log 1\n", log.text.c_str());
+    TEST_ASSERT_EQUAL_UINT32(3, client.getStats().dataFrames);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_ping_and_status);
+    RUN_TEST(test_config);
+    RUN_TEST(test_timeline_dump);
+    RUN_TEST(test_lossy_link);
+    RUN_TEST(test_data_and_log_channels);
+    return UNITY_END();
+}
@@ -0,0 +1,244 @@
+// test_host_demux
+// HostDemux (the [env:host_demux] splitter) on streams framed by HostLink
+// The device side writes ASCII and binary records (0x00 bytes, records
+// longer than a frame) and log text, some lines longer than a frame, with
+// a response frame in between, into a capture. The capture goes through a
+// file opened with FdStream and through a pipe on FdStream::attach() in
+// uneven pieces, as the program reads a saved capture from stdin; records
+// and log text must come out into their files byte for byte, and the input
+// must end. A stream that starts in raw mode and has a damaged record frame
+// loses exactly the raw part and that record.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include "HostDemux.h"
+#include "HostLink.h"
+#include "MaCO2Pty.h"
+
+static const uint32_t RECORDS = 400;
+
+// USB side of the device's HostLink: everything written, always room
+class CaptureStream : public Stream {
+public:
+    std::string bytes;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    size_t write(uint8_t b) override {
+        bytes += (char)b;
+        return 1;
+    }
+    using Print::write;
+    int availableForWrite() override { return 4096; }
+};
+
+class StringPrint : public Print {
+public:
+    std::string text;
+    size_t write(uint8_t b) override {
+        text += (char)b;
+        return 1;
+    }
+    using Print::write;
+};
+
+// Device output and what the demux must give back
+struct Capture {
+    std::string stream;
+    std::string records;
+    std::string log;
+    size_t recordStart[RECORDS];        // Record frames' byte ranges in stream
+    size_t recordEnd[RECORDS];
+    uint32_t recordFrames;              // Data frames (long records take two)
+};
+
+static uint32_t rng = 1;
+
+static uint32_t nextRandom() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+// rawRecords: records sent in LINK_RAW before the link switches to frames
+static Capture makeCapture(uint32_t rawRecords = 0) {
+    Capture c;
+    CaptureStream usb;
+    HostLink link(usb);
+    link.begin(rawRecords > 0 ? LINK_RAW : LINK_FRAMED);
+    for (uint32_t i = 0; i < rawRecords; i++) {
+        link.printf("raw %lu\r\n", (unsigned long)i);
+        link.flush();
+    }
+    link.setMode(LINK_FRAMED);
+    c.recordFrames = 0;
+
+    rng = 99;
+    for (uint32_t i = 0; i < RECORDS; i++) {
+        c.recordStart[i] = usb.bytes.size();
+        std::string record;
+        if (i % 3 == 0) {
+            // LabVIEW-like binary record, 0x00 bytes included
+            const size_t len = (i % 30 == 0) ? HostFrame::MAX_PAYLOAD + 40 : 8 + nextRandom() % 40;
+            for (size_t k = 0; k < len; k++) record += (char)(nextRandom() % 4 == 0 ? 0 : nextRandom());
+        } else {
+            char line[40];
+            snprintf(line, sizeof(line), "%lu\t38\t12\t20.90\r\n", (unsigned long)i);
+            record = line;
+        }
+        link.write((const uint8_t*)record.data(), record.size());
+        link.flush();
+        c.records += record;
+        c.recordEnd[i] = usb.bytes.size();
+        c.recordFrames += (record.size() + HostFrame::MAX_PAYLOAD - 1) / HostFrame::MAX_PAYLOAD;
+
+        if (i % 7 == 0) {
+            std::string text = "# packet " + std::to_string(i);
+            if (i % 49 == 0) text += std::string(300, '.');         // Two log frames
+            text += "\n";
+            link.log().print(text.c_str());
+            c.log += text;
+        }
+        if (i % 50 == 25) {
+            const uint8_t response[] = { 1, 0, 0x81, 0 };           // Dropped
+            link.sendFrame(HOST_CH_CMD, response, sizeof(response));
+        }
+    }
+    c.stream = usb.bytes;
+    return c;
+}
+
+static std::string tempPath(const char* name) {
+    char path[96];
+    snprintf(path, sizeof(path), "/tmp/test_host_demux_%d_%s", (int)getpid(), name);
+    return path;
+}
+
+static bool readFile(const std::string& path, std::string& text) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (f == nullptr) return false;
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) text.append(buf, n);
+    fclose(f);
+    return true;
+}
+
+static bool writeFile(const std::string& path, const std::string& text) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (f == nullptr) return false;
+    const bool ok = fwrite(text.data(), 1, text.size(), f) == text.size();
+    return fclose(f) == 0 && ok;
+}
+
+// The program's loop; false if the input did not end
+static bool runDemux(HostDemux& demux, FdStream& in) {
+    const uint32_t start = millis();
+    while (millis() - start < 10000) {
+        if (demux.update()) continue;
+        if (in.atEnd()) return true;
+        delay(1);
+    }
+    return false;
+}
+
+void setUp() {
+    Serial.setMuted(true);
+}
+
+void tearDown() {
+    Serial.setMuted(false);
+}
+
+void test_capture_file_round_trip() {
+    const Capture c = makeCapture();
+    const std::string input = tempPath("capture.bin");
+    const std::string recordsPath = tempPath("records.bin");
+    const std::string logPath = tempPath("device.log");
+    TEST_ASSERT_TRUE(writeFile(input, c.stream));
+
+    FdStream in;
+    TEST_ASSERT_TRUE(in.open(input.c_str()));
+    FilePrint records;
+    FilePrint log;
+    TEST_ASSERT_TRUE(records.open(recordsPath.c_str()));
+    TEST_ASSERT_TRUE(log.open(logPath.c_str()));
+    HostDemux demux(in, records, log);
+    TEST_ASSERT_TRUE_MESSAGE(runDemux(demux, in), "input did not end");
+    records.close();
+    log.close();
+
+    std::string recordsOut;
+    std::string logOut;
+    TEST_ASSERT_TRUE(readFile(recordsPath, recordsOut));
+    TEST_ASSERT_TRUE(readFile(logPath, logOut));
+    TEST_ASSERT_EQUAL_UINT32(c.records.size(), recordsOut.size());
+    TEST_ASSERT_TRUE_MESSAGE(recordsOut == c.records, "records differ");
+    TEST_ASSERT_EQUAL_STRING(c.log.c_str(), logOut.c_str());
+
+    const HostDemuxStats s = demux.getStats();
+    TEST_ASSERT_EQUAL_UINT32(c.recordFrames, s.records);
+    TEST_ASSERT_EQUAL_UINT32(c.records.size(), s.recordBytes);
+    TEST_ASSERT_EQUAL_UINT32(c.log.size(), s.logBytes);
+    TEST_ASSERT_EQUAL_UINT32(0, s.frameErrors);
+    remove(input.c_str());
+    remove(recordsPath.c_str());
+    remove(logPath.c_str());
+}
+
+void test_pipe_with_raw_start_and_damage() {
+    Capture c = makeCapture(5);
+    const uint32_t damaged = 17;                // A short ASCII record
+    const size_t at = (c.recordStart[damaged] + c.recordEnd[damaged]) / 2;
+    c.stream[at] = (char)((uint8_t)c.stream[at] ^ 0x55);
+
+    int fds[2];
+    TEST_ASSERT_EQUAL_INT(0, pipe(fds));
+    FdStream in;
+    TEST_ASSERT_TRUE(in.attach(fds[0]));
+    // Writer: uneven pieces with pauses, then end of input
+    std::thread writer([&c, fds]() {
+        size_t pos = 0;
+        uint32_t seed = 5;
+        while (pos < c.stream.size()) {
+            seed = seed * 1664525u + 1013904223u;
+            size_t n = 1 + (seed >> 24) % 300;
+            if (n > c.stream.size() - pos) n = c.stream.size() - pos;
+            const ssize_t written = write(fds[1], c.stream.data() + pos, n);
+            if (written > 0) pos += written;
+            if ((seed & 0x300) == 0) delay(1);
+        }
+        close(fds[1]);
+    });
+    StringPrint records;
+    StringPrint log;
+    HostDemux demux(in, records, log);
+    const bool ended = runDemux(demux, in);
+    writer.join();
+    TEST_ASSERT_TRUE_MESSAGE(ended, "input did not end");
+
+    // The raw records and the damaged one are missing, nothing else
+    char line[40];
+    snprintf(line, sizeof(line), "%lu\t38\t12\t20.90\r\n", (unsigned long)damaged);
+    std::string expect = c.records;
+    const size_t lost = expect.find(line);
+    TEST_ASSERT_TRUE(lost != std::string::npos);
+    expect.erase(lost, strlen(line));
+    TEST_ASSERT_EQUAL_UINT32(expect.size(), records.text.size());
+    TEST_ASSERT_TRUE_MESSAGE(records.text == expect, "records differ");
+    TEST_ASSERT_EQUAL_STRING(c.log.c_str(), log.text.c_str());
+    TEST_ASSERT_EQUAL_UINT32(c.recordFrames - 1, demux.getStats().records);
+    TEST_ASSERT_EQUAL_UINT32(2, demux.getStats().frameErrors);   // Raw start, damage
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_capture_file_round_trip);
+    RUN_TEST(test_pipe_with_raw_start_and_damage);
+    return UNITY_END();
+}
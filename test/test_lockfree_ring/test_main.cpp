@@ -0,0 +1,209 @@
+// test_lockfree_ring
+// SPSCRing on the host: FIFO order, batch calls, overruns, consume()
+// Single-threaded cases pin down the index arithmetic: order across slot
+// wrap and across the 2^32 wrap of the free-running indices, batch pushes
+// and pops that only partly fit, and the overrun count. The thread pair
+// moves a counting sequence through single and batch calls and checks that
+// it arrives complete and in order. BroadcastRing is stressed by
+// test_timeline.
+//
+// -fsanitize=thread checks the acquire / release pairs of SPSCRing. GCC's
+// ThreadSanitizer does not model atomic_thread_fence (-Wtsan), so the fence
+// ordering of BroadcastRing's seqlock is only checked by a clang build.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <atomic>
+#include <thread>
+#include "LockFreeRing.h"
+
+static const uint32_t THREAD_ITEMS = 1000000;
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+// Push and pop in uneven steps so the slots wrap many times
+static void checkFifo(SPSCRing<uint32_t, 16>& ring, uint32_t items) {
+    const uint32_t overruns = ring.overruns();
+    uint32_t rejected = 0;
+    uint32_t next = 0;
+    uint32_t expect = 0;
+    uint32_t step = 0;
+    while (expect < items) {
+        for (uint32_t i = 0; i < 1 + step % 7 && next < items; i++) {
+            if (ring.push(next)) next++;
+            else rejected++;
+        }
+        for (uint32_t i = 0; i < 1 + step % 5; i++) {
+            uint32_t v;
+            if (!ring.pop(v)) break;
+            TEST_ASSERT_EQUAL_UINT32(expect, v);
+            expect++;
+        }
+        step++;
+    }
+    TEST_ASSERT_TRUE(ring.empty());
+    TEST_ASSERT_GREATER_THAN(0, rejected);              // The ring did fill up
+    TEST_ASSERT_EQUAL_UINT32(overruns + rejected, ring.overruns());
+}
+
+void test_fifo_across_wrap() {
+    static SPSCRing<uint32_t, 16> ring;
+    checkFifo(ring, 1000);
+
+    // Free-running indices cross 2^32 halfway
+    ring.reset(0xFFFFFFFFu - 500);
+    checkFifo(ring, 1000);
+}
+
+void test_full_ring_counts_overruns() {
+    static SPSCRing<uint32_t, 8> ring;
+    ring.reset(0xFFFFFFFCu);                // Full exactly at the index wrap
+    for (uint32_t i = 0; i < 8; i++) {
+        TEST_ASSERT_TRUE(ring.push(i));
+    }
+    TEST_ASSERT_EQUAL_UINT32(8, ring.size());
+    TEST_ASSERT_FALSE(ring.push(100));
+    TEST_ASSERT_FALSE(ring.push(101));
+    TEST_ASSERT_EQUAL_UINT32(2, ring.overruns());
+
+    uint32_t v;
+    TEST_ASSERT_TRUE(ring.pop(v));
+    TEST_ASSERT_EQUAL_UINT32(0, v);
+    TEST_ASSERT_TRUE(ring.push(8));         // Room again after a pop
+    for (uint32_t i = 1; i <= 8; i++) {
+        TEST_ASSERT_TRUE(ring.pop(v));
+        TEST_ASSERT_EQUAL_UINT32(i, v);
+    }
+    TEST_ASSERT_FALSE(ring.pop(v));
+    TEST_ASSERT_EQUAL_UINT32(2, ring.overruns());
+
+    ring.reset();
+    TEST_ASSERT_EQUAL_UINT32(0, ring.overruns());
+    TEST_ASSERT_TRUE(ring.empty());
+}
+
+void test_batch_partial() {
+    static SPSCRing<uint32_t, 16> ring;
+    ring.reset(0xFFFFFFF8u);
+    uint32_t items[32];
+    for (uint32_t i = 0; i < 32; i++) items[i] = i;
+
+    // 10 fit, then 6 of 10 (4 overruns)
+    TEST_ASSERT_EQUAL_UINT32(10, ring.push(items, 10));
+    TEST_ASSERT_EQUAL_UINT32(6, ring.push(items + 10, 10));
+    TEST_ASSERT_EQUAL_UINT32(4, ring.overruns());
+    TEST_ASSERT_EQUAL_UINT32(0, ring.push(items, 3));
+    TEST_ASSERT_EQUAL_UINT32(7, ring.overruns());
+
+    uint32_t out[32];
+    TEST_ASSERT_EQUAL_UINT32(5, ring.pop(out, 5));
+    TEST_ASSERT_EQUAL_UINT32(11, ring.pop(out + 5, 32));       // Only 11 left
+    for (uint32_t i = 0; i < 16; i++) {
+        TEST_ASSERT_EQUAL_UINT32(i, out[i]);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, ring.pop(out, 32));
+
+    // A batch that straddles the end of the buffer
+    TEST_ASSERT_EQUAL_UINT32(3, ring.push(items, 3));
+    TEST_ASSERT_EQUAL_UINT32(3, ring.pop(out, 3));
+    TEST_ASSERT_EQUAL_UINT32(16, ring.push(items + 16, 16));
+    TEST_ASSERT_EQUAL_UINT32(16, ring.pop(out, 16));
+    for (uint32_t i = 0; i < 16; i++) {
+        TEST_ASSERT_EQUAL_UINT32(16 + i, out[i]);
+    }
+}
+
+void test_consume() {
+    static SPSCRing<uint32_t, 16> ring;
+    ring.reset(0xFFFFFFFAu);
+    for (uint32_t round = 0; round < 5; round++) {
+        for (uint32_t i = 0; i < 11; i++) {
+            TEST_ASSERT_TRUE(ring.push(round * 100 + i));
+        }
+        uint32_t expect = round * 100;
+        const uint32_t n = ring.consume([&](const uint32_t& v) {
+            TEST_ASSERT_EQUAL_UINT32(expect, v);
+            expect++;
+        });
+        TEST_ASSERT_EQUAL_UINT32(11, n);
+        TEST_ASSERT_TRUE(ring.empty());
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, ring.consume([](const uint32_t&) {}));
+}
+
+// Producer alternates single and batch pushes, consumer single pops,
+// batch pops and consume(); every value arrives once, in order
+void test_thread_pair() {
+    static SPSCRing<uint32_t, 64> ring;
+    ring.reset();
+    std::thread producer([]() {
+        uint32_t next = 0;
+        uint32_t batch[13];
+        while (next < THREAD_ITEMS) {
+            if (next % 3 == 0) {
+                if (ring.push(next)) next++;
+                else std::this_thread::yield();
+            } else {
+                uint32_t n = THREAD_ITEMS - next < 13 ? THREAD_ITEMS - next : 13;
+                for (uint32_t i = 0; i < n; i++) batch[i] = next + i;
+                const uint32_t pushed = ring.push(batch, n);
+                if (pushed == 0) std::this_thread::yield();
+                next += pushed;
+            }
+        }
+    });
+
+    uint32_t expect = 0;
+    bool inOrder = true;
+    uint32_t out[9];
+    uint32_t mode = 0;
+    while (expect < THREAD_ITEMS) {
+        if (ring.empty()) std::this_thread::yield();    // Also on one core
+        switch (mode++ % 3) {
+            case 0: {
+                uint32_t v;
+                if (ring.pop(v)) {
+                    inOrder &= (v == expect);
+                    expect++;
+                }
+                break;
+            }
+            case 1: {
+                const uint32_t n = ring.pop(out, 9);
+                for (uint32_t i = 0; i < n; i++) {
+                    inOrder &= (out[i] == expect);
+                    expect++;
+                }
+                break;
+            }
+            default:
+                ring.consume([&](const uint32_t& v) {
+                    inOrder &= (v == expect);
+                    expect++;
+                });
+                break;
+        }
+    }
+    producer.join();
+    TEST_ASSERT_TRUE(inOrder);
+    TEST_ASSERT_TRUE(ring.empty());
+
+    char line[80];
+    snprintf(line, sizeof(line), "%lu items, %lu rejected pushes (full ring)",
+             (unsigned long)THREAD_ITEMS, (unsigned long)ring.overruns());
+    TEST_MESSAGE(line);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_fifo_across_wrap);
+    RUN_TEST(test_full_ring_counts_overruns);
+    RUN_TEST(test_batch_partial);
+    RUN_TEST(test_consume);
+    RUN_TEST(test_thread_pair);
+    return UNITY_END();
+}
@@ -0,0 +1,232 @@
+// test_metabolic
+// MetabolicCalc scenarios with known gas exchange
+// Breaths are built from a target VO2 / VCO2: with the inspired volume
+// VI = VE + VO2 - VCO2 (nitrogen balance) the expired fractions follow
+// exactly, so the Haldane transform must give the targets back. Rest,
+// exercise ramp, hyperoxia, irregular and fast breathing cover the rolling
+// windows; a last scenario runs the waveforms through VolumetricCapno.
+
+#include <Arduino.h>
+#include <unity.h>
+#include "MetabolicCalc.h"
+#include "VolumetricCapno.h"
+
+static const float FIO2_AIR = 0.2093f;
+static const float FICO2_AIR = 0.0004f;
+
+// One breath exchanging vo2 / vco2 mL with expired volume ve mL
+static VolumetricBreath makeBreath(float ve, float vo2, float vco2, float period_ms,
+                                   uint32_t end_ms, float fio2 = FIO2_AIR,
+                                   float fico2 = FICO2_AIR) {
+    VolumetricBreath b;
+    memset(&b, 0, sizeof(b));
+    const float vi = ve + vo2 - vco2;
+    b.vte_ml = ve;
+    b.vti_ml = vi;
+    b.fi_o2 = fio2;
+    b.fi_co2 = fico2;
+    b.fe_o2 = (vi * fio2 - vo2) / ve;
+    b.fe_co2 = (vco2 + vi * fico2) / ve;
+    b.vco2_ml = b.fe_co2 * ve;
+    b.period_ms = period_ms;
+    b.end_time = end_ms;
+    return b;
+}
+
+static float weir(float vo2, float vco2) {
+    return (3.941f * vo2 + 1.106f * vco2) / 1000.0f * 1440.0f;
+}
+
+static void report(const char* name, const MetabolicResult& r) {
+    char line[160];
+    snprintf(line, sizeof(line), "%-10s VO2 %.1f  VCO2 %.1f mL/min  RQ %.3f  VE %.2f L/min  EE %.0f kcal/day  (%u breaths)",
+             name, r.vo2_ml_min, r.vco2_ml_min, r.rq, r.ve_l_min, r.ee_kcal_day, r.breaths);
+    TEST_MESSAGE(line);
+}
+
+static MetabolicCalc* calc;
+
+void setUp() { calc = new MetabolicCalc(); }
+void tearDown() { delete calc; }
+
+// Steady breathing at rr breaths/min for seconds
+static void breathe(float rr, float ve_l_min, float vo2_ml_min, float vco2_ml_min, uint32_t& t,
+                    uint32_t seconds, float fio2 = FIO2_AIR) {
+    const float period = 60000.0f / rr;
+    const float n = rr;                             // Breaths per minute
+    for (float elapsed = 0; elapsed < seconds * 1000.0f; elapsed += period) {
+        t += (uint32_t)period;
+        TEST_ASSERT_TRUE(calc->addBreath(makeBreath(ve_l_min * 1000.0f / n, vo2_ml_min / n,
+                                                    vco2_ml_min / n, period, t, fio2)));
+    }
+}
+
+void test_rest() {
+    uint32_t t = 0;
+    breathe(12, 6.0f, 250, 200, t, 90);
+    report("rest", calc->get60s());
+    const MetabolicResult& r = calc->get60s();
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 250.0f, r.vo2_ml_min);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 200.0f, r.vco2_ml_min);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, 0.8f, r.rq);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 6.0f, r.ve_l_min);
+    TEST_ASSERT_FLOAT_WITHIN(5.0f, weir(250, 200), r.ee_kcal_day);
+    TEST_ASSERT_EQUAL_UINT8(12, r.breaths);
+    TEST_ASSERT_EQUAL_UINT8(6, calc->get30s().breaths);
+}
+
+// Step from rest to exercise: the 30 s window settles first, both exactly
+void test_exercise_step() {
+    uint32_t t = 0;
+    breathe(12, 6.0f, 250, 200, t, 60);
+    breathe(30, 60.0f, 2500, 2750, t, 30);
+    report("step 30s", calc->get30s());
+    report("step 60s", calc->get60s());
+    TEST_ASSERT_FLOAT_WITHIN(10.0f, 2500.0f, calc->get30s().vo2_ml_min);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 1.1f, calc->get30s().rq);
+    // Half rest, half exercise
+    TEST_ASSERT_FLOAT_WITHIN(30.0f, (250.0f + 2500.0f) / 2, calc->get60s().vo2_ml_min);
+
+    breathe(30, 60.0f, 2500, 2750, t, 30);
+    TEST_ASSERT_FLOAT_WITHIN(10.0f, 2500.0f, calc->get60s().vo2_ml_min);
+}
+
+// Incremental ramp: the windows lag by half their length
+void test_exercise_ramp() {
+    uint32_t t = 0;
+    float vo2 = 300.0f;
+    for (int minute = 0; minute < 10; minute++) {
+        for (int b = 0; b < 20; b++) {
+            vo2 += 10.0f;                           // +200 mL/min per minute
+            t += 3000;
+            calc->addBreath(makeBreath(1000.0f + vo2, vo2 / 20, 0.9f * vo2 / 20, 3000, t));
+        }
+    }
+    report("ramp 30s", calc->get30s());
+    report("ramp 60s", calc->get60s());
+    TEST_ASSERT_FLOAT_WITHIN(15.0f, vo2 - 50.0f, calc->get30s().vo2_ml_min);
+    TEST_ASSERT_FLOAT_WITHIN(15.0f, vo2 - 100.0f, calc->get60s().vo2_ml_min);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.9f, calc->get60s().rq);
+}
+
+// High FiO2 is where the Haldane transform amplifies fraction errors
+void test_hyperoxia() {
+    uint32_t t = 0;
+    breathe(15, 7.5f, 280, 230, t, 60, 0.60f);
+    report("FiO2 60%", calc->get60s());
+    TEST_ASSERT_FLOAT_WITHIN(2.0f, 280.0f, calc->get60s().vo2_ml_min);
+    TEST_ASSERT_FLOAT_WITHIN(2.0f, 230.0f, calc->get60s().vco2_ml_min);
+}
+
+void test_rejects_unusable_breaths() {
+    VolumetricBreath b = makeBreath(500, 20, 16, 5000, 5000, 0.99f, 0.0f);
+    TEST_ASSERT_FALSE(calc->addBreath(b));          // FiO2 + FiCO2 >= 98 %
+    b = makeBreath(500, 20, 16, 0, 5000);
+    TEST_ASSERT_FALSE(calc->addBreath(b));          // First breath (no period)
+    b = makeBreath(500, 20, 16, 5000, 5000);
+    b.vte_ml = 0.0f;
+    TEST_ASSERT_FALSE(calc->addBreath(b));
+    TEST_ASSERT_EQUAL_UINT8(0, calc->get60s().breaths);
+}
+
+// Rates come from the time the breaths cover, not from the breath count
+void test_irregular_breathing() {
+    const float periods[] = { 2500, 7000, 4000, 3000, 9000, 3500 };
+    uint32_t t = 0;
+    for (int i = 0; i < 12; i++) {
+        const float p = periods[i % 6];
+        const float vo2 = 250.0f * p / 60000.0f;    // Constant 250 mL/min
+        t += (uint32_t)p;
+        calc->addBreath(makeBreath(300 + p / 20, vo2, 0.85f * vo2, p, t));
+    }
+    report("irregular", calc->get60s());
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 250.0f, calc->get60s().vo2_ml_min);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, 0.85f, calc->get60s().rq);
+}
+
+// 60 breaths/min still fits the 1 min window
+void test_fast_breathing_fills_window() {
+    uint32_t t = 0;
+    breathe(60, 12.0f, 400, 360, t, 120);
+    TEST_ASSERT_EQUAL_UINT8(60, calc->get60s().breaths);
+    TEST_ASSERT_FLOAT_WITHIN(2.0f, 400.0f, calc->get60s().vo2_ml_min);
+}
+
+// Waveforms through VolumetricCapno (100 Hz volume, 8 Hz CO2, O2 on the
+// same sampling line), scored against the Haldane result of the exact
+// expired fractions
+void test_end_to_end_through_volumetric_capno() {
+    const float period = 5000, ti = 2000, vt = 500, vd = 150, delay = 600;
+    const float rqAirway = 0.8f;                    // O2 drop = CO2 rise / RQ
+    auto volumeAt = [&](float t_ms) {
+        const float u = fmodf(t_ms, period);
+        return u < ti ? vt * 0.5f * (1 + cosf(3.14159265f * u / ti))
+                      : vt * 0.5f * (1 - cosf(3.14159265f * (u - ti) / (period - ti)));
+    };
+    auto fco2At = [&](float t_ms) {                 // Airway CO2 fraction
+        const float u = fmodf(t_ms, period);
+        if (u < ti) return FICO2_AIR;
+        const float x = (volumeAt(t_ms) - (vd - 30)) / 60;
+        const float rise = x <= 0 ? 0 : (x >= 1 ? 1 : x * x * (3 - 2 * x));
+        return FICO2_AIR + rise * 0.05f;
+    };
+    auto fo2At = [&](float t_ms) {
+        return FIO2_AIR - (fco2At(t_ms) - FICO2_AIR) / rqAirway;
+    };
+
+    // Exact mixed expired fractions of one breath
+    float ve = 0, sumCO2 = 0, sumO2 = 0;
+    for (float u = ti; u < period; u += 0.1f) {
+        const float dv = volumeAt(u + 0.1f) - volumeAt(u);
+        ve += dv;
+        sumCO2 += fco2At(u + 0.05f) * dv;
+        sumO2 += fo2At(u + 0.05f) * dv;
+    }
+    const VolumetricBreath truth = makeBreath(ve, 0, 0, period, 0);
+    MetabolicCalc exact;
+    VolumetricBreath e = truth;
+    e.fe_co2 = sumCO2 / ve;
+    e.fe_o2 = sumO2 / ve;
+    e.fi_o2 = FIO2_AIR;
+    e.fi_co2 = FICO2_AIR;
+    for (int i = 1; i <= 12; i++) {
+        e.end_time = i * 5000;
+        exact.addBreath(e);
+    }
+
+    VolumetricCapno capno;
+    capno.setBarometricPressure(760.0f);
+    uint64_t nextPacket = 0;
+    for (uint64_t t = 0; t < 240000000ULL; t += 10000) {
+        const float t_ms = t / 1000.0f;
+        bool done = capno.addVolume(volumeAt(t_ms), (uint32_t)t);
+        if (t >= nextPacket) {
+            done |= capno.addCO2(fco2At(t_ms - delay) * 760.0f, fo2At(t_ms - delay) * 100.0f, t);
+            nextPacket += 125000;
+        }
+        if (done) {
+            calc->addBreath(capno.getLastBreath());
+        }
+    }
+    report("exact", exact.get60s());
+    report("pipeline", calc->get60s());
+    const MetabolicResult& r = calc->get60s();
+    TEST_ASSERT_FLOAT_WITHIN(0.05f * exact.get60s().vco2_ml_min, exact.get60s().vco2_ml_min,
+                             r.vco2_ml_min);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f * exact.get60s().vo2_ml_min, exact.get60s().vo2_ml_min,
+                             r.vo2_ml_min);
+    TEST_ASSERT_FLOAT_WITHIN(0.03f, exact.get60s().rq, r.rq);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_rest);
+    RUN_TEST(test_exercise_step);
+    RUN_TEST(test_exercise_ramp);
+    RUN_TEST(test_hyperoxia);
+    RUN_TEST(test_rejects_unusable_breaths);
+    RUN_TEST(test_irregular_breathing);
+    RUN_TEST(test_fast_breathing_fills_window);
+    RUN_TEST(test_end_to_end_through_volumetric_capno);
+    return UNITY_END();
+}
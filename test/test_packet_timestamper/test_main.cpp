@@ -0,0 +1,228 @@
+// test_packet_timestamper
+// PacketTimestamper against a simulated sensor, UART and polling loop
+// The sensor sends 8-byte packets at 9600 baud every 125 ms of its own
+// clock (which may run fast or slow). The loop wakes every 100-130 ms,
+// parses every complete packet and passes micros() and the bytes already
+// queued behind it, as MaCO2Parser does. Reconstructed times are compared
+// with the true arrival of each packet's last byte: after the fit settles
+// the error and the interval jitter must stay within bounds, and times must
+// increase strictly. Cases: plain jitter, sensor clock offsets, the 32-bit
+// micros() wrap, dropped packets and a sensor pause (one relock).
+
+#include <Arduino.h>
+#include <unity.h>
+#include <math.h>
+#include <vector>
+#include "PacketTimestamper.h"
+
+static const int64_t PERIOD_US = 125000;
+static const double BYTE_US = 10.0 * 1000000.0 / 9600;
+static const uint32_t PACKET_BYTES = 8;
+static const uint32_t SETTLE = 200;                 // Packets before errors are checked (25 s)
+
+// Error bounds once settled (us). Raw arrivals are up to a poll (130 ms)
+// late; the reconstruction has to stay within an eighth of a period of the
+// truth, and on average within 1 ms.
+static const double MAX_ERROR_US = PERIOD_US / 8;               // Reconstructed - true arrival
+static const double MAX_MEAN_ERROR_US = 1000;
+static const double MAX_INTERVAL_ERROR_US = PERIOD_US / 10;     // Interval - true interval
+static const float MAX_PERIOD_ERROR_US = 50;                    // Tracked period (0.04 %)
+
+struct Trace {
+    std::vector<int64_t> end;       // True arrival of each packet's last byte (us)
+    std::vector<bool> dropped;      // Arrives, but the parser discards it
+};
+
+struct Result {
+    uint32_t stamped;
+    double maxError;                // After SETTLE, per segment
+    double maxIntervalError;
+    double meanError;
+    bool increasing;
+    TimestampStats stats;
+};
+
+static uint32_t rng = 1;
+
+static uint32_t nextRandom() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+// count packets from start_us; ppm: sensor clock error; pause_us inserted
+// before packet pauseAt (0: none); every dropEvery-th packet dropped
+static Trace makeTrace(int64_t start_us, uint32_t count, double ppm,
+                       uint32_t dropEvery = 0, uint32_t pauseAt = 0, int64_t pause_us = 0) {
+    Trace t;
+    const double period = PERIOD_US * (1.0 + ppm * 1e-6);
+    double at = (double)start_us;
+    for (uint32_t k = 0; k < count; k++) {
+        if (pauseAt != 0 && k == pauseAt) at += pause_us;
+        t.end.push_back((int64_t)llround(at));
+        t.dropped.push_back(dropEvery != 0 && k % dropEvery == dropEvery - 1);
+        at += period;
+    }
+    return t;
+}
+
+// Bytes received in (end[k], now]: whole later packets and the partial one
+static uint32_t queuedBehind(const Trace& t, size_t k, int64_t now) {
+    uint32_t queued = 0;
+    for (size_t m = k + 1; m < t.end.size(); m++) {
+        for (uint32_t b = 0; b < PACKET_BYTES; b++) {
+            if (t.end[m] - (int64_t)((PACKET_BYTES - 1 - b) * BYTE_US) <= now) queued++;
+        }
+        if (t.end[m] - (int64_t)((PACKET_BYTES - 1) * BYTE_US) > now) break;
+    }
+    return queued;
+}
+
+// Poll every 100-130 ms; segmentStart: index from which errors count again
+// (after a pause the fit has to settle anew)
+static Result run(PacketTimestamper& ts, const Trace& t, size_t segmentStart = 0) {
+    Result r;
+    memset(&r, 0, sizeof(r));
+    r.increasing = true;
+    int64_t poll = t.end[0] - 50000;
+    size_t next = 0;
+    size_t previous = 0;
+    int64_t lastOut = 0;
+    double errorSum = 0;
+    uint32_t errorCount = 0;
+    uint32_t periods = 0;
+    while (next < t.end.size()) {
+        poll += 100000 + nextRandom() % 30001;
+        int64_t now = poll;
+        while (next < t.end.size() && t.end[next] <= poll) {
+            periods++;
+            if (t.dropped[next]) {
+                next++;
+                continue;
+            }
+            now += 40 + nextRandom() % 40;          // Parse time of a packet
+            const uint32_t queued = queuedBehind(t, next, now);
+            const int64_t arrival = ts.estimateArrival((uint32_t)now, queued);
+            const int64_t out = ts.addPacket(arrival, periods);
+            if (r.stamped > 0 && out <= lastOut) r.increasing = false;
+
+            const size_t settled = (next >= segmentStart) ? next - segmentStart : next;
+            if (settled >= SETTLE) {
+                const double error = (double)(out - t.end[next]);
+                const double interval = (double)((out - lastOut) - (t.end[next] - t.end[previous]));
+                errorSum += error;
+                errorCount++;
+                if (fabs(error) > r.maxError) r.maxError = fabs(error);
+                if (fabs(interval) > r.maxIntervalError) r.maxIntervalError = fabs(interval);
+            }
+            lastOut = out;
+            previous = next;
+            periods = 0;
+            r.stamped++;
+            next++;
+        }
+    }
+    r.meanError = errorCount > 0 ? errorSum / errorCount : 0;
+    r.stats = ts.getStats();
+    return r;
+}
+
+static void report(const char* name, const Result& r) {
+    char line[160];
+    snprintf(line, sizeof(line),
+             "%s: max error %.0f us (mean %.0f), interval %.0f us, residual %.0f us, period %.1f us",
+             name, r.maxError, r.meanError, r.maxIntervalError, r.stats.residual_us, r.stats.period_us);
+    TEST_MESSAGE(line);
+}
+
+static void checkSettled(const Result& r) {
+    TEST_ASSERT_TRUE(r.increasing);
+    TEST_ASSERT_LESS_THAN(MAX_ERROR_US, r.maxError);
+    TEST_ASSERT_LESS_THAN(MAX_MEAN_ERROR_US, fabs(r.meanError));
+    TEST_ASSERT_LESS_THAN(MAX_INTERVAL_ERROR_US, r.maxIntervalError);
+    TEST_ASSERT_EQUAL_UINT32(r.stamped, r.stats.packets);
+}
+
+void setUp() {
+    Serial.setMuted(true);
+    rng = 12345;
+}
+
+void tearDown() {
+    Serial.setMuted(false);
+}
+
+void test_jittered_polling() {
+    PacketTimestamper ts;
+    const Result r = run(ts, makeTrace(1000000, 1600, 0));
+    report("8 Hz, polls 100-130 ms", r);
+    checkSettled(r);
+    TEST_ASSERT_EQUAL_UINT32(0, r.stats.missed);
+    TEST_ASSERT_EQUAL_UINT32(0, r.stats.relocks);
+    TEST_ASSERT_FLOAT_WITHIN(MAX_PERIOD_ERROR_US, 125000.0f, r.stats.period_us);
+    // Raw arrivals are up to a poll late; the envelope removes that
+    TEST_ASSERT_GREATER_THAN(10 * r.stats.jitter_us, r.stats.raw_jitter_us);
+}
+
+void test_sensor_clock_offsets() {
+    const double ppm[] = { -15000, -1000, 1000, 15000 };
+    for (double p : ppm) {
+        PacketTimestamper ts;
+        const Result r = run(ts, makeTrace(1000000, 1600, p));
+        char name[32];
+        snprintf(name, sizeof(name), "%+.0f ppm", p);
+        report(name, r);
+        checkSettled(r);
+        TEST_ASSERT_EQUAL_UINT32(0, r.stats.relocks);
+        TEST_ASSERT_FLOAT_WITHIN(MAX_PERIOD_ERROR_US, (float)(PERIOD_US * (1.0 + p * 1e-6)), r.stats.period_us);
+    }
+}
+
+void test_micros_wrap() {
+    // micros() wraps 100 s into the trace; times carry on in 64 bits
+    PacketTimestamper ts;
+    const int64_t start = (int64_t)0xFFFFFFFFLL - 100000000LL;
+    const Trace t = makeTrace(start, 1600, 300);
+    const Result r = run(ts, t);
+    report("micros() wrap", r);
+    checkSettled(r);
+    TEST_ASSERT_EQUAL_UINT32(0, r.stats.relocks);
+    TEST_ASSERT_TRUE(t.end.back() > (int64_t)0xFFFFFFFFLL);
+}
+
+void test_dropped_packets() {
+    // Every 7th packet fails its checksum; the parser counts its bytes as
+    // one more period
+    PacketTimestamper ts;
+    const Trace t = makeTrace(1000000, 1600, 0, 7);
+    const Result r = run(ts, t);
+    report("every 7th packet dropped", r);
+    checkSettled(r);
+    TEST_ASSERT_EQUAL_UINT32(1600 / 7, r.stats.missed);
+    TEST_ASSERT_EQUAL_UINT32(0, r.stats.relocks);
+    TEST_ASSERT_EQUAL_UINT32(1600 - 1600 / 7, r.stats.packets);
+}
+
+void test_relock_after_pause() {
+    // The sensor stops for 3.3 s and comes back at another phase
+    PacketTimestamper ts;
+    const uint32_t pauseAt = 800;
+    const Trace t = makeTrace(1000000, 1600, 500, 0, pauseAt, 3300000);
+    const Result r = run(ts, t, pauseAt);
+    report("pause 3.3 s", r);
+    checkSettled(r);
+    TEST_ASSERT_EQUAL_UINT32(1, r.stats.relocks);
+    TEST_ASSERT_EQUAL_UINT32(0, r.stats.missed);
+    TEST_ASSERT_EQUAL_UINT32(1600, r.stats.packets);    // Relock packet counted once
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_jittered_polling);
+    RUN_TEST(test_sensor_clock_offsets);
+    RUN_TEST(test_micros_wrap);
+    RUN_TEST(test_dropped_packets);
+    RUN_TEST(test_relock_after_pause);
+    return UNITY_END();
+}
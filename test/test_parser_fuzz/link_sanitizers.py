@@ -0,0 +1,4 @@
+# [env:fuzz_parser]: link the sanitizer runtimes (build_flags may only
+# reach the compiler)
+Import("env")
+env.Append(LINKFLAGS=["-fsanitize=address,undefined"])
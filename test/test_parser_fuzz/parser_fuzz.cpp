@@ -0,0 +1,246 @@
+// parser_fuzz.cpp
+// Implementation of the MaCO2Parser fuzz harness (see parser_fuzz.h)
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "MaCO2Parser.h"
+#include "parser_fuzz.h"
+
+// The stream built from one input, handed to the parser a poll at a time
+class FuzzStream : public Stream {
+public:
+    FuzzStream() : _len(0), _pos(0), _end(0) {}
+
+    void append(const uint8_t* data, size_t len) {
+        memcpy(_data + _len, data, len);
+        _len += len;
+    }
+    // Make up to n more bytes available; returns how many
+    size_t nextPoll(size_t n) {
+        if (n > _len - _end) n = _len - _end;
+        _end += n;
+        return n;
+    }
+    bool finished() const { return _end == _len; }
+    const uint8_t* bytes() const { return _data; }
+
+    int available() override { return (int)(_end - _pos); }
+    int read() override { return _pos < _end ? _data[_pos++] : -1; }
+    int peek() override { return _pos < _end ? _data[_pos] : -1; }
+    size_t write(uint8_t) override { return 1; }
+    using Print::write;
+
+private:
+    uint8_t _data[FUZZ_MAX_INPUT + FUZZ_CLEAN_PACKETS * 8];
+    size_t _len;
+    size_t _pos;
+    size_t _end;
+};
+
+static void fail(const char* invariant, size_t size) {
+    fprintf(stderr, "parser_fuzz: %s (input of %lu bytes)\n", invariant, (unsigned long)size);
+    abort();
+}
+
+void fuzzBuildPacket(uint8_t* out, uint8_t rr, uint8_t wave, uint8_t fetco2) {
+    out[0] = 0x06;
+    out[1] = 0x00;
+    out[2] = rr;
+    out[3] = 1;
+    out[4] = wave;
+    out[5] = fetco2;
+    out[6] = 0;
+    uint8_t sum = 0;
+    for (uint8_t i = 0; i < 7; i++) {
+        sum += out[i];
+    }
+    out[7] = sum;
+}
+
+// The parser's acceptance test (checksum, header, RR and CO2 ranges)
+static bool plausible(const uint8_t* p) {
+    uint8_t sum = 0;
+    for (uint8_t i = 0; i < 7; i++) {
+        sum += p[i];
+    }
+    return sum == p[7] && p[0] == 0x06 && p[2] <= 60 && p[4] <= 50 && p[5] <= 120;
+}
+
+// Reference framing: every 0x06 is tried as a header, in order, and an
+// accepted packet is skipped whole; returns the packet offsets
+static uint32_t referenceScan(const uint8_t* bytes, size_t len, uint16_t* offsets) {
+    uint32_t n = 0;
+    size_t i = 0;
+    while (i + 8 <= len) {
+        if (bytes[i] == 0x06 && plausible(bytes + i)) {
+            offsets[n++] = (uint16_t)i;
+            i += 8;
+        } else {
+            i++;
+        }
+    }
+    return n;
+}
+
+// Clean packet k: RR 12, waveform 3k (k = 2 puts a false 0x06 inside)
+static void cleanPacket(uint8_t k, uint8_t* out) {
+    fuzzBuildPacket(out, 12, k * 3, 38);
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    if (size < 4 || size > FUZZ_MAX_INPUT) {
+        return 0;
+    }
+    static bool muted = false;
+    if (!muted) {
+        Serial.setMuted(true);      // Parser log lines
+        muted = true;
+    }
+
+    // Input: 4 poll sizes (cycled), then the bytes ahead of the clean packets
+    uint8_t polls[4];
+    for (uint8_t i = 0; i < 4; i++) {
+        polls[i] = 1 + data[i] % 48;
+    }
+    FuzzStream stream;
+    stream.append(data + 4, size - 4);
+    for (uint8_t k = 0; k < FUZZ_CLEAN_PACKETS; k++) {
+        uint8_t packet[8];
+        cleanPacket(k, packet);
+        stream.append(packet, sizeof(packet));
+    }
+    const size_t total = size - 4 + FUZZ_CLEAN_PACKETS * 8;
+    uint16_t expected[(FUZZ_MAX_INPUT + FUZZ_CLEAN_PACKETS * 8) / 8];
+    const uint32_t expectedCount = referenceScan(stream.bytes(), total, expected);
+
+    VirtualClock clock;
+    MaCO2Parser parser;
+    parser.setClock(&clock);
+    CO2Data out;
+    memset(&out, 0, sizeof(out));
+
+    // Last decoded packets (a clean tail is checked at the end)
+    uint8_t tailWave[FUZZ_CLEAN_PACKETS];
+    uint8_t tailRR[FUZZ_CLEAN_PACKETS];
+    uint32_t decoded = 0;
+    for (uint32_t p = 0; !stream.finished(); p++) {
+        clock.advance(125000);      // < 2 s: no partial-packet timeouts
+        const size_t bytes = stream.nextPoll(polls[p % 4]);
+        uint32_t calls = 0;
+        for (;;) {
+            calls++;
+            if (calls > (bytes + 7) / 8 + 1) {     // Up to 7 bytes held from earlier polls
+                fail("more parsePacket calls than packets in the poll", size);
+            }
+            if (!parser.parsePacket(stream, out)) {
+                break;
+            }
+            if (decoded >= expectedCount) {
+                fail("packet the reference scan does not find", size);
+            }
+            const uint8_t* ref = stream.bytes() + expected[decoded];
+            if (out.status2 != ref[1] || out.respiratory_rate != ref[2] || out.fco2 != ref[3] ||
+                out.co2_waveform != ref[4]) {
+                fail("packet differs from the reference scan (lost or out of order)", size);
+            }
+            tailWave[decoded % FUZZ_CLEAN_PACKETS] = (uint8_t)out.co2_waveform;
+            tailRR[decoded % FUZZ_CLEAN_PACKETS] = out.respiratory_rate;
+            decoded++;
+        }
+        if (stream.available() != 0) {
+            fail("bytes left unread after draining a poll", size);
+        }
+    }
+
+    if (decoded != expectedCount) {
+        fail("packets the reference scan finds were not decoded", size);
+    }
+    if (parser.getPacketCount() != decoded) {
+        fail("packet count", size);
+    }
+    if (decoded < FUZZ_CLEAN_PACKETS - 2) {
+        fail("clean packets lost after the first two", size);
+    }
+    // Clean packets 2..15 are the last ones decoded, in order
+    for (uint8_t k = 2; k < FUZZ_CLEAN_PACKETS; k++) {
+        const uint32_t i = decoded - FUZZ_CLEAN_PACKETS + k;
+        if (tailWave[i % FUZZ_CLEAN_PACKETS] != k * 3 || tailRR[i % FUZZ_CLEAN_PACKETS] != 12) {
+            fail("clean packet lost or out of order", size);
+        }
+    }
+    return 0;
+}
+
+static uint32_t next(uint32_t& rng) {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+size_t fuzzRandomInput(uint32_t& rng, uint8_t* out, size_t max) {
+    const size_t room = (max - 4 < 600) ? max - 4 : 600;
+    const size_t len = 4 + next(rng) % (room + 1);
+    for (uint8_t i = 0; i < 4; i++) {
+        out[i] = (uint8_t)next(rng);
+    }
+    const uint8_t headerBias = next(rng) % 4;       // 0x06 density from 0 to ~3/8
+    size_t i = 4;
+    while (i < len) {
+        const uint32_t r = next(rng);
+        switch (r % 16) {
+            case 0:     // A valid packet (possibly cut short)
+            case 1: {
+                uint8_t packet[8];
+                fuzzBuildPacket(packet, (r >> 8) % 61, (r >> 16) % 51, (r >> 24) % 121);
+                for (uint8_t b = 0; b < 8 && i < len; b++) out[i++] = packet[b];
+                break;
+            }
+            case 2: {   // Near miss: one byte off
+                uint8_t packet[8];
+                fuzzBuildPacket(packet, (r >> 8) % 61, (r >> 16) % 51, 38);
+                packet[1 + (r >> 24) % 7] ^= 1 << ((r >> 28) & 7);
+                for (uint8_t b = 0; b < 8 && i < len; b++) out[i++] = packet[b];
+                break;
+            }
+            case 3:     // Run of headers
+                for (uint8_t b = 0; b < (r >> 8) % 12 && i < len; b++) out[i++] = 0x06;
+                break;
+            default:
+                out[i++] = ((r >> 8) % 8 < headerBias) ? 0x06 : (uint8_t)(r >> 16);
+                break;
+        }
+    }
+    return len;
+}
+
+#ifdef PARSER_FUZZ_MAIN
+// Random driver for builds without libFuzzer: program [inputs] or
+// program file... (replays saved inputs, e.g. a libFuzzer crash file)
+int main(int argc, char** argv) {
+    static uint8_t input[FUZZ_MAX_INPUT];
+    if (argc > 1 && (argv[1][0] < '0' || argv[1][0] > '9')) {
+        for (int a = 1; a < argc; a++) {
+            FILE* file = fopen(argv[a], "rb");
+            if (file == nullptr) {
+                perror(argv[a]);
+                return 1;
+            }
+            const size_t len = fread(input, 1, sizeof(input), file);
+            fclose(file);
+            LLVMFuzzerTestOneInput(input, len);
+        }
+        printf("%d inputs passed\n", argc - 1);
+        return 0;
+    }
+    const uint32_t count = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 200000;
+    uint32_t rng = 0x9E3779B9u;
+    for (uint32_t n = 0; n < count; n++) {
+        const size_t len = fuzzRandomInput(rng, input, sizeof(input));
+        LLVMFuzzerTestOneInput(input, len);
+    }
+    printf("%lu random inputs passed\n", (unsigned long)count);
+    return 0;
+}
+#endif // PARSER_FUZZ_MAIN
@@ -0,0 +1,41 @@
+// parser_fuzz.h
+// MaCO2Parser fuzz harness (libFuzzer entry point, random input generator)
+// LLVMFuzzerTestOneInput builds a byte stream from the input, arbitrary
+// bytes followed by clean packets, feeds it to a fresh parser in polls of
+// input-chosen sizes and aborts when an invariant breaks:
+//   - draining a poll reads every byte, in at most one call per packet
+//     that can end in it, + 1
+//   - the packets decoded are exactly those of a reference scan that tries
+//     every 0x06 as a header, in order (nothing lost, nothing extra)
+//   - every clean packet after the first two is decoded, in order, last
+//   - packet count = packets returned
+// Out-of-bounds accesses are left to ASan/UBSan.
+//
+// Three builds share parser_fuzz.cpp:
+//   pio test -e native -f test_parser_fuzz     random inputs + throughput floor
+//   pio run -e fuzz_parser && .pio/build/fuzz_parser/program [n | files...]
+//                                              ASan/UBSan random driver
+//   clang++ -fsanitize=fuzzer,address,undefined -std=gnu++17 -pthread
+//     -I include -I lib/NativeArduino <the [env:fuzz_parser] sources>
+//     lib/NativeArduino/*.cpp lib/NativeArduino/freertos/*.cpp
+//     test/test_parser_fuzz/parser_fuzz.cpp     libFuzzer
+
+#ifndef PARSER_FUZZ_H
+#define PARSER_FUZZ_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+static const size_t FUZZ_MAX_INPUT = 4 + 2048;     // Poll pattern + arbitrary bytes
+static const uint8_t FUZZ_CLEAN_PACKETS = 16;
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+// Random input biased toward the parser's edge cases (0x06 runs, valid
+// packets and near-misses among the noise); returns its length
+size_t fuzzRandomInput(uint32_t& rng, uint8_t* out, size_t max);
+
+// 8-byte packet with a correct checksum
+void fuzzBuildPacket(uint8_t* out, uint8_t rr, uint8_t wave, uint8_t fetco2);
+
+#endif // PARSER_FUZZ_H
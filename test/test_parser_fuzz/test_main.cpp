@@ -0,0 +1,132 @@
+// test_parser_fuzz
+// MaCO2Parser resync under arbitrary byte streams (harness in parser_fuzz.cpp)
+// Runs the fuzz entry point on seeded random inputs and on the cases behind
+// the resync fixes: packets in every byte phase after garbage, false
+// headers, header runs and one-byte polls. A throughput floor fails the run
+// when resync on adversarial noise (dense false headers, near-miss packets)
+// slows down. Coverage-guided runs: see parser_fuzz.h.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <chrono>
+#include "MaCO2Parser.h"
+#include "parser_fuzz.h"
+
+static const uint32_t RANDOM_INPUTS = 20000;
+static const float MIN_RESYNC_MB_S = 5.0f;
+
+void setUp() {
+    Serial.setMuted(true);
+}
+
+void tearDown() {
+    Serial.setMuted(false);
+}
+
+void test_random_inputs() {
+    static uint8_t input[FUZZ_MAX_INPUT];
+    uint32_t rng = 12345;
+    for (uint32_t n = 0; n < RANDOM_INPUTS; n++) {
+        const size_t len = fuzzRandomInput(rng, input, sizeof(input));
+        TEST_ASSERT_EQUAL_INT(0, LLVMFuzzerTestOneInput(input, len));
+    }
+}
+
+// Garbage of every length 0..15 (each packet byte phase), made of 0x06 or
+// of bytes that never start a header, in every poll size pattern
+void test_packet_phases_after_garbage() {
+    uint8_t input[4 + 16];
+    for (uint8_t fill = 0; fill < 2; fill++) {
+        for (uint8_t garbage = 0; garbage < 16; garbage++) {
+            for (uint8_t poll = 0; poll < 48; poll += 5) {
+                memset(input, poll, 4);
+                memset(input + 4, fill ? 0x06 : 0x3C, garbage);
+                TEST_ASSERT_EQUAL_INT(0, LLVMFuzzerTestOneInput(input, 4 + garbage));
+            }
+        }
+    }
+}
+
+// Near-miss and cut-off packets hiding a real header, and header runs
+// around a packet; one byte per poll
+void test_false_headers() {
+    uint8_t input[4 + 32];
+    memset(input, 0, 4);                // 1-byte polls
+
+    // Near miss: bad checksum, the real header 3 bytes in
+    fuzzBuildPacket(input + 4, 12, 20, 38);
+    input[4 + 7] ^= 0xFF;
+    input[4 + 3] = 0x06;
+    TEST_ASSERT_EQUAL_INT(0, LLVMFuzzerTestOneInput(input, 4 + 8));
+
+    // Valid packet cut after 5 bytes, then a complete one
+    fuzzBuildPacket(input + 4, 12, 20, 38);
+    fuzzBuildPacket(input + 4 + 5, 30, 6, 6);
+    TEST_ASSERT_EQUAL_INT(0, LLVMFuzzerTestOneInput(input, 4 + 13));
+
+    // Runs of headers around packets
+    memset(input + 4, 0x06, 32);
+    fuzzBuildPacket(input + 4 + 9, 6, 6, 6);
+    TEST_ASSERT_EQUAL_INT(0, LLVMFuzzerTestOneInput(input, 4 + 32));
+}
+
+// Throughput of the sync search on noise with 1 byte in 4 a false header
+// and a near-miss packet now and then, in 64-byte polls
+void test_resync_throughput() {
+    static const uint32_t BYTES = 4u << 20;
+    static const uint16_t POLL = 64;
+    static uint8_t noise[64 * 1024];
+    uint32_t rng = 99;
+    for (uint32_t i = 0; i < sizeof(noise); i++) {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        noise[i] = ((rng >> 8) & 3) == 0 ? 0x06 : (uint8_t)(rng >> 16);
+    }
+    for (uint32_t i = 0; i + 8 <= sizeof(noise); i += 251) {
+        fuzzBuildPacket(noise + i, 12, 20, 38);
+        noise[i + 7] ^= 1;
+    }
+
+    class NoiseStream : public Stream {
+    public:
+        uint32_t pos = 0;
+        uint32_t end = 0;
+        int available() override { return (int)(end - pos); }
+        int read() override { return pos < end ? noise[pos++ % sizeof(noise)] : -1; }
+        int peek() override { return pos < end ? noise[pos % sizeof(noise)] : -1; }
+        size_t write(uint8_t) override { return 1; }
+        using Print::write;
+    } stream;
+
+    VirtualClock clock;
+    MaCO2Parser parser;
+    parser.setClock(&clock);
+    CO2Data data;
+    memset(&data, 0, sizeof(data));
+    uint32_t packets = 0;
+    const auto start = std::chrono::steady_clock::now();
+    while (stream.end < BYTES) {
+        clock.advance(66667);               // 64 B at 9600 baud
+        stream.end += POLL;
+        while (parser.parsePacket(stream, data)) packets++;
+    }
+    const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const float mb_s = BYTES / s / 1e6;
+
+    char line[100];
+    snprintf(line, sizeof(line), "resync: %.1f MB/s over %lu MB of noise (%lu false packets)",
+             mb_s, (unsigned long)(BYTES >> 20), (unsigned long)packets);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL_UINT32(BYTES, stream.pos);
+    TEST_ASSERT_GREATER_THAN(MIN_RESYNC_MB_S, mb_s);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_random_inputs);
+    RUN_TEST(test_packet_phases_after_garbage);
+    RUN_TEST(test_false_headers);
+    RUN_TEST(test_resync_throughput);
+    return UNITY_END();
+}
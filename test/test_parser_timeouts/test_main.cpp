@@ -0,0 +1,230 @@
+// test_parser_timeouts
+// MaCO2Parser's two timeouts on a VirtualClock
+// A partial packet is dropped after 2 s without bytes: a stall of 1.9 s
+// mid-packet must still complete the packet, one of 2.1 s must drop it,
+// count one error and resync on the next packet. During a sync search
+// (noise with false 0x06 headers) the parser reports once per 5 s and
+// counts each report as an error; a valid packet ends the search. A 30 min
+// emulator run polled like loop() must trip neither timeout.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <string>
+#include <vector>
+#include "MaCO2Emulator.h"
+#include "MaCO2Parser.h"
+
+static const uint32_t POLL_MS = 100;            // Data update of loop()
+static const uint8_t MAX_PACKETS = 10;          // Per poll, as loop()
+
+// Bytes "received" so far, read by the parser
+class FeedStream : public Stream {
+public:
+    void feed(const uint8_t* data, size_t len) { _rx.append((const char*)data, len); }
+    int available() override { return (int)(_rx.size() - _pos); }
+    int read() override { return _pos < _rx.size() ? (uint8_t)_rx[_pos++] : -1; }
+    int peek() override { return _pos < _rx.size() ? (uint8_t)_rx[_pos] : -1; }
+    size_t write(uint8_t) override { return 1; }
+    using Print::write;
+
+private:
+    std::string _rx;
+    size_t _pos = 0;
+};
+
+// A valid packet; no 0x06 but the header
+static void makePacket(uint8_t wave, uint8_t* p) {
+    p[0] = 0x06;
+    p[1] = 0x01;                // Pump running
+    p[2] = 12;                  // RR
+    p[3] = 0;
+    p[4] = wave;
+    p[5] = 38;
+    p[6] = 0;
+    uint8_t sum = 0;
+    for (uint8_t i = 0; i < 7; i++) sum += p[i];
+    if (sum == 0x06) {          // Keep the checksum from looking like a header
+        p[6] = 1;
+        sum++;
+    }
+    p[7] = sum;
+}
+
+struct Rig {
+    VirtualClock clock;
+    FeedStream uart;
+    MaCO2Parser parser;
+    CO2Data data;
+    uint8_t wave = 0;
+
+    Rig() {
+        memset(&data, 0, sizeof(data));
+        clock.set(1000000);
+        parser.setClock(&clock);
+    }
+
+    // One data update: up to MAX_PACKETS packets; returns packets parsed
+    uint32_t poll() {
+        clock.advance(POLL_MS * 1000);
+        uint32_t n = 0;
+        while (n < MAX_PACKETS && parser.parsePacket(uart, data)) n++;
+        return n;
+    }
+
+    // Poll for ms without new bytes
+    uint32_t idle(uint32_t ms) {
+        uint32_t n = 0;
+        for (uint32_t t = 0; t < ms; t += POLL_MS) n += poll();
+        return n;
+    }
+
+    void feedPacket(uint8_t from = 0, uint8_t to = 8) {
+        uint8_t p[8];
+        makePacket(wave, p);
+        uart.feed(p + from, to - from);
+        if (to == 8) {
+            wave = (uint8_t)((wave + 3) % 33);
+            if (wave == 0x06) wave++;
+        }
+    }
+
+    // count packets, one per poll
+    uint32_t packets(uint32_t count) {
+        uint32_t n = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            feedPacket();
+            n += poll();
+        }
+        return n;
+    }
+};
+
+void setUp() {
+    Serial.setMuted(true);
+}
+
+void tearDown() {
+    Serial.setMuted(false);
+}
+
+void test_partial_packet_stall_under_2s() {
+    Rig rig;
+    TEST_ASSERT_EQUAL_UINT32(20, rig.packets(20));
+
+    // Half a packet, polls for 1.9 s without bytes, the other half by the
+    // next poll: still one packet
+    rig.feedPacket(0, 4);
+    TEST_ASSERT_EQUAL_UINT32(0, rig.poll());
+    TEST_ASSERT_EQUAL_UINT32(0, rig.idle(1900));
+    rig.feedPacket(4, 8);
+    TEST_ASSERT_EQUAL_UINT32(1, rig.poll());
+    TEST_ASSERT_EQUAL_UINT32(0, rig.parser.getErrorCount());
+    TEST_ASSERT_EQUAL_UINT32(21, rig.parser.getPacketCount());
+}
+
+void test_partial_packet_stall_over_2s() {
+    Rig rig;
+    TEST_ASSERT_EQUAL_UINT32(20, rig.packets(20));
+
+    // Half a packet and 2.1 s of silence: dropped, one error
+    rig.feedPacket(0, 4);
+    TEST_ASSERT_EQUAL_UINT32(0, rig.poll());
+    TEST_ASSERT_EQUAL_UINT32(0, rig.idle(2000));
+    TEST_ASSERT_EQUAL_UINT32(0, rig.parser.getErrorCount());    // 2.0 s: not yet
+    TEST_ASSERT_EQUAL_UINT32(0, rig.idle(POLL_MS));
+    TEST_ASSERT_EQUAL_UINT32(1, rig.parser.getErrorCount());
+
+    // The stale half (no header in it) is skipped, the next packet decodes
+    rig.feedPacket(4, 8);
+    TEST_ASSERT_EQUAL_UINT32(0, rig.poll());
+    TEST_ASSERT_EQUAL_UINT32(10, rig.packets(10));
+    TEST_ASSERT_EQUAL_UINT32(1, rig.parser.getErrorCount());
+    TEST_ASSERT_EQUAL_UINT32(30, rig.parser.getPacketCount());
+
+    // A later stall times out again (the timeout is not one-shot)
+    rig.feedPacket(0, 5);
+    TEST_ASSERT_EQUAL_UINT32(0, rig.idle(2200));
+    TEST_ASSERT_EQUAL_UINT32(2, rig.parser.getErrorCount());
+}
+
+void test_sync_search_reports_every_5s() {
+    Rig rig;
+    TEST_ASSERT_EQUAL_UINT32(20, rig.packets(20));
+
+    // 23 s of false headers: 8 bytes from a 0x06 with a bad checksum and no
+    // other 0x06, one candidate per poll
+    uint32_t seed = 7;
+    std::vector<uint32_t> reportMs;
+    uint32_t errors = rig.parser.getErrorCount();
+    const uint32_t noiseStart = rig.clock.millis();
+    for (uint32_t t = 0; t < 23000; t += POLL_MS) {
+        uint8_t noise[8];
+        noise[0] = 0x06;
+        uint8_t sum = 0x06;
+        for (uint8_t i = 1; i < 7; i++) {
+            seed = seed * 1664525u + 1013904223u;
+            noise[i] = (uint8_t)(seed >> 24);
+            if (noise[i] == 0x06) noise[i] = 0x07;
+            sum += noise[i];
+        }
+        noise[7] = (uint8_t)(sum + 1);
+        if (noise[7] == 0x06) noise[7] = 0x08;
+        rig.uart.feed(noise, sizeof(noise));
+        TEST_ASSERT_EQUAL_UINT32(0, rig.poll());
+        if (rig.parser.getErrorCount() != errors) {
+            errors = rig.parser.getErrorCount();
+            reportMs.push_back(rig.clock.millis() - noiseStart);
+        }
+    }
+
+    // Rejections 1-4 are counted one by one; the search starts at the next
+    // poll, and from then on only the reports count, one per 5 s
+    TEST_ASSERT_EQUAL_UINT32(4 + 4, reportMs.size());
+    TEST_ASSERT_EQUAL_UINT32(4 * POLL_MS, reportMs[3]);
+    TEST_ASSERT_EQUAL_UINT32(5 * POLL_MS + 5000 + POLL_MS, reportMs[4]);
+    for (uint8_t i = 5; i < reportMs.size(); i++) {
+        const uint32_t gap = reportMs[i] - reportMs[i - 1];
+        TEST_ASSERT_GREATER_THAN(5000, gap);
+        TEST_ASSERT_LESS_THAN(5000 + POLL_MS + 1, gap);
+    }
+    TEST_ASSERT_EQUAL_UINT32(8, rig.parser.getErrorCount());
+
+    // A valid packet ends the search: no more reports
+    TEST_ASSERT_EQUAL_UINT32(80, rig.packets(80));
+    TEST_ASSERT_EQUAL_UINT32(8, rig.parser.getErrorCount());
+    TEST_ASSERT_EQUAL_UINT32(100, rig.parser.getPacketCount());
+}
+
+void test_long_run_no_timeouts() {
+    // 30 min of 8 Hz packets split across 100 ms polls at every phase
+    VirtualClock clock;
+    MaCO2Emulator emulator;
+    EmulatorConfig config = MaCO2Emulator::defaultConfig();
+    config.handshake = false;
+    emulator.setClock(&clock);
+    emulator.begin(config);
+    MaCO2Parser parser;
+    parser.setClock(&clock);
+    CO2Data data;
+    memset(&data, 0, sizeof(data));
+
+    const uint32_t seconds = 30 * 60;
+    for (uint32_t t = 0; t < seconds * 1000; t += POLL_MS) {
+        clock.advance(POLL_MS * 1000);
+        uint8_t n = 0;
+        while (n < MAX_PACKETS && parser.parsePacket(emulator, data)) n++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, parser.getErrorCount());
+    TEST_ASSERT_UINT32_WITHIN(2, seconds * 8, parser.getPacketCount());
+    // All but a packet still on the line when the run ends
+    TEST_ASSERT_UINT32_WITHIN(1, emulator.getStats().packets, parser.getPacketCount());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_partial_packet_stall_under_2s);
+    RUN_TEST(test_partial_packet_stall_over_2s);
+    RUN_TEST(test_sync_search_reports_every_5s);
+    RUN_TEST(test_long_run_no_timeouts);
+    return UNITY_END();
+}
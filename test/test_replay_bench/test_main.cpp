@@ -0,0 +1,284 @@
+// test_replay_bench
+// UART capture round trip and the 'B' replay benchmark on the host
+// The emulator is read through UartRecorder on a VirtualClock by a loop
+// that polls every 90-130 ms; UartReplay must hand back the same bytes in
+// the same chunks at the same times, in real time and in fast mode.
+// ReplayBench then replays emulator.mcr (2 min, with corrupt packets and
+// dropped bytes) in both modes through parser, ADC, volumetric capnography,
+// calorimetry, timeline and host output. It reports throughput and time per
+// packet and stage, and every stage digest must match golden.txt.
+//
+//   UPDATE_GOLDEN=1              record emulator.mcr again, rewrite golden.txt
+//   REPLAY_CAPTURE=<file.mcr>    bench another capture (report only)
+
+#include <Arduino.h>
+#include <unity.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "MaCO2Emulator.h"
+#include "ReplayBench.h"
+#include "UartCapture.h"
+
+#ifndef PROJECT_DIR
+#define PROJECT_DIR "."
+#endif
+
+static const char* CAPTURE_FILE = PROJECT_DIR "/test/test_replay_bench/emulator.mcr";
+static const char* GOLDEN_FILE = PROJECT_DIR "/test/test_replay_bench/golden.txt";
+static const uint32_t CAPTURE_S = 120;
+static const float MIN_SPEEDUP = 100.0f;        // Replay vs recorded time
+
+// Capture file bytes as a Stream (input of UartReplay)
+class MemoryStream : public Stream {
+public:
+    explicit MemoryStream(const std::vector<uint8_t>& data) : _data(data), _pos(0) {}
+    int available() override { return (int)(_data.size() - _pos); }
+    int read() override { return _pos < _data.size() ? _data[_pos++] : -1; }
+    int peek() override { return _pos < _data.size() ? _data[_pos] : -1; }
+    size_t write(uint8_t) override { return 1; }
+    using Print::write;
+
+private:
+    const std::vector<uint8_t>& _data;
+    size_t _pos;
+};
+
+// Recorder sink
+class VectorPrint : public Print {
+public:
+    std::vector<uint8_t> bytes;
+    size_t write(uint8_t b) override {
+        bytes.push_back(b);
+        return 1;
+    }
+    using Print::write;
+};
+
+static void message(const std::string& line) {
+    TEST_MESSAGE(line.c_str());
+}
+
+// Bench report into the test output, line by line
+class MessagePrint : public Print {
+public:
+    size_t write(uint8_t b) override {
+        if (b == '\n') {
+            message(_line);
+            _line.clear();
+        } else if (b != '\r') {
+            _line += (char)b;
+        }
+        return 1;
+    }
+    using Print::write;
+
+private:
+    std::string _line;
+};
+
+// What one poll of the recording loop read
+struct Poll {
+    uint64_t t_us;              // Since recording started
+    std::vector<uint8_t> bytes;
+};
+
+static uint32_t rng = 1;
+
+static uint32_t nextRandom() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+// Record seconds of emulator output, polled every 90-130 ms
+static std::vector<uint8_t> recordEmulator(uint32_t seconds, std::vector<Poll>* polls = nullptr) {
+    VirtualClock clock;
+    clock.set(5000000);                         // Recording starts at a non-zero time
+    MaCO2Emulator emulator;
+    EmulatorConfig config = MaCO2Emulator::defaultConfig();
+    config.handshake = false;
+    config.corrupt_prob = 0.01f;
+    config.drop_byte_prob = 0.0005f;
+    emulator.setClock(&clock);
+    emulator.begin(config);
+
+    UartRecorder recorder(emulator);
+    recorder.setClock(&clock);
+    VectorPrint sink;
+    TEST_ASSERT_TRUE(recorder.startRecording(&sink, 9600));
+    const uint64_t start = clock.now();
+    rng = 2024;
+    while (clock.now() - start < (uint64_t)seconds * 1000000) {
+        clock.advance(90000 + nextRandom() % 40001);
+        Poll poll;
+        poll.t_us = clock.now() - start;
+        while (recorder.available() > 0) {
+            poll.bytes.push_back((uint8_t)recorder.read());
+        }
+        if (polls != nullptr && !poll.bytes.empty()) polls->push_back(poll);
+    }
+    recorder.stopRecording();
+    return sink.bytes;
+}
+
+static bool readFile(const char* path, std::vector<uint8_t>& bytes) {
+    FILE* f = fopen(path, "rb");
+    if (f == nullptr) return false;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) bytes.insert(bytes.end(), buf, buf + n);
+    fclose(f);
+    return true;
+}
+
+static bool writeFile(const char* path, const void* data, size_t len) {
+    FILE* f = fopen(path, "wb");
+    if (f == nullptr) return false;
+    const bool ok = fwrite(data, 1, len, f) == len;
+    return fclose(f) == 0 && ok;
+}
+
+void setUp() {
+    Serial.setMuted(true);
+}
+
+void tearDown() {
+    Serial.setMuted(false);
+}
+
+void test_record_replay_realtime() {
+    std::vector<Poll> polls;
+    const std::vector<uint8_t> capture = recordEmulator(30, &polls);
+    TEST_ASSERT_GREATER_THAN(200, polls.size());
+
+    // Replay stepped to the same poll times: each poll gets what it read
+    MemoryStream file(capture);
+    UartReplay replay(file);
+    VirtualClock clock;
+    clock.set(123456789);                       // Replay clock has its own origin
+    replay.setClock(&clock);
+    TEST_ASSERT_TRUE(replay.begin(REPLAY_REALTIME));
+    TEST_ASSERT_EQUAL_UINT32(9600, replay.getBaud());
+    const uint64_t origin = clock.now();
+    uint32_t bytes = 0;
+    for (const Poll& poll : polls) {
+        // Just before the poll nothing of it is out yet
+        clock.set(origin + poll.t_us - 1);
+        replay.update();
+        TEST_ASSERT_EQUAL_INT(0, replay.available());
+
+        clock.set(origin + poll.t_us);
+        replay.update();
+        TEST_ASSERT_EQUAL_UINT32(poll.t_us, (uint32_t)replay.getTime());
+        TEST_ASSERT_EQUAL_INT((int)poll.bytes.size(), replay.available());
+        for (uint8_t b : poll.bytes) {
+            TEST_ASSERT_EQUAL_UINT8(b, (uint8_t)replay.read());
+        }
+        bytes += poll.bytes.size();
+    }
+    replay.update();
+    TEST_ASSERT_TRUE(replay.isFinished());
+    TEST_ASSERT_EQUAL_UINT32(bytes, replay.getStats().bytes);
+    TEST_ASSERT_EQUAL_UINT32(capture.size(), replay.getStats().fileBytes);
+    TEST_ASSERT_EQUAL_UINT32(polls.back().t_us, (uint32_t)replay.getStats().duration_us);
+}
+
+void test_record_replay_fast() {
+    // Polls read at most 64 bytes here, so every poll is one chunk
+    std::vector<Poll> polls;
+    const std::vector<uint8_t> capture = recordEmulator(30, &polls);
+    MemoryStream file(capture);
+    UartReplay replay(file);
+    VirtualClock clock;                         // Never advanced
+    replay.setClock(&clock);
+    TEST_ASSERT_TRUE(replay.begin(REPLAY_FAST));
+    for (const Poll& poll : polls) {
+        TEST_ASSERT_TRUE(poll.bytes.size() <= UartRecorder::MAX_CHUNK);
+        TEST_ASSERT_TRUE(replay.update());
+        TEST_ASSERT_EQUAL_UINT32(poll.t_us, (uint32_t)replay.getTime());
+        TEST_ASSERT_EQUAL_INT((int)poll.bytes.size(), replay.available());
+        for (uint8_t b : poll.bytes) {
+            TEST_ASSERT_EQUAL_UINT8(b, (uint8_t)replay.read());
+        }
+    }
+    TEST_ASSERT_FALSE(replay.update());
+    TEST_ASSERT_EQUAL_UINT32(polls.size(), replay.getStats().chunks);
+}
+
+void test_replay_bench_golden() {
+    std::vector<uint8_t> capture;
+    const bool update = getenv("UPDATE_GOLDEN") != nullptr;
+    if (update) {
+        capture = recordEmulator(CAPTURE_S);
+        TEST_ASSERT_TRUE_MESSAGE(writeFile(CAPTURE_FILE, capture.data(), capture.size()), CAPTURE_FILE);
+    } else {
+        TEST_ASSERT_TRUE_MESSAGE(readFile(CAPTURE_FILE, capture),
+                                 "missing emulator.mcr (run with UPDATE_GOLDEN=1)");
+    }
+
+    const ReplayMode modes[] = { REPLAY_REALTIME, REPLAY_FAST };
+    const char* const names[] = { "realtime", "fast" };
+    std::string lines;
+    MessagePrint report;
+    uint32_t adcDigest[2];
+    for (uint8_t m = 0; m < 2; m++) {
+        MemoryStream file(capture);
+        ReplayBench bench;
+        TEST_ASSERT_TRUE(bench.run(file, modes[m], Clock::hardware(), report));
+        const ReplayBenchResult& r = bench.getResult();
+        TEST_ASSERT_GREATER_THAN(CAPTURE_S * 8 * 95 / 100, r.packets);
+        TEST_ASSERT_GREATER_THAN(0, r.errors);                  // Faults in the capture
+        TEST_ASSERT_GREATER_THAN(CAPTURE_S / 6, r.breaths);
+        const float speedup = r.elapsed_us > 0 ? (float)r.duration_us / r.elapsed_us : 0.0f;
+        TEST_ASSERT_GREATER_THAN(MIN_SPEEDUP, speedup);
+        adcDigest[m] = r.digest[BENCH_ADC];
+
+        char line[ReplayBench::DIGEST_LINE + 16];
+        const int n = snprintf(line, sizeof(line), "%s ", names[m]);
+        bench.formatDigests(line + n, sizeof(line) - n);
+        lines += line;
+
+        if (!update) {
+            std::vector<uint8_t> golden;
+            TEST_ASSERT_TRUE_MESSAGE(readFile(GOLDEN_FILE, golden),
+                                     "missing golden.txt (run with UPDATE_GOLDEN=1)");
+            golden.push_back('\0');
+            const char* stored = strstr((const char*)golden.data(), names[m]);
+            TEST_ASSERT_TRUE_MESSAGE(stored != nullptr, "mode missing from golden.txt");
+            TEST_ASSERT_EQUAL_UINT8(0, bench.compareDigests(stored + strlen(names[m]), report));
+        }
+    }
+    // Packet timestamps follow the polling, sensor values only the packets
+    TEST_ASSERT_EQUAL_HEX32(adcDigest[0], adcDigest[1]);
+    if (update) {
+        TEST_ASSERT_TRUE_MESSAGE(writeFile(GOLDEN_FILE, lines.data(), lines.size()), GOLDEN_FILE);
+        TEST_MESSAGE("emulator.mcr and golden.txt rewritten");
+    }
+}
+
+void test_replay_other_capture() {
+    const char* path = getenv("REPLAY_CAPTURE");
+    if (path == nullptr) {
+        TEST_IGNORE_MESSAGE("set REPLAY_CAPTURE=<capture.mcr> to bench a recording");
+    }
+    std::vector<uint8_t> capture;
+    TEST_ASSERT_TRUE_MESSAGE(readFile(path, capture), path);
+    MessagePrint report;
+    for (ReplayMode mode : { REPLAY_REALTIME, REPLAY_FAST }) {
+        MemoryStream file(capture);
+        ReplayBench bench;
+        TEST_ASSERT_TRUE_MESSAGE(bench.run(file, mode, Clock::hardware(), report), "not a UART capture");
+        TEST_ASSERT_GREATER_THAN(0, bench.getResult().packets);
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_record_replay_realtime);
+    RUN_TEST(test_record_replay_fast);
+    RUN_TEST(test_replay_bench_golden);
+    RUN_TEST(test_replay_other_capture);
+    return UNITY_END();
+}
@@ -0,0 +1,282 @@
+// test_session_codec
+// SessionEncoder / SessionDecoder round trip and compression ratio
+// The trace is 10 min of emulator data through MaCO2Parser and ADCManager
+// on a VirtualClock, with noisy O2 and volume channels, a 100 ppm sample
+// clock error, and shifted in time so the µs timestamps cross 2^32 (the
+// file stores only their low 32 bits).
+// Every field of every record, timestamp_us included, must come back
+// exactly, whether the file is read from the start or one block at a time.
+// Edge cases: extreme deltas in every column, a partial last block,
+// corrupt and truncated blocks, the file header.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <math.h>
+#include <vector>
+#include "SessionCodec.h"
+#include "SessionStore.h"
+#include "MaCO2Emulator.h"
+#include "MaCO2Parser.h"
+#include "ADCManager.h"
+
+static const uint32_t TRACE_S = 601;                                  // Ends in a partial block
+static const uint64_t TIME_OFFSET_US = (1ULL << 32) - 300000000ULL;    // Crosses 2^32 at 5 min
+static const float MIN_RATIO = 5.0f;                                   // Against 24-byte records, this trace
+static const size_t RAW_RECORD = 24;
+
+// O2 falls as CO2 rises, volume swings at 12 breaths/min, both with a few
+// LSB of noise
+class NoisyTraceSource : public ADCSampleSource {
+public:
+    uint16_t co2 = 0;
+    uint32_t packet = 0;
+    uint16_t read(uint8_t channel) override {
+        _state ^= _state << 13;
+        _state ^= _state >> 17;
+        _state ^= _state << 5;
+        const int noise = (int)(_state % 7) - 3;
+        if (channel == SENSOR_O2) {
+            return (uint16_t)constrain(1800 - 8 * (int)co2 + noise, 0, 4095);
+        }
+        return (uint16_t)(2048 + 1200.0f * sinf(packet * (6.2831853f / 40)) + noise);
+    }
+
+private:
+    uint32_t _state = 2463534242u;
+};
+
+static std::vector<SessionRecord> trace;
+
+static void buildTrace() {
+    VirtualClock clock;
+    MaCO2Emulator emulator;
+    MaCO2Parser parser;
+    ADCManager adc;
+    NoisyTraceSource analog;
+    EmulatorConfig config = MaCO2Emulator::defaultConfig();
+    config.handshake = false;
+    emulator.setClock(&clock);
+    parser.setClock(&clock);
+    emulator.begin(config);
+    adc.setSampleSource(&analog);
+    adc.begin();
+
+    CO2Data data;
+    memset(&data, 0, sizeof(data));
+    for (uint32_t t = 0; t < TRACE_S * 1000; t += 100) {
+        clock.advance(100000);
+        while (parser.parsePacket(emulator, data)) {
+            analog.co2 = data.co2_waveform;
+            analog.packet++;
+            adc.update(data);
+            // A sensor clock 100 ppm fast: a period of 125012.5 µs, the worst
+            // case for the µs column (every second difference is ±1)
+            data.timestamp_us += TIME_OFFSET_US + data.timestamp_us / 10000;
+            data.timestamp = (uint32_t)(data.timestamp_us / 1000);
+            SessionRecord record;
+            SessionStore::fromData(data, record);
+            trace.push_back(record);
+        }
+    }
+}
+
+// Encode records into blocks; returns the encoded bytes
+static std::vector<uint8_t> encode(const std::vector<SessionRecord>& records,
+                                   std::vector<size_t>* offsets = nullptr) {
+    SessionEncoder encoder;
+    std::vector<uint8_t> out;
+    uint8_t block[SessionEncoder::MAX_BLOCK];
+    for (size_t i = 0; i < records.size(); i++) {
+        if (!encoder.add(records[i]) && i + 1 < records.size()) {
+            continue;
+        }
+        const size_t len = encoder.finishBlock(block);
+        TEST_ASSERT_TRUE(len > 0 && len <= SessionEncoder::MAX_BLOCK);
+        if (offsets != nullptr) offsets->push_back(out.size());
+        out.insert(out.end(), block, block + len);
+    }
+    return out;
+}
+
+static void assertRecord(const SessionRecord& expected, const SessionRecord& actual, size_t index) {
+    char where[40];
+    snprintf(where, sizeof(where), "record %lu", (unsigned long)index);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE((uint32_t)expected.timestamp_us, (uint32_t)actual.timestamp_us, where);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE((uint32_t)(expected.timestamp_us >> 32),
+                                     (uint32_t)(actual.timestamp_us >> 32), where);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(expected.timestamp, actual.timestamp, where);
+    TEST_ASSERT_EQUAL_UINT16_MESSAGE(expected.co2_waveform, actual.co2_waveform, where);
+    TEST_ASSERT_EQUAL_UINT8_MESSAGE(expected.fco2, actual.fco2, where);
+    TEST_ASSERT_EQUAL_UINT8_MESSAGE(expected.fetco2, actual.fetco2, where);
+    TEST_ASSERT_EQUAL_UINT8_MESSAGE(expected.respiratory_rate, actual.respiratory_rate, where);
+    TEST_ASSERT_EQUAL_UINT8_MESSAGE(expected.status1, actual.status1, where);
+    TEST_ASSERT_EQUAL_UINT8_MESSAGE(expected.status2, actual.status2, where);
+    TEST_ASSERT_EQUAL_UINT8_MESSAGE(expected.valid, actual.valid, where);
+    for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+        TEST_ASSERT_EQUAL_INT32_MESSAGE(expected.sensors[ch], actual.sensors[ch], where);
+    }
+}
+
+// Walk the blocks from the start like a file reader; returns the records
+static std::vector<SessionRecord> decode(const std::vector<uint8_t>& bytes) {
+    std::vector<SessionRecord> out;
+    SessionRecord rows[SessionEncoder::BLOCK_RECORDS];
+    size_t pos = 0;
+    while (pos < bytes.size()) {
+        const size_t len = SessionDecoder::blockLength(&bytes[pos]);
+        TEST_ASSERT_TRUE(len > 0 && pos + len <= bytes.size());
+        const uint8_t n = SessionDecoder::decodeBlock(&bytes[pos], len, rows);
+        TEST_ASSERT_GREATER_THAN_UINT32(0, n);
+        out.insert(out.end(), rows, rows + n);
+        pos += len;
+    }
+    return out;
+}
+
+void setUp() {
+    Serial.setMuted(true);
+}
+
+void tearDown() {
+    Serial.setMuted(false);
+}
+
+void test_round_trip() {
+    TEST_ASSERT_UINT32_WITHIN(16, TRACE_S * 8, trace.size());
+    TEST_ASSERT_TRUE(trace.front().timestamp_us < (1ULL << 32));
+    TEST_ASSERT_TRUE(trace.back().timestamp_us > (1ULL << 32));
+    TEST_ASSERT_TRUE(trace.size() % SessionEncoder::BLOCK_RECORDS != 0);    // Partial last block
+
+    const std::vector<SessionRecord> decoded = decode(encode(trace));
+    TEST_ASSERT_EQUAL_UINT32(trace.size(), decoded.size());
+    for (size_t i = 0; i < trace.size(); i++) {
+        assertRecord(trace[i], decoded[i], i);
+    }
+}
+
+// Any block decodes on its own (keyframes)
+void test_random_access() {
+    std::vector<size_t> offsets;
+    const std::vector<uint8_t> bytes = encode(trace, &offsets);
+    SessionRecord rows[SessionEncoder::BLOCK_RECORDS];
+    for (size_t b = offsets.size(); b-- > 0;) {
+        const size_t len = SessionDecoder::blockLength(&bytes[offsets[b]]);
+        const uint8_t n = SessionDecoder::decodeBlock(&bytes[offsets[b]], len, rows);
+        const size_t first = b * SessionEncoder::BLOCK_RECORDS;
+        TEST_ASSERT_EQUAL_UINT8(first + SessionEncoder::BLOCK_RECORDS <= trace.size()
+                                    ? SessionEncoder::BLOCK_RECORDS : trace.size() - first, n);
+        for (uint8_t i = 0; i < n; i++) {
+            assertRecord(trace[first + i], rows[i], first + i);
+        }
+    }
+}
+
+// Compression against 24-byte records, and what the µs column costs over
+// a µs time that is exactly ms * 1000. The codec's >5x target is for this
+// trace: emulator waveform, O2 and volume with +-3 LSB of noise, and the
+// 100 ppm clock error, the worst case for the µs column. It measures 5.2x
+// (4.6 B per sample, 0.8 B of it the µs column), so MIN_RATIO leaves little
+// room; the same trace without the µs cost is ~6.3x, quiet channels more.
+void test_ratio() {
+    const size_t bytes = encode(trace).size();
+    std::vector<SessionRecord> exact = trace;
+    for (SessionRecord& r : exact) {
+        r.timestamp_us = (uint64_t)r.timestamp * 1000;
+    }
+    const size_t exactBytes = encode(exact).size();
+
+    const float perSample = (float)bytes / trace.size();
+    const float ratio = (float)RAW_RECORD / perSample;
+    const float usCost = ((float)bytes - (float)exactBytes) / trace.size();
+    char line[120];
+    snprintf(line, sizeof(line), "%lu samples: %.2f B/sample, %.1fx (µs column %.2f B/sample)",
+             (unsigned long)trace.size(), perSample, ratio, usCost);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_GREATER_THAN(MIN_RATIO, ratio);
+    TEST_ASSERT_LESS_THAN(1.0f, usCost);
+}
+
+// Every column swinging across its whole range, and timestamps jumping
+// back and forth: the 5-byte varints and wrapping deltas must hold
+void test_extreme_deltas() {
+    std::vector<SessionRecord> records;
+    uint32_t rng = 7;
+    for (uint32_t i = 0; i < 3 * SessionEncoder::BLOCK_RECORDS + 5; i++) {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        SessionRecord r;
+        memset(&r, 0, sizeof(r));
+        const bool high = (i & 1) != 0;
+        // Up to the last ms the u32 ms time holds (it restores the µs high bits)
+        r.timestamp_us = high ? 0xFFFFFFFFULL * 1000 - rng % 1000000 : (uint64_t)rng;
+        r.timestamp = (uint32_t)(r.timestamp_us / 1000);
+        r.co2_waveform = high ? 0xFFFF : 0;
+        r.fco2 = high ? 0xFF : 0;
+        r.fetco2 = (uint8_t)rng;
+        r.respiratory_rate = (uint8_t)(rng >> 8);
+        r.status1 = high ? 0xFF : 0;
+        r.status2 = (uint8_t)(rng >> 16);
+        r.valid = high ? 1 : 0;
+        for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+            r.sensors[ch] = high ? INT32_MAX : INT32_MIN;
+        }
+        records.push_back(r);
+    }
+    const std::vector<SessionRecord> decoded = decode(encode(records));
+    TEST_ASSERT_EQUAL_UINT32(records.size(), decoded.size());
+    for (size_t i = 0; i < records.size(); i++) {
+        assertRecord(records[i], decoded[i], i);
+    }
+}
+
+void test_corrupt_blocks_and_header() {
+    std::vector<SessionRecord> first(trace.begin(), trace.begin() + SessionEncoder::BLOCK_RECORDS);
+    const std::vector<uint8_t> bytes = encode(first);
+    const size_t len = bytes.size();
+    SessionRecord rows[SessionEncoder::BLOCK_RECORDS];
+    TEST_ASSERT_EQUAL_UINT32(len, SessionDecoder::blockLength(bytes.data()));
+
+    std::vector<uint8_t> bad = bytes;
+    bad[0] ^= 0xFF;                                         // Sync
+    TEST_ASSERT_EQUAL_UINT32(0, SessionDecoder::blockLength(bad.data()));
+    bad = bytes;
+    bad[1] = SessionEncoder::BLOCK_RECORDS + 1;             // Record count
+    TEST_ASSERT_EQUAL_UINT32(0, SessionDecoder::blockLength(bad.data()));
+    TEST_ASSERT_EQUAL_UINT8(0, SessionDecoder::decodeBlock(bytes.data(), len - 1, rows));
+
+    // A body cut short (header length patched to match) runs out of tokens
+    bad = bytes;
+    bad[2] = (uint8_t)(len - SessionEncoder::BLOCK_HEADER - 8);
+    bad[3] = (uint8_t)((len - SessionEncoder::BLOCK_HEADER - 8) >> 8);
+    TEST_ASSERT_EQUAL_UINT8(0, SessionDecoder::decodeBlock(bad.data(), len - 8, rows));
+
+    SessionFileHeader header;
+    header.fields = SessionEncoder::FIELD_COUNT;
+    header.blockRecords = SessionEncoder::BLOCK_RECORDS;
+    header.records = 4801;
+    header.duration_ms = 600125;
+    uint8_t raw[SessionFileHeader::SIZE];
+    header.write(raw);
+    TEST_ASSERT_EQUAL_INT(0, memcmp("SES3", raw, 4));
+    SessionFileHeader back;
+    TEST_ASSERT_TRUE(back.read(raw));
+    TEST_ASSERT_EQUAL_UINT8(SessionEncoder::FIELD_COUNT, back.fields);
+    TEST_ASSERT_EQUAL_UINT8(SessionEncoder::BLOCK_RECORDS, back.blockRecords);
+    TEST_ASSERT_EQUAL_UINT32(4801, back.records);
+    TEST_ASSERT_EQUAL_UINT32(600125, back.duration_ms);
+    raw[3] = '2';                                           // An older format
+    TEST_ASSERT_FALSE(back.read(raw));
+}
+
+int main(int argc, char** argv) {
+    Serial.setMuted(true);
+    buildTrace();
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_random_access);
+    RUN_TEST(test_ratio);
+    RUN_TEST(test_extreme_deltas);
+    RUN_TEST(test_corrupt_blocks_and_header);
+    return UNITY_END();
+}
@@ -0,0 +1,325 @@
+// test_session_store
+// SessionStore recording and SessionExport read-out on the in-memory LittleFS
+// A recorded session is read back raw (equal to the file for any read
+// size), in byte ranges as /api/sessions/<id> serves Range requests (a
+// broken download resumed from where it stopped gives the whole file), and
+// as CSV (header, then one line per record with every field). A file cut
+// short inside a block, as a reset leaves it, lists and converts its whole
+// blocks only. parseRange() is checked on the forms a client sends.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <LittleFS.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include "SessionStore.h"
+
+static const uint32_t RECORDS = 300;            // 9 full blocks and a partial one
+
+class StringPrint : public Print {
+public:
+    std::string text;
+    size_t write(uint8_t b) override {
+        text += (char)b;
+        return 1;
+    }
+    using Print::write;
+};
+
+static CO2Data sample(uint32_t i) {
+    CO2Data data;
+    memset(&data, 0, sizeof(data));
+    data.timestamp_us = 4294000000ULL + 125000ULL * i + (i % 3);  // Crosses 2^32
+    data.timestamp = (uint32_t)(data.timestamp_us / 1000);
+    data.co2_waveform = (uint16_t)(i % 40);
+    data.fco2 = (uint8_t)(i % 40);
+    data.fetco2 = 38;
+    data.respiratory_rate = 12;
+    data.status1 = 0x01;
+    data.status2 = (uint8_t)(i % 5 == 0 ? 0x40 : 0);
+    data.valid = (i % 50) != 0;
+    for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+        data.sensors[ch].value = 20.9f - 0.013f * (float)(i % 97) + ch;
+    }
+    return data;
+}
+
+static uint32_t record(SessionStore& store, uint32_t count, bool stop = true) {
+    TEST_ASSERT_TRUE(store.startRecording());
+    const uint32_t id = store.getRecordingId();
+    for (uint32_t i = 0; i < count; i++) {
+        store.addSample(sample(i));
+    }
+    if (stop) store.stopRecording();
+    return id;
+}
+
+static std::string fileBytes(uint32_t id) {
+    char name[32];
+    SessionStore::path(id, name, sizeof(name));
+    File file = LittleFS.open(name, FILE_READ);
+    std::string bytes;
+    int b;
+    while ((b = file.read()) >= 0) bytes += (char)b;
+    return bytes;
+}
+
+static std::string readAll(SessionExport& out, size_t chunk) {
+    std::vector<uint8_t> buf(chunk);
+    std::string text;
+    size_t n;
+    while ((n = out.read(buf.data(), chunk)) > 0) {
+        TEST_ASSERT_TRUE(n <= chunk);
+        text.append((const char*)buf.data(), n);
+    }
+    return text;
+}
+
+static std::vector<std::string> lines(const std::string& text) {
+    std::vector<std::string> out;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find('\n', pos);
+        TEST_ASSERT_TRUE_MESSAGE(end != std::string::npos, "last line not terminated");
+        out.push_back(text.substr(pos, end - pos));
+        pos = end + 1;
+    }
+    return out;
+}
+
+// One CSV line against sample(i)
+static void checkLine(const std::string& line, uint32_t i) {
+    const CO2Data d = sample(i);
+    std::vector<std::string> cols;
+    size_t pos = 0;
+    for (;;) {
+        const size_t comma = line.find(',', pos);
+        cols.push_back(line.substr(pos, comma - pos));
+        if (comma == std::string::npos) break;
+        pos = comma + 1;
+    }
+    TEST_ASSERT_EQUAL_UINT32(9 + SENSOR_COUNT, cols.size());
+    TEST_ASSERT_EQUAL_UINT32(d.timestamp, strtoul(cols[0].c_str(), nullptr, 10));
+    TEST_ASSERT_TRUE(d.timestamp_us == strtoull(cols[1].c_str(), nullptr, 10));
+    TEST_ASSERT_EQUAL_UINT32(d.co2_waveform, strtoul(cols[2].c_str(), nullptr, 10));
+    TEST_ASSERT_EQUAL_UINT32(d.fco2, strtoul(cols[3].c_str(), nullptr, 10));
+    TEST_ASSERT_EQUAL_UINT32(d.fetco2, strtoul(cols[4].c_str(), nullptr, 10));
+    TEST_ASSERT_EQUAL_UINT32(d.respiratory_rate, strtoul(cols[5].c_str(), nullptr, 10));
+    TEST_ASSERT_EQUAL_UINT32(d.status1, strtoul(cols[6].c_str(), nullptr, 10));
+    TEST_ASSERT_EQUAL_UINT32(d.status2, strtoul(cols[7].c_str(), nullptr, 10));
+    TEST_ASSERT_EQUAL_UINT32(d.valid ? 1 : 0, strtoul(cols[8].c_str(), nullptr, 10));
+    for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+        const uint8_t decimals = Sensors::info(ch).decimals;
+        const float lsb = powf(10.0f, -(float)decimals);
+        const std::string& col = cols[9 + ch];
+        const size_t dot = col.find('.');
+        TEST_ASSERT_EQUAL_UINT32(decimals, dot == std::string::npos ? 0 : col.size() - dot - 1);
+        TEST_ASSERT_FLOAT_WITHIN(lsb * 0.51f, d.sensors[ch].value, strtof(col.c_str(), nullptr));
+    }
+}
+
+void setUp() {
+    Serial.setMuted(true);
+    LittleFS.format();
+}
+
+void tearDown() {
+    Serial.setMuted(false);
+}
+
+void test_parse_range() {
+    const uint32_t size = 1000;
+    uint32_t first = 7;
+    uint32_t last = 7;
+    struct Case {
+        const char* header;
+        RangeResult result;
+        uint32_t first;
+        uint32_t last;
+    };
+    const Case cases[] = {
+        { "bytes=0-99", RANGE_OK, 0, 99 },
+        { "bytes=100-", RANGE_OK, 100, 999 },
+        { "bytes=999-999", RANGE_OK, 999, 999 },
+        { "bytes=500-5000", RANGE_OK, 500, 999 },       // Clipped to the file
+        { "bytes=-50", RANGE_OK, 950, 999 },
+        { "bytes=-5000", RANGE_OK, 0, 999 },
+        { "bytes=1000-", RANGE_UNSATISFIABLE, 0, 0 },
+        { "bytes=4294967296-", RANGE_UNSATISFIABLE, 0, 0 },
+        { "bytes=5-2", RANGE_UNSATISFIABLE, 0, 0 },
+        { "bytes=-0", RANGE_UNSATISFIABLE, 0, 0 },
+        { "bytes=0-1,5-6", RANGE_NONE, 0, 0 },          // Several ranges: whole file
+        { "items=0-1", RANGE_NONE, 0, 0 },
+        { "bytes=", RANGE_NONE, 0, 0 },
+        { "bytes=-", RANGE_NONE, 0, 0 },
+        { "bytes=abc", RANGE_NONE, 0, 0 },
+        { "bytes=5-x", RANGE_NONE, 0, 0 },
+    };
+    for (const Case& c : cases) {
+        first = last = 7;
+        const RangeResult r = SessionExport::parseRange(c.header, size, first, last);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(c.result, r, c.header);
+        if (r == RANGE_OK) {
+            TEST_ASSERT_EQUAL_UINT32_MESSAGE(c.first, first, c.header);
+            TEST_ASSERT_EQUAL_UINT32_MESSAGE(c.last, last, c.header);
+        }
+    }
+}
+
+void test_raw_export() {
+    SessionStore store;
+    TEST_ASSERT_TRUE(store.begin(LittleFS));
+    const uint32_t id = record(store, RECORDS);
+    const std::string file = fileBytes(id);
+    TEST_ASSERT_GREATER_THAN(SessionFileHeader::SIZE, file.size());
+
+    const size_t chunks[] = { 1, 100, SessionExport::BLOCK_SIZE, 4096 };
+    for (size_t chunk : chunks) {
+        SessionExport out(LittleFS, id, SESSION_EXPORT_RAW);
+        TEST_ASSERT_TRUE(out.isOpen());
+        TEST_ASSERT_EQUAL_UINT32(file.size(), out.size());
+        TEST_ASSERT_TRUE_MESSAGE(readAll(out, chunk) == file, "raw export differs from the file");
+    }
+    SessionExport missing(LittleFS, id + 1, SESSION_EXPORT_RAW);
+    TEST_ASSERT_FALSE(missing.isOpen());
+    TEST_ASSERT_EQUAL_UINT32(0, missing.read(nullptr, 0));
+}
+
+void test_range_resume() {
+    SessionStore store;
+    TEST_ASSERT_TRUE(store.begin(LittleFS));
+    const uint32_t id = record(store, RECORDS);
+    const std::string file = fileBytes(id);
+    const uint32_t size = (uint32_t)file.size();
+
+    // A download that broke after 1000 bytes, resumed with "bytes=1000-"
+    std::string got;
+    {
+        SessionExport out(LittleFS, id, SESSION_EXPORT_RAW);
+        uint8_t buf[250];
+        while (got.size() < 1000) {
+            const size_t n = out.read(buf, sizeof(buf));
+            TEST_ASSERT_TRUE(n > 0);
+            got.append((const char*)buf, n);
+        }
+    }
+    uint32_t first;
+    uint32_t last;
+    TEST_ASSERT_EQUAL_INT(RANGE_OK, SessionExport::parseRange("bytes=1000-", size, first, last));
+    SessionExport resumed(LittleFS, id, SESSION_EXPORT_RAW);
+    TEST_ASSERT_TRUE(resumed.setRange(first, last));
+    got += readAll(resumed, 700);
+    TEST_ASSERT_TRUE_MESSAGE(got == file, "resumed download differs from the file");
+
+    // Inner ranges give exactly their bytes
+    const uint32_t ranges[][2] = { { 0, 0 }, { 0, 15 }, { 16, 1039 }, { size - 1, size - 1 }, { 123, size - 2 } };
+    for (const auto& r : ranges) {
+        SessionExport out(LittleFS, id, SESSION_EXPORT_RAW);
+        TEST_ASSERT_TRUE(out.setRange(r[0], r[1]));
+        TEST_ASSERT_TRUE(readAll(out, 333) == file.substr(r[0], r[1] - r[0] + 1));
+    }
+
+    // Ranges the file cannot serve are refused, not served in full
+    SessionExport out(LittleFS, id, SESSION_EXPORT_RAW);
+    TEST_ASSERT_FALSE(out.setRange(0, size));
+    TEST_ASSERT_FALSE(out.setRange(size, size));
+    TEST_ASSERT_FALSE(out.setRange(10, 9));
+    SessionExport csv(LittleFS, id, SESSION_EXPORT_CSV);
+    TEST_ASSERT_FALSE(csv.setRange(0, 10));
+}
+
+void test_csv_export() {
+    SessionStore store;
+    TEST_ASSERT_TRUE(store.begin(LittleFS));
+    const uint32_t id = record(store, RECORDS);
+
+    SessionExport out(LittleFS, id, SESSION_EXPORT_CSV);
+    TEST_ASSERT_TRUE(out.isOpen());
+    const std::string text = readAll(out, 4096);
+    const std::vector<std::string> rows = lines(text);
+    TEST_ASSERT_EQUAL_UINT32(1 + RECORDS, rows.size());
+    std::string header = "time_ms,time_us,co2_waveform,fco2,fetco2,rr,status1,status2,valid";
+    for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+        header += ",";
+        header += Sensors::info(ch).key;
+    }
+    TEST_ASSERT_EQUAL_STRING(header.c_str(), rows[0].c_str());
+    for (uint32_t i = 0; i < RECORDS; i++) {
+        checkLine(rows[1 + i], i);
+    }
+
+    // Small reads (chunked HTTP) give the same text
+    SessionExport small(LittleFS, id, SESSION_EXPORT_CSV);
+    TEST_ASSERT_TRUE(readAll(small, 7) == text);
+}
+
+void test_truncated_session() {
+    // A reset during recording leaves the header open and the last block
+    // cut; copy such a file as session 7
+    SessionStore store;
+    TEST_ASSERT_TRUE(store.begin(LittleFS));
+    const uint32_t id = record(store, 100, false);     // 3 blocks written, 4 records pending
+    const std::string open = fileBytes(id);
+    store.stopRecording();
+
+    uint32_t blockEnd[4];
+    {
+        uint32_t pos = SessionFileHeader::SIZE;
+        for (uint8_t b = 0; b < 3; b++) {
+            const size_t len = SessionDecoder::blockLength((const uint8_t*)open.data() + pos);
+            TEST_ASSERT_TRUE(len > 0);
+            pos += len;
+            blockEnd[b] = pos;
+        }
+        TEST_ASSERT_EQUAL_UINT32(open.size(), blockEnd[2]);
+    }
+    const std::string cut = open.substr(0, blockEnd[1] + (blockEnd[2] - blockEnd[1]) / 2);
+    char name[32];
+    SessionStore::path(7, name, sizeof(name));
+    File f = LittleFS.open(name, FILE_WRITE);
+    TEST_ASSERT_EQUAL_UINT32(cut.size(), f.write((const uint8_t*)cut.data(), cut.size()));
+    f.close();
+
+    // Listed with its two whole blocks (scanned), the next id follows it
+    SessionStore restarted;
+    TEST_ASSERT_TRUE(restarted.begin(LittleFS));
+    StringPrint json;
+    restarted.printJson(json);
+    char expect[96];
+    snprintf(expect, sizeof(expect), "{\"id\":7,\"bytes\":%lu,\"records\":64,\"duration_ms\":%lu,\"recording\":false}",
+             (unsigned long)cut.size(), (unsigned long)(63 * 125));
+    TEST_ASSERT_TRUE_MESSAGE(json.text.find(expect) != std::string::npos, json.text.c_str());
+    TEST_ASSERT_TRUE(restarted.startRecording());
+    TEST_ASSERT_EQUAL_UINT32(8, restarted.getRecordingId());
+    restarted.stopRecording();
+
+    // CSV stops after the last whole block; raw gives the file as it is
+    SessionExport csv(LittleFS, 7, SESSION_EXPORT_CSV);
+    TEST_ASSERT_TRUE(csv.isOpen());
+    const std::vector<std::string> rows = lines(readAll(csv, 512));
+    TEST_ASSERT_EQUAL_UINT32(1 + 64, rows.size());
+    for (uint32_t i = 0; i < 64; i++) {
+        checkLine(rows[1 + i], i);
+    }
+    SessionExport raw(LittleFS, 7, SESSION_EXPORT_RAW);
+    TEST_ASSERT_TRUE(readAll(raw, 1024) == cut);
+
+    // A file cut inside its header cannot be converted
+    SessionStore::path(9, name, sizeof(name));
+    f = LittleFS.open(name, FILE_WRITE);
+    f.write((const uint8_t*)open.data(), SessionFileHeader::SIZE - 1);
+    f.close();
+    SessionExport broken(LittleFS, 9, SESSION_EXPORT_CSV);
+    TEST_ASSERT_FALSE(broken.isOpen());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_parse_range);
+    RUN_TEST(test_raw_export);
+    RUN_TEST(test_range_resume);
+    RUN_TEST(test_csv_export);
+    RUN_TEST(test_truncated_session);
+    return UNITY_END();
+}
@@ -0,0 +1,281 @@
+// test_timeline
+// Every parsed packet reaches SampleTimeline, also when packets arrive in bursts
+// The emulator feeds MaCO2Parser on a VirtualClock and a loop() stand-in
+// drains up to MAX_PACKETS packets per data update, pushing each one. Stalled
+// loops, rate multipliers up to 12x and a reader cursor check that the
+// timeline holds one sample per packet, in order (by its us packet time),
+// without gaps. The stress
+// case runs the writer and four readers on threads; build it with
+// -fsanitize=thread to check the ring for races. Use clang for that: GCC's
+// ThreadSanitizer does not model atomic_thread_fence (-Wtsan), which the
+// BroadcastRing seqlock relies on, and reports nothing about it.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <atomic>
+#include <thread>
+#include "MaCO2Emulator.h"
+#include "SampleTimeline.h"
+
+static const uint32_t DATA_INTERVAL_MS = 100;   // As in main.cpp
+static const uint8_t MAX_PACKETS = 10;          // MAX_PACKETS_PER_LOOP
+
+static VirtualClock* clock_;
+static MaCO2Emulator* emulator;
+static MaCO2Parser* parser;
+static SampleTimeline* timeline;
+
+void setUp() {
+    clock_ = new VirtualClock();
+    emulator = new MaCO2Emulator();
+    parser = new MaCO2Parser();
+    timeline = new SampleTimeline();
+    emulator->setClock(clock_);
+    parser->setClock(clock_);
+    clock_->advance(1000000);       // Packet times reach back before the first arrival
+}
+
+void tearDown() {
+    delete timeline;
+    delete parser;
+    delete emulator;
+    delete clock_;
+}
+
+static void startEmulator(float rate_multiplier) {
+    EmulatorConfig config = MaCO2Emulator::defaultConfig();
+    config.handshake = false;
+    config.rate_multiplier = rate_multiplier;
+    emulator->begin(config);
+}
+
+// One data update of loop(); returns the packets handled
+static uint8_t dataUpdate(CO2Data& data) {
+    uint8_t packets = 0;
+    while (packets < MAX_PACKETS && parser->parsePacket(*emulator, data)) {
+        packets++;
+        timeline->push(data);
+    }
+    return packets;
+}
+
+// Every packet in the timeline once, in arrival order
+static void checkTimeline(uint32_t expected) {
+    TEST_ASSERT_EQUAL_UINT32(expected, timeline->head());
+    TEST_ASSERT_EQUAL_UINT32(expected, parser->getPacketCount());
+    TimelineCursor cursor = timeline->attach(true);
+    CO2Data out;
+    uint32_t n = 0;
+    uint64_t last = 0;
+    while (timeline->read(cursor, out)) {
+        // Microsecond packet time, strictly increasing, consistent with ms
+        TEST_ASSERT_TRUE(n == 0 || out.timestamp_us > last);
+        TEST_ASSERT_EQUAL_UINT32((uint32_t)(out.timestamp_us / 1000), out.timestamp);
+        last = out.timestamp_us;
+        n++;
+    }
+    const uint32_t held = expected < SampleTimeline::CAPACITY ? expected : SampleTimeline::CAPACITY;
+    TEST_ASSERT_EQUAL_UINT32(held, n);
+    TEST_ASSERT_EQUAL_UINT32(0, cursor.dropped);
+}
+
+// 8 Hz packets, 10 Hz updates: one packet per update, sometimes none
+void test_one_packet_per_update() {
+    startEmulator(1.0f);
+    CO2Data data;
+    memset(&data, 0, sizeof(data));
+    uint32_t maxBurst = 0;
+    for (uint32_t t = 0; t < 60000; t += DATA_INTERVAL_MS) {
+        clock_->advance(DATA_INTERVAL_MS * 1000);
+        const uint8_t n = dataUpdate(data);
+        if (n > maxBurst) maxBurst = n;
+    }
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(2, maxBurst);
+    TEST_ASSERT_UINT32_WITHIN(1, 480, emulator->getStats().packets);
+    checkTimeline(parser->getPacketCount());
+    TEST_ASSERT_EQUAL_UINT32(0, parser->getErrorCount());
+}
+
+// loop() blocked for 1 s: the next updates drain the backlog packet by packet
+void test_stalled_loop_catches_up() {
+    startEmulator(1.0f);
+    CO2Data data;
+    memset(&data, 0, sizeof(data));
+    uint32_t bursts = 0, maxBurst = 0;
+    for (uint32_t t = 0; t < 30000; t += DATA_INTERVAL_MS) {
+        // Every 5 s the loop stalls for 1 s (WiFi reconnect, file flush)
+        const uint32_t step = (t % 5000 == 0) ? 1000 : DATA_INTERVAL_MS;
+        clock_->advance(step * 1000);
+        t += step - DATA_INTERVAL_MS;
+        const uint8_t n = dataUpdate(data);
+        if (n > 1) bursts++;
+        if (n > maxBurst) maxBurst = n;
+    }
+    char line[80];
+    snprintf(line, sizeof(line), "%lu bursts, largest %lu packets in one update",
+             (unsigned long)bursts, (unsigned long)maxBurst);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(6, bursts);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(8, maxBurst);
+    TEST_ASSERT_EQUAL_UINT32(0, emulator->getStats().overflowBytes);
+    checkTimeline(parser->getPacketCount());
+    TEST_ASSERT_UINT32_WITHIN(1, emulator->getStats().packets, timeline->head());
+}
+
+// Packet rate above the update rate: bursts every update, none dropped
+void test_rate_stress() {
+    const float rates[] = { 2.0f, 4.0f, 8.0f, 12.0f };
+    for (float rate : rates) {
+        tearDown();
+        setUp();
+        startEmulator(rate);
+        CO2Data data;
+        memset(&data, 0, sizeof(data));
+        for (uint32_t t = 0; t < 20000; t += DATA_INTERVAL_MS) {
+            clock_->advance(DATA_INTERVAL_MS * 1000);
+            dataUpdate(data);
+        }
+        char line[100];
+        snprintf(line, sizeof(line), "%4.0fx (%3.0f Hz): %lu packets generated, %lu in the timeline",
+                 rate, 8.0f * rate, (unsigned long)emulator->getStats().packets,
+                 (unsigned long)timeline->head());
+        TEST_MESSAGE(line);
+        TEST_ASSERT_EQUAL_UINT32(0, emulator->getStats().overflowBytes);
+        TEST_ASSERT_EQUAL_UINT32(0, parser->getErrorCount());
+        TEST_ASSERT_UINT32_WITHIN(1, emulator->getStats().packets, timeline->head());
+        checkTimeline(parser->getPacketCount());
+    }
+}
+
+// A reader polling slower than the writer keeps up through bursts
+void test_reader_sees_every_burst_sample() {
+    startEmulator(8.0f);
+    CO2Data data, out;
+    memset(&data, 0, sizeof(data));
+    TimelineCursor cursor = timeline->attach();
+    uint32_t read = 0;
+    for (uint32_t t = 0; t < 20000; t += DATA_INTERVAL_MS) {
+        clock_->advance(DATA_INTERVAL_MS * 1000);
+        dataUpdate(data);
+        if ((t / DATA_INTERVAL_MS) % 5 == 0) {      // Web / host output at 2 Hz
+            while (timeline->read(cursor, out)) read++;
+        }
+    }
+    while (timeline->read(cursor, out)) read++;
+    TEST_ASSERT_EQUAL_UINT32(timeline->head(), read);
+    TEST_ASSERT_EQUAL_UINT32(0, cursor.overruns);
+}
+
+// Sample whose every field is derived from its sequence number
+static void makeSample(uint32_t seq, CO2Data& data) {
+    data.timestamp_us = ((uint64_t)seq << 20) | 0x55;
+    data.timestamp = seq;
+    data.co2_waveform = (uint16_t)(seq * 3);
+    data.fco2 = (uint8_t)seq;
+    data.fetco2 = (uint8_t)(seq >> 8);
+    data.respiratory_rate = (uint8_t)(seq >> 16);
+    data.status1 = (uint8_t)(seq * 5);
+    data.status2 = (uint8_t)(seq * 7);
+    data.valid = (seq & 1) != 0;
+    for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+        data.sensors[ch].value = (float)(seq & 0xFFFFF) + ch;
+        data.sensors[ch].pic = (uint16_t)(seq + ch);
+    }
+}
+
+static bool intact(uint32_t seq, const CO2Data& data) {
+    CO2Data ref;
+    makeSample(seq, ref);
+    bool ok = data.timestamp_us == ref.timestamp_us && data.timestamp == ref.timestamp &&
+              data.co2_waveform == ref.co2_waveform &&
+              data.fco2 == ref.fco2 && data.fetco2 == ref.fetco2 &&
+              data.respiratory_rate == ref.respiratory_rate && data.status1 == ref.status1 &&
+              data.status2 == ref.status2 && data.valid == ref.valid;
+    for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+        ok = ok && data.sensors[ch].value == ref.sensors[ch].value &&
+             data.sensors[ch].pic == ref.sensors[ch].pic;
+    }
+    return ok;
+}
+
+// Writer and readers on their own threads, readers lapped now and then
+void test_concurrent_readers_stress() {
+    static const uint32_t PUSHES = 400000;
+    static const int CURSOR_READERS = 3;
+    std::atomic<bool> done(false);
+    std::atomic<uint32_t> torn(0), disorder(0);
+    uint32_t reads[CURSOR_READERS], peeks = 0;
+    TimelineCursor cursors[CURSOR_READERS];
+    for (int r = 0; r < CURSOR_READERS; r++) {
+        cursors[r] = timeline->attach();
+        reads[r] = 0;
+    }
+
+    std::thread readers[CURSOR_READERS];
+    for (int r = 0; r < CURSOR_READERS; r++) {
+        readers[r] = std::thread([&, r]() {
+            CO2Data out;
+            uint32_t next = 0;
+            for (;;) {
+                const bool finished = done.load(std::memory_order_acquire);
+                while (timeline->read(cursors[r], out)) {
+                    const uint32_t seq = cursors[r].seq - 1;
+                    if (!intact(seq, out)) torn++;
+                    if (seq < next) disorder++;
+                    next = seq + 1;
+                    reads[r]++;
+                }
+                if (finished) break;
+            }
+        });
+    }
+    std::thread peeker([&]() {
+        TimelineSample sample;
+        uint32_t rng = 7;
+        while (!done.load(std::memory_order_acquire)) {
+            rng = rng * 1664525u + 1013904223u;
+            const uint32_t seq = timeline->oldest() + (rng >> 8) % SampleTimeline::CAPACITY;
+            if (timeline->sampleAt(seq, sample)) {
+                if (sample.timestamp != seq || sample.co2_waveform != (uint16_t)(seq * 3) ||
+                    sample.sensor_pic[0] != (uint16_t)seq) {
+                    torn++;
+                }
+                peeks++;
+            }
+        }
+    });
+
+    CO2Data data;
+    memset(&data, 0, sizeof(data));
+    for (uint32_t seq = 0; seq < PUSHES; seq++) {
+        makeSample(seq, data);
+        TEST_ASSERT_EQUAL_UINT32(seq, timeline->push(data));
+        if ((seq & 255) == 0) std::this_thread::yield();
+    }
+    done.store(true, std::memory_order_release);
+    for (int r = 0; r < CURSOR_READERS; r++) readers[r].join();
+    peeker.join();
+
+    char line[160];
+    for (int r = 0; r < CURSOR_READERS; r++) {
+        snprintf(line, sizeof(line), "reader %d: %lu read, %lu dropped in %lu overruns", r,
+                 (unsigned long)reads[r], (unsigned long)cursors[r].dropped,
+                 (unsigned long)cursors[r].overruns);
+        TEST_MESSAGE(line);
+        TEST_ASSERT_EQUAL_UINT32(PUSHES, reads[r] + cursors[r].dropped);
+    }
+    snprintf(line, sizeof(line), "sampleAt: %lu intact samples", (unsigned long)peeks);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL_UINT32(0, torn.load());
+    TEST_ASSERT_EQUAL_UINT32(0, disorder.load());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_one_packet_per_update);
+    RUN_TEST(test_stalled_loop_catches_up);
+    RUN_TEST(test_rate_stress);
+    RUN_TEST(test_reader_sees_every_burst_sample);
+    RUN_TEST(test_concurrent_readers_stress);
+    return UNITY_END();
+}
@@ -0,0 +1,381 @@
+// test_tracer
+// Tracer ring and TraceExport in a -DTRACING=1 build (pio test -e native_tracing)
+// Two threads record nested scopes at the same time. The export must parse
+// as trace_event JSON: one thread_name track per thread and every event of
+// both, with B/E pairs balanced and properly nested per track and times
+// non-decreasing per track. Chunked reads with small buffers (as the
+// chunked /api/trace response makes) must give the same bytes as
+// dumpJson(). A full ring exports its last EVENTS events, recording pauses
+// while an export exists, and an event must cost less than
+// MAX_EVENT_NS on the host.
+
+#ifndef TRACING
+#error "test_tracer needs -DTRACING=1 (pio test -e native_tracing)"
+#endif
+
+#include <Arduino.h>
+#include <unity.h>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Tracer.h"
+
+static const uint32_t SCOPES = 150;             // Per thread, 4 events each
+static const double MAX_EVENT_NS = 1000;        // Host; the device takes 0.1-0.3 us
+
+// Minimal JSON document, enough to check the export's structure
+struct Json {
+    enum Type { NUL, BOOL, NUMBER, STRING, ARRAY, OBJECT };
+    Type type = NUL;
+    double number = 0;
+    std::string string;
+    std::vector<Json> items;
+    std::vector<std::pair<std::string, Json>> members;
+
+    const Json* get(const char* key) const {
+        for (const auto& m : members) {
+            if (m.first == key) return &m.second;
+        }
+        return nullptr;
+    }
+};
+
+class JsonParser {
+public:
+    explicit JsonParser(const std::string& text) : _s(text), _pos(0) {}
+
+    // Whole text is one value (trailing whitespace allowed)
+    bool parse(Json& out) {
+        if (!value(out)) return false;
+        skipSpace();
+        return _pos == _s.size();
+    }
+
+private:
+    const std::string& _s;
+    size_t _pos;
+
+    void skipSpace() {
+        while (_pos < _s.size() && strchr(" \t\r\n", _s[_pos]) != nullptr) _pos++;
+    }
+
+    bool literal(const char* word) {
+        const size_t n = strlen(word);
+        if (_s.compare(_pos, n, word) != 0) return false;
+        _pos += n;
+        return true;
+    }
+
+    bool string(std::string& out) {
+        if (_pos >= _s.size() || _s[_pos] != '"') return false;
+        _pos++;
+        while (_pos < _s.size() && _s[_pos] != '"') {
+            char c = _s[_pos++];
+            if ((uint8_t)c < 0x20) return false;
+            if (c == '\\') {
+                if (_pos >= _s.size()) return false;
+                c = _s[_pos++];
+                if (strchr("\"\\/bfnrt", c) == nullptr) return false;   // No \u in the export
+            }
+            out += c;
+        }
+        if (_pos >= _s.size()) return false;
+        _pos++;
+        return true;
+    }
+
+    bool value(Json& out) {
+        skipSpace();
+        if (_pos >= _s.size()) return false;
+        const char c = _s[_pos];
+        if (c == '{') {
+            out.type = Json::OBJECT;
+            _pos++;
+            skipSpace();
+            if (_pos < _s.size() && _s[_pos] == '}') {
+                _pos++;
+                return true;
+            }
+            for (;;) {
+                skipSpace();
+                std::pair<std::string, Json> member;
+                if (!string(member.first)) return false;
+                skipSpace();
+                if (_pos >= _s.size() || _s[_pos++] != ':') return false;
+                if (!value(member.second)) return false;
+                out.members.push_back(member);
+                skipSpace();
+                if (_pos >= _s.size()) return false;
+                if (_s[_pos] == '}') {
+                    _pos++;
+                    return true;
+                }
+                if (_s[_pos++] != ',') return false;
+            }
+        }
+        if (c == '[') {
+            out.type = Json::ARRAY;
+            _pos++;
+            skipSpace();
+            if (_pos < _s.size() && _s[_pos] == ']') {
+                _pos++;
+                return true;
+            }
+            for (;;) {
+                Json item;
+                if (!value(item)) return false;
+                out.items.push_back(item);
+                skipSpace();
+                if (_pos >= _s.size()) return false;
+                if (_s[_pos] == ']') {
+                    _pos++;
+                    return true;
+                }
+                if (_s[_pos++] != ',') return false;
+            }
+        }
+        if (c == '"') {
+            out.type = Json::STRING;
+            return string(out.string);
+        }
+        if (literal("true") || literal("false")) {
+            out.type = Json::BOOL;
+            return true;
+        }
+        if (literal("null")) {
+            return true;
+        }
+        const char* start = _s.c_str() + _pos;
+        char* end;
+        out.number = strtod(start, &end);
+        if (end == start) return false;
+        out.type = Json::NUMBER;
+        _pos += end - start;
+        return true;
+    }
+};
+
+// dumpJson() output
+class StringPrint : public Print {
+public:
+    std::string text;
+    size_t write(uint8_t b) override {
+        text += (char)b;
+        return 1;
+    }
+    using Print::write;
+};
+
+static void message(const char* line) {
+    TEST_MESSAGE(line);
+}
+
+static std::string dump() {
+    StringPrint out;
+    Tracer::dumpJson(out);
+    TEST_ASSERT_TRUE(out.text.size() >= 2);
+    TEST_ASSERT_EQUAL_STRING("\r\n", out.text.c_str() + out.text.size() - 2);
+    out.text.resize(out.text.size() - 2);
+    return out.text;
+}
+
+static std::string exportChunked(size_t chunk) {
+    TraceExport trace;
+    std::vector<uint8_t> buf(chunk);
+    std::string text;
+    size_t len;
+    while ((len = trace.read(buf.data(), chunk)) > 0) {
+        TEST_ASSERT_TRUE(len <= chunk);
+        text.append((const char*)buf.data(), len);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, trace.read(buf.data(), chunk));     // Stays done
+    return text;
+}
+
+// Parse an export; traceEvents, split into metadata and B/E events
+struct Trace {
+    std::map<uint32_t, std::string> tracks;     // tid -> thread_name
+    std::vector<const Json*> events;
+    Json doc;
+};
+
+static void parseTrace(const std::string& text, Trace& trace) {
+    TEST_ASSERT_TRUE_MESSAGE(JsonParser(text).parse(trace.doc), "export is not valid JSON");
+    TEST_ASSERT_EQUAL_INT(Json::OBJECT, trace.doc.type);
+    const Json* unit = trace.doc.get("displayTimeUnit");
+    TEST_ASSERT_TRUE(unit != nullptr && unit->type == Json::STRING);
+    const Json* events = trace.doc.get("traceEvents");
+    TEST_ASSERT_TRUE_MESSAGE(events != nullptr && events->type == Json::ARRAY, "no traceEvents array");
+    for (const Json& e : events->items) {
+        TEST_ASSERT_EQUAL_INT(Json::OBJECT, e.type);
+        const Json* name = e.get("name");
+        const Json* ph = e.get("ph");
+        const Json* pid = e.get("pid");
+        const Json* tid = e.get("tid");
+        TEST_ASSERT_TRUE(name != nullptr && name->type == Json::STRING);
+        TEST_ASSERT_TRUE(ph != nullptr && ph->type == Json::STRING && ph->string.size() == 1);
+        TEST_ASSERT_TRUE(pid != nullptr && pid->type == Json::NUMBER);
+        TEST_ASSERT_TRUE(tid != nullptr && tid->type == Json::NUMBER);
+        if (ph->string == "M") {
+            // Metadata comes first, one per track
+            TEST_ASSERT_EQUAL_STRING("thread_name", name->string.c_str());
+            TEST_ASSERT_TRUE_MESSAGE(trace.events.empty(), "metadata after events");
+            const Json* args = e.get("args");
+            TEST_ASSERT_TRUE(args != nullptr && args->get("name") != nullptr);
+            TEST_ASSERT_TRUE_MESSAGE(trace.tracks.count((uint32_t)tid->number) == 0, "track named twice");
+            trace.tracks[(uint32_t)tid->number] = args->get("name")->string;
+        } else {
+            TEST_ASSERT_TRUE(ph->string == "B" || ph->string == "E");
+            const Json* ts = e.get("ts");
+            TEST_ASSERT_TRUE(ts != nullptr && ts->type == Json::NUMBER);
+            TEST_ASSERT_TRUE_MESSAGE(trace.tracks.count((uint32_t)tid->number) == 1, "event on an unnamed track");
+            trace.events.push_back(&e);
+        }
+    }
+}
+
+// Per track: B/E nest (each E closes the innermost open B of that name),
+// nothing stays open and times do not go back. Returns the tracks seen.
+static uint32_t checkBalanced(const Trace& trace) {
+    std::map<uint32_t, std::vector<std::string>> open;
+    std::map<uint32_t, double> lastTs;
+    for (const Json* e : trace.events) {
+        const uint32_t tid = (uint32_t)e->get("tid")->number;
+        const std::string& name = e->get("name")->string;
+        const double ts = e->get("ts")->number;
+        TEST_ASSERT_TRUE(ts >= 0);
+        if (lastTs.count(tid) != 0) {
+            TEST_ASSERT_TRUE_MESSAGE(ts >= lastTs[tid], "time goes back on a track");
+        }
+        lastTs[tid] = ts;
+        std::vector<std::string>& stack = open[tid];
+        if (e->get("ph")->string == "B") {
+            stack.push_back(name);
+        } else {
+            TEST_ASSERT_TRUE_MESSAGE(!stack.empty(), "E without B");
+            TEST_ASSERT_EQUAL_STRING(stack.back().c_str(), name.c_str());
+            stack.pop_back();
+        }
+    }
+    for (const auto& t : open) {
+        TEST_ASSERT_TRUE_MESSAGE(t.second.empty(), "B without E");
+    }
+    return (uint32_t)open.size();
+}
+
+static std::atomic<uint8_t> ready;
+
+static void worker(const char* track, const char* inner) {
+    Tracer::nameTask(track);
+    ready.fetch_add(1);
+    while (ready.load() < 2) std::this_thread::yield();
+    for (uint32_t i = 0; i < SCOPES; i++) {
+        TRACE_SCOPE("outer");
+        {
+            TRACE_SCOPE(inner);
+            if ((i & 3) == 0) std::this_thread::yield();    // Interleave on one core
+        }
+    }
+}
+
+void setUp() {
+    Serial.setMuted(true);
+    Tracer::clear();
+}
+
+void tearDown() {
+    Serial.setMuted(false);
+}
+
+void test_two_threads_export_parses() {
+    TEST_ASSERT_TRUE(Tracer::isEnabled());
+    ready = 0;
+    std::thread a(worker, "worker_a", "inner_a");
+    std::thread b(worker, "worker_b", "inner_b");
+    a.join();
+    b.join();
+
+    Trace trace;
+    parseTrace(dump(), trace);
+    TEST_ASSERT_EQUAL_UINT32(2 * SCOPES * 4, trace.events.size());
+    TEST_ASSERT_EQUAL_UINT32(2, checkBalanced(trace));
+    TEST_ASSERT_EQUAL_UINT32(2, trace.tracks.size());
+
+    // Each track holds only its thread's scopes
+    std::map<std::string, uint32_t> perTrack;
+    for (const Json* e : trace.events) {
+        const std::string& track = trace.tracks[(uint32_t)e->get("tid")->number];
+        const std::string& name = e->get("name")->string;
+        if (name != "outer") {
+            TEST_ASSERT_EQUAL_STRING(track.c_str() + strlen("worker_"), name.c_str() + strlen("inner_"));
+        }
+        perTrack[track]++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(SCOPES * 4, perTrack["worker_a"]);
+    TEST_ASSERT_EQUAL_UINT32(SCOPES * 4, perTrack["worker_b"]);
+}
+
+void test_chunked_export_matches_dump() {
+    ready = 0;
+    std::thread a(worker, "worker_a", "inner_a");
+    std::thread b(worker, "worker_b", "inner_b");
+    a.join();
+    b.join();
+
+    const std::string whole = dump();
+    const size_t chunks[] = { 1, 2, 7, 64, 159, 160, 161, 1460, 65536 };
+    for (size_t chunk : chunks) {
+        const std::string text = exportChunked(chunk);
+        TEST_ASSERT_EQUAL_UINT32(whole.size(), text.size());
+        TEST_ASSERT_TRUE_MESSAGE(text == whole, "chunked export differs from dumpJson()");
+    }
+}
+
+void test_full_ring_and_pause() {
+    // 3000 scopes: the ring keeps the last EVENTS events
+    for (uint32_t i = 0; i < 3000; i++) {
+        TRACE_SCOPE("wrap");
+    }
+    Trace trace;
+    parseTrace(dump(), trace);
+    TEST_ASSERT_EQUAL_UINT32(Tracer::EVENTS, trace.events.size());
+    TEST_ASSERT_EQUAL_STRING("B", trace.events.front()->get("ph")->string.c_str());
+    TEST_ASSERT_EQUAL_UINT32(1, checkBalanced(trace));
+
+    // Nothing is recorded while an export exists; clear() empties the ring
+    Tracer::clear();
+    {
+        TraceExport pausing;
+        TRACE_SCOPE("paused");
+    }
+    Trace empty;
+    parseTrace(dump(), empty);
+    TEST_ASSERT_EQUAL_UINT32(0, empty.events.size());
+}
+
+void test_event_cost() {
+    const uint32_t scopes = 200000;
+    const auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < scopes; i++) {
+        Tracer::begin("cost");
+        Tracer::end("cost");
+    }
+    const double ns = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - start).count() / (2.0 * scopes);
+    char line[64];
+    snprintf(line, sizeof(line), "%.1f ns per event", ns);
+    message(line);
+    TEST_ASSERT_LESS_THAN(MAX_EVENT_NS, ns);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_two_threads_export_parses);
+    RUN_TEST(test_chunked_export_matches_dump);
+    RUN_TEST(test_full_ring_and_pause);
+    RUN_TEST(test_event_cost);
+    return UNITY_END();
+}
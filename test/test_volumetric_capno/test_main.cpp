@@ -0,0 +1,190 @@
+// test_volumetric_capno
+// VolumetricCapno on a synthetic patient with a known sampling-line delay
+// Volume comes as the ADC's 100 Hz stream and CO2 as 8 Hz packets delayed
+// by the sampling line. The airway CO2 is a function of the expired volume
+// (Fowler dead space, phase II, sloping plateau), so VTE, VCO2 and VD are
+// known exactly. The high-rate path (addVolume / addCO2) is compared with
+// the per-packet path (addSample at 8 Hz), which is reported as reference.
+
+#include <Arduino.h>
+#include <unity.h>
+#include "VolumetricCapno.h"
+
+static const float PERIOD_MS = 5000.0f;     // 12 breaths/min
+static const float TI_MS = 2000.0f;         // Inspiration first, then expiration
+static const float VT_ML = 500.0f;
+static const float VD_ML = 150.0f;          // Fowler dead space (50% of phase II)
+static const float PHASE2_ML = 60.0f;       // Width of the phase II rise
+static const float PLATEAU_MMHG = 36.0f;    // At the end of phase II
+static const float SLOPE_MMHG_PER_ML = 0.008f;
+static const float BARO_MMHG = 760.0f;
+
+static const uint32_t VOLUME_PERIOD_US = 10000;     // 100 Hz stream
+static const uint32_t PACKET_PERIOD_US = 125000;    // 8 Hz packets
+static const uint64_t START_US = 1000000;
+
+// Volume above the end-inspiratory level, expiration positive
+static float volumeAt(float t_ms) {
+    const float u = fmodf(t_ms, PERIOD_MS);
+    if (u < TI_MS) {
+        return VT_ML * 0.5f * (1.0f + cosf(3.14159265f * u / TI_MS));
+    }
+    return VT_ML * 0.5f * (1.0f - cosf(3.14159265f * (u - TI_MS) / (PERIOD_MS - TI_MS)));
+}
+
+static bool expiring(float t_ms) {
+    return fmodf(t_ms, PERIOD_MS) >= TI_MS;
+}
+
+// Airway CO2 as a function of the volume expired so far
+static float co2OfExpired(float e_ml) {
+    const float x = (e_ml - (VD_ML - PHASE2_ML / 2)) / PHASE2_ML;
+    if (x <= 0.0f) return 0.0f;
+    if (x >= 1.0f) return PLATEAU_MMHG + SLOPE_MMHG_PER_ML * (e_ml - (VD_ML + PHASE2_ML / 2));
+    return PLATEAU_MMHG * x * x * (3.0f - 2.0f * x);
+}
+
+static float airwayCO2(float t_ms) {
+    return expiring(t_ms) ? co2OfExpired(volumeAt(t_ms)) : 0.0f;
+}
+
+// VCO2 of one expiration: integral of PCO2 / Pb over the expired volume
+static float trueVCO2() {
+    float sum = 0.0f;
+    const float de = 0.01f;
+    for (float e = 0.0f; e < VT_ML; e += de) {
+        sum += co2OfExpired(e + de / 2) / BARO_MMHG * de;
+    }
+    return sum;
+}
+
+struct Result {
+    uint32_t breaths;
+    float delay_ms;
+    bool locked;
+    float vte_err;      // Mean absolute errors over the last breaths
+    float vco2_err;
+    float vd_err;
+};
+
+// 4 minutes of breathing through a sampling line with delay_ms transport
+static Result run(float delay_ms, bool highRate) {
+    VolumetricCapno capno;
+    capno.setBarometricPressure(BARO_MMHG);
+    Result r;
+    memset(&r, 0, sizeof(r));
+    const float vco2 = trueVCO2();
+    uint32_t scored = 0;
+    uint64_t nextPacket = START_US;
+
+    for (uint64_t t = START_US; t < START_US + 240000000ULL; t += VOLUME_PERIOD_US) {
+        const float t_ms = (t - START_US) / 1000.0f;
+        bool done = false;
+        if (highRate) {
+            done |= capno.addVolume(volumeAt(t_ms), (uint32_t)t);
+        }
+        if (t >= nextPacket) {
+            const float co2 = airwayCO2(t_ms - delay_ms);
+            if (highRate) {
+                done |= capno.addCO2(co2, 20.9f, t);
+            } else {
+                done |= capno.addSample(co2, volumeAt(t_ms), (uint32_t)(t / 1000), 20.9f);
+            }
+            nextPacket += PACKET_PERIOD_US;
+        }
+        if (done) {
+            r.breaths++;
+            const VolumetricBreath& b = capno.getLastBreath();
+            if (t_ms > 120000.0f) {            // After the correlator has locked
+                r.vte_err += fabsf(b.vte_ml - VT_ML);
+                r.vco2_err += fabsf(b.vco2_ml - vco2);
+                r.vd_err += fabsf(b.vd_fowler_ml - VD_ML);
+                scored++;
+            }
+        }
+    }
+    if (scored > 0) {
+        r.vte_err /= scored;
+        r.vco2_err /= scored;
+        r.vd_err /= scored;
+    }
+    r.delay_ms = capno.getDelayMs();
+    r.locked = capno.isDelayLocked();
+
+    char line[200];
+    snprintf(line, sizeof(line),
+             "%s, line delay %.0f ms: %lu breaths, delay %.0f ms (%s), |err| VTE %.1f mL  "
+             "VCO2 %.2f mL (of %.2f)  VD %.1f mL",
+             highRate ? "100 Hz" : "  8 Hz", delay_ms, (unsigned long)r.breaths, r.delay_ms,
+             r.locked ? "locked" : "default", r.vte_err, r.vco2_err, vco2, r.vd_err);
+    TEST_MESSAGE(line);
+    return r;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_high_rate_locks_delay_and_integrates() {
+    const Result r = run(600.0f, true);
+    TEST_ASSERT_UINT32_WITHIN(2, 48, r.breaths);
+    TEST_ASSERT_TRUE(r.locked);
+    TEST_ASSERT_FLOAT_WITHIN(40.0f, 600.0f, r.delay_ms);
+    TEST_ASSERT_LESS_OR_EQUAL(0.02f * VT_ML, r.vte_err);
+    TEST_ASSERT_LESS_OR_EQUAL(0.05f * trueVCO2(), r.vco2_err);
+    TEST_ASSERT_LESS_OR_EQUAL(10.0f, r.vd_err);
+}
+
+void test_long_sampling_line() {
+    const Result r = run(2000.0f, true);
+    TEST_ASSERT_TRUE(r.locked);
+    TEST_ASSERT_FLOAT_WITHIN(40.0f, 2000.0f, r.delay_ms);
+    TEST_ASSERT_LESS_OR_EQUAL(0.05f * trueVCO2(), r.vco2_err);
+}
+
+void test_high_rate_beats_packet_rate() {
+    const Result fast = run(600.0f, true);
+    const Result slow = run(600.0f, false);
+    TEST_ASSERT_LESS_OR_EQUAL(slow.vd_err, fast.vd_err);
+    TEST_ASSERT_LESS_OR_EQUAL(slow.vco2_err, fast.vco2_err);
+}
+
+// Packets stop: queued volume is processed with the last CO2 held
+void test_volume_without_packets_is_not_lost() {
+    VolumetricCapno capno;
+    capno.addCO2(0.0f, 20.9f, START_US);
+    uint32_t breaths = 0;
+    for (uint64_t t = START_US; t < START_US + 30000000ULL; t += VOLUME_PERIOD_US) {
+        breaths += capno.addVolume(volumeAt((t - START_US) / 1000.0f), (uint32_t)t);
+    }
+    TEST_ASSERT_UINT32_WITHIN(1, 5, breaths);
+    TEST_ASSERT_FLOAT_WITHIN(0.02f * VT_ML, VT_ML, capno.getLastBreath().vte_ml);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, capno.getLastBreath().vco2_ml);
+}
+
+// micros() wraps every 71 minutes; the 64-bit packet time does not
+void test_micros_wrap() {
+    VolumetricCapno capno;
+    const uint64_t base = 0xFFFFFFFFULL - 20000000ULL;     // Wraps after 20 s
+    uint64_t nextPacket = base;
+    uint32_t breaths = 0;
+    for (uint64_t t = base; t < base + 60000000ULL; t += VOLUME_PERIOD_US) {
+        const float t_ms = (t - base) / 1000.0f;
+        breaths += capno.addVolume(volumeAt(t_ms), (uint32_t)t);
+        if (t >= nextPacket) {
+            breaths += capno.addCO2(airwayCO2(t_ms), 20.9f, t);
+            nextPacket += PACKET_PERIOD_US;
+        }
+    }
+    TEST_ASSERT_UINT32_WITHIN(1, 12, breaths);
+    TEST_ASSERT_FLOAT_WITHIN(5.0f, PERIOD_MS, capno.getLastBreath().period_ms);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_high_rate_locks_delay_and_integrates);
+    RUN_TEST(test_long_sampling_line);
+    RUN_TEST(test_high_rate_beats_packet_rate);
+    RUN_TEST(test_volume_without_packets_is_not_lost);
+    RUN_TEST(test_micros_wrap);
+    return UNITY_END();
+}